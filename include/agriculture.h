@@ -58,6 +58,7 @@ typedef struct {
 
 /* Function prototypes */
 int agriculture_init(agriculture_system_t* ag, const system_config_t* config);
+int agriculture_apply_config(agriculture_system_t* ag, const system_config_t* config);
 void agriculture_update_measurements(agriculture_system_t* ag, system_measurements_t* measurements);
 bool agriculture_manage_irrigation(agriculture_system_t* ag, double available_power, 
                                   double battery_soc, bool grid_available);
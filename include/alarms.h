@@ -0,0 +1,98 @@
+#ifndef ALARMS_H
+#define ALARMS_H
+
+#include "core.h"
+#include <time.h>
+#include <stdbool.h>
+
+/* Alarm severity */
+typedef enum {
+    ALARM_SEVERITY_INFO = 0,
+    ALARM_SEVERITY_WARNING,
+    ALARM_SEVERITY_MAJOR,
+    ALARM_SEVERITY_CRITICAL
+} alarm_severity_t;
+
+/* Per-alarm state machine
+ *
+ *   INACTIVE --raise--> ACTIVE --ack--> ACKNOWLEDGED --clear--> INACTIVE
+ *                         |                  ^
+ *                       clear              raise
+ *                         v                  |
+ *                      CLEARED --ack--> INACTIVE  (latched until acknowledged)
+ */
+typedef enum {
+    ALARM_STATE_INACTIVE = 0,
+    ALARM_STATE_ACTIVE,             // condition present, not acknowledged
+    ALARM_STATE_ACKNOWLEDGED,       // condition present, acknowledged
+    ALARM_STATE_CLEARED             // condition gone, awaiting acknowledgement
+} alarm_state_t;
+
+/* Static alarm definition */
+typedef struct {
+    const char* name;
+    alarm_severity_t severity;
+    double raise_delay;             // seconds the condition must persist before raising
+    double clear_delay;             // seconds the condition must be absent before clearing
+    bool latching;                  // cleared alarms stay visible until acknowledged
+} alarm_definition_t;
+
+/* Runtime alarm entry */
+typedef struct {
+    alarm_state_t state;
+    bool condition;                 // latest raw (undebounced) input
+    bool pending;                   // debounce timer running (on the pending list)
+    time_t condition_since;         // when the raw input last changed
+    time_t first_seen;
+    time_t last_seen;
+    time_t last_transition;
+    time_t acknowledged_at;
+    uint32_t occurrence_count;
+    double value;                   // last reported measurement
+} alarm_entry_t;
+
+/* Transition notification */
+typedef struct {
+    alarm_code_t code;
+    alarm_state_t from;
+    alarm_state_t to;
+    time_t timestamp;
+    double value;
+    uint32_t occurrence_count;
+} alarm_transition_t;
+
+typedef void (*alarm_transition_cb_t)(const alarm_transition_t* transition, void* user_data);
+
+/* Alarm engine context */
+typedef struct {
+    alarm_entry_t entries[ALARM_CODE_COUNT];
+
+    /* Codes with a running debounce timer; the only ones processed per cycle */
+    alarm_code_t pending[ALARM_CODE_COUNT];
+    int pending_count;
+
+    /* Aggregates maintained on transitions */
+    int active_count;               // ACTIVE + ACKNOWLEDGED
+    int unacked_count;              // ACTIVE + CLEARED
+
+    /* Statistics */
+    uint32_t transition_count;
+    uint32_t bounce_count;          // input changes that reverted within the debounce window
+
+    alarm_transition_cb_t on_transition;
+    void* callback_data;
+} alarm_engine_t;
+
+/* Function prototypes */
+void alarm_engine_init(alarm_engine_t* engine, alarm_transition_cb_t callback, void* user_data);
+void alarm_engine_update(alarm_engine_t* engine, alarm_code_t code, bool condition, double value, time_t now);
+int alarm_engine_process(alarm_engine_t* engine, time_t now);
+int alarm_engine_acknowledge(alarm_engine_t* engine, alarm_code_t code, time_t now);
+int alarm_engine_acknowledge_all(alarm_engine_t* engine, time_t now);
+bool alarm_engine_is_active(const alarm_engine_t* engine, alarm_code_t code);
+const alarm_definition_t* alarm_get_definition(alarm_code_t code);
+const char* alarm_state_str(alarm_state_t state);
+const char* alarm_severity_str(alarm_severity_t severity);
+void alarm_engine_log_status(const alarm_engine_t* engine);
+
+#endif /* ALARMS_H */
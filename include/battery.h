@@ -3,6 +3,10 @@
 #define BATTERY_H
 
 #include "core.h"
+#include "battery_cells.h"
+#include "battery_health.h"
+#include "battery_limits.h"
+#include "battery_thermal.h"
 #include <time.h>
 #include <stdbool.h>
 
@@ -15,12 +19,9 @@
 #define DEFAULT_BANK_MAX_CHARGE_W       5000.0
 #define DEFAULT_BANK_MAX_DISCHARGE_W    5000.0
 
-// Chemistry enum for supported battery types
-typedef enum {
-    BAT_CHEM_LFP = 0,
-    BAT_CHEM_NMC,
-    BAT_CHEM_LEAD_ACID
-} battery_chemistry_e;
+// Bank dispatch weighting
+#define BATTERY_DISPATCH_SOC_GAIN       4.0     // share change per unit of SOC away from the pack mean
+#define BATTERY_DISPATCH_TEMP_GAIN      0.05    // share reduction per K above the coolest bank
 
 // Battery management states
 typedef enum {
@@ -41,16 +42,40 @@ typedef enum {
     CHARGE_EQUALIZE
 } charge_stage_t;
 
+/* Extended Kalman filter state for one bank: x = [SOC (0..1), V_RC1, V_RC2] */
+#define SOC_EKF_STATES  3
+
+typedef struct {
+    double x[SOC_EKF_STATES];
+    double p[SOC_EKF_STATES][SOC_EKF_STATES];   // state covariance
+    double innovation;              // last terminal voltage residual (V)
+    bool initialized;
+} soc_ekf_t;
+
+/* Runtime state of one bank (ratings live in battery_bank_t) */
+typedef struct {
+    double accumulated_ah;          // coulomb counter
+    double capacity_ah;             // usable capacity (rated x health)
+    double soc_coulomb;             // % from this bank's counter
+    double voltage;                 // V, bank terminal voltage
+    double cell_voltage;            // V, mean cell voltage
+    double current_a;               // A, positive = charging
+    double max_charge_power_w;      // live limits after SOC/temperature derating
+    double max_discharge_power_w;
+    double setpoint_w;              // dispatched power, positive = discharge
+} battery_bank_state_t;
+
 // Battery management context
 typedef struct {
     // Configuration & topology
     battery_chemistry_e chemistry;
     battery_bank_t banks[MAX_BATTERY_BANKS];
+    battery_bank_state_t bank_state[MAX_BATTERY_BANKS];
     int bank_count;                 // configured banks
     int active_bank_count;          // number of banks in service
 
     // Time & coulomb counting
-    double accumulated_ah;          // Ah (coulomb counter)
+    double accumulated_ah;          // Ah, sum of the bank counters
     time_t last_update_ts;          // last timestamp for coulomb integration
     time_t last_energy_update_ts;   // for energy integration
 
@@ -59,6 +84,8 @@ typedef struct {
     double soc_voltage;             // % from voltage mapping
     double soc_estimated;           // fusion result %
     double soc_smoothed;            // smoothed for control
+    soc_estimator_t soc_estimator;  // algorithm behind soc_estimated
+    soc_ekf_t soc_ekf[MAX_BATTERY_BANKS];
 
     // Capacity and health
     double nominal_voltage;
@@ -71,19 +98,22 @@ typedef struct {
     double ambient_temperature_c;
     bool cooling_active;
     bool heating_active;
+    battery_thermal_t thermal[MAX_BATTERY_BANKS];   // per-bank model and look-ahead limit
 
     // Limits
     double max_charge_current_a;    // A
     double max_discharge_current_a; // A
     double max_charge_power_w;      // W
     double max_discharge_power_w;   // W
+    double power_setpoint_w;        // requested pack power, positive = discharge
 
     // Statistics
     double total_charge_wh;         // Wh
     double total_discharge_wh;      // Wh
-    double cycle_depth_accumulated; // for cycle estimation
+    double cycle_depth_accumulated; // equivalent full cycles (sum of counted DoD)
     int cycle_count;
-    int deep_cycle_count;           // cycles below 20% DOD
+    int deep_cycle_count;           // counted cycles deeper than 80% DoD
+    battery_health_t health[MAX_BATTERY_BANKS];     // per-bank rainflow + fade model
 
     // Timing for charge stages
     time_t absorption_start_ts;
@@ -99,6 +129,7 @@ typedef struct {
     char last_fault_reason[128];
     time_t fault_timestamp;         // When fault occurred
     int fault_clear_attempts;       // Auto-clear attempts
+    battery_limits_t limits;        // per-rule, per-bank trip state
 
     // State machine
     battery_state_t state;
@@ -110,6 +141,7 @@ typedef struct {
     double max_cell_voltage;
     double min_cell_voltage;
     double cell_voltage_spread;     // V
+    battery_cells_t cells;          // per-cell telemetry and statistics
 
     // Tuning
     double soc_voltage_weight;      // 0..1 weight for coulomb vs voltage fusion
@@ -131,12 +163,16 @@ typedef struct {
 
 // Public API
 int battery_init(battery_system_t* bat, const system_config_t* config);
+int battery_prepare_config(const battery_system_t* bat, const system_config_t* config);
+int battery_apply_config(battery_system_t* bat, const system_config_t* config);
 void battery_update_measurements(battery_system_t* bat, system_measurements_t* measurements);
 int battery_calculate_soc(battery_system_t* bat, system_measurements_t* measurements);
 void battery_manage_charging(battery_system_t* bat, double available_power, double load_power);
 void battery_manage_discharging(battery_system_t* bat, double load_power, bool grid_available);
+void battery_follow_setpoint(battery_system_t* bat, double setpoint_w);
 double battery_calculate_max_charge(battery_system_t* bat);
 double battery_calculate_max_discharge(battery_system_t* bat);
+double battery_dispatch(battery_system_t* bat, double setpoint_w);
 bool battery_check_limits(battery_system_t* bat, system_measurements_t* measurements);
 void battery_thermal_management(battery_system_t* bat);
 void battery_equalize(battery_system_t* bat);
@@ -0,0 +1,65 @@
+#ifndef BATTERY_CELLS_H
+#define BATTERY_CELLS_H
+
+#include "core.h"
+#include <stddef.h>
+#include <time.h>
+
+/*
+ * Per-cell telemetry
+ *
+ * Cell voltages and temperatures are kept per bank in contiguous float
+ * arrays (structure of arrays) so the per-cycle statistics, outlier and
+ * balancing passes are straight loops over packed data that the compiler
+ * can vectorize. Banks without cell telemetry have a cell count of zero.
+ */
+
+#define BATTERY_CELLS_MAX_PER_BANK      256     // cells per bank (16S .. large string sets)
+#define BATTERY_CELL_OUTLIER_V          0.025f  // deviation from bank mean flagged as outlier
+#define BATTERY_CELL_BALANCE_START_V    0.030f  // bank spread that starts balancing
+#define BATTERY_CELL_BALANCE_STOP_V     0.010f  // bank spread that ends balancing
+#define BATTERY_CELL_BALANCE_WINDOW_V   0.005f  // cells this far above the bank minimum keep bleeding
+
+/* Aggregates for one bank (or the whole pack) */
+typedef struct {
+    int cell_count;
+    float v_min;
+    float v_max;
+    float v_mean;
+    float v_spread;                 // v_max - v_min
+    float t_min;
+    float t_max;
+    float t_mean;
+    int v_min_bank;                 // bank holding the lowest cell
+    int v_min_cell;                 // index of the lowest cell within that bank
+    int v_max_bank;
+    int v_max_cell;
+    int outlier_count;              // cells further than BATTERY_CELL_OUTLIER_V from the mean
+    int balance_count;              // cells selected for bleeding
+    float balance_target_v;         // bleed cells above this voltage (0 when not balancing)
+} battery_cell_stats_t;
+
+/* Cell data for all banks */
+typedef struct {
+    float voltage[MAX_BATTERY_BANKS][BATTERY_CELLS_MAX_PER_BANK];       // V
+    float temperature[MAX_BATTERY_BANKS][BATTERY_CELLS_MAX_PER_BANK];   // °C
+    uint8_t outlier[MAX_BATTERY_BANKS][BATTERY_CELLS_MAX_PER_BANK];     // 1 = outlier cell
+    uint8_t balance[MAX_BATTERY_BANKS][BATTERY_CELLS_MAX_PER_BANK];     // 1 = bleed requested
+    int count[MAX_BATTERY_BANKS];
+
+    battery_cell_stats_t bank[MAX_BATTERY_BANKS];
+    battery_cell_stats_t pack;      // across all banks with telemetry
+
+    time_t updated[MAX_BATTERY_BANKS];
+    bool analyzed;                  // stats reflect the latest ingest
+} battery_cells_t;
+
+/* Function prototypes */
+void battery_cells_init(battery_cells_t* cells);
+int battery_cells_ingest(battery_cells_t* cells, int bank, const float* voltage,
+                         const float* temperature, int count, time_t timestamp);
+void battery_cells_clear(battery_cells_t* cells, int bank);
+void battery_cells_analyze(battery_cells_t* cells);
+bool battery_cells_available(const battery_cells_t* cells);
+
+#endif /* BATTERY_CELLS_H */
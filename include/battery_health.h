@@ -0,0 +1,68 @@
+#ifndef BATTERY_HEALTH_H
+#define BATTERY_HEALTH_H
+
+#include "core.h"
+#include <time.h>
+
+/*
+ * Battery health: streaming rainflow cycle counting + semi-empirical fade
+ *
+ * Each bank's SOC signal is reduced to reversals (turning points that move
+ * at least BATTERY_RAINFLOW_HYSTERESIS away from the last extreme) and fed
+ * to an incremental three-point (ASTM E1049) rainflow counter. Every closed
+ * cycle adds stress-weighted damage (depth of discharge, mean SOC, C-rate
+ * and temperature); calendar ageing accumulates with time at SOC/temperature.
+ * The linearized damage is mapped to capacity fade with an SEI term:
+ *
+ *   fade = 1 - a_sei * exp(-b_sei * d) - (1 - a_sei) * exp(-d)
+ *
+ * Updates are O(1) amortized and the reversal stack is fixed-size.
+ */
+
+#define BATTERY_RAINFLOW_DEPTH          64      // residual reversals kept per bank
+#define BATTERY_RAINFLOW_HYSTERESIS     0.5     // SOC (%) swing that confirms a reversal
+#define BATTERY_HEALTH_DOD_BINS         10      // 10 % depth-of-discharge bins
+
+/* Degradation model coefficients for one chemistry */
+typedef struct {
+    double cycle_k;                 // damage per full 100 % DoD cycle at reference stress
+    double cycle_exp;               // DoD exponent (Woehler slope)
+    double calendar_k;              // calendar damage per second at reference stress
+    double soc_k;                   // mean-SOC stress, exp(soc_k * (soc - 0.5))
+    double temp_k;                  // Arrhenius-style stress per K away from 25 °C
+    double c_rate_k;                // cycle stress per C above 0.5 C
+    double sei_a;                   // SEI share of fade
+    double sei_b;                   // SEI growth rate
+} battery_health_params_t;
+
+/* Per-bank health state */
+typedef struct {
+    // Rainflow
+    float reversals[BATTERY_RAINFLOW_DEPTH];
+    int reversal_count;
+    double extreme;                 // running extreme since the last confirmed reversal
+    int direction;                  // +1 rising, -1 falling, 0 not yet known
+
+    // Stress averages (time-weighted, ~1 h)
+    double c_rate_avg;
+    double temp_avg_c;
+
+    // Model accumulators
+    double cycle_damage;
+    double calendar_damage;
+    double fade;                    // capacity fade, 0..1
+    double full_cycles;             // equivalent full cycles from counted DoD
+    double throughput_ah;
+    double dod_cycles[BATTERY_HEALTH_DOD_BINS];   // counted cycles per DoD bin
+    double operating_s;
+    time_t last_ts;
+} battery_health_t;
+
+/* Function prototypes */
+const battery_health_params_t* battery_health_params(battery_chemistry_e chemistry);
+void battery_health_init(battery_health_t* health);
+void battery_health_update(battery_health_t* health, battery_chemistry_e chemistry, double soc,
+                           double current_a, double capacity_ah, double temp_c, time_t now);
+double battery_health_percent(const battery_health_t* health);
+
+#endif /* BATTERY_HEALTH_H */
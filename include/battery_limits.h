@@ -0,0 +1,82 @@
+#ifndef BATTERY_LIMITS_H
+#define BATTERY_LIMITS_H
+
+#include "core.h"
+#include <time.h>
+
+/*
+ * Battery limit rules
+ *
+ * Safety limits are data: each chemistry has a table of rules
+ * {signal, threshold, hysteresis, debounce}, evaluated in one pass by
+ * battery_check_limits(). Bank-scoped rules run once per enabled bank;
+ * pack-scoped rules once per pack. A rule trips after its signal has been
+ * beyond the threshold for debounce_s and clears once the signal is back
+ * inside the threshold by the hysteresis band.
+ *
+ * All trip state lives in battery_limits_t inside each battery_system_t,
+ * so several battery systems never share fault state.
+ */
+
+#define BATTERY_LIMIT_MAX_RULES     16
+
+/* Measured quantity a rule watches */
+typedef enum {
+    LIMIT_SIGNAL_CELL_VOLTAGE_MAX = 0,  // V, highest cell in the bank
+    LIMIT_SIGNAL_CELL_VOLTAGE_MIN,      // V, lowest cell in the bank
+    LIMIT_SIGNAL_CELL_TEMPERATURE,      // °C, hottest cell in the bank
+    LIMIT_SIGNAL_BANK_CHARGE_CURRENT,   // bank charge current / bank rating
+    LIMIT_SIGNAL_BANK_DISCHARGE_CURRENT,
+    LIMIT_SIGNAL_PACK_CHARGE_CURRENT,   // pack charge current / configured maximum
+    LIMIT_SIGNAL_PACK_DISCHARGE_CURRENT
+} battery_limit_signal_t;
+
+/* Fault a rule raises; values are bit positions in the bank fault masks */
+typedef enum {
+    LIMIT_FAULT_OVERVOLTAGE = 0,
+    LIMIT_FAULT_UNDERVOLTAGE,
+    LIMIT_FAULT_OVERCURRENT,
+    LIMIT_FAULT_OVERTEMPERATURE
+} battery_limit_fault_t;
+
+#define BATTERY_LIMIT_FAULT_BIT(f)  (1u << (f))
+
+typedef struct {
+    battery_limit_signal_t signal;
+    battery_limit_fault_t fault;
+    bool trip_below;                // low limit (trips when the signal falls below)
+    double threshold;
+    double hysteresis;              // clear band inside the threshold
+    double debounce_s;              // time beyond the threshold before tripping
+    const char* reason;
+} battery_limit_rule_t;
+
+typedef enum {
+    LIMIT_EVENT_NONE = 0,
+    LIMIT_EVENT_TRIP,
+    LIMIT_EVENT_CLEAR
+} battery_limit_event_t;
+
+/* Trip state of one rule instance */
+typedef struct {
+    bool active;
+    time_t pending_since;           // first sample beyond the threshold, 0 if none
+} battery_limit_state_t;
+
+/* Per-system limit state; pack-scoped rules use instance 0 */
+typedef struct {
+    battery_limit_state_t state[BATTERY_LIMIT_MAX_RULES][MAX_BATTERY_BANKS];
+    uint8_t bank_faults[MAX_BATTERY_BANKS];     // active fault bits per bank
+    uint8_t pack_faults;                        // active fault bits from pack rules
+    int active_count;
+} battery_limits_t;
+
+/* Function prototypes */
+const battery_limit_rule_t* battery_limit_rules(battery_chemistry_e chemistry, int* count);
+bool battery_limit_signal_per_bank(battery_limit_signal_t signal);
+const char* battery_limit_fault_str(battery_limit_fault_t fault);
+void battery_limits_init(battery_limits_t* limits);
+battery_limit_event_t battery_limit_step(const battery_limit_rule_t* rule, battery_limit_state_t* state,
+                                         double value, time_t now);
+
+#endif /* BATTERY_LIMITS_H */
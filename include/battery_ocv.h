@@ -0,0 +1,37 @@
+#ifndef BATTERY_OCV_H
+#define BATTERY_OCV_H
+
+#include "battery.h"
+#include <stddef.h>
+
+/*
+ * Open-circuit voltage -> SOC lookup
+ *
+ * Each chemistry curve is resampled once at init onto a uniform cell-voltage
+ * grid, one row per temperature step. A lookup is then an index computation
+ * plus one fused multiply-add, with no search and no division, so it can run
+ * per cell every cycle.
+ */
+
+#define BATTERY_OCV_GRID_POINTS     256     // voltage samples per row
+#define BATTERY_OCV_TEMP_MIN_C      -20.0
+#define BATTERY_OCV_TEMP_STEP_C     5.0
+#define BATTERY_OCV_TEMP_ROWS       17      // -20 .. 60 °C
+
+/* Resampled table for one chemistry */
+typedef struct {
+    float v_min;                    // cell voltage of grid point 0
+    float inv_step;                 // grid points per volt
+    float soc[BATTERY_OCV_TEMP_ROWS][BATTERY_OCV_GRID_POINTS];     // SOC (%) at grid point
+    float slope[BATTERY_OCV_TEMP_ROWS][BATTERY_OCV_GRID_POINTS];   // SOC delta to the next point
+} battery_ocv_table_t;
+
+/* Function prototypes */
+void battery_ocv_init(void);
+const battery_ocv_table_t* battery_ocv_table(battery_chemistry_e chemistry);
+double battery_ocv_soc(battery_chemistry_e chemistry, double cell_v, double temp_c);
+void battery_ocv_soc_batch(battery_chemistry_e chemistry, double temp_c,
+                           const float* cell_v, float* soc, size_t count);
+double battery_ocv_voltage(battery_chemistry_e chemistry, double soc, double temp_c, double* dv_dsoc);
+
+#endif /* BATTERY_OCV_H */
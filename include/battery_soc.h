@@ -0,0 +1,59 @@
+#ifndef BATTERY_SOC_H
+#define BATTERY_SOC_H
+
+#include "battery.h"
+
+/*
+ * SOC estimators
+ *
+ * battery_calculate_soc() does the shared bookkeeping (timestamps, per-bank
+ * coulomb counters, smoothing) and delegates the estimate itself to the
+ * estimator selected by bat->soc_estimator. Both estimators work per bank,
+ * set banks[].bank_soc and return the capacity-weighted pack SOC:
+ *
+ *   FUSION  coulomb count blended with an OCV lookup near rest
+ *   EKF     extended Kalman filter on a 1-RC/2-RC equivalent circuit
+ *
+ * Estimators keep all state in battery_system_t (fixed-size, no allocation).
+ */
+
+/* Equivalent-circuit parameters for one chemistry. Resistances are specific
+ * values in ohm*Ah, divided by the bank capacity at run time, so one set
+ * covers banks of any size. r2 = 0 selects the 1-RC model. */
+typedef struct {
+    double r0;                      // ohmic resistance
+    double r1;                      // fast RC pair (charge transfer)
+    double tau1;                    // s
+    double r2;                      // slow RC pair (diffusion)
+    double tau2;                    // s
+    double q_soc;                   // SOC process noise, 1/s
+    double q_rc;                    // RC voltage process noise, V^2/s
+    double r_meas;                  // cell voltage measurement noise, V^2
+} soc_ekf_params_t;
+
+/* One EKF step for one bank */
+typedef struct {
+    double cell_voltage;            // V, terminal voltage per series cell
+    double current;                 // A, bank current, positive = charging
+    double temperature_c;
+    double capacity_ah;             // usable bank capacity
+    double charge_efficiency;       // applied to charging current
+    double dt_s;
+} soc_ekf_input_t;
+
+/* Estimator interface */
+typedef struct {
+    const char* name;
+    bool smoothed;                  // output goes through the control smoothing filter
+    void (*reset)(battery_system_t* bat, double soc);
+    double (*update)(battery_system_t* bat, const system_measurements_t* measurements, double dt_s);
+} battery_soc_estimator_t;
+
+/* Function prototypes */
+const battery_soc_estimator_t* battery_soc_estimator(soc_estimator_t id);
+const char* battery_soc_estimator_str(soc_estimator_t id);
+const soc_ekf_params_t* soc_ekf_params(battery_chemistry_e chemistry);
+void soc_ekf_reset(soc_ekf_t* ekf, double soc);
+double soc_ekf_step(soc_ekf_t* ekf, battery_chemistry_e chemistry, const soc_ekf_input_t* in);
+
+#endif /* BATTERY_SOC_H */
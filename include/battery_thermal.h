@@ -0,0 +1,50 @@
+#ifndef BATTERY_THERMAL_H
+#define BATTERY_THERMAL_H
+
+#include "core.h"
+
+/*
+ * Lumped thermal model, one node per bank
+ *
+ *   C dT/dt = I^2 R - G (T - T_ambient)
+ *
+ * C scales with bank energy, R is the bank's equivalent-circuit resistance
+ * and G the exchange with ambient (larger while cooling runs). For a
+ * constant setpoint the solution is closed-form,
+ *
+ *   T(t) = T_ss + (T_0 - T_ss) exp(-t G / C),  T_ss = T_ambient + I^2 R / G
+ *
+ * which lets the controller predict the temperature at the end of the
+ * planning horizon and pre-cool or cap power before a limit is reached.
+ */
+
+#define BATTERY_THERMAL_HORIZON_S       900.0   // look-ahead for the planned setpoint
+#define BATTERY_THERMAL_DERATE_C        55.0    // keep the predicted temperature below this
+#define BATTERY_THERMAL_MIN_POWER       0.3     // derating floor, fraction of the bank rating
+
+/* Thermal coefficients for one chemistry, per unit of bank energy */
+typedef struct {
+    double heat_capacity;           // J/K per Wh
+    double conductance;             // W/K per kWh, passive exchange
+    double cooling_conductance;     // W/K per kWh added while cooling runs
+} battery_thermal_params_t;
+
+/* Model state of one bank, refreshed every cycle */
+typedef struct {
+    double heat_capacity_jk;        // J/K
+    double conductance_wk;          // W/K with the current cooling state
+    double resistance_ohm;          // bank resistance seen by the bank current
+    double heat_w;                  // I^2 R at the planned setpoint
+    double predicted_c;             // °C at the horizon, cooling as planned
+    double power_limit_w;           // W keeping the horizon temperature at or below the derate point
+    bool cooling_requested;
+} battery_thermal_t;
+
+/* Function prototypes */
+const battery_thermal_params_t* battery_thermal_params(battery_chemistry_e chemistry);
+double battery_thermal_predict(double temp_c, double ambient_c, double heat_w,
+                               double heat_capacity_jk, double conductance_wk, double horizon_s);
+double battery_thermal_heat_budget(double temp_c, double ambient_c, double limit_c,
+                                   double heat_capacity_jk, double conductance_wk, double horizon_s);
+
+#endif /* BATTERY_THERMAL_H */
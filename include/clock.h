@@ -0,0 +1,29 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdbool.h>
+#include <time.h>
+
+/*
+ * Control clock
+ *
+ * Everything on the control path reads time through here rather than from
+ * time(NULL) or CLOCK_MONOTONIC directly. By default both follow the system
+ * clocks. A simulation switches to a virtual clock and advances it in
+ * lockstep with its plant, so controller, forecasts, tariff and statistics
+ * see simulated time however fast the loop actually runs.
+ *
+ * The virtual time is a single atomic, so readers on other threads (web,
+ * dispatch) stay consistent with the control thread that advances it.
+ */
+
+/* Function prototypes */
+time_t clock_now(void);
+double clock_now_s(void);
+double clock_monotonic(void);
+void clock_use_virtual(double start);
+void clock_use_system(void);
+bool clock_is_virtual(void);
+double clock_advance(double seconds);
+
+#endif /* CLOCK_H */
@@ -5,7 +5,13 @@
 #include <stdio.h>
 
 #define CONFIG_FILENAME "system_config.json"
-#define CONFIG_MAX_SIZE 16384  // 16KB maximum config size
+
+/* Binary config cache (<config>.bin): a validated system_config_t image keyed
+ * by the source content hash. Bump CONFIG_LAYOUT_VERSION whenever
+ * system_config_t or anything it embeds changes. */
+#define CONFIG_CACHE_SUFFIX     ".bin"
+#define CONFIG_CACHE_MAGIC      0x47464353u     // "SCFG"
+#define CONFIG_LAYOUT_VERSION   8
 
 /* Configuration error codes */
 typedef enum {
@@ -17,8 +23,41 @@ typedef enum {
     CONFIG_MEMORY_ERROR
 } config_error_t;
 
+/* Cache file header, followed by sizeof(system_config_t) payload bytes */
+typedef struct {
+    uint32_t magic;
+    uint16_t layout_version;
+    uint16_t header_size;
+    uint32_t config_size;           // sizeof(system_config_t) when written
+    uint32_t reserved;
+    uint64_t source_size;           // JSON file size
+    uint64_t source_hash;           // hash of the JSON bytes
+    uint64_t payload_checksum;      // hash of the image
+} config_cache_header_t;
+
+/* Location of the last parse error (per thread) */
+typedef struct {
+    int line;
+    int column;
+    char message[64];
+} config_parse_error_t;
+
+/* Configuration sections reported by config_diff() */
+#define CONFIG_SECTION_GENERAL      (1u << 0)   // name, voltage, grid limits
+#define CONFIG_SECTION_BATTERY      (1u << 1)
+#define CONFIG_SECTION_PV           (1u << 2)
+#define CONFIG_SECTION_LOADS        (1u << 3)
+#define CONFIG_SECTION_IRRIGATION   (1u << 4)
+#define CONFIG_SECTION_EV           (1u << 5)
+#define CONFIG_SECTION_CONTROL      (1u << 6)   // loop intervals, hysteresis
+#define CONFIG_SECTION_TARIFF       (1u << 7)   // prices, demand charge, feed-in cap
+#define CONFIG_SECTION_ALL          0xFFu
+
 /* Configuration management functions */
 config_error_t config_load(const char* filename, system_config_t* config);
+config_error_t config_parse(const char* text, size_t length, system_config_t* config);
+const config_parse_error_t* config_last_error(void);
+uint32_t config_diff(const system_config_t* a, const system_config_t* b);
 config_error_t config_save(const char* filename, const system_config_t* config);
 config_error_t config_validate(const system_config_t* config);
 void config_print(const system_config_t* config);
@@ -2,12 +2,17 @@
 #define CONTROLLER_H
 
 #include <stdio.h>
+#include <pthread.h>
 #include "core.h"
 #include "pv.h"
 #include "battery.h"
 #include "loads.h"
 #include "agriculture.h"
 #include "ev.h"
+#include "alarms.h"
+#include "reload.h"
+#include "dispatch.h"
+#include "tariff.h"
 
 /* Controller operating modes */
 typedef enum {
@@ -34,6 +39,23 @@ typedef struct {
     control_commands_t commands;
     system_statistics_t statistics;
     
+    /* Configuration currently applied (baseline for live reload diffs) */
+    system_config_t config;
+    config_reload_t* reload;    // live reload worker, NULL when not running
+    
+    /* Held by the control loop over each cycle and reload; other threads
+     * take it to read controller state (see controller_lock) */
+    pthread_mutex_t state_lock;
+    
+    /* Dispatch optimizer */
+    dispatch_worker_t* dispatch;        // worker, NULL when not running
+    dispatch_plan_t* plan;              // latest plan taken from it, NULL before the first
+    dispatch_input_t dispatch_input;    // snapshot being submitted
+    
+    /* Tariff and battery schedule */
+    tariff_t tariff;
+    tariff_schedule_t schedule;         // re-planned every tariff slot while grid-connected
+    
     /* Control parameters */
     double control_interval;
     time_t last_control_cycle;
@@ -46,7 +68,7 @@ typedef struct {
     double grid_export_limit;
     
     /* Optimization targets */
-    double battery_soc_target;
+    double battery_soc_target;          // from the tariff schedule
     double pv_self_consumption_target;
     
     /* Safety limits */
@@ -61,7 +83,7 @@ typedef struct {
     char* name;
     
     /* Fault handling */
-    uint32_t fault_mask;
+    alarm_engine_t alarms;
     time_t last_fault_time;
     char last_fault_description[128];
 } system_controller_t;
@@ -69,8 +91,13 @@ typedef struct {
 /* Function prototypes */
 int controller_init(system_controller_t* ctrl, const system_config_t* config);
 int controller_run_cycle(system_controller_t* ctrl);
+int controller_apply_config(system_controller_t* ctrl, const system_config_t* config);
 void controller_update_measurements(system_controller_t* ctrl);
 void controller_determine_mode(system_controller_t* ctrl);
+void controller_plan_dispatch(system_controller_t* ctrl);
+void controller_schedule_battery(system_controller_t* ctrl);
+void controller_schedule_deferrable(system_controller_t* ctrl);
+double controller_forecast_w(const pv_forecast_t* pv, const load_forecast_t* load, time_t from, time_t to);
 void controller_optimize_energy_flow(system_controller_t* ctrl);
 void controller_manage_grid_connection(system_controller_t* ctrl);
 void controller_handle_faults(system_controller_t* ctrl);
@@ -78,6 +105,8 @@ void controller_update_statistics(system_controller_t* ctrl);
 void controller_log_status(system_controller_t* ctrl);
 void controller_emergency_shutdown(system_controller_t* ctrl);
 bool controller_check_safety_limits(system_controller_t* ctrl);
+void controller_lock(system_controller_t* ctrl);
+void controller_unlock(system_controller_t* ctrl);
 void controller_cleanup(system_controller_t* ctrl);
 
 #endif /* CONTROLLER_H */
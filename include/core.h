@@ -7,11 +7,27 @@
 
 // System-wide constants
 #define MAX_BATTERY_BANKS      4
-#define MAX_CONTROLLABLE_LOADS 12
 #define MAX_IRRIGATION_ZONES   8
 #define MAX_EV_CHARGERS        2
 
-#define MAX_PV_STRINGS         4
+// Configuration capacity: a site file may describe more devices than one
+// controller drives; subsystems take the first MAX_* entries. Loads are
+// sized to the config, so CONFIG_MAX_LOADS is also the controller's limit.
+#define CONFIG_MAX_LOADS       512
+#define CONFIG_MAX_ZONES       256
+#define CONFIG_MAX_EV_CHARGERS 64
+#define CONFIG_MAX_TARIFF_PERIODS 32
+#define TARIFF_ALL_DAYS        0x7F     // tariff period weekday mask, bit 0 = Sunday
+
+#define MAX_PV_STRINGS         4        // default string count; per-inverter DC inputs in measurements
+#define CONFIG_MAX_PV_STRINGS  4096
+#define PV_MPPT_RATE_MIN_HZ    10       // per-inverter MPPT worker rate bounds
+#define PV_MPPT_RATE_MAX_HZ    100
+#define PV_MPPT_RATE_DEFAULT_HZ 20
+#define DISPATCH_HORIZON_MIN_H 6        // dispatch optimizer horizon and slot bounds
+#define DISPATCH_HORIZON_MAX_H 48
+#define DISPATCH_STEP_MIN_MIN  5
+#define DISPATCH_STEP_MAX_MIN  60
 #define DEFAULT_PV_VOLTAGE     0.0
 #define DEFAULT_PV_CURRENT     0.0
 
@@ -51,6 +67,19 @@ typedef enum {
     IRRIGATION_OFF             // Irrigation disabled
 } irrigation_mode_t;
 
+// Chemistry enum for supported battery types
+typedef enum {
+    BAT_CHEM_LFP = 0,
+    BAT_CHEM_NMC,
+    BAT_CHEM_LEAD_ACID
+} battery_chemistry_e;
+
+// Battery SOC estimation algorithms
+typedef enum {
+    SOC_ESTIMATOR_FUSION = 0,  // Coulomb counting blended with OCV lookup
+    SOC_ESTIMATOR_EKF          // Extended Kalman filter on an equivalent-circuit model, per bank
+} soc_estimator_t;
+
 // Error and alarm codes
 typedef enum {
     ALARM_GRID_FAILURE = 0,
@@ -60,7 +89,11 @@ typedef enum {
     ALARM_OVERLOAD,
     ALARM_COMM_FAILURE,
     ALARM_IRRIGATION_FAULT,
-    ALARM_EV_CHARGER_FAULT
+    ALARM_EV_CHARGER_FAULT,
+    ALARM_BATTERY_OVER_VOLTAGE,
+    ALARM_BATTERY_UNDER_VOLTAGE,
+    ALARM_BATTERY_OVER_CURRENT,
+    ALARM_CODE_COUNT            // Number of alarm codes (keep last)
 } alarm_code_t;
 
 // Warning codes
@@ -73,6 +106,13 @@ typedef enum {
     WARNING_IRRIGATION_SKIPPED
 } warning_code_t;
 
+// Readings supplied by the HAL this cycle (system_measurements_t.measured);
+// subsystems estimate whatever is not flagged
+#define MEASURED_PV            (1u << 0)    // pv_power_total, pv_voltage, pv_current
+#define MEASURED_BATTERY       (1u << 1)    // battery_power, battery_voltage, battery_current, battery_temp
+#define MEASURED_LOADS         (1u << 2)    // load_power_total
+#define MEASURED_GRID          (1u << 3)    // grid_power, grid_voltage, grid_frequency
+
 // Real-time measurements structure
 typedef struct {
     double grid_power;          // Grid power (positive = import, negative = export)
@@ -82,7 +122,7 @@ typedef struct {
     double pv_power_total;      // Total PV power production (W)
     double pv_voltage[MAX_PV_STRINGS]; // Per-string voltages
     double pv_current[MAX_PV_STRINGS]; // Per-string currents
-    uint8_t pv_strings_active;  // Number of active PV strings
+    uint16_t pv_strings_active; // Number of active PV strings
     
     double battery_power;       // Battery power (positive = discharging, negative = charging)
     double battery_voltage;     // Battery voltage (V)
@@ -90,6 +130,12 @@ typedef struct {
     double battery_soc;         // State of charge (%)
     double battery_temp;        // Battery temperature (°C)
     
+    // Per-bank readings for the first battery_bank_count banks (0 = pack totals only)
+    double battery_bank_voltage[MAX_BATTERY_BANKS];     // V
+    double battery_bank_current[MAX_BATTERY_BANKS];     // A (positive = charging)
+    double battery_bank_temp[MAX_BATTERY_BANKS];        // °C
+    uint8_t battery_bank_count;
+    
     double load_power_total;    // Total load power (W)
     double load_power_critical; // Critical loads power (W)
     double load_power_deferrable; // Deferrable loads power (W)
@@ -97,6 +143,7 @@ typedef struct {
     double irrigation_power;    // Irrigation system power (W)
     double ev_charging_power;   // EV charging power (W)
     
+    uint8_t measured;           // MEASURED_* sources
     time_t timestamp;           // Unix timestamp of measurement
 } system_measurements_t;
 
@@ -110,7 +157,8 @@ typedef struct {
     bool critical_loads_on;     // Critical loads status
     
     soc_category_t battery_soc_category; // Battery SOC category
-    uint8_t alarms;                      // Bitmask of active alarms
+    uint16_t active_alarms;              // Alarms currently active (see alarm engine)
+    uint16_t unacked_alarms;             // Alarms awaiting acknowledgement
     uint8_t warnings;                    // Bitmask of active warnings
     
     time_t last_mode_change;    // When mode was last changed
@@ -119,11 +167,12 @@ typedef struct {
 
 // Control commands structur
 typedef struct {
-    double battery_setpoint;     // Battery power setpoint (W)
+    double battery_setpoint;     // Battery power setpoint (W, positive = discharge)
+    double battery_bank_setpoint[MAX_BATTERY_BANKS];   // Dispatched share per bank (W)
     bool pv_curtail;             // PV curtailment active
     double pv_curtail_percent;   // PV curtailment percentage
     
-    bool load_shed[MAX_CONTROLLABLE_LOADS];         // Load shed commands
+    bool load_shed[CONFIG_MAX_LOADS];               // Load shed commands
     bool irrigation_enable[MAX_IRRIGATION_ZONES];   // Irrigation zone control
     double ev_charge_rate[MAX_EV_CHARGERS];         // EV charge rate setpoints
     
@@ -140,6 +189,8 @@ typedef struct {
     bool is_sheddable;          // Can be shed
     double min_on_time;         // Minimum on time (seconds)
     double min_off_time;        // Minimum off time (seconds)
+    double daily_energy_wh;     // Deferrable: energy to deliver per day (Wh), 0 if unplanned
+    double deadline_hour;       // Deferrable: local hour the daily energy is due by
     time_t last_state_change;   // Last state change time
     bool current_state;         // Current on/off state
 } load_definition_t;
@@ -178,6 +229,9 @@ typedef struct {
     bool enabled;               // String enabled
     bool fault;                 // Fault detected
     double efficiency;          // String efficiency (%)
+    double tilt;                // Plane tilt from horizontal (deg)
+    double azimuth;             // Plane azimuth, clockwise from north (deg)
+    double temp_coefficient;    // Power temperature coefficient (%/K)
 } pv_string_t;
 
 // Battery bank description (one physical bank)
@@ -199,6 +253,17 @@ typedef struct {
 } battery_bank_t;
 
 
+// Tariff period: prices that apply on the given weekdays between two local
+// times; start_hour > end_hour wraps past midnight
+typedef struct {
+    uint8_t days;               // weekday mask, bit 0 = Sunday
+    double start_hour;          // [0, 24)
+    double end_hour;            // (0, 24]
+    double import_price;        // per kWh
+    double export_price;        // per kWh
+} tariff_period_t;
+
+
 // System config structure
 typedef struct {
     // General settings
@@ -206,6 +271,14 @@ typedef struct {
     double nominal_voltage;
     double max_grid_import;
     double max_grid_export;
+    double grid_import_price;    // per kWh
+    double grid_export_price;    // per kWh
+    
+    // Tariff: periods override the flat prices above, later periods win
+    tariff_period_t tariff_periods[CONFIG_MAX_TARIFF_PERIODS];
+    int tariff_period_count;
+    double demand_charge;        // per kW of the month's peak import
+    double feed_in_limit;        // export paid for, W (0 = no cap)
     
     // Battery settings
     double battery_soc_min;      // Minimum SOC for discharge
@@ -214,23 +287,31 @@ typedef struct {
     double battery_reserve_soc;  // Reserve SOC for outages
     battery_bank_t batteries[MAX_BATTERY_BANKS];
     int bank_count;
+    soc_estimator_t battery_soc_estimator;
     
     // PV settings
     double pv_curtail_start;     // SOC level to start PV curtailment
     double pv_curtail_max;       // Maximum curtailment percentage
+    int pv_string_count;         // strings across all inverters
+    int pv_mppt_rate_hz;         // MPPT worker rate per inverter
+    double pv_tilt;              // Array tilt from horizontal (deg)
+    double pv_azimuth;           // Array azimuth, clockwise from north (deg)
+    double pv_temp_coefficient;  // Module power temperature coefficient (%/K)
+    double site_latitude;        // deg, north positive
+    double site_longitude;       // deg, east positive
     
     // Load management
-    load_definition_t loads[MAX_CONTROLLABLE_LOADS];
+    load_definition_t loads[CONFIG_MAX_LOADS];
     int load_count;
     
     // Irrigation settings
-    irrigation_zone_t zones[MAX_IRRIGATION_ZONES];
+    irrigation_zone_t zones[CONFIG_MAX_ZONES];
     int zone_count;
     irrigation_mode_t irrigation_mode;
     double irrigation_power_limit;
     
     // EV charging
-    ev_charger_t ev_chargers[MAX_EV_CHARGERS];
+    ev_charger_t ev_chargers[CONFIG_MAX_EV_CHARGERS];
     int ev_charger_count;
     double ev_charge_power_limit;
     
@@ -238,6 +319,9 @@ typedef struct {
     double control_interval;     // Control loop interval (seconds)
     double measurement_interval; // Measurement interval (seconds)
     double hysteresis;           // Hysteresis for mode changes
+    int dispatch_horizon_hours;  // Dispatch optimizer look-ahead
+    int dispatch_step_minutes;   // Dispatch optimizer slot length
+    int dispatch_interval_cycles; // Cycles between re-plans, 0 disables the optimizer
 } system_config_t;
 
 /* System statistics */
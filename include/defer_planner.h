@@ -0,0 +1,76 @@
+#ifndef DEFER_PLANNER_H
+#define DEFER_PLANNER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Deferrable-load planner
+ *
+ * Places the runs of flexible loads (pumps, water heaters, dryers) in the
+ * forecast PV surplus. Each job is a load with an energy still to deliver
+ * before a deadline, a minimum run length and a relay that should switch as
+ * little as possible. Jobs are packed earliest deadline first into the
+ * surplus the earlier jobs left over; each job's runs come from a dynamic
+ * programme over the slots up to its deadline that minimises
+ *
+ *   grid energy drawn + DEFER_START_PENALTY_WH per run started
+ *   + DEFER_MISS_WEIGHT x energy left undelivered at the deadline
+ *
+ * with every run at least the minimum length. A run already under way
+ * continues without a start penalty and must reach its minimum length.
+ *
+ * A plan covers DEFER_PLAN_SLOTS slots of DEFER_PLAN_STEP_S from its start.
+ * The caller re-plans when the forecasts move on (every slot): runs in
+ * progress carry over as the starting state, so a new plan only changes
+ * what is still ahead.
+ */
+
+#define DEFER_PLAN_STEP_S           900     // slot length, as the PV forecast
+#define DEFER_PLAN_SLOTS            96      // horizon: 24 h
+#define DEFER_MAX_RUN_SLOTS         16      // minimum run lengths are capped here (4 h)
+#define DEFER_START_PENALTY_WH      50.0    // a relay cycle is worth this much grid energy
+#define DEFER_MISS_WEIGHT           10.0    // per Wh missing at the deadline
+
+typedef struct {
+    int id;                                 // caller's index of the load
+    double power_w;
+    double need_wh;                         // still to deliver before the deadline
+    int deadline;                           // slots from the plan start, exclusive
+    int min_run;                            // slots
+    int running;                            // slots of the run under way, 0 if off
+    int earliest_start;                     // first slot a new run may start
+
+    /* Plan */
+    uint8_t on[DEFER_PLAN_SLOTS];
+    int starts;                             // runs started in the plan
+    double surplus_wh;                      // planned energy drawn from the surplus
+    double shortfall_wh;                    // planned energy missing at the deadline
+} defer_job_t;
+
+typedef struct {
+    defer_job_t* jobs;
+    int count;
+    int capacity;
+
+    time_t start;                           // plan start, slot aligned; 0 before the first plan
+    float remaining_w[DEFER_PLAN_SLOTS];    // surplus the plan leaves
+
+    /* Workspace */
+    int* order;                             // jobs, earliest deadline first
+    double* cost;                           // two slots of (need + 1) x (run + 1) states
+    uint8_t* choice;                        // how each state was reached, per slot
+
+    /* Statistics */
+    uint32_t plans;
+    double last_plan_s;
+} defer_planner_t;
+
+/* Function prototypes */
+int defer_planner_init(defer_planner_t* planner, int capacity);
+void defer_planner_free(defer_planner_t* planner);
+int defer_planner_solve(defer_planner_t* planner, time_t start, const float* surplus_w);
+int defer_planner_slot(const defer_planner_t* planner, time_t t);
+
+#endif /* DEFER_PLANNER_H */
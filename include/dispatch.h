@@ -0,0 +1,133 @@
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include "core.h"
+#include "qp.h"
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/*
+ * Receding-horizon dispatch (MPC)
+ *
+ * Every few control cycles the controller snapshots the forecasts, prices
+ * and battery and grid limits into a dispatch_input_t and hands it to a
+ * worker thread, which solves the horizon as one QP and publishes a plan.
+ * The control loop tracks the plan's grid trajectory with the battery, so
+ * forecast error lands on the battery rather than on the grid.
+ *
+ * Per slot t (powers kW, energies kWh, tau = step in hours):
+ *
+ *   c charge, u discharge, gi import, ge export, f deferrable,
+ *   s unserved, e stored energy, w deferrable energy served so far
+ *
+ *   load - pv <= gi - ge - c + u - f + s <= load    (surplus is curtailed)
+ *   e(t) = e(t-1) + tau (eta c - u / eta)
+ *   w(t) = w(t-1) + tau f
+ *
+ * minimising import cost - export revenue + unserved and wear penalties
+ * - value of deferrable energy served - value of energy left at the end.
+ * Variables are ordered by slot, so the solver's KKT matrix has half-
+ * bandwidth DISPATCH_BANDWIDTH and each iteration is linear in the horizon.
+ */
+
+#define DISPATCH_MAX_SLOTS          576     // 48 h at 5 min
+#define DISPATCH_VARS_PER_SLOT      8
+#define DISPATCH_ROWS_PER_SLOT      11      // balance, energy, deferrable, 8 bounds
+#define DISPATCH_BANDWIDTH          8
+#define DISPATCH_EFFICIENCY         0.95    // one-way battery efficiency
+#define DISPATCH_WEAR_COST          0.02    // per kWh through the battery
+#define DISPATCH_UNSERVED_COST      5.0     // per kWh not supplied
+#define DISPATCH_SMOOTHING          0.002   // quadratic on battery and import power, per kW^2 h
+#define DISPATCH_TOLERANCE          2e-3    // solver residual tolerance, kW (2 W) and relative
+#define DISPATCH_MAX_PLAN_AGE_S     1800    // older plans are not tracked
+#define DISPATCH_DEFERRED_RUN_H     1.0     // energy need per deferred load, in hours at rated power
+
+/* Problem snapshot, built on the control thread */
+typedef struct {
+    time_t start;                           // start of slot 0
+    int step_s;
+    int slots;
+
+    double energy_wh;                       // stored now
+    double capacity_wh;
+    double reserve_wh;                      // keep at least this while grid-connected
+    double max_energy_wh;
+    double max_charge_w;
+    double max_discharge_w;
+    double import_limit_w;                  // 0 when import is not allowed
+    double export_limit_w;                  // 0 when export is not allowed
+    double deferrable_power_w;              // deferred loads waiting to run
+    double deferrable_energy_wh;            // their energy need over the horizon
+
+    float load_w[DISPATCH_MAX_SLOTS];
+    float pv_w[DISPATCH_MAX_SLOTS];
+    float import_price[DISPATCH_MAX_SLOTS]; // per kWh
+    float export_price[DISPATCH_MAX_SLOTS];
+} dispatch_input_t;
+
+/* Setpoint trajectory */
+typedef struct {
+    time_t start;
+    time_t created;
+    int step_s;
+    int slots;
+
+    float battery_w[DISPATCH_MAX_SLOTS];    // positive = discharge
+    float grid_w[DISPATCH_MAX_SLOTS];       // positive = import
+    float deferrable_w[DISPATCH_MAX_SLOTS];
+    float curtail_w[DISPATCH_MAX_SLOTS];
+    float unserved_w[DISPATCH_MAX_SLOTS];
+    float soc[DISPATCH_MAX_SLOTS];          // % at the end of each slot
+
+    double cost;                            // objective, currency
+    qp_status_t status;
+    int iterations;
+    double solve_ms;
+} dispatch_plan_t;
+
+/* QP and warm-start bookkeeping; one per thread that solves */
+typedef struct {
+    qp_t qp;
+    int max_slots;
+    int slots;                              // layout of the last solve, 0 before it
+    int step_s;
+    time_t start;
+} dispatch_solver_t;
+
+/* Dispatch worker */
+typedef struct {
+    dispatch_solver_t solver;               // worker thread only
+
+    pthread_t thread;
+    sem_t wakeup;
+    atomic_bool running;
+
+    /* Latest submitted problem, consumed by the worker */
+    pthread_mutex_t input_lock;
+    dispatch_input_t pending;
+    bool pending_set;
+    dispatch_input_t work;                  // worker's copy
+
+    /* Plan waiting for the control loop (owned by the worker until taken) */
+    _Atomic(dispatch_plan_t*) published;
+
+    /* Statistics */
+    atomic_uint solve_count;
+    atomic_uint fail_count;                 // numerical failures, plan withheld
+    atomic_uint last_iterations;
+    atomic_uint last_solve_us;
+} dispatch_worker_t;
+
+/* Function prototypes */
+int dispatch_solver_init(dispatch_solver_t* solver, int max_slots);
+void dispatch_solver_free(dispatch_solver_t* solver);
+int dispatch_solve(dispatch_solver_t* solver, const dispatch_input_t* input, dispatch_plan_t* plan);
+int dispatch_start(dispatch_worker_t* worker);
+void dispatch_stop(dispatch_worker_t* worker);
+int dispatch_submit(dispatch_worker_t* worker, const dispatch_input_t* input);
+dispatch_plan_t* dispatch_take(dispatch_worker_t* worker);
+int dispatch_plan_slot(const dispatch_plan_t* plan, time_t now);
+
+#endif /* DISPATCH_H */
@@ -2,6 +2,11 @@
 #define EV_H
 
 #include "core.h"
+#include "pv_forecast.h"
+
+#define EV_DEFAULT_BATTERY_WH   75000.0     // assumed vehicle battery size
+#define EV_FORECAST_PV_SHARE    0.5         // share of forecast PV expected to reach the chargers
+#define EV_DEFAULT_DWELL_S      (8 * 3600)  // assumed time to departure when none is set
 
 /* EV charging states */
 typedef enum {
@@ -49,6 +54,7 @@ typedef struct {
     double battery_soc_limit;
     bool allow_grid_charging;
     bool allow_solar_charging;
+    const pv_forecast_t* pv_forecast;   // set by the controller, NULL if unavailable
     
     /* Fault detection */
     bool communication_fault;
@@ -59,6 +65,7 @@ typedef struct {
 
 /* Function prototypes */
 int ev_init(ev_charging_system_t* ev, const system_config_t* config);
+int ev_apply_config(ev_charging_system_t* ev, const system_config_t* config);
 void ev_update_measurements(ev_charging_system_t* ev, system_measurements_t* measurements);
 bool ev_manage_charging(ev_charging_system_t* ev, double available_power, 
                        double battery_soc, bool grid_available);
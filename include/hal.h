@@ -7,7 +7,7 @@
 
 /* Maximum number of devices per type */
 #define MAX_PV_INVERTERS     4
-#define MAX_BATTERY_BANKS    2
+#define MAX_BATTERY_BANKS    4      /* matches core.h */
 #define MAX_RELAYS           16
 #define MAX_METERS           8
 #define MAX_SENSORS          32
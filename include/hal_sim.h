@@ -0,0 +1,35 @@
+#ifndef HAL_SIM_H
+#define HAL_SIM_H
+
+#include "hal.h"
+#include "plant.h"
+
+/*
+ * Simulated HAL backend
+ *
+ * Implements the generic device calls of hal_pv.h, hal_battery.h,
+ * hal_meter.h and hal_relay.h on top of a plant twin instead of Modbus/CAN
+ * drivers. Device ids are indices: inverters and banks as the plant has
+ * them, meter 0 at the grid connection and meter 1 on the site loads, and
+ * relay modules of HAL_SIM_RELAY_CHANNELS channels each, module m channel c
+ * switching controllable load m * HAL_SIM_RELAY_CHANNELS + c.
+ *
+ * Readings describe the plant as of its last plant_step(); commands take
+ * effect on the next one. Like the hardware drivers it stands in for, the
+ * backend is driven from the control thread only.
+ */
+
+#define HAL_SIM_METER_GRID      0
+#define HAL_SIM_METER_LOAD      1
+#define HAL_SIM_METER_COUNT     2
+#define HAL_SIM_RELAY_CHANNELS  16
+#define HAL_SIM_MAX_RELAY_MODULES (CONFIG_MAX_LOADS / HAL_SIM_RELAY_CHANNELS)
+
+/* Function prototypes */
+hal_error_t hal_sim_attach(plant_t* plant);
+void hal_sim_detach(void);
+uint32_t hal_sim_inverter_count(void);
+uint32_t hal_sim_battery_count(void);
+uint32_t hal_sim_relay_module_count(void);
+
+#endif /* HAL_SIM_H */
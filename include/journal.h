@@ -0,0 +1,65 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Write-ahead event journal
+ *
+ * Append-only file of fixed-size binary records. Producers (control loop,
+ * web handlers) only copy a record into an in-memory queue; a background
+ * writer drains the queue in batches and issues a single write + fsync per
+ * batch (group commit), so the control cycle never blocks on disk I/O.
+ */
+
+#define JOURNAL_RECORD_SIZE         64
+#define JOURNAL_SOURCE_LEN          32
+#define JOURNAL_QUEUE_CAPACITY      1024    // records pending commit
+#define JOURNAL_COMMIT_INTERVAL_MS  250     // group commit window
+#define JOURNAL_INDEX_STRIDE        64      // one sparse index entry per N records
+
+/* Journaled event types */
+typedef enum {
+    JOURNAL_EVENT_FAULT_RAISED = 0,
+    JOURNAL_EVENT_FAULT_CLEARED,
+    JOURNAL_EVENT_MODE_CHANGE,
+    JOURNAL_EVENT_LOAD_SHED,
+    JOURNAL_EVENT_LOAD_RESTORE,
+    JOURNAL_EVENT_IRRIGATION_START,
+    JOURNAL_EVENT_IRRIGATION_STOP,
+    JOURNAL_EVENT_EV_SESSION_START,
+    JOURNAL_EVENT_EV_SESSION_PAUSE,
+    JOURNAL_EVENT_EV_SESSION_COMPLETE,
+    JOURNAL_EVENT_EV_FAULT,
+    JOURNAL_EVENT_OPERATOR_COMMAND,
+    JOURNAL_EVENT_ALARM_ACKNOWLEDGED,
+    JOURNAL_EVENT_CONFIG_RELOAD,
+    JOURNAL_EVENT_COUNT
+} journal_event_type_t;
+
+/* On-disk record (little-endian host layout, exactly JOURNAL_RECORD_SIZE bytes) */
+typedef struct {
+    uint64_t seq;                       // monotonically increasing sequence
+    int64_t timestamp_ms;               // wall clock, ms since epoch
+    uint16_t type;                      // journal_event_type_t
+    uint16_t code;                      // alarm code, mode, load/zone/charger index
+    uint32_t crc;                       // CRC-32 of the record with crc = 0
+    double value;                       // event specific payload (power, previous mode...)
+    char source[JOURNAL_SOURCE_LEN];    // load/zone/charger id or originator
+} journal_record_t;
+
+_Static_assert(sizeof(journal_record_t) == JOURNAL_RECORD_SIZE,
+               "journal_record_t must stay a fixed-size record");
+
+/* Function prototypes */
+int journal_open(const char* path);
+void journal_close(void);
+int journal_append(journal_event_type_t type, uint16_t code, double value, const char* source);
+int journal_flush(void);
+size_t journal_read_since(int64_t since_ms, journal_record_t* out, size_t max_records);
+const char* journal_event_type_str(journal_event_type_t type);
+void journal_log_status(void);
+
+#endif /* JOURNAL_H */
@@ -0,0 +1,71 @@
+#ifndef LOAD_FORECAST_H
+#define LOAD_FORECAST_H
+
+#include "core.h"
+#include <time.h>
+
+/*
+ * Site load forecast
+ *
+ * Consumption is learned per component (household loads, irrigation, EV
+ * charging) as 15-minute average power per weekday and local time of day,
+ * each slot an exponentially weighted average over the weeks it has been
+ * seen. A weekday-agnostic profile covers slots not seen yet on that
+ * weekday. A level term, the recent difference between observed and
+ * profile power, carries today's deviation into the next hours:
+ *
+ *   P(h) = profile(weekday, slot + h) + level exp(-h step / tau)
+ *
+ * All state is fixed-size (about 9 KB). The forecast vector is rebuilt
+ * every cycle, 96 slots x 3 components, in a few microseconds.
+ */
+
+#define LOAD_FORECAST_STEP_S        900     // slot length
+#define LOAD_FORECAST_SLOTS         96      // horizon and slots per day: 24 h
+#define LOAD_FORECAST_WEEKDAYS      7
+#define LOAD_FORECAST_WEEKLY_ALPHA  0.25    // per-week weight of a weekday slot
+#define LOAD_FORECAST_DAILY_ALPHA   0.15    // per-day weight of the weekday-agnostic slot
+#define LOAD_FORECAST_LEVEL_ALPHA   0.5     // per-slot weight of the level term
+#define LOAD_FORECAST_LEVEL_TAU_S   3600.0  // level decays over ~1 h of horizon
+
+typedef enum {
+    LOAD_COMPONENT_BASE = 0,                // load_power_total
+    LOAD_COMPONENT_IRRIGATION,
+    LOAD_COMPONENT_EV,
+    LOAD_COMPONENT_COUNT
+} load_component_t;
+
+typedef struct {
+    /* Slot being accumulated */
+    long slot;                              // absolute slot, -1 before the first sample
+    int weekday;                            // local, 0 = Sunday
+    int time_of_day;                        // local slot of the day
+    time_t last_sample;
+    double energy[LOAD_COMPONENT_COUNT];    // Ws
+    double seconds;
+    double last_power[LOAD_COMPONENT_COUNT];
+
+    /* Learned profiles, W */
+    float weekly[LOAD_COMPONENT_COUNT][LOAD_FORECAST_WEEKDAYS][LOAD_FORECAST_SLOTS];
+    uint16_t weekly_seen[LOAD_FORECAST_WEEKDAYS][LOAD_FORECAST_SLOTS];
+    float daily[LOAD_COMPONENT_COUNT][LOAD_FORECAST_SLOTS];
+    uint16_t daily_seen[LOAD_FORECAST_SLOTS];
+
+    double level[LOAD_COMPONENT_COUNT];     // observed minus profile, last closed slots
+    bool level_valid;
+
+    /* Forecast from the current slot on: component[c][h] and total[h] are
+     * the average power (W) of slot first_slot + h */
+    float component[LOAD_COMPONENT_COUNT][LOAD_FORECAST_SLOTS];
+    float total[LOAD_FORECAST_SLOTS];
+    long first_slot;                        // -1 before the first forecast
+} load_forecast_t;
+
+/* Function prototypes */
+void load_forecast_init(load_forecast_t* fc);
+void load_forecast_update(load_forecast_t* fc, time_t now, double base_w, double irrigation_w, double ev_w);
+double load_forecast_power_at(const load_forecast_t* fc, time_t t);
+double load_forecast_energy(const load_forecast_t* fc, time_t from, time_t to);
+double load_forecast_peak(const load_forecast_t* fc, time_t from, time_t to);
+
+#endif /* LOAD_FORECAST_H */
@@ -2,6 +2,9 @@
 #define LOADS_H
 
 #include "core.h"
+#include "load_forecast.h"
+#include "shed_solver.h"
+#include "defer_planner.h"
 
 /* Load control states */
 typedef enum {
@@ -12,6 +15,23 @@ typedef enum {
     LOAD_STATE_FAULT
 } load_state_t;
 
+/* Island shedding looks this far ahead in the load forecast, so a known
+ * peak is met by shedding before it arrives rather than after */
+#define LOADS_FORECAST_LOOKAHEAD_S  900
+
+/* Impact of shedding a load, as weighed by the shedding solver: the
+ * priority weight, raised with the outage a load has already taken and
+ * while it has only just come back on (so the same loads are not hit every
+ * episode), and for loads that stay locked out long once off. A small
+ * per-watt term prefers the set overshooting least. */
+#define LOADS_SHED_WEIGHT_HIGH      27.0
+#define LOADS_SHED_WEIGHT_MEDIUM    9.0
+#define LOADS_SHED_WEIGHT_LOW       3.0
+#define LOADS_SHED_WEIGHT_NON_ESSENTIAL 1.0
+#define LOADS_SHED_LOCKOUT_REF_S    1800.0  // min_off_time that doubles the impact
+#define LOADS_SHED_FAIR_REF_S       3600.0  // accumulated shed time that doubles the impact
+#define LOADS_SHED_OVERSHOOT_WEIGHT 0.1     // per need-sized share of power shed
+
 /* Load scheduling modes */
 typedef enum {
     SCHEDULE_NONE = 0,
@@ -20,27 +40,81 @@ typedef enum {
     SCHEDULE_POWER_BASED
 } schedule_mode_t;
 
+#define LOAD_PRIORITY_LEVELS    5       // PRIORITY_CRITICAL .. PRIORITY_NON_ESSENTIAL
+
+/*
+ * Switching order
+ *
+ * Every load the manager may switch sits in heaps per priority. While its
+ * minimum on/off time runs, a load waits in sheddable[] (ON) or shed[]
+ * (SHED), keyed on when that time runs out, so one look at the top tells
+ * whether anything is due. Once free to switch it moves to to_shed[] or
+ * to_restore[], ordered for fairness by the outage each load has already
+ * taken: loads ON least shed first, loads SHED most deprived first. Every
+ * SHED load is also in spell, longest current spell first, which is how
+ * max_shed_duration is enforced. Ties go to the larger load (fewer relay
+ * operations for the same power).
+ *
+ * Shedding, restoring and rotating k loads cost O(k log n); state changes
+ * keep the heaps, the per-state aggregates and the accumulated shed time
+ * current, so nothing rescans the table each cycle.
+ */
+typedef struct {
+    double* key;
+    int* load;                          // load index
+    int* slot;                          // position of each load in this heap, -1 if not in it
+    int count;
+    int capacity;
+} load_heap_t;
+
 /* Load management context */
 typedef struct {
-    load_definition_t loads[MAX_CONTROLLABLE_LOADS];
-    load_state_t load_states[MAX_CONTROLLABLE_LOADS];
+    /* Load table, sized to the configuration */
+    load_definition_t* loads;
+    load_state_t* load_states;
+    double* shed_seconds;               // time shed over finished spells, s
+    int* heap_slot;                     // position in the switching heap holding the load
+    load_heap_t** heap_of;              // that heap, NULL if none
+    int* spell_slot;                    // position in spell while SHED
+    int* scratch;                       // loads set aside while walking a heap
     int load_count;
-    
-    /* Load groups by priority */
-    double priority_power[5];  // Total power per priority level
-    int priority_count[5];     // Count of loads per priority
+
+    load_heap_t sheddable[LOAD_PRIORITY_LEVELS];    // ON, minimum on time running
+    load_heap_t shed[LOAD_PRIORITY_LEVELS];         // SHED, minimum off time running
+    load_heap_t to_shed[LOAD_PRIORITY_LEVELS];      // ON and free to switch, least shed first
+    load_heap_t to_restore[LOAD_PRIORITY_LEVELS];   // SHED and free to switch, most deprived first
+    load_heap_t spell;                  // every SHED load, longest current spell first
+    shed_solver_t shed_solver;          // which loads to shed, greedy heaps as fallback
+
+    /* Aggregates, updated on every state change */
+    double priority_power[LOAD_PRIORITY_LEVELS];    // rated power of loads ON, per priority
+    int priority_count[LOAD_PRIORITY_LEVELS];       // loads ON, per priority
+    double deferrable_power;            // ON and deferrable
+    double shed_power;                  // rated power currently shed, W
+    int shed_count;
+    double deferred_power;              // waiting in LOAD_STATE_DEFERRED
     
     /* Shedding control */
     bool shedding_active;
     double shed_power_target;
     time_t shedding_start_time;
     
-    /* Deferrable loads */
-    double deferred_power;
-    time_t next_deferrable_start;
+    /* Deferrable loads with a daily energy (the planned loads) wait
+     * DEFERRED and run when the planner's plan says so */
+    defer_planner_t defer_planner;
+    double* delivered_wh;               // delivered towards the daily energy
+    time_t* defer_due;                  // when the daily energy is due, 0 if unplanned
+    int* defer_job;                     // job in the current plan, -1 if none
+    bool defer_replan;                  // a deadline rolled over or the table changed
+    time_t defer_update_ts;
+    uint32_t defer_missed;              // deadlines passed with energy undelivered
     
+    /* Site demand forecast (loads, irrigation, EV) */
+    load_forecast_t forecast;
+
     /* Statistics */
-    double total_energy_consumed;
+    double total_energy_consumed;       // kWh at rated power
+    time_t energy_update_ts;
     uint32_t shed_event_count;
     uint32_t restart_event_count;
     
@@ -50,17 +124,35 @@ typedef struct {
     double load_rotation_interval;
 } load_manager_t;
 
+/* A reloaded load table, built before anything is changed */
+typedef struct {
+    load_manager_t* next;               // NULL once committed or discarded
+    int kept;                           // loads carrying their runtime state over
+} loads_config_stage_t;
+
 /* Function prototypes */
 int loads_init(load_manager_t* lm, const system_config_t* config);
+int loads_apply_config(load_manager_t* lm, const system_config_t* config);
+int loads_prepare_config(const load_manager_t* lm, const system_config_t* config, loads_config_stage_t* stage);
+void loads_commit_config(load_manager_t* lm, loads_config_stage_t* stage);
+void loads_discard_config(loads_config_stage_t* stage);
+void loads_cleanup(load_manager_t* lm);
+int loads_find(const load_manager_t* lm, const char* id);
+int loads_set_state(load_manager_t* lm, int load_index, load_state_t state);
 void loads_update_measurements(load_manager_t* lm, system_measurements_t* measurements);
+void loads_update_forecast(load_manager_t* lm, const system_measurements_t* measurements);
 bool loads_manage_shedding(load_manager_t* lm, double available_power, double total_load,
     double battery_soc, bool grid_available);
-void loads_restore_shed(load_manager_t* lm, double available_power);
-void loads_rotate_shedding(load_manager_t* lm);
-void loads_prioritize_deferrable(load_manager_t* lm, double excess_power);
+void loads_restore_shed(load_manager_t* lm, double excess_power);
+void loads_rotate_shedding(load_manager_t* lm, double headroom_w);
+int loads_plan_deferrable(load_manager_t* lm, time_t start, const float* surplus_w);
+void loads_run_deferrable(load_manager_t* lm, time_t now);
+double loads_plan_power_w(const load_manager_t* lm, time_t from, time_t to);
+double loads_planned_power(const load_manager_t* lm);
 bool loads_check_timing_constraints(const load_manager_t* lm, int load_index);
 void loads_log_status(const load_manager_t* lm);
 double loads_calculate_power_needed(const load_manager_t* lm);
+double loads_shed_seconds(const load_manager_t* lm, int load_index);
 void loads_update_energy_consumed(load_manager_t* lm);
 bool loads_can_shed_load(const load_manager_t* lm, int load_index, double available_power);
 
@@ -0,0 +1,209 @@
+#ifndef PLANT_H
+#define PLANT_H
+
+#include "core.h"
+#include "controller.h"
+#include "solar.h"
+#include <time.h>
+
+/*
+ * Digital twin of the site
+ *
+ * Physical models standing in for the hardware behind the HAL, built from
+ * the controller's nameplate data (PV strings, battery banks, load table,
+ * site position) and integrated to a given time by plant_step():
+ *
+ *   PV       clear-sky irradiance on each string's plane (solar.h) scaled by
+ *            a cloud field, log clearness an Ornstein-Uhlenbeck process;
+ *            cell temperature derating, inverter efficiency and power limit
+ *   battery  per cell: OCV(SOC, T) + two RC pairs + R0 with the chemistry
+ *            parameters the SOC estimator assumes, each cell with its own
+ *            capacity, resistance and starting SOC spread; BMS cut-offs on
+ *            cell voltage; one lumped thermal node per bank
+ *   loads    an uncontrolled base load on a daily profile with lognormal
+ *            noise, plus one relay channel per controllable load, each
+ *            cycling between running and idle as a two-state Markov chain
+ *   grid     meter at the point of connection; outages as a Poisson process
+ *            with exponential durations, or forced
+ *
+ * Grid-connected the banks follow their current commands and the grid
+ * takes the rest. Islanded the banks form the grid: they carry the net load
+ * up to their limits, surplus PV is throttled and a deficit is unserved.
+ *
+ * The plant holds no clock of its own; the caller passes the time to
+ * integrate to, so it runs in lockstep with whatever clock drives it.
+ */
+
+#define PLANT_MAX_INVERTERS         4       // inverters behind the HAL
+#define PLANT_STRINGS_REPORTED      8       // string records per inverter reading
+#define PLANT_MAX_CELLS             BATTERY_CELLS_MAX_PER_BANK
+#define PLANT_STRINGS_PER_INVERTER  8       // strings grouped onto one inverter
+#define PLANT_MAX_STEP_S            5.0     // longer intervals run in sub-steps
+
+#define PLANT_CLOUD_TAU_S           1200.0  // persistence of the cloud field
+#define PLANT_CLOUD_SIGMA           0.5     // stationary sd of the log clearness
+#define PLANT_CLEARNESS_MEAN        0.8
+#define PLANT_LOAD_TAU_S            1800.0
+#define PLANT_LOAD_SIGMA            0.3
+#define PLANT_LOAD_RUN_S            1200.0  // mean running spell of a cycling load
+#define PLANT_LOAD_IDLE_S           600.0   // mean idle spell
+#define PLANT_BASE_LOAD_W           400.0   // uncontrolled consumption, daily mean
+#define PLANT_INVERTER_EFFICIENCY   0.97
+#define PLANT_DC_LOSSES             0.95    // soiling and wiring
+#define PLANT_CELL_SPREAD           0.02    // capacity and resistance spread between cells
+#define PLANT_GRID_VOLTAGE          240.0
+#define PLANT_GRID_FREQUENCY        60.0
+#define PLANT_OUTAGE_RATE_PER_DAY   0.0     // random outages off unless configured
+#define PLANT_OUTAGE_MEAN_S         1800.0
+
+/* One inverter and its strings (a contiguous range of the solar array) */
+typedef struct {
+    int first_string;
+    int string_count;
+    double rated_w;                     // AC rating, sum of its strings
+    double vmp_stc;                     // string maximum-power voltage at 25 °C
+    double voc_stc;
+    double limit_percent;               // commanded power limit
+    bool enabled;
+
+    double dc_voltage;
+    double dc_current;
+    double dc_power;
+    double ac_power;
+    double temperature_c;
+    float string_voltage[PLANT_STRINGS_REPORTED];
+    float string_current[PLANT_STRINGS_REPORTED];
+    float string_power[PLANT_STRINGS_REPORTED];
+
+    double energy_wh;
+    double daily_wh;
+    unsigned start_count;
+} plant_inverter_t;
+
+/* One battery bank, cells in series */
+typedef struct {
+    bool enabled;
+    int series;
+    double capacity_ah;
+    double max_charge_a;                // BMS limits
+    double max_discharge_a;
+
+    double v_max_cell;                  // BMS cut-offs
+    double v_min_cell;
+
+    /* Per cell */
+    float soc[PLANT_MAX_CELLS];         // 0..1
+    float capacity[PLANT_MAX_CELLS];    // Ah
+    float r0[PLANT_MAX_CELLS];          // ohm
+    float v1[PLANT_MAX_CELLS];          // RC pair voltages
+    float v2[PLANT_MAX_CELLS];
+    float cell_voltage[PLANT_MAX_CELLS];
+    float temperature[PLANT_MAX_CELLS];
+    double r1, r2;                      // ohm, shared
+    double tau1, tau2;                  // s
+
+    /* Commands, current positive = charging */
+    bool charge_enabled;
+    bool discharge_enabled;
+    double command_a;
+    double charge_limit_a;
+    double discharge_limit_a;
+
+    /* State */
+    double current_a;
+    double voltage;
+    double temperature_c;
+    double heat_w;
+    double heat_capacity_jk;
+    double conductance_wk;
+
+    double charge_wh;
+    double discharge_wh;
+    time_t last_full_charge;
+} plant_bank_t;
+
+/* One relay channel with the load behind it */
+typedef struct {
+    double rated_w;
+    bool cycling;                       // runs in spells; critical loads run continuously
+    bool relay_on;
+    bool running;
+    double power_w;
+    unsigned on_count;
+    unsigned fault_count;
+    time_t last_change;
+} plant_load_t;
+
+typedef struct {
+    bool available;
+    bool forced_down;
+    double outage_until;                // random outage end, 0 when none
+    double next_outage;                 // start of the next random outage
+    double outage_rate_per_day;
+    double outage_mean_s;
+
+    double voltage;
+    double frequency;
+    double power_w;                     // positive = import
+    double import_wh;
+    double export_wh;
+    double peak_import_w;
+    double peak_export_w;
+    time_t peak_import_time;
+    time_t peak_export_time;
+    unsigned outage_count;
+} plant_grid_t;
+
+/* Generator: xorshift64*, normals by Box-Muller in pairs */
+typedef struct {
+    uint64_t state;
+    double spare;
+    bool has_spare;
+} plant_rng_t;
+
+typedef struct {
+    double t;                           // unix seconds integrated to
+    plant_rng_t rng;
+
+    /* Environment */
+    solar_site_t site;
+    solar_day_table_t sun;
+    solar_array_t array;
+    double cloud;                       // log clearness anomaly
+    double clearness;
+    double ambient_c;
+
+    plant_inverter_t inverters[PLANT_MAX_INVERTERS];
+    int inverter_count;
+
+    battery_chemistry_e chemistry;
+    plant_bank_t banks[MAX_BATTERY_BANKS];
+    int bank_count;
+
+    plant_load_t* loads;                // one per controllable load
+    int load_count;
+    double base_load_w;
+    double base_noise;                  // log anomaly of the base load
+    double external_w;                  // consumers modelled elsewhere (irrigation, EV)
+
+    plant_grid_t grid;
+
+    /* Balance of the last step, W */
+    double pv_w;
+    double load_w;                      // served site load, base plus channels
+    double battery_w;                   // positive = discharge
+    double curtailed_w;
+    double unserved_w;
+    double unserved_wh;
+} plant_t;
+
+/* Function prototypes */
+int plant_init(plant_t* plant, const system_controller_t* ctrl, uint64_t seed, double start);
+void plant_free(plant_t* plant);
+void plant_step(plant_t* plant, double now);
+void plant_set_grid(plant_t* plant, bool available);
+void plant_set_outages(plant_t* plant, double rate_per_day, double mean_s);
+void plant_set_external_load(plant_t* plant, double power_w);
+void plant_log_status(const plant_t* plant);
+
+#endif /* PLANT_H */
@@ -2,6 +2,10 @@
 #define PV_H
 
 #include "core.h"
+#include "pv_strings.h"
+#include "pv_mppt.h"
+#include "solar.h"
+#include "pv_forecast.h"
 
 /* PV system states */
 typedef enum {
@@ -13,30 +17,34 @@ typedef enum {
     PV_STATE_MAINTENANCE
 } pv_state_t;
 
-/* MPPT algorithms */
-typedef enum {
-    MPPT_OFF = 0,
-    MPPT_PERTURB_OBSERVE,
-    MPPT_INCREMENTAL_CONDUCTANCE,
-    MPPT_CONSTANT_VOLTAGE
-} mppt_algorithm_t;
-
 /* PV system context */
 typedef struct {
     pv_state_t state;
     mppt_algorithm_t mppt_algorithm;
     
-    pv_string_t strings[MAX_PV_STRINGS];
+    pv_string_t* strings;               // string_count entries, sized from the config
+    int string_count;
     int active_string_count;
+    pv_string_telemetry_t telemetry;    // per-string readings and detector state
     
     double total_capacity;      // Total installed capacity (W)
     double available_power;     // Currently available power (W)
     double max_operating_power; // Current max operating power (W)
     
     /* MPPT tracking */
-    double mppt_voltage_ref;
-    double mppt_power_ref;
-    double mppt_step_size;
+    pv_mppt_tracker_t mppt_tracker;     // control-cycle tracking when no worker runs
+    pv_mppt_worker_t* mppt;             // per-inverter MPPT threads, NULL when not running (see pv_mppt.h)
+    double mppt_energy_wh;              // worker energy already accounted
+    double last_update_time;            // monotonic seconds of the last measurement update
+    
+    /* Clear-sky model */
+    solar_site_t site;
+    solar_day_table_t sun;              // sun position and irradiance, rebuilt once per UTC day
+    solar_array_t solar;                // per-string planes and expected power
+    solar_sample_t sun_now;             // sample for the current cycle
+    double expected_power;              // W, clear-sky power of the healthy strings
+    double ambient_temperature_c;
+    pv_forecast_t forecast;             // production forecast, next 24 h in 15 min slots
     
     /* Statistics */
     double daily_energy;
@@ -50,11 +58,25 @@ typedef struct {
     char last_fault_reason[64];
 } pv_system_t;
 
+/* A reloaded string table, built before anything is changed */
+typedef struct {
+    pv_string_t* strings;
+    pv_string_telemetry_t telemetry;
+    solar_array_t solar;
+    int count;                          // 0 when the string count is unchanged
+} pv_config_stage_t;
+
 /* Function prototypes */
 int pv_init(pv_system_t* pv, const system_config_t* config);
+int pv_apply_config(pv_system_t* pv, const system_config_t* config);
+int pv_prepare_config(const pv_system_t* pv, const system_config_t* config, pv_config_stage_t* stage);
+void pv_commit_config(pv_system_t* pv, const system_config_t* config, pv_config_stage_t* stage);
+void pv_discard_config(pv_config_stage_t* stage);
+void pv_cleanup(pv_system_t* pv);
 void pv_update_measurements(pv_system_t* pv, system_measurements_t* measurements);
 double pv_calculate_available_power(pv_system_t* pv, system_measurements_t* measurements);
 void pv_run_mppt(pv_system_t* pv, system_measurements_t* measurements);
+void pv_attach_mppt(pv_system_t* pv, pv_mppt_worker_t* worker);
 void pv_apply_curtailment(pv_system_t* pv, double curtail_percent);
 bool pv_detect_faults(pv_system_t* pv, system_measurements_t* measurements);
 void pv_clear_faults(pv_system_t* pv);
@@ -0,0 +1,61 @@
+#ifndef PV_FORECAST_H
+#define PV_FORECAST_H
+
+#include "core.h"
+#include <time.h>
+
+/*
+ * Short-horizon PV production forecast
+ *
+ * Production is forecast per 15-minute slot as clear-sky power times a
+ * clear-sky index k. Each closed slot yields one observed k (measured over
+ * clear-sky energy), which feeds
+ *
+ *   - history: one slow average per time-of-day slot across days (the
+ *     site's usual pattern: morning fog, afternoon build-up)
+ *   - persistence: a fast average of how far recent slots were off their
+ *     history (today is cloudier or clearer than usual)
+ *
+ * A slot h steps ahead gets k = k_history + w anomaly with
+ * w = exp(-h step / tau), so today's departure from the usual pattern
+ * dominates the next hour and fades into history over the day. State is a few fixed arrays; updates are
+ * O(1) per cycle plus one O(horizon) pass per closed slot.
+ */
+
+#define PV_FORECAST_STEP_S          900     // slot length
+#define PV_FORECAST_SLOTS           96      // horizon: 24 h
+#define PV_FORECAST_PERSIST_TAU_S   5400.0  // persistence weight decays over ~1.5 h
+#define PV_FORECAST_PERSIST_ALPHA   0.5     // per-slot weight of the anomaly average
+#define PV_FORECAST_HISTORY_ALPHA   0.2     // per-day weight of the time-of-day history
+#define PV_FORECAST_DEFAULT_INDEX   0.75    // k before any history exists
+#define PV_FORECAST_MAX_INDEX       1.3     // cloud-edge enhancement can exceed clear sky
+#define PV_FORECAST_MIN_CLEAR_WH    1.0     // slots with less clear-sky energy say nothing about k
+
+typedef struct {
+    long slot;                              // absolute slot being accumulated, -1 before the first sample
+    time_t last_sample;
+    double measured_wh;                     // current slot
+    double clear_wh;
+
+    double k_anomaly;                       // recent k minus history
+    bool anomaly_valid;
+    float k_history[PV_FORECAST_SLOTS];     // per time-of-day slot (UTC)
+    uint16_t history_days[PV_FORECAST_SLOTS];
+
+    /* Ring of predictions: predicted[s % PV_FORECAST_SLOTS] is the average
+     * power (W) of absolute slot s, for s in [first_slot, first_slot + SLOTS) */
+    float predicted[PV_FORECAST_SLOTS];
+    long first_slot;                        // slot of the last prediction pass, -1 before it
+} pv_forecast_t;
+
+/* Clear-sky power (W) at a time, supplied by the PV model */
+typedef double (*pv_forecast_clear_sky_fn)(void* ctx, time_t t);
+
+/* Function prototypes */
+void pv_forecast_init(pv_forecast_t* fc);
+bool pv_forecast_observe(pv_forecast_t* fc, time_t now, double measured_w, double clear_sky_w);
+void pv_forecast_predict(pv_forecast_t* fc, time_t now, pv_forecast_clear_sky_fn clear_sky, void* ctx);
+double pv_forecast_power_at(const pv_forecast_t* fc, time_t t);
+double pv_forecast_energy(const pv_forecast_t* fc, time_t from, time_t to);
+
+#endif /* PV_FORECAST_H */
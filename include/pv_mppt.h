@@ -0,0 +1,116 @@
+#ifndef PV_MPPT_H
+#define PV_MPPT_H
+
+#include "core.h"
+#include "pv_strings.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+/*
+ * High-rate MPPT workers
+ *
+ * Maximum power point tracking has to follow irradiance, which moves within
+ * a second under passing clouds, so it cannot live in the 1 s control cycle.
+ * Each inverter gets its own thread on an absolute CLOCK_MONOTONIC schedule
+ * (10-100 Hz): it reads the inverter's DC voltage and power, steps its
+ * tracker and hands the new voltage reference back to the inverter.
+ *
+ * Results are published per inverter through a sequence lock, so the
+ * control thread reads a consistent snapshot without blocking a worker.
+ *
+ * The digital twin starts one worker per plant inverter (twin_init); they
+ * read the DC side the twin publishes after each plant step. The hardware
+ * integration (hal_integration.c, ems_hal_mppt_start) does the same against
+ * the HAL but is not part of the build yet. Without workers the control
+ * cycle tracks on the aggregate input (pv_run_mppt).
+ */
+
+#define PV_MPPT_STEP_V          0.5     // reference step per perturbation
+#define PV_MPPT_CV_FRACTION     0.78    // constant-voltage reference, of Voc
+#define PV_MPPT_STALE_PERIODS   5       // snapshots older than this many periods are ignored
+
+/* MPPT algorithms */
+typedef enum {
+    MPPT_OFF = 0,
+    MPPT_PERTURB_OBSERVE,
+    MPPT_INCREMENTAL_CONDUCTANCE,
+    MPPT_CONSTANT_VOLTAGE
+} mppt_algorithm_t;
+
+/* Tracker state for one MPPT input */
+typedef struct {
+    mppt_algorithm_t algorithm;
+    double step_size;               // V
+    double voltage_ref;             // V, reference handed to the inverter
+    double voltage_min;             // V, clamp derived from Voc
+    double voltage_max;
+    double direction;               // +1/-1, perturb & observe
+    double prev_voltage;
+    double prev_power;
+    bool primed;                    // prev_* hold a sample
+} pv_mppt_tracker_t;
+
+/* Inverter I/O supplied by the HAL. read returns 0 on success;
+ * set_voltage may be NULL for inverters that track internally. */
+typedef struct {
+    int (*read)(void* ctx, int inverter, double* dc_voltage, double* dc_power);
+    int (*set_voltage)(void* ctx, int inverter, double voltage_ref);
+    void* ctx;
+} pv_mppt_io_t;
+
+/* Consistent copy of one inverter's published state */
+typedef struct {
+    double available_power;         // W at the tracked operating point
+    double voltage;                 // V, last DC reading
+    double voltage_ref;             // V
+    double energy_wh;               // integrated at the tracking rate since start, on the control clock
+    double updated;                 // CLOCK_MONOTONIC seconds of the last good sample
+} pv_mppt_snapshot_t;
+
+struct pv_mppt_worker;
+
+/* One inverter's thread and its published state (written by that thread only) */
+typedef struct {
+    int inverter;
+    pthread_t thread;
+    bool started;
+    struct pv_mppt_worker* owner;
+
+    atomic_uint seq;                // odd while a publish is in progress
+    _Atomic double available_power;
+    _Atomic double voltage;
+    _Atomic double voltage_ref;
+    _Atomic double energy_wh;
+    _Atomic double updated;
+
+    atomic_uint samples;
+    atomic_uint read_errors;
+    atomic_uint overruns;           // periods missed because a step ran late
+} pv_mppt_task_t;
+
+typedef struct pv_mppt_worker {
+    pv_mppt_task_t tasks[PV_MAX_STRING_GROUPS];
+    int task_count;
+
+    pv_mppt_io_t io;
+    double open_circuit_voltage;    // V, proxy Voc for the reference clamp
+
+    atomic_bool running;
+    atomic_int rate_hz;             // picked up by the workers on their next period
+    atomic_int algorithm;           // mppt_algorithm_t, likewise
+} pv_mppt_worker_t;
+
+/* Function prototypes */
+void pv_mppt_tracker_init(pv_mppt_tracker_t* tracker, mppt_algorithm_t algorithm, double open_circuit_voltage);
+double pv_mppt_tracker_step(pv_mppt_tracker_t* tracker, double voltage, double power);
+int pv_mppt_start(pv_mppt_worker_t* worker, int inverter_count, int rate_hz, mppt_algorithm_t algorithm,
+                  double open_circuit_voltage, const pv_mppt_io_t* io);
+void pv_mppt_stop(pv_mppt_worker_t* worker);
+void pv_mppt_set_rate(pv_mppt_worker_t* worker, int rate_hz);
+void pv_mppt_set_algorithm(pv_mppt_worker_t* worker, mppt_algorithm_t algorithm);
+bool pv_mppt_snapshot(const pv_mppt_worker_t* worker, int inverter, pv_mppt_snapshot_t* snapshot);
+int pv_mppt_collect(const pv_mppt_worker_t* worker, double* power, double* energy_wh);
+const char* pv_mppt_algorithm_str(mppt_algorithm_t algorithm);
+
+#endif /* PV_MPPT_H */
@@ -0,0 +1,84 @@
+#ifndef PV_STRINGS_H
+#define PV_STRINGS_H
+
+#include "core.h"
+#include <time.h>
+
+/*
+ * Per-string PV telemetry (structure-of-arrays, sized at init)
+ *
+ * Strings are reported in groups, one per inverter; each group owns a
+ * contiguous range of the arrays, fixed the first time the inverter reports.
+ * Fault detection compares every string with the median of its group peers
+ * (strings on one inverter share irradiance and temperature), so a single
+ * branch-free pass over each range computes relative voltage/current
+ * deviation and the fault signature. Medians come from a quickselect on a
+ * scratch copy, O(n) per group.
+ */
+
+#define PV_MAX_STRING_GROUPS    32      // inverters
+#define FAULT_VOLTAGE_THRESHOLD 0.3     // 30% voltage deviation from the peer median
+#define FAULT_CURRENT_THRESHOLD 0.5     // 50% current imbalance against the peer median
+#define PV_FAULT_DEBOUNCE       2       // consecutive faulty samples before a string is marked
+#define PV_SHADING_THRESHOLD    0.15    // current deficit vs peers that indicates shading
+#define PV_SOILING_THRESHOLD    0.05    // persistent (averaged) current deficit that indicates soiling
+#define PV_SOILING_ALPHA        (1.0f / 3600.0f)   // per-sample weight of the soiling average
+#define PV_MIN_DETECT_FRACTION  0.05    // group median current below this share of rating: too dark to compare
+#define PV_MIN_PEERS            3       // fewer reporting strings and peer comparison is skipped
+
+/* Per-string classification from the last detector pass, in increasing
+ * priority: when several signatures match, the highest value wins */
+typedef enum {
+    PV_SIGNATURE_NORMAL = 0,
+    PV_SIGNATURE_SOILED,            // small persistent current deficit
+    PV_SIGNATURE_SHADED,            // current deficit, voltage in line with peers
+    PV_SIGNATURE_CURRENT_MISMATCH,  // current off the peer median beyond the fault threshold
+    PV_SIGNATURE_VOLTAGE_MISMATCH,  // voltage off the peer median (bypass diode, shorted module)
+    PV_SIGNATURE_OPEN,              // no current while peers produce
+    PV_SIGNATURE_OVER_LIMIT         // above the string's voltage or current rating
+} pv_string_signature_t;
+
+#define PV_SIGNATURE_IS_FAULT(s)    ((s) >= PV_SIGNATURE_CURRENT_MISMATCH)
+
+typedef struct {
+    int first;                      // offset into the arrays
+    int capacity;                   // strings reserved for the group
+    int count;                      // strings in the latest report
+    time_t updated;
+} pv_string_group_t;
+
+typedef struct {
+    int capacity;                   // allocated strings
+    int used;                       // strings reserved by groups
+
+    // Latest readings
+    float* voltage;
+    float* current;
+
+    // Ratings (copied from the string table)
+    float* voltage_limit;
+    float* current_limit;
+
+    // Detector output
+    float* v_dev;                   // (V - group median) / group median
+    float* i_dev;
+    float* i_dev_avg;               // slow average of i_dev (soiling)
+    uint8_t* signature;             // pv_string_signature_t
+    uint8_t* consecutive;           // debounce counters
+
+    float* scratch;                 // median workspace
+
+    pv_string_group_t groups[PV_MAX_STRING_GROUPS];
+    int group_count;
+} pv_string_telemetry_t;
+
+/* Function prototypes */
+int pv_strings_alloc(pv_string_telemetry_t* t, int capacity);
+void pv_strings_free(pv_string_telemetry_t* t);
+int pv_strings_ingest(pv_string_telemetry_t* t, int group, const float* voltage,
+                      const float* current, int count, time_t timestamp);
+void pv_strings_clear(pv_string_telemetry_t* t, int group);
+int pv_strings_detect(pv_string_telemetry_t* t);
+const char* pv_string_signature_str(pv_string_signature_t signature);
+
+#endif /* PV_STRINGS_H */
@@ -0,0 +1,99 @@
+#ifndef QP_H
+#define QP_H
+
+#include "core.h"
+
+/*
+ * Embedded convex QP solver (ADMM, OSQP iteration)
+ *
+ *   minimize    1/2 x' P x + q' x
+ *   subject to  l <= A x <= u
+ *
+ * P is diagonal and A sparse (rows stored CSR). Every iteration solves
+ * (P + sigma I + A' R A) x = b with R = diag(rho); for problems whose
+ * variables are ordered along time that matrix is banded, so it is factored
+ * as a band Cholesky in O(n bw^2) and each solve costs O(n bw). The
+ * bandwidth is fixed at allocation; rows that would exceed it are rejected.
+ *
+ * Rows with l == u are equalities and get a larger rho. x, z and y persist
+ * between solves, so a caller that re-solves a shifted problem can
+ * warm-start by shifting them (qp_shift). rho adapts to the residual
+ * balance; every change is one refactorisation, and each solve starts
+ * with one, so P and A may change freely between solves.
+ */
+
+#define QP_INFINITY         1e20
+#define QP_RHO_DEFAULT      0.1
+#define QP_RHO_EQ_SCALE     1e3     // equality rows
+#define QP_RHO_MIN          1e-6
+#define QP_RHO_MAX          1e6
+#define QP_SIGMA            1e-6
+#define QP_ALPHA            1.6     // over-relaxation
+#define QP_EPS_ABS          1e-3
+#define QP_EPS_REL          1e-3
+#define QP_MAX_ITER         4000
+#define QP_CHECK_EVERY      25      // residual check / rho adaptation period
+
+typedef enum {
+    QP_SOLVED = 0,
+    QP_MAX_ITER_REACHED,            // x is the last iterate, usable but not converged
+    QP_NUMERICAL_ERROR,
+    QP_INVALID
+} qp_status_t;
+
+typedef struct {
+    int n;                          // variables, may shrink below the allocation between solves
+    int m;                          // rows
+    int bandwidth;                  // half-bandwidth of the KKT matrix
+    int max_rows;
+    int max_nnz;
+
+    /* Problem */
+    double* p_diag;                 // [n]
+    double* q;                      // [n]
+    int* row_start;                 // [max_rows + 1], CSR
+    int* col;                       // [max_nnz]
+    double* val;                    // [max_nnz]
+    double* l;                      // [max_rows]
+    double* u;                      // [max_rows]
+
+    /* Iterates, persistent for warm starts */
+    double* x;                      // [n]
+    double* z;                      // [max_rows]
+    double* y;                      // [max_rows]
+
+    /* Workspace */
+    double* rho_row;                // [max_rows]
+    double* rho_inv;                // [max_rows]
+    double* band;                   // [n (bandwidth + 1)], L of the band Cholesky
+    double* diag_inv;               // [n], 1 / L(i, i)
+    double* rhs;                    // [n]
+    double* x_tilde;                // [n]
+    double* z_tilde;                // [max_rows]
+    double rho;
+    bool factored;
+
+    /* Settings, defaults from qp_alloc */
+    double eps_abs;
+    double eps_rel;
+    int max_iter;
+
+    /* Result of the last solve */
+    qp_status_t status;
+    int iterations;
+    double primal_residual;
+    double dual_residual;
+    double objective;
+} qp_t;
+
+/* Function prototypes */
+int qp_alloc(qp_t* qp, int n, int max_rows, int max_nnz, int bandwidth);
+void qp_free(qp_t* qp);
+void qp_clear_rows(qp_t* qp);
+int qp_add_row(qp_t* qp, const int* cols, const double* vals, int count, double lower, double upper);
+void qp_cold_start(qp_t* qp);
+void qp_shift(qp_t* qp, int var_shift, int row_shift);
+qp_status_t qp_solve(qp_t* qp);
+const char* qp_status_str(qp_status_t status);
+
+#endif /* QP_H */
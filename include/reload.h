@@ -0,0 +1,53 @@
+#ifndef RELOAD_H
+#define RELOAD_H
+
+#include "core.h"
+#include "config.h"
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+/*
+ * Live configuration reload
+ *
+ * Requests (SIGHUP or an API POST) only wake a worker thread; the worker
+ * reads, parses and validates the new configuration off the control thread
+ * and publishes it through an atomic pointer. The control loop picks the
+ * staged configuration up between cycles and applies it with
+ * controller_apply_config(), so a cycle never sees a half-applied config.
+ */
+
+#define RELOAD_MAX_BODY     (8u * 1024 * 1024)    // largest config accepted over the API
+
+/* Reload context */
+typedef struct {
+    char config_path[256];
+
+    pthread_t thread;
+    sem_t wakeup;                           // posted by requests (async-signal-safe)
+    atomic_bool running;
+    atomic_bool file_requested;             // re-read config_path
+
+    /* Config document submitted over the API, consumed by the worker */
+    pthread_mutex_t body_lock;
+    char* pending_body;
+    size_t pending_length;
+
+    /* Validated config waiting for the next cycle boundary (owned by the context) */
+    _Atomic(system_config_t*) staged;
+
+    /* Statistics */
+    atomic_uint reload_count;               // configs staged
+    atomic_uint reject_count;               // requests that failed parse/validation
+    atomic_int last_result;                 // config_error_t of the last request
+} config_reload_t;
+
+/* Function prototypes */
+int config_reload_start(config_reload_t* rl, const char* config_path);
+void config_reload_stop(config_reload_t* rl);
+void config_reload_request_file(config_reload_t* rl);
+int config_reload_submit(config_reload_t* rl, const char* json, size_t length);
+system_config_t* config_reload_take(config_reload_t* rl);
+
+#endif /* RELOAD_H */
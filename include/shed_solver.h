@@ -0,0 +1,55 @@
+#ifndef SHED_SOLVER_H
+#define SHED_SOLVER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Load-shedding solver
+ *
+ * Chooses which of the candidate loads to shed as a minimum-cost covering
+ * knapsack: shed at least the power needed at the least total impact.
+ * Power is counted in steps of need / SHED_SOLVER_CELLS (never finer than
+ * SHED_SOLVER_MIN_STEP_W), each load rounded down, so the chosen set always
+ * covers the need and the impact is optimal to within that resolution.
+ * When the candidates cannot cover the need, all of them are shed: the
+ * shortfall is minimised before the impact.
+ *
+ * The dynamic programme costs O(candidates x cells) and stops when it runs
+ * past the caller's time budget; the caller then falls back to its greedy
+ * order. The workspace is allocated once for the largest candidate count.
+ */
+
+#define SHED_SOLVER_CELLS       1024        // power resolution across the need
+#define SHED_SOLVER_MIN_STEP_W  10.0
+#define SHED_SOLVER_BUDGET_S    0.005       // per solve, on the monotonic clock
+
+typedef struct {
+    /* Candidates */
+    int* id;                                // caller's index of the load
+    double* power;                          // W
+    double* impact;
+    bool* picked;                           // solution, valid after a successful solve
+    int count;
+    int capacity;
+
+    /* Workspace */
+    double* cost;                           // SHED_SOLVER_CELLS + 1
+    int* units;
+    uint64_t* take;                         // capacity rows of SHED_SOLVER_CELLS + 1 bits
+
+    /* Statistics */
+    uint32_t solves;
+    uint32_t fallbacks;                     // over budget or not representable
+    double last_solve_s;
+    double worst_solve_s;
+} shed_solver_t;
+
+/* Function prototypes */
+int shed_solver_init(shed_solver_t* solver, int capacity);
+void shed_solver_free(shed_solver_t* solver);
+void shed_solver_reset(shed_solver_t* solver);
+int shed_solver_add(shed_solver_t* solver, int id, double power_w, double impact);
+int shed_solver_solve(shed_solver_t* solver, double need_w, double budget_s);
+
+#endif /* SHED_SOLVER_H */
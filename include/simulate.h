@@ -0,0 +1,113 @@
+#ifndef SIMULATE_H
+#define SIMULATE_H
+
+#include "core.h"
+#include "controller.h"
+#include "tariff.h"
+#include <time.h>
+
+/*
+ * What-if simulation
+ *
+ * sim_snapshot() copies what the energy balance depends on out of the
+ * controller, under controller_lock() when off the control thread: battery
+ * energy and limits, the PV and load forecasts, the tariff's price path and
+ * the battery schedule. sim_run() then steps K
+ * scenarios through the controller's dispatch rules, SIM_STEP_S at a time:
+ *
+ *   PV     forecast x exp(c), c an AR(1) clearness anomaly
+ *   load   forecast x exp(l), l an AR(1) anomaly; critical share as measured
+ *   grid   a requested outage window, or outages at a Poisson rate with
+ *          exponential durations
+ *
+ * Grid-connected the battery follows the tariff schedule exactly as the
+ * control loop does (tariff_schedule_setpoint), discharging further where
+ * the import limit falls short; islanded it covers the deficit down to its
+ * minimum operating SOC. Whatever neither covers is met by shedding
+ * non-critical load, and the critical load left over is unserved.
+ *
+ * Scenarios are spread over a work-stealing pool: every worker owns a range
+ * of scenario indices and takes SIM_CHUNK at a time from its front; a worker
+ * that runs dry steals the back half of another's range. Each scenario has
+ * its own generator seeded from (seed, index), so the result does not
+ * depend on the thread count or on who ran what.
+ */
+
+#define SIM_STEP_S              300     // 5 min
+#define SIM_MAX_STEPS           288     // 24 h
+#define SIM_MAX_SCENARIOS       20000
+#define SIM_DEFAULT_SCENARIOS   2000
+#define SIM_MAX_THREADS         16
+#define SIM_CHUNK               32      // scenarios taken from a range at a time
+#define SIM_PV_RHO              0.9     // per-step persistence of the clearness anomaly
+#define SIM_PV_SIGMA            0.45    // stationary sd of the log clearness
+#define SIM_LOAD_RHO            0.95
+#define SIM_LOAD_SIGMA          0.2
+#define SIM_SUNRISE_FRACTION    0.02    // of the forecast peak, marks sunrise
+
+typedef struct {
+    int scenarios;
+    int steps;                          // horizon for sim_snapshot()
+    int threads;                        // 0 = one per online CPU
+    uint64_t seed;
+
+    /* Outages: a fixed window when outage_duration_s > 0, otherwise random */
+    double outage_start_s;              // from the snapshot time
+    double outage_duration_s;
+    double outage_rate_per_day;
+    double outage_mean_s;
+} sim_request_t;
+
+typedef struct {
+    time_t start;
+    int steps;
+    double energy_wh;
+    double capacity_wh;
+    double min_energy_wh;               // minimum operating SOC
+    double max_energy_wh;
+    double max_charge_w;
+    double max_discharge_w;
+    double import_limit_w;
+    double export_limit_w;
+    double feed_in_limit_w;
+    double pv_capacity_w;               // installed, caps the PV tail
+    double critical_fraction;           // of total consumption
+    bool grid_available;
+    int sunrise_step;                   // first step of the next sunrise, -1 if none
+
+    float pv_w[SIM_MAX_STEPS];
+    float load_w[SIM_MAX_STEPS];
+    float import_price[SIM_MAX_STEPS];
+    float export_price[SIM_MAX_STEPS];
+    tariff_schedule_t schedule;
+} sim_snapshot_t;
+
+typedef struct {
+    double mean;
+    double min;
+    double p05;
+    double p50;
+    double p95;
+    double max;
+} sim_distribution_t;
+
+typedef struct {
+    int scenarios;
+    int threads;
+    int steals;
+    double elapsed_ms;
+    time_t sunrise;                     // 0 when the horizon holds none
+
+    sim_distribution_t soc_at_sunrise;  // %, at the end of the horizon without a sunrise
+    sim_distribution_t unserved_critical_wh;
+    sim_distribution_t cost;
+    double p_critical_served;           // share of scenarios without unserved critical load
+    double p_outage;                    // share of scenarios with an outage
+} sim_result_t;
+
+/* Function prototypes */
+void sim_request_defaults(sim_request_t* req);
+int sim_snapshot(const system_controller_t* ctrl, int steps, sim_snapshot_t* snap);
+int sim_run(const sim_snapshot_t* snap, const sim_request_t* req, sim_result_t* result);
+
+#endif /* SIMULATE_H */
@@ -0,0 +1,79 @@
+#ifndef SOLAR_H
+#define SOLAR_H
+
+#include "core.h"
+#include <time.h>
+
+/*
+ * Solar geometry and clear-sky irradiance
+ *
+ * Sun position (low-precision almanac, ~0.01 deg) and clear-sky beam and
+ * diffuse irradiance are computed once per UTC day into a table of
+ * SOLAR_TABLE_SLOTS entries. During the day a sample is a linear
+ * interpolation between two slots, so the per-cycle cost is a table lookup
+ * plus, for each string, one dot product with its plane normal:
+ *
+ *   POA = DNI max(0, s . n) + DHI (1 + cos tilt) / 2 + GHI albedo (1 - cos tilt) / 2
+ *   P   = P_stc POA / 1000 (1 + gamma (T_cell - 25)),  T_cell = T_amb + k POA
+ *
+ * Vectors are east/north/up; azimuth is clockwise from north (180 = south).
+ * Samples for other days reuse the table's time of day, close enough for
+ * forecasting a day ahead.
+ */
+
+#define SOLAR_TABLE_SLOTS       288         // 5-minute resolution
+#define SOLAR_SLOT_SECONDS      (86400 / SOLAR_TABLE_SLOTS)
+#define SOLAR_CONSTANT          1361.0      // W/m^2 at 1 AU
+#define SOLAR_STC_IRRADIANCE    1000.0f     // W/m^2 at the module rating
+#define SOLAR_CELL_RISE         0.03125f    // K per W/m^2, (NOCT 45 - 20) / 800
+#define SOLAR_DEFAULT_ALBEDO    0.2
+
+typedef struct {
+    double latitude;                // deg, north positive
+    double longitude;               // deg, east positive
+    double albedo;
+} solar_site_t;
+
+/* One UTC day of sun vectors and clear-sky irradiance */
+typedef struct {
+    long day;                       // days since the epoch (UTC), -1 when empty
+    float sun_e[SOLAR_TABLE_SLOTS];
+    float sun_n[SOLAR_TABLE_SLOTS];
+    float sun_u[SOLAR_TABLE_SLOTS]; // cos(zenith); <= 0 at night
+    float dni[SOLAR_TABLE_SLOTS];   // W/m^2 beam normal
+    float dhi[SOLAR_TABLE_SLOTS];   // W/m^2 diffuse horizontal
+} solar_day_table_t;
+
+/* Sun and clear-sky irradiance at one instant */
+typedef struct {
+    float sun_e, sun_n, sun_u;
+    float dni, dhi, ghi;
+} solar_sample_t;
+
+/* Plane geometry and rating per string (structure-of-arrays) */
+typedef struct {
+    int count;
+    float* normal_e;
+    float* normal_n;
+    float* normal_u;
+    float* sky_view;                // (1 + cos tilt) / 2
+    float* ground_view;             // albedo (1 - cos tilt) / 2
+    float* rated_power;             // W at STC; 0 excludes the string
+    float* temp_coeff;              // 1/K
+    float* expected;                // W, last evaluation
+    float* scratch;                 // W, evaluation at another instant
+} solar_array_t;
+
+/* Function prototypes */
+void solar_table_build(solar_day_table_t* table, const solar_site_t* site, long day);
+bool solar_table_refresh(solar_day_table_t* table, const solar_site_t* site, time_t now);
+void solar_table_sample(const solar_day_table_t* table, time_t now, solar_sample_t* sample);
+double solar_elevation_deg(const solar_sample_t* sample);
+int solar_array_alloc(solar_array_t* array, int count);
+void solar_array_free(solar_array_t* array);
+void solar_array_set_plane(solar_array_t* array, int index, double tilt_deg, double azimuth_deg,
+                           double albedo, double rated_power, double temp_coeff);
+double solar_array_evaluate(solar_array_t* array, const solar_sample_t* sample, double ambient_c);
+const float* solar_array_evaluate_at(solar_array_t* array, const solar_sample_t* sample, double ambient_c);
+
+#endif /* SOLAR_H */
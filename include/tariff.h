@@ -0,0 +1,112 @@
+#ifndef TARIFF_H
+#define TARIFF_H
+
+#include "core.h"
+#include <time.h>
+
+/*
+ * Time-of-use tariff
+ *
+ * The configured periods are expanded once into a weekly table of import
+ * and export prices at 15-minute resolution (a period applies to the slots
+ * that start inside it), so a price lookup is an index computation. The
+ * local day containing the last lookup is cached; localtime only runs when
+ * a lookup leaves it, which also keeps DST days correct.
+ *
+ * Demand is metered as 15-minute average import. The highest window of the
+ * month sets the demand charge; exports above the feed-in cap earn nothing.
+ *
+ * Battery scheduler: dynamic programming over the next 24 h in 15-minute
+ * slots with stored energy discretised into TARIFF_SOC_LEVELS levels
+ * between the reserve and the operating maximum. Each step moves at most
+ * the charge or discharge limit; the slot cost is import cost minus paid
+ * export plus wear, and energy left at the end is valued at the cheapest
+ * import of the day. A demand charge couples all slots through the peak,
+ * so it is handled outside the recursion: the DP is run for a few caps on
+ * import between this month's peak and the unshaved peak, and the cap with
+ * the lowest cost including the demand increment wins.
+ */
+
+#define TARIFF_STEP_S               900     // price table resolution
+#define TARIFF_SLOTS_PER_DAY        96
+#define TARIFF_WEEK_SLOTS           (7 * TARIFF_SLOTS_PER_DAY)
+#define TARIFF_DEMAND_WINDOW_S      900     // demand metering window
+
+#define TARIFF_SCHEDULE_SLOTS       96      // 24 h of TARIFF_STEP_S
+#define TARIFF_SOC_LEVELS           101     // stored energy grid of the scheduler
+#define TARIFF_DEMAND_CAPS          8       // import caps tried against a demand charge
+#define TARIFF_EFFICIENCY           0.95    // one-way battery efficiency
+#define TARIFF_WEAR_COST            0.02    // per kWh through the battery
+#define TARIFF_OVER_LIMIT_COST      5.0     // per kWh imported above the cap
+#define TARIFF_TRACK_MIN_S          60.0    // shortest horizon for reaching a slot's SOC target
+
+/* Battery and grid limits for one schedule */
+typedef struct {
+    double energy_wh;                       // stored now
+    double capacity_wh;
+    double min_energy_wh;                   // reserve
+    double max_energy_wh;
+    double max_charge_w;
+    double max_discharge_w;
+    double import_limit_w;
+    double export_limit_w;
+} tariff_battery_t;
+
+/* Battery schedule, slot h covers [start + h step, start + (h + 1) step) */
+typedef struct {
+    bool valid;
+    time_t start;
+    time_t created;
+
+    float soc[TARIFF_SCHEDULE_SLOTS];       // target at the end of the slot, %
+    float battery_w[TARIFF_SCHEDULE_SLOTS]; // positive = discharge
+    float grid_w[TARIFF_SCHEDULE_SLOTS];    // positive = import
+
+    double import_cap_w;                    // chosen against the demand charge
+    double cost;                            // energy and demand cost of the day
+    double savings;                         // versus an idle battery, stored energy valued
+} tariff_schedule_t;
+
+typedef struct {
+    /* Price table, per kWh, indexed by weekday * TARIFF_SLOTS_PER_DAY + slot */
+    float import_price[TARIFF_WEEK_SLOTS];
+    float export_price[TARIFF_WEEK_SLOTS];
+    double demand_charge;                   // per kW of the month's peak
+    double feed_in_limit_w;                 // 0 = no cap
+
+    /* Local day of the last lookup */
+    time_t day_start;
+    time_t day_end;
+    int weekday;
+    int month;                              // years * 12 + month
+
+    /* Demand metering */
+    time_t window_start;
+    double window_wh;
+    double month_peak_w;
+    int peak_month;
+
+    /* Running cost of the current day */
+    time_t last_update;
+    double import_price_now;                // at last_update, for readers off the control thread
+    double export_price_now;
+    time_t cost_day;
+    double cost_today;
+    double import_wh_today;
+    double export_wh_today;
+} tariff_t;
+
+/* Function prototypes */
+int tariff_init(tariff_t* tariff, const system_config_t* config);
+int tariff_apply_config(tariff_t* tariff, const system_config_t* config);
+double tariff_import_price(tariff_t* tariff, time_t t);
+double tariff_export_price(tariff_t* tariff, time_t t);
+void tariff_update(tariff_t* tariff, time_t now, double grid_w);
+int tariff_schedule_battery(tariff_t* tariff, const tariff_battery_t* bat, const float* load_w,
+                            const float* pv_w, time_t start, tariff_schedule_t* schedule);
+int tariff_schedule_slot(const tariff_schedule_t* schedule, time_t now);
+double tariff_schedule_setpoint(const tariff_schedule_t* schedule, int slot, time_t now, double energy_wh,
+                                double capacity_wh, double net_load_w);
+void tariff_log_status(tariff_t* tariff, const tariff_schedule_t* schedule);
+
+#endif /* TARIFF_H */
@@ -0,0 +1,74 @@
+#ifndef TWIN_H
+#define TWIN_H
+
+#include "controller.h"
+#include "plant.h"
+#include "hal_sim.h"
+
+/*
+ * Controller against the digital twin
+ *
+ * Runs the controller in closed loop with a plant instead of hardware. Each
+ * twin_step() is one control cycle on the virtual clock:
+ *
+ *   1. the previous cycle's commands go out through the HAL (hal_sim.h):
+ *      per-bank battery currents, the PV power limit, load relays
+ *   2. the virtual clock advances by the control interval and the plant is
+ *      integrated to it
+ *   3. the plant is read back through the HAL into the controller's
+ *      measurements, flagged MEASURED_*, together with cell and string
+ *      telemetry
+ *   4. the controller runs its cycle on those readings
+ *
+ * Irrigation and EV charging stay with their subsystems' own models; their
+ * power is passed to the plant as external load.
+ *
+ * PV power reaches the controller through the per-inverter MPPT workers
+ * (pv_mppt.h), as on hardware. hal_sim belongs to the control thread, so
+ * the workers sample the DC side the twin publishes after each plant step
+ * rather than calling the HAL. If the workers cannot start, the inverters'
+ * readings are flagged MEASURED_PV instead.
+ *
+ * Grid outages come from the plant: random ones at a Poisson rate
+ * (plant_set_outages), and a forced window the twin opens and closes on
+ * the control clock (twin_schedule_outage).
+ *
+ * How fast the loop runs against the wall clock is up to the caller: the
+ * step itself never sleeps.
+ */
+
+typedef struct {
+    plant_t plant;
+    system_controller_t* ctrl;
+
+    uint32_t inverter_ids[PLANT_MAX_INVERTERS];
+    int inverter_count;
+    uint32_t battery_ids[MAX_BATTERY_BANKS];
+    int battery_count;
+    uint32_t grid_meter;
+    uint32_t load_meter;
+    uint32_t relay_modules[HAL_SIM_MAX_RELAY_MODULES];
+    int relay_module_count;
+
+    /* MPPT workers and the DC samples they read */
+    pv_mppt_worker_t mppt;
+    bool mppt_running;
+    pthread_mutex_t dc_lock;
+    bool dc_valid[PLANT_MAX_INVERTERS];
+    double dc_voltage[PLANT_MAX_INVERTERS];
+    double dc_power[PLANT_MAX_INVERTERS];
+
+    /* Forced grid outage, control-clock seconds; outage_to is 0 when none */
+    double outage_from;
+    double outage_to;
+
+    uint64_t steps;
+} twin_t;
+
+/* Function prototypes */
+int twin_init(twin_t* twin, system_controller_t* ctrl, uint64_t seed);
+int twin_step(twin_t* twin);
+int twin_schedule_outage(twin_t* twin, double hour, double duration_s);
+void twin_free(twin_t* twin);
+
+#endif /* TWIN_H */
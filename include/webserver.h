@@ -179,6 +179,7 @@ void api_system_status(struct mg_connection *c, void *user_data);
 void api_system_config(struct mg_connection *c, void *user_data);
 void api_system_stats(struct mg_connection *c, void *user_data);
 void api_system_mode(struct mg_connection *c, void *user_data);
+void api_simulate(struct mg_connection *c, void *user_data);
 void api_pv_status(struct mg_connection *c, void *user_data);
 void api_battery_status(struct mg_connection *c, void *user_data);
 void api_loads_status(struct mg_connection *c, void *user_data);
@@ -190,6 +191,7 @@ void api_ev_control(struct mg_connection *c, void *user_data);
 void api_alarms(struct mg_connection *c, void *user_data);
 void api_alarms_ack(struct mg_connection *c, void *user_data);
 void api_history(struct mg_connection *c, void *user_data);
+void api_events(struct mg_connection *c, void *user_data);
 void api_export_data(struct mg_connection *c, void *user_data);
 void api_login(struct mg_connection *c, void *user_data);
 void api_logout(struct mg_connection *c, void *user_data);
@@ -1,4 +1,6 @@
 #include "agriculture.h"
+#include "clock.h"
+#include "journal.h"
 #include <string.h>
 #include <time.h>
 #include <math.h>
@@ -17,12 +19,12 @@ int agriculture_init(agriculture_system_t* ag, const system_config_t* config) {
     
     memset(ag, 0, sizeof(agriculture_system_t));
     
-    ag->zone_count = config->zone_count;
+    ag->zone_count = config->zone_count < MAX_IRRIGATION_ZONES ? config->zone_count : MAX_IRRIGATION_ZONES;
     ag->mode = config->irrigation_mode;
     ag->max_power_usage = config->irrigation_power_limit;
     
     // Copy zone config
-    for (int i = 0; i < config->zone_count && i < MAX_IRRIGATION_ZONES; i++) {
+    for (int i = 0; i < ag->zone_count; i++) {
         memcpy(&ag->zones[i], &config->zones[i], sizeof(irrigation_zone_t));
         ag->zone_states[i] = IRR_STATE_IDLE;
         ag->moisture_status[i] = MOISTURE_OK;
@@ -38,7 +40,7 @@ int agriculture_init(agriculture_system_t* ag, const system_config_t* config) {
     ag->moisture_high_threshold = 85.0;
     
     // Set default schedule (6 AM to 10 AM)
-    time_t now = time(NULL);
+    time_t now = clock_now();
     struct tm* tm_info = localtime(&now);
     tm_info->tm_hour = 6;
     tm_info->tm_min = 0;
@@ -48,7 +50,61 @@ int agriculture_init(agriculture_system_t* ag, const system_config_t* config) {
     tm_info->tm_hour = 10;
     ag->daily_end_time = mktime(tm_info);
     ag->max_daily_water = 1000.0;  // 1000 gallons limit
-    ag->last_irrigation_day = time(NULL);
+    ag->last_irrigation_day = clock_now();
+
+    return 0;
+}
+
+/* Apply a reloaded zone table; zones matched by id keep state and sensor readings */
+int agriculture_apply_config(agriculture_system_t* ag, const system_config_t* config) {
+    if (!ag || !config) return -1;
+
+    irrigation_zone_t zones[MAX_IRRIGATION_ZONES];
+    irrigation_state_t states[MAX_IRRIGATION_ZONES];
+    moisture_status_t moisture[MAX_IRRIGATION_ZONES];
+    int count = config->zone_count < MAX_IRRIGATION_ZONES ? config->zone_count : MAX_IRRIGATION_ZONES;
+    // Stop zones that disappear from the config before the table is replaced
+    for (int j = 0; j < ag->zone_count; j++) {
+        bool present = false;
+
+        for (int i = 0; i < count && !present; i++)
+            present = strcmp(ag->zones[j].zone_id, config->zones[i].zone_id) == 0;
+
+        if (!present) agriculture_stop_zone(ag, j);
+    }
+
+    for (int i = 0; i < count; i++) {
+        memcpy(&zones[i], &config->zones[i], sizeof(irrigation_zone_t));
+        states[i] = IRR_STATE_IDLE;
+        moisture[i] = MOISTURE_OK;
+
+        if (zones[i].moisture_threshold == 0) {
+            zones[i].moisture_threshold = 30.0;  // Default 30%
+        }
+
+        for (int j = 0; j < ag->zone_count; j++) {
+            if (strcmp(ag->zones[j].zone_id, zones[i].zone_id) != 0) continue;
+
+            states[i] = ag->zone_states[j];
+            moisture[i] = ag->moisture_status[j];
+            zones[i].soil_moisture = ag->zones[j].soil_moisture;
+            zones[i].last_watered = ag->zones[j].last_watered;
+            break;
+        }
+
+        // A zone disabled by the new config must not keep watering
+        if (!zones[i].enabled && states[i] == IRR_STATE_WATERING) {
+            journal_append(JOURNAL_EVENT_IRRIGATION_STOP, (uint16_t)i, zones[i].power_consumption, zones[i].zone_id);
+            states[i] = IRR_STATE_IDLE;
+        }
+    }
+
+    memcpy(ag->zones, zones, count * sizeof(irrigation_zone_t));
+    memcpy(ag->zone_states, states, count * sizeof(irrigation_state_t));
+    memcpy(ag->moisture_status, moisture, count * sizeof(moisture_status_t));
+    ag->zone_count = count;
+    ag->mode = config->irrigation_mode;
+    ag->max_power_usage = config->irrigation_power_limit;
 
     return 0;
 }
@@ -63,7 +119,7 @@ void agriculture_update_measurements(agriculture_system_t* ag, system_measuremen
         if (!ag->sensor_fault) {
             /* Normal variation in soil moisture */
             double base_moisture = 40.0;  /* Base moisture level */
-            double variation = sin(time(NULL) / 3600.0) * 10.0;  /* Daily cycle */
+            double variation = sin(clock_now() / 3600.0) * 10.0;  /* Daily cycle */
             ag->zones[i].soil_moisture = base_moisture + variation;
             
             /* Reduce moisture when watering */
@@ -92,7 +148,7 @@ bool agriculture_manage_irrigation(agriculture_system_t* ag, double available_po
     if (!ag) return false;
     
     bool irrigation_changed = false;
-    time_t now = time(NULL);
+    time_t now = clock_now();
     
     /* Check for emergency conditions */
     if (ag->pump_fault || ag->valve_fault) {
@@ -251,7 +307,9 @@ void agriculture_start_zone(agriculture_system_t* ag, int zone_index) {
     
     /* Start watering */
     ag->zone_states[zone_index] = IRR_STATE_WATERING;
-    ag->zones[zone_index].last_watered = time(NULL);
+    ag->zones[zone_index].last_watered = clock_now();
+    journal_append(JOURNAL_EVENT_IRRIGATION_START, (uint16_t)zone_index,
+                   ag->zones[zone_index].power_consumption, ag->zones[zone_index].zone_id);
     
     /* Update statistics */
     double water_used = ag->zones[zone_index].water_flow_rate * 
@@ -271,6 +329,11 @@ void agriculture_stop_zone(agriculture_system_t* ag, int zone_index) {
         return;
     }
     
+    if (ag->zone_states[zone_index] == IRR_STATE_WATERING) {
+        journal_append(JOURNAL_EVENT_IRRIGATION_STOP, (uint16_t)zone_index,
+                       ag->zones[zone_index].power_consumption, ag->zones[zone_index].zone_id);
+    }
+    
     ag->zone_states[zone_index] = IRR_STATE_IDLE;
 }
 
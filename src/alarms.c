@@ -0,0 +1,233 @@
+#include "alarms.h"
+#include <stdio.h>
+#include <string.h>
+
+static const alarm_definition_t alarm_definitions[ALARM_CODE_COUNT] = {
+    [ALARM_GRID_FAILURE]          = {"Grid failure",             ALARM_SEVERITY_MAJOR,    0.0, 30.0, true},
+    [ALARM_BATTERY_OVER_TEMP]     = {"Battery over temperature", ALARM_SEVERITY_CRITICAL, 0.0, 60.0, true},
+    [ALARM_BATTERY_LOW_SOC]       = {"Battery low SOC",          ALARM_SEVERITY_MAJOR,    5.0, 60.0, false},
+    [ALARM_PV_DISCONNECT]         = {"PV disconnect",            ALARM_SEVERITY_WARNING,  5.0, 30.0, true},
+    [ALARM_OVERLOAD]              = {"System overload",          ALARM_SEVERITY_MAJOR,    2.0, 10.0, true},
+    [ALARM_COMM_FAILURE]          = {"Communication failure",    ALARM_SEVERITY_WARNING, 10.0, 10.0, true},
+    [ALARM_IRRIGATION_FAULT]      = {"Irrigation fault",         ALARM_SEVERITY_WARNING,  5.0, 30.0, true},
+    [ALARM_EV_CHARGER_FAULT]      = {"EV charger fault",         ALARM_SEVERITY_WARNING,  5.0, 30.0, true},
+    [ALARM_BATTERY_OVER_VOLTAGE]  = {"Battery over voltage",     ALARM_SEVERITY_CRITICAL, 0.0, 30.0, true},
+    [ALARM_BATTERY_UNDER_VOLTAGE] = {"Battery under voltage",    ALARM_SEVERITY_CRITICAL, 0.0, 30.0, true},
+    [ALARM_BATTERY_OVER_CURRENT]  = {"Battery over current",     ALARM_SEVERITY_CRITICAL, 0.0, 30.0, true},
+};
+
+static const char* alarm_state_names[] = {
+    "INACTIVE", "ACTIVE", "ACKNOWLEDGED", "CLEARED"
+};
+
+static const char* alarm_severity_names[] = {
+    "INFO", "WARNING", "MAJOR", "CRITICAL"
+};
+
+static bool alarm_code_valid(alarm_code_t code) {
+    return (int)code >= 0 && code < ALARM_CODE_COUNT;
+}
+
+static bool alarm_state_is_active(alarm_state_t state) {
+    return state == ALARM_STATE_ACTIVE || state == ALARM_STATE_ACKNOWLEDGED;
+}
+
+static bool alarm_state_is_unacked(alarm_state_t state) {
+    return state == ALARM_STATE_ACTIVE || state == ALARM_STATE_CLEARED;
+}
+
+/* Move an entry to a new state, keep aggregates in sync and notify */
+static void alarm_transition(alarm_engine_t* engine, alarm_code_t code, alarm_state_t to, time_t now) {
+    alarm_entry_t* entry = &engine->entries[code];
+    alarm_state_t from = entry->state;
+
+    if (from == to) return;
+
+    engine->active_count += (int)alarm_state_is_active(to) - (int)alarm_state_is_active(from);
+    engine->unacked_count += (int)alarm_state_is_unacked(to) - (int)alarm_state_is_unacked(from);
+
+    entry->state = to;
+    entry->last_transition = now;
+    engine->transition_count++;
+
+    if (engine->on_transition) {
+        alarm_transition_t t = {
+            .code = code,
+            .from = from,
+            .to = to,
+            .timestamp = now,
+            .value = entry->value,
+            .occurrence_count = entry->occurrence_count,
+        };
+        engine->on_transition(&t, engine->callback_data);
+    }
+}
+
+static void alarm_pending_remove(alarm_engine_t* engine, int index) {
+    engine->entries[engine->pending[index]].pending = false;
+    engine->pending[index] = engine->pending[--engine->pending_count];
+}
+
+void alarm_engine_init(alarm_engine_t* engine, alarm_transition_cb_t callback, void* user_data) {
+    if (!engine) return;
+
+    memset(engine, 0, sizeof(alarm_engine_t));
+    engine->on_transition = callback;
+    engine->callback_data = user_data;
+}
+
+/* Feed the raw condition for one alarm. O(1); only input changes arm a debounce timer. */
+void alarm_engine_update(alarm_engine_t* engine, alarm_code_t code, bool condition, double value, time_t now) {
+    if (!engine || !alarm_code_valid(code)) return;
+
+    alarm_entry_t* entry = &engine->entries[code];
+
+    if (condition) {
+        entry->last_seen = now;
+        entry->value = value;
+    }
+
+    if (condition == entry->condition) return;
+
+    entry->condition = condition;
+    entry->condition_since = now;
+
+    if (condition == alarm_state_is_active(entry->state)) {
+        // Input reverted to the debounced state before the timer expired
+        if (entry->pending) {
+            for (int i = 0; i < engine->pending_count; i++) {
+                if (engine->pending[i] == code) {
+                    alarm_pending_remove(engine, i);
+                    break;
+                }
+            }
+            engine->bounce_count++;
+        }
+        return;
+    }
+
+    if (!entry->pending) {
+        entry->pending = true;
+        engine->pending[engine->pending_count++] = code;
+    }
+}
+
+/* Expire debounce timers; returns the number of transitions applied */
+int alarm_engine_process(alarm_engine_t* engine, time_t now) {
+    if (!engine) return 0;
+
+    int transitions = 0;
+
+    for (int i = 0; i < engine->pending_count; ) {
+        alarm_code_t code = engine->pending[i];
+        alarm_entry_t* entry = &engine->entries[code];
+        const alarm_definition_t* def = &alarm_definitions[code];
+        double held = difftime(now, entry->condition_since);
+
+        if (entry->condition) {
+            if (held < def->raise_delay) {
+                i++;
+                continue;
+            }
+
+            entry->occurrence_count++;
+            if (entry->first_seen == 0) entry->first_seen = entry->condition_since;
+
+            // Re-raising a CLEARED (latched) alarm requires a fresh acknowledgement
+            alarm_transition(engine, code, ALARM_STATE_ACTIVE, now);
+        } else {
+            if (held < def->clear_delay) {
+                i++;
+                continue;
+            }
+
+            if (entry->state == ALARM_STATE_ACTIVE && def->latching) {
+                alarm_transition(engine, code, ALARM_STATE_CLEARED, now);
+            } else {
+                alarm_transition(engine, code, ALARM_STATE_INACTIVE, now);
+            }
+        }
+
+        transitions++;
+        alarm_pending_remove(engine, i);
+    }
+
+    return transitions;
+}
+
+int alarm_engine_acknowledge(alarm_engine_t* engine, alarm_code_t code, time_t now) {
+    if (!engine || !alarm_code_valid(code)) return -1;
+
+    alarm_entry_t* entry = &engine->entries[code];
+
+    switch (entry->state) {
+        case ALARM_STATE_ACTIVE:
+            entry->acknowledged_at = now;
+            alarm_transition(engine, code, ALARM_STATE_ACKNOWLEDGED, now);
+            return 0;
+        case ALARM_STATE_CLEARED:
+            entry->acknowledged_at = now;
+            alarm_transition(engine, code, ALARM_STATE_INACTIVE, now);
+            return 0;
+        case ALARM_STATE_INACTIVE:
+        case ALARM_STATE_ACKNOWLEDGED:
+            break;
+    }
+
+    return -1;
+}
+
+int alarm_engine_acknowledge_all(alarm_engine_t* engine, time_t now) {
+    if (!engine) return 0;
+
+    int acknowledged = 0;
+
+    for (int code = 0; code < ALARM_CODE_COUNT && engine->unacked_count > 0; code++) {
+        if (alarm_engine_acknowledge(engine, (alarm_code_t)code, now) == 0)
+            acknowledged++;
+    }
+
+    return acknowledged;
+}
+
+bool alarm_engine_is_active(const alarm_engine_t* engine, alarm_code_t code) {
+    if (!engine || !alarm_code_valid(code)) return false;
+    return alarm_state_is_active(engine->entries[code].state);
+}
+
+const alarm_definition_t* alarm_get_definition(alarm_code_t code) {
+    if (!alarm_code_valid(code)) return NULL;
+    return &alarm_definitions[code];
+}
+
+const char* alarm_state_str(alarm_state_t state) {
+    if ((int)state < 0 || state > ALARM_STATE_CLEARED) return "UNKNOWN";
+    return alarm_state_names[state];
+}
+
+const char* alarm_severity_str(alarm_severity_t severity) {
+    if ((int)severity < 0 || severity > ALARM_SEVERITY_CRITICAL) return "UNKNOWN";
+    return alarm_severity_names[severity];
+}
+
+void alarm_engine_log_status(const alarm_engine_t* engine) {
+    if (!engine) return;
+
+    printf("=== Alarm Status ===\n");
+    printf("Active: %d, Unacknowledged: %d, Pending: %d\n",
+           engine->active_count, engine->unacked_count, engine->pending_count);
+    printf("Transitions: %u, Bounces suppressed: %u\n",
+           engine->transition_count, engine->bounce_count);
+
+    for (int code = 0; code < ALARM_CODE_COUNT; code++) {
+        const alarm_entry_t* entry = &engine->entries[code];
+        if (entry->state == ALARM_STATE_INACTIVE) continue;
+
+        printf("  [%-8s] %-26s %-12s count=%u value=%.1f\n",
+               alarm_severity_names[alarm_definitions[code].severity],
+               alarm_definitions[code].name,
+               alarm_state_names[entry->state],
+               entry->occurrence_count, entry->value);
+    }
+    printf("====================\n");
+}
@@ -1,6 +1,10 @@
 #include "webserver.h"
 #include "mongoose.h"
+#include "journal.h"
+#include "battery_soc.h"
+#include "simulate.h"
 #include <jansson.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <math.h>
@@ -9,11 +13,14 @@
 static json_t* create_system_status_json(system_controller_t *controller);
 static json_t* create_pv_status_json(system_controller_t *controller);
 static json_t* create_battery_status_json(system_controller_t *controller);
+static json_t* create_cell_stats_json(const battery_cell_stats_t *s);
+static json_t* create_bank_health_json(const battery_health_t *h);
 static json_t* create_loads_status_json(system_controller_t *controller);
 static json_t* create_agriculture_status_json(system_controller_t *controller);
 static json_t* create_ev_status_json(system_controller_t *controller);
 static json_t* create_alarms_json(system_controller_t *controller);
 static json_t* create_system_stats_json(system_controller_t *controller);
+static json_t* create_distribution_json(const sim_distribution_t *d);
 
 /* System Status API */
 void api_system_status(struct mg_connection *c, void *user_data) {
@@ -30,26 +37,67 @@ void api_system_status(struct mg_connection *c, void *user_data) {
 
 /* System Config API */
 void api_system_config(struct mg_connection *c, void *user_data) {
+    system_controller_t *controller = (system_controller_t *)user_data;
     struct http_message *hm = (struct http_message *)c->data;
     
     if (strncmp(hm->method.p, "GET", 3) == 0) {
-        /* Return current configuration */
+        /* Return the configuration currently applied by the controller */
+        const system_config_t *cfg = &controller->config;
         json_t *config = json_object();
-        json_object_set_new(config, "config", json_string("Configuration endpoint"));
+        json_object_set_new(config, "system_name", json_string(cfg->system_name));
+        json_object_set_new(config, "nominal_voltage", json_real(cfg->nominal_voltage));
+        json_object_set_new(config, "max_grid_import", json_real(cfg->max_grid_import));
+        json_object_set_new(config, "max_grid_export", json_real(cfg->max_grid_export));
+        json_object_set_new(config, "control_interval", json_real(cfg->control_interval));
+        json_object_set_new(config, "load_count", json_integer(cfg->load_count));
+        json_object_set_new(config, "zone_count", json_integer(cfg->zone_count));
+        json_object_set_new(config, "ev_charger_count", json_integer(cfg->ev_charger_count));
+        json_object_set_new(config, "bank_count", json_integer(cfg->bank_count));
+        
+        if (controller->reload) {
+            json_object_set_new(config, "reload_count",
+                json_integer(atomic_load(&controller->reload->reload_count)));
+            json_object_set_new(config, "reload_rejected",
+                json_integer(atomic_load(&controller->reload->reject_count)));
+            json_object_set_new(config, "last_reload_result",
+                json_integer(atomic_load(&controller->reload->last_result)));
+        }
         
         send_json_response(c, 200, config);
         json_decref(config);
     } else if (strncmp(hm->method.p, "POST", 4) == 0) {
-        /* Update configuration */
+        /* Hand the new configuration to the reload worker; it is parsed and
+         * validated off the control thread and applied at a cycle boundary */
         json_t *body = webserver_get_json_body(c);
         if (!body) {
             send_error_response(c, 400, "Invalid JSON body", 4001);
             return;
         }
         
-        /* TODO: Update configuration */
+        if (!controller->reload) {
+            json_decref(body);
+            send_error_response(c, 503, "Configuration reload not available", 5030);
+            return;
+        }
+        
+        char *text = json_dumps(body, JSON_COMPACT);
         json_decref(body);
-        send_success_response(c, "Configuration updated", NULL);
+        
+        if (!text) {
+            send_error_response(c, 500, "Failed to serialize configuration", 5003);
+            return;
+        }
+        
+        int rc = config_reload_submit(controller->reload, text, strlen(text));
+        free(text);
+        
+        if (rc != 0) {
+            send_error_response(c, 413, "Configuration rejected", 4131);
+            return;
+        }
+        
+        journal_append(JOURNAL_EVENT_OPERATOR_COMMAND, 0, 0.0, "config reload");
+        send_success_response(c, "Configuration accepted, applying at next control cycle", NULL);
     }
 }
 
@@ -86,6 +134,8 @@ void api_system_mode(struct mg_connection *c, void *user_data) {
     int mode = json_integer_value(mode_json);
     
     if (mode >= MODE_NORMAL && mode <= MODE_EMERGENCY) {
+        journal_append(JOURNAL_EVENT_OPERATOR_COMMAND, (uint16_t)mode,
+                       (double)controller->status.mode, "api/system/mode");
         controller->status.mode = (system_mode_t)mode;
         controller->status.last_mode_change = time(NULL);
         
@@ -112,6 +162,89 @@ void api_system_mode(struct mg_connection *c, void *user_data) {
     }
 }
 
+/* What-if Simulation API */
+void api_simulate(struct mg_connection *c, void *user_data) {
+    system_controller_t *controller = (system_controller_t *)user_data;
+    json_t *body = webserver_get_json_body(c);
+    
+    if (!body) {
+        send_error_response(c, 400, "Invalid JSON body", 4001);
+        return;
+    }
+    
+    sim_request_t req;
+    sim_request_defaults(&req);
+    
+    json_t *value = json_object_get(body, "scenarios");
+    if (value) req.scenarios = json_is_integer(value) ? (int)json_integer_value(value) : -1;
+    value = json_object_get(body, "horizon_hours");
+    if (value) req.steps = json_is_number(value) ? (int)(json_number_value(value) * 3600.0 / SIM_STEP_S) : -1;
+    value = json_object_get(body, "threads");
+    if (value) req.threads = json_is_integer(value) ? (int)json_integer_value(value) : -1;
+    value = json_object_get(body, "seed");
+    if (value && json_is_integer(value)) req.seed = (uint64_t)json_integer_value(value);
+    
+    json_t *outage = json_object_get(body, "outage");
+    if (outage && json_is_object(outage)) {
+        req.outage_start_s = json_number_value(json_object_get(outage, "start_hours")) * 3600.0;
+        req.outage_duration_s = json_number_value(json_object_get(outage, "duration_hours")) * 3600.0;
+    }
+    value = json_object_get(body, "outage_rate_per_day");
+    if (value) req.outage_rate_per_day = json_number_value(value);
+    value = json_object_get(body, "outage_mean_hours");
+    if (value) req.outage_mean_s = json_number_value(value) * 3600.0;
+    json_decref(body);
+    
+    if (req.scenarios <= 0 || req.scenarios > SIM_MAX_SCENARIOS ||
+        req.steps <= 0 || req.steps > SIM_MAX_STEPS ||
+        req.threads < 0 || req.threads > SIM_MAX_THREADS ||
+        req.outage_start_s < 0.0 || req.outage_duration_s < 0.0 ||
+        req.outage_rate_per_day < 0.0 || req.outage_mean_s <= 0.0) {
+        send_error_response(c, 400, "Invalid simulation parameters", 4002);
+        return;
+    }
+    
+    /* Copy under the controller lock, then simulate without holding it */
+    sim_snapshot_t *snap = malloc(sizeof(sim_snapshot_t));
+    int snap_rc = -1;
+    if (snap) {
+        controller_lock(controller);
+        snap_rc = sim_snapshot(controller, req.steps, snap);
+        controller_unlock(controller);
+    }
+    if (snap_rc != 0) {
+        free(snap);
+        send_error_response(c, 503, "Simulation not available", 5031);
+        return;
+    }
+    
+    /* Runs on the web server thread; bounded by SIM_MAX_SCENARIOS */
+    sim_result_t result;
+    int rc = sim_run(snap, &req, &result);
+    free(snap);
+    if (rc != 0) {
+        send_error_response(c, 500, "Simulation failed", 5010);
+        return;
+    }
+    
+    json_t *json = json_object();
+    json_object_set_new(json, "scenarios", json_integer(result.scenarios));
+    json_object_set_new(json, "horizon_hours", json_real(req.steps * SIM_STEP_S / 3600.0));
+    json_object_set_new(json, "seed", json_integer((json_int_t)req.seed));
+    json_object_set_new(json, "sunrise", result.sunrise ? json_integer(result.sunrise) : json_null());
+    json_object_set_new(json, "soc_at_sunrise", create_distribution_json(&result.soc_at_sunrise));
+    json_object_set_new(json, "unserved_critical_wh", create_distribution_json(&result.unserved_critical_wh));
+    json_object_set_new(json, "cost", create_distribution_json(&result.cost));
+    json_object_set_new(json, "p_critical_served", json_real(result.p_critical_served));
+    json_object_set_new(json, "p_outage", json_real(result.p_outage));
+    json_object_set_new(json, "threads", json_integer(result.threads));
+    json_object_set_new(json, "steals", json_integer(result.steals));
+    json_object_set_new(json, "elapsed_ms", json_real(result.elapsed_ms));
+    
+    send_json_response(c, 200, json);
+    json_decref(json);
+}
+
 /* PV Status API */
 void api_pv_status(struct mg_connection *c, void *user_data) {
     system_controller_t *controller = (system_controller_t *)user_data;
@@ -180,34 +313,28 @@ void api_loads_control(struct mg_connection *c, void *user_data) {
     load_manager_t *lm = &controller->load_manager;
     bool success = false;
     
-    for (int i = 0; i < lm->load_count; i++) {
-        if (strcmp(lm->loads[i].id, load_id) == 0) {
-            switch (command) {
-                case 0: /* Turn off */
-                    lm->load_states[i] = LOAD_STATE_OFF;
-                    lm->loads[i].current_state = false;
-                    lm->loads[i].last_state_change = time(NULL);
-                    success = true;
-                    break;
-                case 1: /* Turn on */
-                    lm->load_states[i] = LOAD_STATE_ON;
-                    lm->loads[i].current_state = true;
-                    lm->loads[i].last_state_change = time(NULL);
-                    success = true;
-                    break;
-                case 2: /* Shed */
-                    if (lm->loads[i].is_sheddable) {
-                        lm->load_states[i] = LOAD_STATE_SHED;
-                        lm->loads[i].current_state = false;
-                        lm->loads[i].last_state_change = time(NULL);
-                        success = true;
-                    }
-                    break;
-            }
-            break;
+    int i = loads_find(lm, load_id);
+    
+    if (i >= 0) {
+        switch (command) {
+            case 0: /* Turn off */
+                success = loads_set_state(lm, i, LOAD_STATE_OFF) == 0;
+                break;
+            case 1: /* Turn on */
+                success = loads_set_state(lm, i, LOAD_STATE_ON) == 0;
+                break;
+            case 2: /* Shed */
+                if (lm->loads[i].is_sheddable) {
+                    success = loads_set_state(lm, i, LOAD_STATE_SHED) == 0;
+                }
+                break;
         }
     }
     
+    if (success) {
+        journal_append(JOURNAL_EVENT_OPERATOR_COMMAND, (uint16_t)command, 0.0, load_id);
+    }
+    
     json_decref(body);
     
     if (success) {
@@ -300,15 +427,30 @@ void api_alarms_ack(struct mg_connection *c, void *user_data) {
     
     json_t *ack_all = json_object_get(body, "acknowledge_all");
     json_t *alarm_code = json_object_get(body, "alarm_code");
+    time_t now = time(NULL);
     
     if (ack_all && json_is_true(ack_all)) {
+        journal_append(JOURNAL_EVENT_OPERATOR_COMMAND, 0xFFFF,
+                       (double)controller->alarms.unacked_count, "api/alarms/acknowledge");
+        
         /* Acknowledge all alarms */
-        controller->status.alarms = 0;
+        alarm_engine_acknowledge_all(&controller->alarms, now);
         controller->status.warnings = 0;
     } else if (alarm_code && json_is_integer(alarm_code)) {
-        int code = json_integer_value(alarm_code);
-        if (code >= 0 && code < 32) {
-            controller->status.alarms &= ~(1 << code);
+        json_int_t code = json_integer_value(alarm_code);
+        if (code < 0 || code >= ALARM_CODE_COUNT) {
+            json_decref(body);
+            send_error_response(c, 400, "Unknown alarm code", 4003);
+            return;
+        }
+        
+        journal_append(JOURNAL_EVENT_OPERATOR_COMMAND, (uint16_t)code,
+                       (double)controller->alarms.unacked_count, "api/alarms/acknowledge");
+        
+        if (alarm_engine_acknowledge(&controller->alarms, (alarm_code_t)code, now) != 0) {
+            json_decref(body);
+            send_error_response(c, 409, "Alarm is not awaiting acknowledgement", 4004);
+            return;
         }
     } else {
         json_decref(body);
@@ -316,6 +458,9 @@ void api_alarms_ack(struct mg_connection *c, void *user_data) {
         return;
     }
     
+    controller->status.active_alarms = (uint16_t)controller->alarms.active_count;
+    controller->status.unacked_alarms = (uint16_t)controller->alarms.unacked_count;
+    
     json_decref(body);
     send_success_response(c, "Alarms acknowledged", NULL);
 }
@@ -366,6 +511,70 @@ void api_history(struct mg_connection *c, void *user_data) {
     json_decref(response);
 }
 
+/* Event Journal API: GET /api/events?since=<unix seconds>&limit=<n> */
+void api_events(struct mg_connection *c, void *user_data) {
+    (void)user_data;
+    struct http_message *hm = (struct http_message *)c->data;
+    struct mg_str *qs = &hm->query_string;
+    
+    time_t since = time(NULL) - 86400; /* Last 24 hours */
+    long limit = 500;
+    
+    if (qs->len > 0 && qs->len < 256) {
+        char query[256];
+        strncpy(query, qs->p, qs->len);
+        query[qs->len] = '\0';
+        
+        char *token = strtok(query, "&");
+        while (token) {
+            if (strncmp(token, "since=", 6) == 0) {
+                since = atol(token + 6);
+            } else if (strncmp(token, "limit=", 6) == 0) {
+                limit = atol(token + 6);
+            }
+            token = strtok(NULL, "&");
+        }
+    }
+    
+    if (limit <= 0 || limit > 5000) {
+        send_error_response(c, 400, "Invalid limit parameter", 4002);
+        return;
+    }
+    
+    journal_record_t *records = malloc((size_t)limit * sizeof(journal_record_t));
+    if (!records) {
+        send_error_response(c, 500, "Out of memory", 5009);
+        return;
+    }
+    
+    size_t count = journal_read_since((int64_t)since * 1000, records, (size_t)limit);
+    
+    json_t *response = json_object();
+    json_t *events = json_array();
+    
+    for (size_t i = 0; i < count; i++) {
+        json_t *event = json_object();
+        json_object_set_new(event, "seq", json_integer((json_int_t)records[i].seq));
+        json_object_set_new(event, "timestamp", json_real(records[i].timestamp_ms / 1000.0));
+        json_object_set_new(event, "type",
+            json_string(journal_event_type_str((journal_event_type_t)records[i].type)));
+        json_object_set_new(event, "code", json_integer(records[i].code));
+        json_object_set_new(event, "value", json_real(records[i].value));
+        json_object_set_new(event, "source", json_stringn(records[i].source,
+            strnlen(records[i].source, sizeof(records[i].source))));
+        json_array_append_new(events, event);
+    }
+    
+    json_object_set_new(response, "since", json_integer(since));
+    json_object_set_new(response, "count", json_integer((json_int_t)count));
+    json_object_set_new(response, "truncated", json_boolean(count == (size_t)limit));
+    json_object_set_new(response, "events", events);
+    
+    free(records);
+    send_json_response(c, 200, response);
+    json_decref(response);
+}
+
 /* Export Data API */
 void api_export_data(struct mg_connection *c, void *user_data) {
     system_controller_t *controller = (system_controller_t *)user_data;
@@ -733,12 +942,68 @@ static json_t* create_system_status_json(system_controller_t *controller) {
     json_object_set_new(status, "pv_available", 
                        json_boolean(controller->status.pv_available));
     json_object_set_new(status, "alarms", 
-                       json_integer(controller->status.alarms));
+                       json_integer(controller->status.active_alarms));
+    json_object_set_new(status, "unacked_alarms", 
+                       json_integer(controller->status.unacked_alarms));
     json_object_set_new(status, "warnings", 
                        json_integer(controller->status.warnings));
     
+    /* Dispatch plan */
+    json_t *dispatch = json_object();
+    const dispatch_plan_t *plan = controller->plan;
+    int slot = dispatch_plan_slot(plan, time(NULL));
+    json_object_set_new(dispatch, "active", json_boolean(slot >= 0));
+    if (plan) {
+        json_object_set_new(dispatch, "status", 
+                           json_string(qp_status_str(plan->status)));
+        json_object_set_new(dispatch, "created", json_integer(plan->created));
+        json_object_set_new(dispatch, "slots", json_integer(plan->slots));
+        json_object_set_new(dispatch, "slot_seconds", json_integer(plan->step_s));
+        json_object_set_new(dispatch, "iterations", json_integer(plan->iterations));
+        json_object_set_new(dispatch, "solve_ms", json_real(plan->solve_ms));
+        json_object_set_new(dispatch, "cost", json_real(plan->cost));
+    }
+    if (slot >= 0) {
+        json_object_set_new(dispatch, "battery_setpoint", 
+                           json_real(plan->battery_w[slot]));
+        json_object_set_new(dispatch, "grid_setpoint", 
+                           json_real(plan->grid_w[slot]));
+        json_object_set_new(dispatch, "deferrable_setpoint", 
+                           json_real(plan->deferrable_w[slot]));
+    }
+    if (controller->dispatch) {
+        json_object_set_new(dispatch, "solve_count", 
+                           json_integer(atomic_load(&controller->dispatch->solve_count)));
+        json_object_set_new(dispatch, "fail_count", 
+                           json_integer(atomic_load(&controller->dispatch->fail_count)));
+    }
+    
     json_object_set_new(root, "measurements", measurements);
     json_object_set_new(root, "status", status);
+    json_object_set_new(root, "dispatch", dispatch);
+    
+    /* Tariff and battery schedule */
+    json_t *tariff = json_object();
+    const tariff_t *tf = &controller->tariff;
+    json_object_set_new(tariff, "import_price", json_real(tf->import_price_now));
+    json_object_set_new(tariff, "export_price", json_real(tf->export_price_now));
+    json_object_set_new(tariff, "cost_today", json_real(tf->cost_today));
+    json_object_set_new(tariff, "import_kwh_today", json_real(tf->import_wh_today / 1000.0));
+    json_object_set_new(tariff, "export_kwh_today", json_real(tf->export_wh_today / 1000.0));
+    json_object_set_new(tariff, "month_peak_demand", json_real(tf->month_peak_w));
+    json_object_set_new(tariff, "demand_charge", json_real(tf->demand_charge));
+    json_object_set_new(tariff, "battery_soc_target", json_real(controller->battery_soc_target));
+    if (controller->schedule.valid) {
+        json_t *targets = json_array();
+        for (int h = 0; h < TARIFF_SCHEDULE_SLOTS; h++)
+            json_array_append_new(targets, json_real(controller->schedule.soc[h]));
+        json_object_set_new(tariff, "schedule_start", json_integer(controller->schedule.start));
+        json_object_set_new(tariff, "slot_seconds", json_integer(TARIFF_STEP_S));
+        json_object_set_new(tariff, "soc_targets", targets);
+        json_object_set_new(tariff, "import_cap", json_real(controller->schedule.import_cap_w));
+        json_object_set_new(tariff, "schedule_savings", json_real(controller->schedule.savings));
+    }
+    json_object_set_new(root, "tariff", tariff);
     
     return root;
 }
@@ -755,10 +1020,107 @@ static json_t* create_pv_status_json(system_controller_t *controller) {
                        json_real(pv->total_capacity));
     json_object_set_new(root, "available_power", 
                        json_real(pv->available_power));
+    json_object_set_new(root, "expected_power", 
+                       json_real(pv->expected_power));
+    json_object_set_new(root, "sun_elevation", 
+                       json_real(solar_elevation_deg(&pv->sun_now)));
+    
+    /* Forecast ring, oldest slot first */
+    json_t *forecast = json_object();
+    json_t *slots = json_array();
+    time_t now = time(NULL);
+    if (pv->forecast.first_slot >= 0) {
+        for (int h = 0; h < PV_FORECAST_SLOTS; h++) {
+            time_t t = (time_t)(pv->forecast.first_slot + h) * PV_FORECAST_STEP_S;
+            json_array_append_new(slots, json_real(pv_forecast_power_at(&pv->forecast, t)));
+        }
+        json_object_set_new(forecast, "start", 
+                           json_integer((json_int_t)pv->forecast.first_slot * PV_FORECAST_STEP_S));
+    }
+    json_object_set_new(forecast, "slot_seconds", json_integer(PV_FORECAST_STEP_S));
+    json_object_set_new(forecast, "power", slots);
+    json_object_set_new(forecast, "next_hour_wh", 
+                       json_real(pv_forecast_energy(&pv->forecast, now, now + 3600)));
+    json_object_set_new(forecast, "next_day_wh", 
+                       json_real(pv_forecast_energy(&pv->forecast, now, now + 86400)));
+    json_object_set_new(root, "forecast", forecast);
     json_object_set_new(root, "daily_energy", 
                        json_real(pv->daily_energy));
     json_object_set_new(root, "total_energy", 
                        json_real(pv->total_energy));
+    json_object_set_new(root, "string_count", json_integer(pv->string_count));
+    
+    /* Only strings the detector flags; large farms report hundreds */
+    const pv_string_telemetry_t *t = &pv->telemetry;
+    json_t *flagged = json_array();
+    for (int g = 0; g < t->group_count; g++) {
+        const pv_string_group_t *grp = &t->groups[g];
+        
+        for (int k = 0; k < grp->count; k++) {
+            int i = grp->first + k;
+            if (t->signature[i] == PV_SIGNATURE_NORMAL && !pv->strings[i].fault) continue;
+            
+            json_t *str = json_object();
+            json_object_set_new(str, "index", json_integer(i));
+            json_object_set_new(str, "id", json_string(pv->strings[i].string_id));
+            json_object_set_new(str, "inverter", json_integer(g));
+            json_object_set_new(str, "signature",
+                               json_string(pv_string_signature_str((pv_string_signature_t)t->signature[i])));
+            json_object_set_new(str, "fault", json_boolean(pv->strings[i].fault));
+            json_object_set_new(str, "voltage", json_real(t->voltage[i]));
+            json_object_set_new(str, "current", json_real(t->current[i]));
+            json_object_set_new(str, "voltage_deviation", json_real(t->v_dev[i]));
+            json_object_set_new(str, "current_deviation", json_real(t->i_dev[i]));
+            json_array_append_new(flagged, str);
+        }
+    }
+    json_object_set_new(root, "flagged_strings", flagged);
+    
+    return root;
+}
+
+/* Helper: Create cell statistics JSON for one bank or the whole pack */
+static json_t* create_cell_stats_json(const battery_cell_stats_t *s) {
+    json_t *root = json_object();
+    
+    json_object_set_new(root, "cell_count", json_integer(s->cell_count));
+    json_object_set_new(root, "voltage_min", json_real(s->v_min));
+    json_object_set_new(root, "voltage_max", json_real(s->v_max));
+    json_object_set_new(root, "voltage_mean", json_real(s->v_mean));
+    json_object_set_new(root, "voltage_spread", json_real(s->v_spread));
+    json_object_set_new(root, "temperature_min", json_real(s->t_min));
+    json_object_set_new(root, "temperature_max", json_real(s->t_max));
+    json_object_set_new(root, "temperature_mean", json_real(s->t_mean));
+    json_object_set_new(root, "min_cell_bank", json_integer(s->v_min_bank));
+    json_object_set_new(root, "min_cell", json_integer(s->v_min_cell));
+    json_object_set_new(root, "max_cell_bank", json_integer(s->v_max_bank));
+    json_object_set_new(root, "max_cell", json_integer(s->v_max_cell));
+    json_object_set_new(root, "outlier_count", json_integer(s->outlier_count));
+    json_object_set_new(root, "balancing_count", json_integer(s->balance_count));
+    json_object_set_new(root, "balance_target_voltage", json_real(s->balance_target_v));
+    
+    return root;
+}
+
+/* Helper: Create per-bank degradation JSON */
+static json_t* create_bank_health_json(const battery_health_t *h) {
+    json_t *root = json_object();
+    
+    json_object_set_new(root, "capacity_fade", json_real(h->fade));
+    json_object_set_new(root, "health_percent", json_real(battery_health_percent(h)));
+    json_object_set_new(root, "equivalent_full_cycles", json_real(h->full_cycles));
+    json_object_set_new(root, "throughput_ah", json_real(h->throughput_ah));
+    json_object_set_new(root, "cycle_damage", json_real(h->cycle_damage));
+    json_object_set_new(root, "calendar_damage", json_real(h->calendar_damage));
+    json_object_set_new(root, "operating_hours", json_real(h->operating_s / 3600.0));
+    json_object_set_new(root, "average_c_rate", json_real(h->c_rate_avg));
+    json_object_set_new(root, "average_temperature", json_real(h->temp_avg_c));
+    
+    /* Counted cycles per 10 % depth-of-discharge bin */
+    json_t *dod = json_array();
+    for (int i = 0; i < BATTERY_HEALTH_DOD_BINS; i++)
+        json_array_append_new(dod, json_real(h->dod_cycles[i]));
+    json_object_set_new(root, "dod_histogram", dod);
     
     return root;
 }
@@ -766,19 +1128,80 @@ static json_t* create_pv_status_json(system_controller_t *controller) {
 /* Helper: Create battery status JSON */
 static json_t* create_battery_status_json(system_controller_t *controller) {
     battery_system_t *bat = &controller->battery_system;
+    const battery_cells_t *cells = &bat->cells;
     json_t *root = json_object();
     
     json_object_set_new(root, "state", json_integer(bat->state));
     json_object_set_new(root, "soc_estimated", 
                        json_real(bat->soc_estimated));
+    json_object_set_new(root, "soc_estimator", 
+                       json_string(battery_soc_estimator_str(bat->soc_estimator)));
     json_object_set_new(root, "capacity_remaining", 
-                       json_real(bat->capacity_remaining));
+                       json_real(bat->capacity_remaining_wh));
     json_object_set_new(root, "capacity_nominal", 
-                       json_real(bat->capacity_nominal));
+                       json_real(bat->capacity_nominal_wh));
     json_object_set_new(root, "health_percentage", 
-                       json_real(bat->health_percentage));
+                       json_real(bat->health_percent));
     json_object_set_new(root, "temperature", 
-                       json_real(bat->temperature));
+                       json_real(bat->temperature_c));
+    json_object_set_new(root, "cell_voltage_spread", 
+                       json_real(bat->cell_voltage_spread));
+    
+    json_object_set_new(root, "power_setpoint", json_real(bat->power_setpoint_w));
+    
+    /* Pack cell analytics; omitted when the BMS reports no per-cell data */
+    if (battery_cells_available(cells))
+        json_object_set_new(root, "cells", create_cell_stats_json(&cells->pack));
+    
+    json_t *banks = json_array();
+    for (int b = 0; b < bat->bank_count && b < MAX_BATTERY_BANKS; b++) {
+        const battery_bank_t *bk = &bat->banks[b];
+        const battery_bank_state_t *st = &bat->bank_state[b];
+        json_t *bank = json_object();
+        
+        json_object_set_new(bank, "id", json_string(bk->bank_id));
+        json_object_set_new(bank, "enabled", json_boolean(bk->enabled));
+        json_object_set_new(bank, "soc", json_real(bk->bank_soc));
+        json_object_set_new(bank, "soc_coulomb", json_real(st->soc_coulomb));
+        json_object_set_new(bank, "health_percent", json_real(bk->health_percent));
+        json_object_set_new(bank, "temperature", json_real(bk->temperature_c));
+        json_object_set_new(bank, "voltage", json_real(st->voltage));
+        json_object_set_new(bank, "current", json_real(st->current_a));
+        json_object_set_new(bank, "setpoint", json_real(st->setpoint_w));
+        json_object_set_new(bank, "max_charge_power", json_real(st->max_charge_power_w));
+        json_object_set_new(bank, "max_discharge_power", json_real(st->max_discharge_power_w));
+        json_object_set_new(bank, "balancing_active", json_boolean(bk->balancing_active));
+        json_object_set_new(bank, "health", create_bank_health_json(&bat->health[b]));
+        
+        const battery_thermal_t *th = &bat->thermal[b];
+        json_t *thermal = json_object();
+        json_object_set_new(thermal, "predicted_temperature", json_real(th->predicted_c));
+        json_object_set_new(thermal, "horizon_s", json_real(BATTERY_THERMAL_HORIZON_S));
+        json_object_set_new(thermal, "heat_w", json_real(th->heat_w));
+        json_object_set_new(thermal, "power_limit", json_real(th->power_limit_w));
+        json_object_set_new(thermal, "cooling_requested", json_boolean(th->cooling_requested));
+        json_object_set_new(bank, "thermal", thermal);
+        
+        if (cells->count[b] > 0) {
+            json_t *cell = create_cell_stats_json(&cells->bank[b]);
+            
+            /* Sparse index lists: only the cells that need attention */
+            json_t *outliers = json_array();
+            json_t *balancing = json_array();
+            for (int i = 0; i < cells->count[b]; i++) {
+                if (cells->outlier[b][i])
+                    json_array_append_new(outliers, json_integer(i));
+                if (cells->balance[b][i])
+                    json_array_append_new(balancing, json_integer(i));
+            }
+            json_object_set_new(cell, "outlier_cells", outliers);
+            json_object_set_new(cell, "balancing_cells", balancing);
+            json_object_set_new(bank, "cells", cell);
+        }
+        
+        json_array_append_new(banks, bank);
+    }
+    json_object_set_new(root, "banks", banks);
     
     return root;
 }
@@ -794,6 +1217,24 @@ static json_t* create_loads_status_json(system_controller_t *controller) {
     json_object_set_new(root, "deferred_power", 
                        json_real(lm->deferred_power));
     
+    /* Demand forecast, current slot first */
+    json_t *forecast = json_object();
+    json_t *slots = json_array();
+    time_t now = time(NULL);
+    if (lm->forecast.first_slot >= 0) {
+        for (int h = 0; h < LOAD_FORECAST_SLOTS; h++)
+            json_array_append_new(slots, json_real(lm->forecast.total[h]));
+        json_object_set_new(forecast, "start", 
+                           json_integer((json_int_t)lm->forecast.first_slot * LOAD_FORECAST_STEP_S));
+    }
+    json_object_set_new(forecast, "slot_seconds", json_integer(LOAD_FORECAST_STEP_S));
+    json_object_set_new(forecast, "power", slots);
+    json_object_set_new(forecast, "next_hour_wh", 
+                       json_real(load_forecast_energy(&lm->forecast, now, now + 3600)));
+    json_object_set_new(forecast, "next_day_wh", 
+                       json_real(load_forecast_energy(&lm->forecast, now, now + 86400)));
+    json_object_set_new(root, "forecast", forecast);
+    
     /* Load list */
     json_t *loads = json_array();
     for (int i = 0; i < lm->load_count; i++) {
@@ -805,6 +1246,14 @@ static json_t* create_loads_status_json(system_controller_t *controller) {
                            json_integer(lm->loads[i].priority));
         json_object_set_new(load, "current_state", 
                            json_boolean(lm->load_states[i] == LOAD_STATE_ON));
+        json_object_set_new(load, "shed_seconds", 
+                           json_real(loads_shed_seconds(lm, i)));
+        if (lm->defer_due[i] != 0) {
+            json_object_set_new(load, "delivered_wh", 
+                               json_real(lm->delivered_wh[i]));
+            json_object_set_new(load, "due", 
+                               json_integer((json_int_t)lm->defer_due[i]));
+        }
         
         json_array_append_new(loads, load);
     }
@@ -852,29 +1301,27 @@ static json_t* create_ev_status_json(system_controller_t *controller) {
 static json_t* create_alarms_json(system_controller_t *controller) {
     json_t *root = json_object();
     
-    /* Active alarms */
+    /* Alarm table: everything not INACTIVE (active, acknowledged, latched) */
     json_t *alarms = json_array();
-    uint8_t active_alarms = controller->status.alarms;
+    const alarm_engine_t *engine = &controller->alarms;
     
-    for (int i = 0; i < 32; i++) {
-        if (active_alarms & (1 << i)) {
-            json_t *alarm = json_object();
-            json_object_set_new(alarm, "code", json_integer(i));
-            
-            const char *description = "Unknown alarm";
-            switch (i) {
-                case ALARM_GRID_FAILURE: description = "Grid failure"; break;
-                case ALARM_BATTERY_OVER_TEMP: description = "Battery over temperature"; break;
-                case ALARM_BATTERY_LOW_SOC: description = "Battery low SOC"; break;
-                case ALARM_PV_DISCONNECT: description = "PV disconnect"; break;
-                case ALARM_OVERLOAD: description = "System overload"; break;
-            }
-            
-            json_object_set_new(alarm, "description", json_string(description));
-            json_object_set_new(alarm, "timestamp", json_integer(time(NULL)));
-            
-            json_array_append_new(alarms, alarm);
-        }
+    for (int i = 0; i < ALARM_CODE_COUNT; i++) {
+        const alarm_entry_t *entry = &engine->entries[i];
+        if (entry->state == ALARM_STATE_INACTIVE) continue;
+        
+        const alarm_definition_t *def = alarm_get_definition((alarm_code_t)i);
+        json_t *alarm = json_object();
+        json_object_set_new(alarm, "code", json_integer(i));
+        json_object_set_new(alarm, "description", json_string(def->name));
+        json_object_set_new(alarm, "severity", json_string(alarm_severity_str(def->severity)));
+        json_object_set_new(alarm, "state", json_string(alarm_state_str(entry->state)));
+        json_object_set_new(alarm, "first_seen", json_integer(entry->first_seen));
+        json_object_set_new(alarm, "last_seen", json_integer(entry->last_seen));
+        json_object_set_new(alarm, "last_transition", json_integer(entry->last_transition));
+        json_object_set_new(alarm, "occurrences", json_integer(entry->occurrence_count));
+        json_object_set_new(alarm, "value", json_real(entry->value));
+        
+        json_array_append_new(alarms, alarm);
     }
     json_object_set_new(root, "active_alarms", alarms);
     
@@ -933,4 +1380,17 @@ static json_t* create_system_stats_json(system_controller_t *controller) {
                        json_integer(stats->stats_start_time));
     
     return root;
-}
\ No newline at end of file
+}
+
+static json_t* create_distribution_json(const sim_distribution_t *d) {
+    json_t *json = json_object();
+    
+    json_object_set_new(json, "mean", json_real(d->mean));
+    json_object_set_new(json, "min", json_real(d->min));
+    json_object_set_new(json, "p05", json_real(d->p05));
+    json_object_set_new(json, "p50", json_real(d->p50));
+    json_object_set_new(json, "p95", json_real(d->p95));
+    json_object_set_new(json, "max", json_real(d->max));
+    
+    return json;
+}
@@ -1,6 +1,9 @@
 /* battery.c — production-grade battery management (LFP defaults) */
 
 #include "battery.h"
+#include "clock.h"
+#include "battery_ocv.h"
+#include "battery_soc.h"
 #include "logging.h"
 #include <stdio.h>
 #include <string.h>
@@ -8,55 +11,11 @@
 #include <math.h>
 #include <time.h>
 
-/* Define the OCV point structure */
-typedef struct {
-    double v;
-    double soc;
-} ocv_point_t;
-
-/* --- Voltage->SOC lookup for LFP (pack per-cell OCV mapping) ---
-   This table maps single-cell open-circuit voltage (V) to SOC (%).
-   Values approximate a common LFP curve. We'll interpolate.
-*/
-static const ocv_point_t lfp_ocv_table[] = {
-    {2.80, 0.0}, {3.00, 2.0}, {3.10, 10.0}, {3.20, 30.0},
-    {3.25, 50.0}, {3.30, 70.0}, {3.35, 85.0}, {3.40, 95.0}, {3.45, 100.0}
-};
-static const int lfp_ocv_len = sizeof(lfp_ocv_table) / sizeof(lfp_ocv_table[0]);
-
-/* NMC OCV table */
-static const ocv_point_t nmc_ocv_table[] = {
-    {3.00, 0.0}, {3.40, 10.0}, {3.60, 30.0}, {3.70, 50.0},
-    {3.85, 70.0}, {4.00, 85.0}, {4.10, 95.0}, {4.20, 100.0}
-};
-static const int nmc_ocv_len = sizeof(nmc_ocv_table) / sizeof(nmc_ocv_table[0]);
-
-/* Lead-Acid OCV table */
-static const ocv_point_t lead_acid_ocv_table[] = {
-    {1.75, 0.0}, {1.95, 20.0}, {2.05, 50.0}, {2.15, 80.0},
-    {2.25, 95.0}, {2.35, 100.0}
-};
-static const int lead_acid_ocv_len = sizeof(lead_acid_ocv_table) / sizeof(lead_acid_ocv_table[0]);
-
-/* Helper: linear interpolation on ocv table */
-static double ocv_to_soc(double cell_v, const ocv_point_t* table, int len) {
-    if (cell_v <= table[0].v) return table[0].soc;
-    if (cell_v >= table[len-1].v) return table[len-1].soc;
-    for (int i = 1; i < len; ++i) {
-        if (cell_v <= table[i].v) {
-            double x0 = table[i-1].v, y0 = table[i-1].soc;
-            double x1 = table[i].v, y1 = table[i].soc;
-            double t = (cell_v - x0) / (x1 - x0);
-            return y0 + t * (y1 - y0);
-        }
-    }
-    return 0.0;
-}
-
 // Initialize battery system with sane production defaults
 int battery_init(battery_system_t* bat, const system_config_t* config) {
     if (!bat) return -1;
     memset(bat, 0, sizeof(*bat));
+    battery_ocv_init();
 
     // Default to LFP chemistry and multi-bank defaults
     bat->chemistry = BAT_CHEM_LFP;
@@ -91,6 +50,7 @@ int battery_init(battery_system_t* bat, const system_config_t* config) {
     bat->soc_voltage = 50.0;
     bat->soc_estimated = 50.0;
     bat->soc_smoothed = 50.0;
+    bat->soc_estimator = config ? config->battery_soc_estimator : SOC_ESTIMATOR_FUSION;
     bat->nominal_voltage = 48.0;
     bat->capacity_remaining_wh = 50.0;
     bat->health_percent = 100.0;
@@ -122,6 +82,7 @@ int battery_init(battery_system_t* bat, const system_config_t* config) {
     bat->max_cell_voltage = 0.0;
     bat->min_cell_voltage = 0.0;
     bat->cell_voltage_spread = 0.0;
+    battery_cells_init(&bat->cells);
 
     // SOC fusion parameters
     bat->soc_voltage_weight = 0.4;   // weight for voltage-based (0..1)
@@ -143,20 +104,156 @@ int battery_init(battery_system_t* bat, const system_config_t* config) {
     bat->last_fault_reason[0] = '\0';
     bat->fault_timestamp = 0;
     bat->fault_clear_attempts = 0;
+    battery_limits_init(&bat->limits);
     
     // Cycle counting
     bat->cycle_count = 0;
     bat->deep_cycle_count = 0;
     bat->cycle_depth_accumulated = 0.0;
+    for (int i = 0; i < MAX_BATTERY_BANKS; i++)
+        battery_health_init(&bat->health[i]);
     bat->total_charge_wh = 0.0;
     bat->total_discharge_wh = 0.0;
 
-    (void)config;
+    LOG_INFO("Battery initialized: %d banks, nominal_wh=%.0f, SOC estimator %s", bat->active_bank_count,
+             bat->capacity_nominal_wh, battery_soc_estimator_str(bat->soc_estimator));
+    return 0;
+}
+
+/* Check a reloaded configuration against the running banks. Ratings may
+ * change, the bank set may not: per-bank SOC, health and thermal state
+ * have nothing to carry over to a new bank, so adding, removing or
+ * renaming banks needs a restart. A file that lists no bank ids leaves the
+ * banks as they are. */
+int battery_prepare_config(const battery_system_t* bat, const system_config_t* config) {
+    if (!bat || !config) return -1;
+
+    int listed = 0;
+    for (int i = 0; i < config->bank_count && i < MAX_BATTERY_BANKS; i++)
+        if (config->batteries[i].bank_id[0]) listed++;
+    if (listed == 0) return 0;
+
+    if (config->bank_count != bat->bank_count) {
+        LOG_ERROR("Battery reconfiguration rejected: %d banks configured, %d running (restart to change banks)",
+                  config->bank_count, bat->bank_count);
+        return -1;
+    }
+
+    for (int i = 0; i < config->bank_count; i++) {
+        const char* id = config->batteries[i].bank_id;
+        int matches = 0;
+
+        for (int j = 0; j < bat->bank_count; j++)
+            if (strcmp(bat->banks[j].bank_id, id) == 0) matches++;
+        for (int j = 0; j < i; j++)
+            if (strcmp(config->batteries[j].bank_id, id) == 0) matches = 0;
+
+        if (matches != 1) {
+            LOG_ERROR("Battery reconfiguration rejected: bank '%s' is not a running bank or is listed twice (restart to change banks)", id);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Apply reloaded bank ratings; SOC, health, cycle and thermal state are kept.
+ * The bank set has been checked by battery_prepare_config(). */
+int battery_apply_config(battery_system_t* bat, const system_config_t* config) {
+    if (!bat || !config) return -1;
+
+    int updated = 0;
+
+    for (int i = 0; i < config->bank_count && i < MAX_BATTERY_BANKS; i++) {
+        const battery_bank_t* cfg = &config->batteries[i];
+
+        for (int j = 0; j < bat->bank_count; j++) {
+            battery_bank_t *b = &bat->banks[j];
+            if (strcmp(b->bank_id, cfg->bank_id) != 0) continue;
+
+            // Only ratings present in the file override the running values
+            if (cfg->nominal_voltage > 0) b->nominal_voltage = cfg->nominal_voltage;
+            if (cfg->cells_in_series > 0) b->cells_in_series = cfg->cells_in_series;
+            if (cfg->capacity_wh > 0) b->capacity_wh = cfg->capacity_wh;
+            if (cfg->max_charge_power > 0) b->max_charge_power = cfg->max_charge_power;
+            if (cfg->max_discharge_power > 0) b->max_discharge_power = cfg->max_discharge_power;
+            updated++;
+            break;
+        }
+    }
+
+    bat->capacity_nominal_wh = 0.0;
+    bat->max_charge_power_w = 0.0;
+    bat->max_discharge_power_w = 0.0;
+
+    for (int i = 0; i < bat->bank_count; ++i) {
+        const battery_bank_t *b = &bat->banks[i];
+        bat->capacity_nominal_wh += b->capacity_wh;
+        bat->max_charge_power_w += b->max_charge_power;
+        bat->max_discharge_power_w += b->max_discharge_power;
+    }
+
+    double pack_v = bat->banks[0].nominal_voltage;
+    bat->max_charge_current_a = pack_v > 0 ? bat->max_charge_power_w / pack_v : 0.0;
+    bat->max_discharge_current_a = pack_v > 0 ? bat->max_discharge_power_w / pack_v : 0.0;
+
+    // Switching estimators restarts the new one from the SOC currently in use
+    if (config->battery_soc_estimator != bat->soc_estimator) {
+        bat->soc_estimator = config->battery_soc_estimator;
+        battery_soc_estimator(bat->soc_estimator)->reset(bat, bat->soc_smoothed);
+        LOG_INFO("Battery SOC estimator switched to %s", battery_soc_estimator_str(bat->soc_estimator));
+    }
 
-    LOG_INFO("Battery initialized: %d banks, nominal_wh=%.0f", bat->active_bank_count, bat->capacity_nominal_wh);
+    LOG_INFO("Battery reconfigured: %d banks updated, nominal_wh=%.0f", updated, bat->capacity_nominal_wh);
     return 0;
 }
 
+// Usable capacity of one bank in Ah (rating scaled by health)
+static double battery_bank_capacity_ah(const battery_bank_t* bank) {
+    if (bank->nominal_voltage <= 0.0) return 0.0;
+    return bank->capacity_wh * (bank->health_percent / 100.0) / bank->nominal_voltage;
+}
+
+// Per-bank voltage, current and temperature. When the BMS only reports pack
+// totals, parallel banks are assumed to share the current by capacity.
+static void battery_update_bank_inputs(battery_system_t* bat, const system_measurements_t* measurements) {
+    double capacity_total = 0.0;
+
+    for (int b = 0; b < bat->bank_count; b++) {
+        if (bat->banks[b].enabled) capacity_total += bat->banks[b].capacity_wh;
+    }
+
+    for (int b = 0; b < bat->bank_count; b++) {
+        battery_bank_t* bank = &bat->banks[b];
+        battery_bank_state_t* st = &bat->bank_state[b];
+        const battery_cell_stats_t* cells = &bat->cells.bank[b];
+        bool measured = b < measurements->battery_bank_count;
+
+        if (!bank->enabled) {
+            st->current_a = 0.0;
+            continue;
+        }
+
+        st->voltage = measured ? measurements->battery_bank_voltage[b] : measurements->battery_voltage;
+
+        if (measured)
+            st->current_a = measurements->battery_bank_current[b];
+        else
+            st->current_a = capacity_total > 0.0 ?
+                measurements->battery_current * bank->capacity_wh / capacity_total : 0.0;
+
+        int series = bank->cells_in_series > 0 ? bank->cells_in_series : DEFAULT_BANK_SERIES_CELLS;
+        st->cell_voltage = cells->cell_count > 0 ? cells->v_mean : st->voltage / series;
+
+        // Derate on the hottest cell when cell data is available
+        if (cells->cell_count > 0)
+            bank->temperature_c = cells->t_max;
+        else if (measured)
+            bank->temperature_c = measurements->battery_bank_temp[b];
+        else
+            bank->temperature_c = bat->temperature_c;
+    }
+}
+
 // Update measurements: compute power, SOC, safety, and thermal actions
 void battery_update_measurements(battery_system_t* bat, system_measurements_t* measurements) {
     if (!bat || !measurements) return;
@@ -166,13 +263,13 @@ void battery_update_measurements(battery_system_t* bat, system_measurements_t* m
         bat->temperature_c = measurements->battery_temp;
     }
 
-    if (bat->capacity_remaining_wh)
-        measurements->battery_power = bat->capacity_remaining_wh;
-
-    // Compute battery power (W) using measured voltage and current
-    measurements->battery_voltage = bat->nominal_voltage;
-    //measurements->battery_power = measurements->battery_voltage * measurements->battery_current;
-    measurements->timestamp = measurements->timestamp ? measurements->timestamp : time(NULL);
+    // Without a BMS reading the pack is taken to have followed the last
+    // dispatched setpoint at its nominal voltage
+    if (!(measurements->measured & MEASURED_BATTERY)) {
+        measurements->battery_power = bat->power_setpoint_w;
+        measurements->battery_voltage = bat->nominal_voltage;
+    }
+    measurements->timestamp = measurements->timestamp ? measurements->timestamp : clock_now();
 
     // Track energy flows
     if (bat->last_energy_update_ts == 0) {
@@ -180,25 +277,33 @@ void battery_update_measurements(battery_system_t* bat, system_measurements_t* m
     } else {
         double dt_hours = difftime(measurements->timestamp, bat->last_energy_update_ts) / 3600.0;
         if (dt_hours > 0) {
+            // battery_power is positive while discharging
             double energy_wh = measurements->battery_power * dt_hours;
             if (energy_wh > 0) {
-                bat->total_charge_wh += energy_wh;
+                bat->total_discharge_wh += energy_wh;
             } else {
-                bat->total_discharge_wh += -energy_wh;
+                bat->total_charge_wh += -energy_wh;
             }
             bat->last_energy_update_ts = measurements->timestamp;
         }
     }
 
+    // Cell statistics feed both SOC estimation and balancing
+    if (!bat->cells.analyzed) battery_cells_analyze(&bat->cells);
+
     // Recalculate SOC using measured values
     battery_calculate_soc(bat, measurements);
 
+    // Feed the per-bank SOC into the cycle counter and fade model
+    battery_update_capacity_health(bat);
+
     // Update safety and thermal controls
     battery_check_limits(bat, measurements);
+    battery_check_balancing(bat, measurements);
     battery_thermal_management(bat);
 
     // Auto-clear transient faults after 5 minutes
-    if (bat->state == BATTERY_STATE_FAULT && difftime(time(NULL), bat->fault_timestamp) > 300)
+    if (bat->state == BATTERY_STATE_FAULT && difftime(clock_now(), bat->fault_timestamp) > 300)
         battery_clear_faults(bat);
 }
 
@@ -207,110 +312,84 @@ int battery_calculate_soc(battery_system_t* bat, system_measurements_t* measurem
     if (!bat || !measurements) return 0;
 
     // Timestamp handling
-    time_t now = measurements->timestamp ? measurements->timestamp : time(NULL);
+    time_t now = measurements->timestamp ? measurements->timestamp : clock_now();
+
+    const battery_soc_estimator_t* estimator = battery_soc_estimator(bat->soc_estimator);
+
+    battery_update_bank_inputs(bat, measurements);
 
     if (bat->last_update_ts == 0) {
         bat->last_update_ts = now;
         bat->soc_smoothed = measurements->battery_soc;
-        bat->accumulated_ah = (measurements->battery_soc / 100.0) * (bat->capacity_nominal_wh / bat->banks[0].nominal_voltage);
+        bat->accumulated_ah = 0.0;
+        for (int b = 0; b < bat->bank_count; b++) {
+            battery_bank_state_t* st = &bat->bank_state[b];
+            st->capacity_ah = battery_bank_capacity_ah(&bat->banks[b]);
+            st->accumulated_ah = (measurements->battery_soc / 100.0) * st->capacity_ah;
+            st->soc_coulomb = measurements->battery_soc;
+            bat->accumulated_ah += st->accumulated_ah;
+        }
+        estimator->reset(bat, bat->soc_smoothed);
         return 0;
     }
 
     double dt_s = difftime(now, bat->last_update_ts);
     if (dt_s < 0.5) dt_s = 1.0;
 
-    // Coulomb counting
-
-    // Self-discharge: extremely small
-    if (bat->self_discharge_rate > 0.0) {
-        double per_sec = bat->self_discharge_rate / (100.0 * 86400.0);
-        double wh_loss = bat->capacity_nominal_wh * per_sec * dt_s;
-        double ah_loss = wh_loss / bat->banks[0].nominal_voltage;
-        bat->accumulated_ah -= ah_loss;
-    }
-
-    // Convert charge/discharge current to Ah
-    double delta_ah = measurements->battery_current * dt_s / 3600.0;
-
-    // Efficiency on charge only
-    if (delta_ah > 0)
-        delta_ah *= bat->coulomb_efficiency;
-
-    bat->accumulated_ah += delta_ah;
+    // Coulomb counting, one counter per bank
+    double total_ah = 0.0;
+    bat->accumulated_ah = 0.0;
 
-    // Clamp
-    double total_ah = bat->capacity_nominal_wh / bat->banks[0].nominal_voltage;
-    if (bat->accumulated_ah < 0) bat->accumulated_ah = 0;
-    if (bat->accumulated_ah > total_ah) bat->accumulated_ah = total_ah;
+    for (int b = 0; b < bat->bank_count; b++) {
+        battery_bank_state_t* st = &bat->bank_state[b];
+        if (!bat->banks[b].enabled) continue;
 
-    bat->last_update_ts = now;
+        // Keep the bank SOC when its rating or health changes
+        double capacity_ah = battery_bank_capacity_ah(&bat->banks[b]);
+        if (st->capacity_ah > 0.0 && capacity_ah != st->capacity_ah)
+            st->accumulated_ah *= capacity_ah / st->capacity_ah;
+        st->capacity_ah = capacity_ah;
 
-    double soc_c = 100.0 * (bat->accumulated_ah / total_ah);
-    bat->soc_coulomb = soc_c;
+        // Self-discharge: extremely small
+        if (bat->self_discharge_rate > 0.0)
+            st->accumulated_ah -= capacity_ah * bat->self_discharge_rate / (100.0 * 86400.0) * dt_s;
 
-    // Voltage-based SOC (OCV)
-    double cell_v;
-    double soc_v = 0.0;
+        // Convert charge/discharge current to Ah, efficiency on charge only
+        double delta_ah = st->current_a * dt_s / 3600.0;
+        if (delta_ah > 0)
+            delta_ah *= bat->coulomb_efficiency;
 
-    if (bat->banks[0].cells_in_series > 0)
-        cell_v = measurements->battery_voltage / bat->banks[0].cells_in_series;
-    else
-        cell_v = measurements->battery_voltage / 16.0;
+        st->accumulated_ah += delta_ah;
+        if (st->accumulated_ah < 0) st->accumulated_ah = 0;
+        if (st->accumulated_ah > capacity_ah) st->accumulated_ah = capacity_ah;
 
-    switch (bat->chemistry) {
-        case BAT_CHEM_LFP:
-            soc_v = ocv_to_soc(cell_v, lfp_ocv_table, lfp_ocv_len);
-            break;
-        case BAT_CHEM_NMC:
-            soc_v = ocv_to_soc(cell_v, nmc_ocv_table, nmc_ocv_len);
-            break;
-        case BAT_CHEM_LEAD_ACID:
-            soc_v = ocv_to_soc(cell_v, lead_acid_ocv_table, lead_acid_ocv_len);
-            break;
-        default:
-            soc_v = 0.0;
-            break;
+        st->soc_coulomb = capacity_ah > 0.0 ? 100.0 * st->accumulated_ah / capacity_ah : 0.0;
+        bat->accumulated_ah += st->accumulated_ah;
+        total_ah += capacity_ah;
     }
 
-    bat->soc_voltage = soc_v;
-
-    // Dynamic fusion
-    double wv = bat->soc_voltage_weight;
-    double current_mag = fabs(measurements->battery_current);
-
-    // Completely disable voltage SOC under significant load/charge
-    if (current_mag > bat->max_charge_current_a * 0.05)
-        wv = 0.0;
+    bat->last_update_ts = now;
+    bat->soc_coulomb = total_ah > 0.0 ? 100.0 * bat->accumulated_ah / total_ah : 0.0;
 
-    // Reduce weight in temperature extremes
-    if (bat->temperature_c < 10 || bat->temperature_c > 40)
-        wv *= 0.3;
+    double soc_est = estimator->update(bat, measurements, dt_s);
+    bat->soc_estimated = soc_est;
 
-    if (wv < 0) wv = 0;
-    if (wv > 1) wv = 1;
+    // Exponential smoothing (model-based estimators are already filtered)
+    double smoothed = soc_est;
 
-    double wf = 1.0 - wv;
+    if (estimator->smoothed) {
+        double alpha = bat->soc_smoothing_alpha;
+        double change_mag = fabs(soc_est - bat->soc_smoothed);
 
-    double soc_est = soc_c * wf + soc_v * wv;
-    bat->soc_estimated = soc_est;
+        // Faster smoothing only when SOC changes quickly
+        if (change_mag > 1.0)
+            alpha = fmin(1.0, alpha * 3.0);
+        else if (change_mag < 0.1)
+            alpha = alpha * 0.5;
 
-    // Large discrepancy correction
-    if (wv > 0.8 && fabs(soc_c - soc_v) > 18.0) {
-        bat->accumulated_ah = (soc_v / 100.0) * total_ah;
-        soc_c = soc_v;
+        smoothed = alpha * soc_est + (1 - alpha) * bat->soc_smoothed;
     }
 
-    // Exponential smoothing
-    double alpha = bat->soc_smoothing_alpha;
-    double change_mag = fabs(soc_est - bat->soc_smoothed);
-
-    // Faster smoothing only when SOC changes quickly
-    if (change_mag > 1.0)
-        alpha = fmin(1.0, alpha * 3.0);
-    else if (change_mag < 0.1)
-        alpha = alpha * 0.5;
-
-    double smoothed = alpha * soc_est + (1 - alpha) * bat->soc_smoothed;
     if (smoothed < 0) smoothed = 0;
     if (smoothed > 100) smoothed = 100;
 
@@ -320,9 +399,6 @@ int battery_calculate_soc(battery_system_t* bat, system_measurements_t* measurem
     measurements->battery_soc = smoothed;
     bat->capacity_remaining_wh = (smoothed / 100.0) * bat->capacity_nominal_wh;
 
-    for (int i = 0; i < bat->active_bank_count; i++)
-        bat->banks[i].bank_soc = smoothed;
-
     return 0;
 }
 
@@ -351,6 +427,7 @@ void battery_manage_charging(battery_system_t* bat, double available_power, doub
         bat->absorption_start_ts = 0;
         bat->float_start_ts = 0;
         bat->charge_stage = CHARGE_BULK;
+        bat->power_setpoint_w = 0.0;
         
         return;
     }
@@ -378,14 +455,14 @@ void battery_manage_charging(battery_system_t* bat, double available_power, doub
         
     } else if (bat->soc_smoothed < bat->absorption_charge_soc_limit) {
         if (bat->absorption_start_ts == 0) {
-            bat->absorption_start_ts = time(NULL);
+            bat->absorption_start_ts = clock_now();
             LOG_INFO("Starting absorption charge at %.1f%% SOC", bat->soc_smoothed);
         }
 
         bat->charge_stage = CHARGE_ABSORPTION;
 
         // Ramp down power during absorption
-        double elapsed = difftime(time(NULL), bat->absorption_start_ts);
+        double elapsed = difftime(clock_now(), bat->absorption_start_ts);
         double factor = 1.0;
         if (bat->absorption_duration_s > 0.0) {
             factor = fmax(0.1, 1.0 - (elapsed / bat->absorption_duration_s));
@@ -395,7 +472,7 @@ void battery_manage_charging(battery_system_t* bat, double available_power, doub
         // Time-based cut-off
         if (elapsed >= bat->absorption_duration_s) {
             bat->charge_stage = CHARGE_FLOAT;
-            bat->float_start_ts = time(NULL);
+            bat->float_start_ts = clock_now();
             LOG_INFO("Moving to float charge after %.1f hours", elapsed/3600.0);
         }
     
@@ -403,7 +480,7 @@ void battery_manage_charging(battery_system_t* bat, double available_power, doub
         bat->charge_stage = CHARGE_FLOAT;
         charge_power = fmin(charge_power, max_charge * 0.05); // float ~5%
         if (bat->float_start_ts == 0) {
-            bat->float_start_ts = time(NULL);
+            bat->float_start_ts = clock_now();
             LOG_INFO("Starting float charge at %.1f%% SOC", bat->soc_smoothed);
         }
         
@@ -437,19 +514,10 @@ void battery_manage_charging(battery_system_t* bat, double available_power, doub
         // Assuming 1-second control cycle
         double energy_wh = charge_power / 3600.0; // Convert W to Wh for 1 second
         bat->total_charge_wh += energy_wh;
-        
-        // Update accumulated Ah for SOC calculation
-        double current_a = charge_power / bat->nominal_voltage;
-        double delta_ah = current_a / 3600.0; // Ah for 1 second
-        
-        // Apply coulomb efficiency for charging
-        delta_ah *= bat->coulomb_efficiency;
-        bat->accumulated_ah += delta_ah;
     }
 
-    // Actual charge power that will be used by controller
-    // In a real system, this would set an actual output
-    (void)charge_power; // Avoid unused warning
+    // Requested pack power, split across banks by battery_dispatch()
+    bat->power_setpoint_w = -charge_power;
 }
 
 // Manage discharging when islanded or requested
@@ -472,6 +540,7 @@ void battery_manage_discharging(battery_system_t* bat, double load_power, bool g
             bat->previous_state = bat->state;
 
         bat->state = BATTERY_STATE_IDLE;
+        bat->power_setpoint_w = 0.0;
         return;
     }
 
@@ -488,10 +557,8 @@ void battery_manage_discharging(battery_system_t* bat, double load_power, bool g
         discharge_power *= power_factor;
     }
 
-    // Temperature derating
-    if (bat->temperature_c > 50.0) {
-        discharge_power *= 0.5;
-    }
+    // Cold derating; heat is limited per bank by the thermal model through
+    // battery_calculate_max_discharge()
     if (bat->temperature_c < -10.0) {
         discharge_power *= 0.2;
     }
@@ -506,44 +573,105 @@ void battery_manage_discharging(battery_system_t* bat, double load_power, bool g
 
     bat->total_discharge_wh += discharge_power * (1.0 / 3600.0); // placeholder
 
-    (void)discharge_power; // actuator uses this
+    bat->power_setpoint_w = discharge_power;
+}
+
+// Follow a planned pack power (positive = discharge). Charging goes through
+// the staged charger; discharge keeps the same low-SOC and cold limits as
+// battery_manage_discharging(), heat is left to the per-bank thermal limit.
+void battery_follow_setpoint(battery_system_t* bat, double setpoint_w) {
+    if (!bat) return;
+
+    if (setpoint_w <= 0.0) {
+        battery_manage_charging(bat, -setpoint_w, 0.0);
+        return;
+    }
+
+    double discharge_power = fmin(setpoint_w, battery_calculate_max_discharge(bat));
+
+    if (bat->soc_smoothed <= bat->min_operating_soc || discharge_power < 10.0) {
+        if (bat->state == BATTERY_STATE_DISCHARGING)
+            bat->previous_state = bat->state;
+
+        bat->state = BATTERY_STATE_IDLE;
+        bat->power_setpoint_w = 0.0;
+        return;
+    }
+
+    if (bat->soc_smoothed < bat->min_operating_soc + 10.0)
+        discharge_power *= fmax((bat->soc_smoothed - bat->min_operating_soc) / 10.0, 0.1);
+    if (bat->temperature_c < -10.0)
+        discharge_power *= 0.2;
+
+    bat->previous_state = bat->state;
+    bat->state = BATTERY_STATE_DISCHARGING;
+    bat->power_setpoint_w = discharge_power;
+}
+
+// Charge limit of one bank from its own SOC and temperature (W)
+static double battery_bank_charge_limit(const battery_system_t* bat, int b) {
+    const battery_bank_t* bank = &bat->banks[b];
+    double max_p = bank->max_charge_power;
+    double soc = bank->bank_soc;
+    double temp = bank->temperature_c;
+    uint8_t faults = bat->limits.bank_faults[b];
+
+    if (!bank->enabled) return 0.0;
+
+    // A tripped bank takes no charge; undervoltage alone still allows recharge
+    if (faults & ~BATTERY_LIMIT_FAULT_BIT(LIMIT_FAULT_UNDERVOLTAGE)) return 0.0;
+
+    // Only reduce near top SOC; full power when low
+    if (soc > 80.0)
+        max_p *= fmax(0.05, (100.0 - soc) / 20.0);
+
+    // Temperature derating
+    if (bat->thermal[b].power_limit_w > 0.0) max_p = fmin(max_p, bat->thermal[b].power_limit_w);
+
+    if (temp > 45.0) {
+        max_p *= fmax(1.0 - ((temp - 45.0) / 20.0), 0.3); // Minimum 30% at 65°C
+    } else if (temp < 0.0) {
+        // Emergency charging allowed at very low SOC even below freezing
+        max_p = soc < 10.0 ? max_p * 0.1 : 0.0;
+    } else if (temp < 10.0) {
+        max_p *= temp / 10.0; // Linear from 0-100%
+    }
+
+    return max_p;
+}
+
+// Discharge limit of one bank from its own SOC and temperature (W)
+static double battery_bank_discharge_limit(const battery_system_t* bat, int b) {
+    const battery_bank_t* bank = &bat->banks[b];
+    double max_p = bank->max_discharge_power;
+    double soc = bank->bank_soc;
+    uint8_t faults = bat->limits.bank_faults[b];
+
+    if (!bank->enabled) return 0.0;
+
+    // Likewise overvoltage alone still allows discharge
+    if (faults & ~BATTERY_LIMIT_FAULT_BIT(LIMIT_FAULT_OVERVOLTAGE)) return 0.0;
+
+    if (soc < 30.0)
+        max_p *= fmax(0.0, (soc - bat->min_operating_soc) / (30.0 - bat->min_operating_soc));
+    if (bat->thermal[b].power_limit_w > 0.0) max_p = fmin(max_p, bat->thermal[b].power_limit_w);
+    if (bank->temperature_c < -10.0) max_p *= 0.2;
+    return max_p;
 }
 
-// Compute conservative max charge power (W)
+// Compute conservative max charge power (W): sum of the bank limits
 double battery_calculate_max_charge(battery_system_t* bat) {
     if (!bat) return 0.0;
     
-    double max_p = bat->max_charge_power_w;
+    double max_p = 0.0;
+    for (int b = 0; b < bat->bank_count; b++) {
+        bat->bank_state[b].max_charge_power_w = battery_bank_charge_limit(bat, b);
+        max_p += bat->bank_state[b].max_charge_power_w;
+    }
     
     if (bat->soc_smoothed < 20.0) {
-        // Emergency mode: allow full charging at very low SOC
-        // Don't reduce power when battery is critically low
+        // Emergency mode: banks are not reduced when the pack is critically low
         LOG_WARNING("Emergency charging at low SOC: %.1f%%", bat->soc_smoothed);
-    } else if (bat->soc_smoothed > 80.0) {
-        // Only reduce near top SOC
-        double factor = fmax(0.05, (100.0 - bat->soc_smoothed) / 20.0);
-        max_p *= factor;
-        LOG_DEBUG("Reducing charge at high SOC: factor=%.2f", factor);
-    }
-    
-    // Temperature derating - FIXED
-    if (bat->temperature_c > 45.0) {
-        double derate = 1.0 - ((bat->temperature_c - 45.0) / 20.0);
-        derate = fmax(derate, 0.3); // Minimum 30% at 65°C
-        max_p *= derate;
-        LOG_DEBUG("Temperature derating: %.1f°C -> factor=%.2f", bat->temperature_c, derate);
-    } else if (bat->temperature_c < 0.0) {
-        // Emergency charging allowed at very low SOC even below freezing
-        if (bat->soc_smoothed < 10.0) {
-            max_p *= 0.1; // 10% emergency charge
-            LOG_WARNING("Emergency cold charging at %.1f°C, SOC=%.1f%%", bat->temperature_c, bat->soc_smoothed);
-        } else {
-            max_p = 0.0; // Normal: no charge below freezing
-        }
-    } else if (bat->temperature_c < 10.0) {
-        double derate = bat->temperature_c / 10.0; // Linear from 0-100%
-        max_p *= derate;
-        LOG_DEBUG("Cold temperature derating: %.1f°C -> factor=%.2f", bat->temperature_c, derate);
     }
     
     // Force at least 100W when battery is low
@@ -554,127 +682,203 @@ double battery_calculate_max_charge(battery_system_t* bat) {
     return max_p;
 }
 
-// Compute conservative max discharge power (W)
+// Compute conservative max discharge power (W): sum of the bank limits
 double battery_calculate_max_discharge(battery_system_t* bat) {
     if (!bat) return 0.0;
-    double max_p = bat->max_discharge_power_w;
-    if (bat->soc_smoothed < 30.0) {
-        double factor = fmax(0.0, (bat->soc_smoothed - bat->min_operating_soc) / (30.0 - bat->min_operating_soc));
-        max_p *= factor;
+
+    double max_p = 0.0;
+    for (int b = 0; b < bat->bank_count; b++) {
+        bat->bank_state[b].max_discharge_power_w = battery_bank_discharge_limit(bat, b);
+        max_p += bat->bank_state[b].max_discharge_power_w;
     }
-    if (bat->temperature_c > 55.0) max_p *= 0.5;
-    if (bat->temperature_c < -10.0) max_p *= 0.2;
     return max_p;
 }
 
-// Check hardware & safety limits with hysteresis
-// Return true if fault found
-bool battery_check_limits(battery_system_t* bat, system_measurements_t* measurements) {
-    if (!bat || !measurements) return false;
+/* Split a pack power setpoint (positive = discharge) across the enabled banks.
+ * Shares follow each bank's headroom, tilted towards banks whose SOC is
+ * furthest from the pack mean in the useful direction and away from banks
+ * hotter than the coolest one. Shares above a bank's limit are capped and
+ * the remainder re-split among the others. Returns the power dispatched. */
+double battery_dispatch(battery_system_t* bat, double setpoint_w) {
+    if (!bat) return 0.0;
 
-    bool fault = false;
-    static bool last_overvoltage = false;
-    static bool last_undervoltage = false;
-    static bool last_overcurrent = false;
-    static bool last_overtemperature = false;
-    
-    // Voltage per-cell sanity using configured series cells
-    int s = bat->banks[0].cells_in_series;
-    if (s <= 0) s = DEFAULT_BANK_SERIES_CELLS;
-    double cell_v = (s > 0) ? (measurements->battery_voltage / (double)s) : 0.0;
-
-    // chemistry-specific thresholds with hysteresis
-    double cell_v_max = 3.65, cell_v_min = 2.5;
-    double cell_v_max_hyst = 3.60, cell_v_min_hyst = 2.6;
-    
-    switch (bat->chemistry) {
-        case BAT_CHEM_LFP:
-            break; 
-        case BAT_CHEM_NMC:
-            cell_v_max = 4.2; cell_v_min = 3.0;
-            cell_v_max_hyst = 4.15; cell_v_min_hyst = 3.1;
-            break;
-        case BAT_CHEM_LEAD_ACID:
-            cell_v_max = 2.45; cell_v_min = 1.75;
-            cell_v_max_hyst = 2.40; cell_v_min_hyst = 1.80;
-            break;
+    bool discharge = setpoint_w > 0.0;
+    double headroom[MAX_BATTERY_BANKS] = {0};
+    double weight[MAX_BATTERY_BANKS] = {0};
+    double share[MAX_BATTERY_BANKS] = {0};
+    bool open[MAX_BATTERY_BANKS] = {0};
+    double soc_mean = 0.0, capacity = 0.0, t_min = 0.0;
+    bool any = false;
+
+    if (discharge)
+        battery_calculate_max_discharge(bat);
+    else
+        battery_calculate_max_charge(bat);
+
+    for (int b = 0; b < bat->bank_count; b++) {
+        const battery_bank_t* bank = &bat->banks[b];
+        const battery_bank_state_t* st = &bat->bank_state[b];
+
+        bat->bank_state[b].setpoint_w = 0.0;
+        headroom[b] = discharge ? st->max_discharge_power_w : st->max_charge_power_w;
+        if (headroom[b] <= 0.0) continue;
+
+        soc_mean += bank->bank_soc * st->capacity_ah;
+        capacity += st->capacity_ah;
+        if (!any || bank->temperature_c < t_min) t_min = bank->temperature_c;
+        any = true;
     }
 
-    // Check overvoltage with hysteresis
-    if (cell_v > cell_v_max) {
-        bat->overvoltage_fault = true;
-        if (!last_overvoltage) {
-            strncpy(bat->last_fault_reason, "Cell overvoltage", sizeof(bat->last_fault_reason)-1);
-            bat->fault_timestamp = time(NULL);
-        }
-        fault = true;
-    } else if (cell_v < cell_v_max_hyst && last_overvoltage) {
-        bat->overvoltage_fault = false;
-    }
-    last_overvoltage = bat->overvoltage_fault;
-
-    // Check undervoltage with hysteresis
-    if (cell_v < cell_v_min) {
-        bat->undervoltage_fault = true;
-        if (!last_undervoltage) {
-            strncpy(bat->last_fault_reason, "Cell undervoltage", sizeof(bat->last_fault_reason)-1);
-            bat->fault_timestamp = time(NULL);
-        }
-        fault = true;
-    
-    } else if (cell_v > cell_v_min_hyst && last_undervoltage)
-        bat->undervoltage_fault = false;
-    
-    last_undervoltage = bat->undervoltage_fault;
-
-    // Current limit
-    double max_charge_a = bat->max_charge_current_a;
-    double max_discharge_a = bat->max_discharge_current_a;
-    double charge_threshold = max_charge_a * 1.2;
-    double discharge_threshold = max_discharge_a * 1.2;
-    double charge_hyst = max_charge_a * 1.1;
-    double discharge_hyst = max_discharge_a * 1.1;
-
-    if (measurements->battery_current > charge_threshold) {
-        bat->overcurrent_fault = true;
-        fault = true;
-
-        if (!last_overcurrent) {
-            strncpy(bat->last_fault_reason, "Charge overcurrent", sizeof(bat->last_fault_reason)-1);
-            bat->fault_timestamp = time(NULL);
-        }
+    if (!any || setpoint_w == 0.0) return 0.0;
+    soc_mean = capacity > 0.0 ? soc_mean / capacity : 0.0;
 
-    } else if (measurements->battery_current < -discharge_threshold) {
-        bat->overcurrent_fault = true;
-        fault = true;
+    for (int b = 0; b < bat->bank_count; b++) {
+        if (headroom[b] <= 0.0) continue;
 
-        if (!last_overcurrent) {
-            strncpy(bat->last_fault_reason, "Discharge overcurrent", sizeof(bat->last_fault_reason)-1);
-            bat->fault_timestamp = time(NULL);
+        // Discharge the fuller banks harder, charge the emptier ones harder
+        double soc_dev = (bat->banks[b].bank_soc - soc_mean) / 100.0;
+        double f_soc = fmax(0.05, 1.0 + BATTERY_DISPATCH_SOC_GAIN * (discharge ? soc_dev : -soc_dev));
+        double f_temp = fmax(0.2, 1.0 - BATTERY_DISPATCH_TEMP_GAIN * (bat->banks[b].temperature_c - t_min));
+
+        weight[b] = headroom[b] * f_soc * f_temp;
+        open[b] = true;
+    }
+
+    // Water-filling: cap banks whose share exceeds their headroom, re-split the rest
+    double remaining = fabs(setpoint_w);
+    for (int pass = 0; pass <= bat->bank_count && remaining > 0.0; pass++) {
+        double wsum = 0.0;
+        for (int b = 0; b < bat->bank_count; b++)
+            if (open[b]) wsum += weight[b];
+        if (wsum <= 0.0) break;
+
+        bool capped = false;
+        for (int b = 0; b < bat->bank_count; b++) {
+            if (open[b] && remaining * weight[b] / wsum >= headroom[b]) {
+                share[b] = headroom[b];
+                remaining -= headroom[b];
+                open[b] = false;
+                capped = true;
+            }
         }
+        if (capped) continue;
 
-    } else if (measurements->battery_current < charge_hyst && measurements->battery_current > -discharge_hyst && last_overcurrent)
-        bat->overcurrent_fault = false;
+        for (int b = 0; b < bat->bank_count; b++)
+            if (open[b]) share[b] = remaining * weight[b] / wsum;
+        remaining = 0.0;
+    }
 
-    last_overcurrent = bat->overcurrent_fault;
+    double dispatched = 0.0;
+    for (int b = 0; b < bat->bank_count; b++) {
+        bat->bank_state[b].setpoint_w = discharge ? share[b] : -share[b];
+        dispatched += bat->bank_state[b].setpoint_w;
+    }
 
-    // Temperature
-    double temp_threshold = 60.0;
-    double temp_hyst = 55.0;
-    
-    if (measurements->battery_temp > temp_threshold) {
-        bat->overtemperature_fault = true;
-        fault = true;
+    return dispatched;
+}
+
+// Sample one limit signal; false if it has no meaningful value right now
+static bool battery_limit_sample(const battery_system_t* bat, const system_measurements_t* measurements,
+                                 battery_limit_signal_t signal, int b, double* value) {
+    const battery_bank_t* bank = &bat->banks[b];
+    const battery_bank_state_t* st = &bat->bank_state[b];
+    const battery_cell_stats_t* cells = &bat->cells.bank[b];
+    double rated_a = bank->nominal_voltage > 0.0 ? bank->max_charge_power / bank->nominal_voltage : 0.0;
+
+    switch (signal) {
+        case LIMIT_SIGNAL_CELL_VOLTAGE_MAX:
+            *value = cells->cell_count > 0 ? cells->v_max : st->cell_voltage;
+            return true;
+        case LIMIT_SIGNAL_CELL_VOLTAGE_MIN:
+            *value = cells->cell_count > 0 ? cells->v_min : st->cell_voltage;
+            return true;
+        case LIMIT_SIGNAL_CELL_TEMPERATURE:
+            *value = bank->temperature_c;
+            return true;
+        case LIMIT_SIGNAL_BANK_CHARGE_CURRENT:
+            *value = rated_a > 0.0 ? st->current_a / rated_a : 0.0;
+            return rated_a > 0.0;
+        case LIMIT_SIGNAL_BANK_DISCHARGE_CURRENT:
+            rated_a = bank->nominal_voltage > 0.0 ? bank->max_discharge_power / bank->nominal_voltage : 0.0;
+            *value = rated_a > 0.0 ? -st->current_a / rated_a : 0.0;
+            return rated_a > 0.0;
+        case LIMIT_SIGNAL_PACK_CHARGE_CURRENT:
+            *value = bat->max_charge_current_a > 0.0 ?
+                measurements->battery_current / bat->max_charge_current_a : 0.0;
+            return bat->max_charge_current_a > 0.0;
+        case LIMIT_SIGNAL_PACK_DISCHARGE_CURRENT:
+            *value = bat->max_discharge_current_a > 0.0 ?
+                -measurements->battery_current / bat->max_discharge_current_a : 0.0;
+            return bat->max_discharge_current_a > 0.0;
+    }
+    return false;
+}
+
+// Check hardware & safety limits against the chemistry's rule table
+// Return true while any limit is tripped
+bool battery_check_limits(battery_system_t* bat, system_measurements_t* measurements) {
+    if (!bat || !measurements) return false;
+
+    battery_limits_t* limits = &bat->limits;
+    time_t now = measurements->timestamp ? measurements->timestamp : clock_now();
+    int rule_count = 0;
+    const battery_limit_rule_t* rules = battery_limit_rules(bat->chemistry, &rule_count);
+    uint8_t pack_faults = 0;
+
+    memset(limits->bank_faults, 0, sizeof(limits->bank_faults));
+    limits->active_count = 0;
+
+    for (int r = 0; r < rule_count; r++) {
+        const battery_limit_rule_t* rule = &rules[r];
+        bool per_bank = battery_limit_signal_per_bank(rule->signal);
+        int instances = per_bank ? bat->bank_count : 1;
+
+        for (int b = 0; b < instances; b++) {
+            battery_limit_state_t* state = &limits->state[r][b];
+            double value = 0.0;
 
-        if (!last_overtemperature) {
-            strncpy(bat->last_fault_reason, "Overtemperature", sizeof(bat->last_fault_reason)-1);
-            bat->fault_timestamp = time(NULL);
+            if (per_bank && !bat->banks[b].enabled) {
+                state->active = false;
+                state->pending_since = 0;
+                continue;
+            }
+
+            if (battery_limit_sample(bat, measurements, rule->signal, b, &value)) {
+                battery_limit_event_t event = battery_limit_step(rule, state, value, now);
+
+                if (event == LIMIT_EVENT_TRIP) {
+                    if (per_bank)
+                        snprintf(bat->last_fault_reason, sizeof(bat->last_fault_reason), "Bank %s %s (%.2f)",
+                                 bat->banks[b].bank_id, rule->reason, value);
+                    else
+                        snprintf(bat->last_fault_reason, sizeof(bat->last_fault_reason), "Pack %s (%.2f)",
+                                 rule->reason, value);
+                    bat->fault_timestamp = clock_now();
+                    LOG_WARNING("Battery limit tripped: %s", bat->last_fault_reason);
+                }
+            }
+
+            if (!state->active) continue;
+
+            limits->active_count++;
+            if (per_bank)
+                limits->bank_faults[b] |= BATTERY_LIMIT_FAULT_BIT(rule->fault);
+            else
+                pack_faults |= BATTERY_LIMIT_FAULT_BIT(rule->fault);
         }
+    }
+
+    limits->pack_faults = pack_faults;
 
-    } else if (measurements->battery_temp < temp_hyst && last_overtemperature)
-        bat->overtemperature_fault = false;
+    uint8_t all_faults = pack_faults;
+    for (int b = 0; b < bat->bank_count; b++) all_faults |= limits->bank_faults[b];
 
-    last_overtemperature = bat->overtemperature_fault;
+    bat->overvoltage_fault = all_faults & BATTERY_LIMIT_FAULT_BIT(LIMIT_FAULT_OVERVOLTAGE);
+    bat->undervoltage_fault = all_faults & BATTERY_LIMIT_FAULT_BIT(LIMIT_FAULT_UNDERVOLTAGE);
+    bat->overcurrent_fault = all_faults & BATTERY_LIMIT_FAULT_BIT(LIMIT_FAULT_OVERCURRENT);
+    bat->overtemperature_fault = all_faults & BATTERY_LIMIT_FAULT_BIT(LIMIT_FAULT_OVERTEMPERATURE);
+
+    bool fault = limits->active_count > 0;
 
     if (fault && bat->state != BATTERY_STATE_FAULT) {
         bat->previous_state = bat->state;
@@ -685,7 +889,21 @@ bool battery_check_limits(battery_system_t* bat, system_measurements_t* measurem
     return fault;
 }
 
-// Simple thermal manager with hysteresis
+// Bank resistance from the equivalent-circuit fit (ohm per series string)
+static double battery_bank_resistance(const battery_system_t* bat, int b) {
+    const battery_bank_t* bank = &bat->banks[b];
+    const soc_ekf_params_t* prm = soc_ekf_params(bat->chemistry);
+    double capacity_ah = bat->bank_state[b].capacity_ah > 0.0 ?
+        bat->bank_state[b].capacity_ah : battery_bank_capacity_ah(bank);
+    int series = bank->cells_in_series > 0 ? bank->cells_in_series : DEFAULT_BANK_SERIES_CELLS;
+
+    if (!prm || capacity_ah <= 0.0) return 0.0;
+    return (prm->r0 + prm->r1 + prm->r2) * series / capacity_ah;
+}
+
+// Thermal manager: per-bank lumped model predicts the temperature at the end
+// of the horizon for the planned setpoint; cooling starts and power is capped
+// before a limit is reached rather than after
 void battery_thermal_management(battery_system_t* bat) {
     if (!bat) return;
 
@@ -693,13 +911,58 @@ void battery_thermal_management(battery_system_t* bat) {
     const double cooling_off = 33.0;
     const double heating_on = 8.0;
     const double heating_off = 10.0;
+    const battery_thermal_params_t* prm = battery_thermal_params(bat->chemistry);
+    bool cooling = false;
+
+    for (int b = 0; b < bat->bank_count; b++) {
+        const battery_bank_t* bank = &bat->banks[b];
+        const battery_bank_state_t* st = &bat->bank_state[b];
+        battery_thermal_t* th = &bat->thermal[b];
+
+        if (!bank->enabled) {
+            th->cooling_requested = false;
+            continue;
+        }
 
-    if (bat->temperature_c >= cooling_on) {
-        bat->cooling_active = true;
-    } else if (bat->temperature_c <= cooling_off) {
-        bat->cooling_active = false;
+        double kwh = bank->capacity_wh / 1000.0;
+        double g_passive = prm->conductance * kwh;
+        double g_cooled = g_passive + prm->cooling_conductance * kwh;
+        double voltage = st->voltage > 0.0 ? st->voltage : bank->nominal_voltage;
+        double current = voltage > 0.0 ? fmax(fabs(st->setpoint_w) / voltage, fabs(st->current_a)) : fabs(st->current_a);
+        double temp = bank->temperature_c;
+        double amb = bat->ambient_temperature_c;
+
+        th->heat_capacity_jk = prm->heat_capacity * bank->capacity_wh;
+        th->resistance_ohm = battery_bank_resistance(bat, b);
+        th->heat_w = current * current * th->resistance_ohm;
+
+        // Pre-cool when the bank would pass the threshold within the horizon
+        double uncooled = battery_thermal_predict(temp, amb, th->heat_w, th->heat_capacity_jk,
+                                                  g_passive, BATTERY_THERMAL_HORIZON_S);
+        if (temp >= cooling_on || uncooled >= cooling_on) {
+            th->cooling_requested = true;
+        } else if (temp <= cooling_off && uncooled < cooling_off) {
+            th->cooling_requested = false;
+        }
+
+        th->conductance_wk = th->cooling_requested ? g_cooled : g_passive;
+        th->predicted_c = battery_thermal_predict(temp, amb, th->heat_w, th->heat_capacity_jk,
+                                                  th->conductance_wk, BATTERY_THERMAL_HORIZON_S);
+
+        // Power whose I^2 R ends the horizon at the derate point with cooling on
+        double rated = fmax(bank->max_charge_power, bank->max_discharge_power);
+        double budget = battery_thermal_heat_budget(temp, amb, BATTERY_THERMAL_DERATE_C, th->heat_capacity_jk,
+                                                    g_cooled, BATTERY_THERMAL_HORIZON_S);
+        double limit = rated;
+        if (th->resistance_ohm > 0.0)
+            limit = budget > 0.0 ? sqrt(budget / th->resistance_ohm) * voltage : 0.0;
+        th->power_limit_w = fmin(rated, fmax(limit, rated * BATTERY_THERMAL_MIN_POWER));
+
+        cooling |= th->cooling_requested;
     }
 
+    bat->cooling_active = cooling;
+
     if (bat->temperature_c <= heating_on) {
         bat->heating_active = true;
     } else if (bat->temperature_c >= heating_off) {
@@ -733,8 +996,9 @@ void battery_log_status(const battery_system_t* bat) {
            (bat->state == BATTERY_STATE_EQUALIZE) ? "EQUALIZE" :
            (bat->state == BATTERY_STATE_FAULT) ? "FAULT" : "IDLE");
     printf("Charge Stage: %d\n", bat->charge_stage);
-    printf("SOC: %.2f%% (est: %.2f, coulomb: %.2f, voltage: %.2f)\n",
-           bat->soc_smoothed, bat->soc_estimated, bat->soc_coulomb, bat->soc_voltage);
+    printf("SOC: %.2f%% (%s est: %.2f, coulomb: %.2f, voltage: %.2f)\n",
+           bat->soc_smoothed, battery_soc_estimator_str(bat->soc_estimator),
+           bat->soc_estimated, bat->soc_coulomb, bat->soc_voltage);
     printf("Capacity Remaining: %.0f Wh / %.0f Wh nominal\n", bat->capacity_remaining_wh, bat->capacity_nominal_wh);
     printf("Temp: %.1f °C (ambient %.1f °C) Cooling=%s Heating=%s\n",
            bat->temperature_c, bat->ambient_temperature_c,
@@ -745,7 +1009,24 @@ void battery_log_status(const battery_system_t* bat) {
     }
     printf("Total Charge: %.3f kWh, Total Discharge: %.3f kWh\n",
            bat->total_charge_wh / 1000.0, bat->total_discharge_wh / 1000.0);
-    printf("Cycle Count: %d\n", bat->cycle_count);
+    printf("Cycle Count: %d (deep: %d), Health: %.2f%%\n", bat->cycle_count, bat->deep_cycle_count, bat->health_percent);
+    for (int b = 0; b < bat->bank_count; b++) {
+        const battery_bank_t* bank = &bat->banks[b];
+        const battery_bank_state_t* st = &bat->bank_state[b];
+        printf("  %-10s %s SOC %5.1f%% (coulomb %5.1f%%) %6.1f A %5.1f °C setpoint %7.0f W limits +%.0f/-%.0f W"
+               " health %.2f%% (%.1f EFC) %.0f min: %.1f °C\n",
+               bank->bank_id, bank->enabled ? "ON " : "OFF", bank->bank_soc, st->soc_coulomb,
+               st->current_a, bank->temperature_c, st->setpoint_w,
+               st->max_discharge_power_w, st->max_charge_power_w,
+               bank->health_percent, bat->health[b].full_cycles,
+               BATTERY_THERMAL_HORIZON_S / 60.0, bat->thermal[b].predicted_c);
+    }
+    if (battery_cells_available(&bat->cells)) {
+        const battery_cell_stats_t* p = &bat->cells.pack;
+        printf("Cells: %d, V min/mean/max: %.3f/%.3f/%.3f V (spread %.0f mV), outliers: %d, balancing: %d\n",
+               p->cell_count, p->v_min, p->v_mean, p->v_max, p->v_spread * 1000.0,
+               p->outlier_count, p->balance_count);
+    }
     printf("============================\n");
 }
 
@@ -774,71 +1055,72 @@ void battery_clear_faults(battery_system_t* bat) {
     }
 }
 
-/* Check cell balancing needs */
+/* Check cell balancing needs from per-cell telemetry */
 bool battery_check_balancing(battery_system_t* bat, system_measurements_t* measurements) {
-    if (!bat || !bat->balancing_enabled) return false;
-    
-    /* Simplified: In real implementation, you would have individual cell voltages */
-    double avg_cell_v = measurements->battery_voltage / bat->banks[0].cells_in_series;
-    
-    /* Simulate some cell voltage spread */
-    double spread = 0.020; /* 20mV typical */
-    if (bat->soc_smoothed > 90.0) {
-        spread = 0.050; /* Higher spread at high SOC */
-    }
-    
-    bat->max_cell_voltage = avg_cell_v + spread/2;
-    bat->min_cell_voltage = avg_cell_v - spread/2;
-    bat->cell_voltage_spread = spread;
-    
-    /* Trigger balancing if spread exceeds threshold */
-    bool needs_balancing = (spread > 0.030); /* 30mV threshold */
-    
-    if (needs_balancing && bat->state == BATTERY_STATE_CHARGING) {
-        for (int i = 0; i < bat->active_bank_count; i++) {
-            bat->banks[i].balancing_active = true;
-        }
+    if (!bat || !measurements) return false;
+
+    battery_cells_t* cells = &bat->cells;
+    if (!cells->analyzed) battery_cells_analyze(cells);
+
+    if (battery_cells_available(cells)) {
+        bat->max_cell_voltage = cells->pack.v_max;
+        bat->min_cell_voltage = cells->pack.v_min;
+        bat->cell_voltage_spread = cells->pack.v_spread;
     } else {
-        for (int i = 0; i < bat->active_bank_count; i++) {
-            bat->banks[i].balancing_active = false;
-        }
+        // No cell telemetry: only the pack average is known
+        int s = bat->banks[0].cells_in_series;
+        double avg_cell_v = (s > 0) ? measurements->battery_voltage / (double)s : 0.0;
+        bat->max_cell_voltage = avg_cell_v;
+        bat->min_cell_voltage = avg_cell_v;
+        bat->cell_voltage_spread = 0.0;
     }
-    
+
+    /* Bleed only while charging; the cell module keeps the start/stop hysteresis */
+    bool allowed = bat->balancing_enabled && bat->state == BATTERY_STATE_CHARGING;
+    bool needs_balancing = false;
+
+    for (int i = 0; i < bat->bank_count && i < MAX_BATTERY_BANKS; i++) {
+        bool bank_needs = cells->bank[i].balance_count > 0;
+        bat->banks[i].balancing_active = allowed && bank_needs;
+        needs_balancing |= bank_needs;
+    }
+
     return needs_balancing;
 }
 
-/* Update capacity health based on usage */
+/* Update capacity health from the per-bank rainflow counter and fade model */
 void battery_update_capacity_health(battery_system_t* bat) {
-    if (!bat) return;
-    
-    /* Simple health model based on cycles and age */
-    double cycle_degradation = bat->cycle_count * 0.05; /* 0.05% per cycle */
-    double deep_cycle_degradation = bat->deep_cycle_count * 0.1; /* 0.1% per deep cycle */
-    
-    /* 2% per year time-based degradation */
-    time_t now = time(NULL);
-    double years_operation = difftime(now, bat->last_update_ts) / (365.25 * 86400.0);
-    double time_degradation = years_operation * 2.0;
-    
-    /* Calculate total degradation */
-    double total_degradation = cycle_degradation + time_degradation + deep_cycle_degradation;
-    
-    /* Update health percentage */
-    bat->health_percent = 100.0 - total_degradation;
-    bat->health_percent = fmax(fmin(bat->health_percent, 100.0), 0.0);
-    
-    /* Update nominal capacity based on health */
-    double original_capacity = 0.0;
-    for (int i = 0; i < bat->bank_count; i++) {
-        original_capacity += bat->banks[i].capacity_wh;
-    }
-    
-    bat->capacity_nominal_wh = original_capacity * (bat->health_percent / 100.0);
-    
-    /* Update individual bank health */
-    for (int i = 0; i < bat->active_bank_count; i++) {
-        bat->banks[i].health_percent = bat->health_percent;
+    if (!bat || bat->last_update_ts == 0) return;
+
+    double capacity = 0.0, rated = 0.0, cycles = 0.0;
+    int deep_cycles = 0;
+
+    for (int b = 0; b < bat->bank_count; b++) {
+        battery_bank_t* bank = &bat->banks[b];
+        battery_health_t* h = &bat->health[b];
+        const battery_bank_state_t* st = &bat->bank_state[b];
+
+        if (!bank->enabled) continue;
+
+        battery_health_update(h, bat->chemistry, bank->bank_soc, st->current_a,
+                              st->capacity_ah, bank->temperature_c, bat->last_update_ts);
+
+        bank->health_percent = battery_health_percent(h);
+        bank->cycle_count = (int)h->full_cycles;
+
+        capacity += bank->capacity_wh * (bank->health_percent / 100.0);
+        rated += bank->capacity_wh;
+        cycles += h->full_cycles;
+        deep_cycles += (int)(h->dod_cycles[BATTERY_HEALTH_DOD_BINS - 1] + h->dod_cycles[BATTERY_HEALTH_DOD_BINS - 2]);
     }
+
+    if (rated <= 0.0) return;
+
+    bat->capacity_nominal_wh = capacity;
+    bat->health_percent = 100.0 * capacity / rated;
+    bat->cycle_depth_accumulated = cycles;
+    bat->cycle_count = (int)cycles;
+    bat->deep_cycle_count = deep_cycles;
 }
 
 /* Enter maintenance mode */
@@ -0,0 +1,217 @@
+#include "battery_cells.h"
+#include "logging.h"
+#include <math.h>
+#include <string.h>
+
+/*
+ * Reductions keep CELL_LANES independent accumulators so the loops vectorize
+ * without -ffast-math: the compiler may not reorder a single float sum or
+ * min/max chain, but it can map one lane per vector element.
+ */
+#define CELL_LANES      8
+
+#define CELL_VOLTAGE_MAX        10.0f   // anything above is a sensor fault, not a cell
+#define CELL_TEMPERATURE_MIN   -60.0f
+#define CELL_TEMPERATURE_MAX    150.0f
+
+typedef struct {
+    float min;
+    float max;
+    float sum;
+} cell_reduction_t;
+
+static cell_reduction_t cell_reduce(const float* x, int n) {
+    float lo[CELL_LANES], hi[CELL_LANES], sum[CELL_LANES];
+
+    for (int k = 0; k < CELL_LANES; k++) {
+        lo[k] = x[0];
+        hi[k] = x[0];
+        sum[k] = 0.0f;
+    }
+
+    int i = 0;
+    for (; i + CELL_LANES <= n; i += CELL_LANES) {
+        for (int k = 0; k < CELL_LANES; k++) {
+            float v = x[i + k];
+            lo[k] = v < lo[k] ? v : lo[k];
+            hi[k] = v > hi[k] ? v : hi[k];
+            sum[k] += v;
+        }
+    }
+    for (; i < n; i++) {
+        float v = x[i];
+        lo[0] = v < lo[0] ? v : lo[0];
+        hi[0] = v > hi[0] ? v : hi[0];
+        sum[0] += v;
+    }
+
+    cell_reduction_t r = { lo[0], hi[0], 0.0f };
+    for (int k = 0; k < CELL_LANES; k++) {
+        r.min = lo[k] < r.min ? lo[k] : r.min;
+        r.max = hi[k] > r.max ? hi[k] : r.max;
+        r.sum += sum[k];
+    }
+    return r;
+}
+
+static int cell_find(const float* x, int n, float value) {
+    for (int i = 0; i < n; i++) {
+        if (x[i] == value) return i;
+    }
+    return 0;
+}
+
+/* flags[i] = |x[i] - center| > limit; returns the number of flagged cells */
+static int cell_flag_deviation(const float* x, int n, float center, float limit, uint8_t* flags) {
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        uint8_t f = fabsf(x[i] - center) > limit;
+        flags[i] = f;
+        count += f;
+    }
+    return count;
+}
+
+/* flags[i] = x[i] > threshold; returns the number of flagged cells */
+static int cell_flag_above(const float* x, int n, float threshold, uint8_t* flags) {
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        uint8_t f = x[i] > threshold;
+        flags[i] = f;
+        count += f;
+    }
+    return count;
+}
+
+/* True if every reading is finite and physically plausible */
+static bool cell_readings_valid(const float* voltage, const float* temperature, int n) {
+    int bad = 0;
+    for (int i = 0; i < n; i++) {
+        bad |= !(voltage[i] >= 0.0f && voltage[i] <= CELL_VOLTAGE_MAX);
+        bad |= !(temperature[i] >= CELL_TEMPERATURE_MIN && temperature[i] <= CELL_TEMPERATURE_MAX);
+    }
+    return bad == 0;
+}
+
+void battery_cells_init(battery_cells_t* cells) {
+    if (!cells) return;
+    memset(cells, 0, sizeof(*cells));
+}
+
+/* Replace one bank's readings; rejected batches leave the previous data in place */
+int battery_cells_ingest(battery_cells_t* cells, int bank, const float* voltage,
+                         const float* temperature, int count, time_t timestamp) {
+    if (!cells || !voltage || !temperature) return -1;
+    if (bank < 0 || bank >= MAX_BATTERY_BANKS || count < 0) return -1;
+
+    if (count > BATTERY_CELLS_MAX_PER_BANK) {
+        LOG_WARNING("Bank %d reports %d cells, keeping the first %d",
+                    bank, count, BATTERY_CELLS_MAX_PER_BANK);
+        count = BATTERY_CELLS_MAX_PER_BANK;
+    }
+
+    if (!cell_readings_valid(voltage, temperature, count)) {
+        LOG_WARNING("Bank %d cell readings rejected: value out of range", bank);
+        return -1;
+    }
+
+    memcpy(cells->voltage[bank], voltage, (size_t)count * sizeof(float));
+    memcpy(cells->temperature[bank], temperature, (size_t)count * sizeof(float));
+    cells->count[bank] = count;
+    cells->updated[bank] = timestamp;
+    cells->analyzed = false;
+    return 0;
+}
+
+void battery_cells_clear(battery_cells_t* cells, int bank) {
+    if (!cells || bank < 0 || bank >= MAX_BATTERY_BANKS) return;
+
+    cells->count[bank] = 0;
+    memset(&cells->bank[bank], 0, sizeof(cells->bank[bank]));
+    cells->analyzed = false;
+}
+
+static void cell_analyze_bank(battery_cells_t* cells, int bank) {
+    battery_cell_stats_t* s = &cells->bank[bank];
+    const float* v = cells->voltage[bank];
+    const float* t = cells->temperature[bank];
+    int n = cells->count[bank];
+    bool was_balancing = s->balance_target_v > 0.0f;
+
+    memset(s, 0, sizeof(*s));
+    s->v_min_bank = s->v_max_bank = bank;
+    if (n == 0) return;
+
+    cell_reduction_t rv = cell_reduce(v, n);
+    cell_reduction_t rt = cell_reduce(t, n);
+
+    s->cell_count = n;
+    s->v_min = rv.min;
+    s->v_max = rv.max;
+    s->v_mean = rv.sum / (float)n;
+    s->v_spread = rv.max - rv.min;
+    s->t_min = rt.min;
+    s->t_max = rt.max;
+    s->t_mean = rt.sum / (float)n;
+    s->v_min_cell = cell_find(v, n, rv.min);
+    s->v_max_cell = cell_find(v, n, rv.max);
+
+    s->outlier_count = cell_flag_deviation(v, n, s->v_mean, BATTERY_CELL_OUTLIER_V, cells->outlier[bank]);
+
+    // Start above BALANCE_START, keep going until the spread falls below BALANCE_STOP
+    float threshold = was_balancing ? BATTERY_CELL_BALANCE_STOP_V : BATTERY_CELL_BALANCE_START_V;
+    if (s->v_spread > threshold) {
+        s->balance_target_v = s->v_min + BATTERY_CELL_BALANCE_WINDOW_V;
+        s->balance_count = cell_flag_above(v, n, s->balance_target_v, cells->balance[bank]);
+    } else {
+        memset(cells->balance[bank], 0, (size_t)n);
+    }
+}
+
+/* Recompute per-bank and pack statistics from the latest readings */
+void battery_cells_analyze(battery_cells_t* cells) {
+    if (!cells) return;
+
+    battery_cell_stats_t* p = &cells->pack;
+    double v_sum = 0.0, t_sum = 0.0;
+
+    memset(p, 0, sizeof(*p));
+
+    for (int b = 0; b < MAX_BATTERY_BANKS; b++) {
+        cell_analyze_bank(cells, b);
+
+        const battery_cell_stats_t* s = &cells->bank[b];
+        if (s->cell_count == 0) continue;
+
+        if (p->cell_count == 0 || s->v_min < p->v_min) {
+            p->v_min = s->v_min;
+            p->v_min_bank = b;
+            p->v_min_cell = s->v_min_cell;
+        }
+        if (p->cell_count == 0 || s->v_max > p->v_max) {
+            p->v_max = s->v_max;
+            p->v_max_bank = b;
+            p->v_max_cell = s->v_max_cell;
+        }
+        if (p->cell_count == 0 || s->t_min < p->t_min) p->t_min = s->t_min;
+        if (p->cell_count == 0 || s->t_max > p->t_max) p->t_max = s->t_max;
+
+        v_sum += (double)s->v_mean * s->cell_count;
+        t_sum += (double)s->t_mean * s->cell_count;
+        p->cell_count += s->cell_count;
+        p->outlier_count += s->outlier_count;
+        p->balance_count += s->balance_count;
+    }
+
+    if (p->cell_count > 0) {
+        p->v_mean = (float)(v_sum / p->cell_count);
+        p->t_mean = (float)(t_sum / p->cell_count);
+        p->v_spread = p->v_max - p->v_min;
+    }
+
+    cells->analyzed = true;
+}
+
+bool battery_cells_available(const battery_cells_t* cells) {
+    return cells && cells->pack.cell_count > 0;
+}
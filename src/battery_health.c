@@ -0,0 +1,157 @@
+#include "battery_health.h"
+#include <math.h>
+#include <string.h>
+
+/* Coefficients follow the semi-empirical cycle/calendar model of Xu et al.
+ * (2018), with cycle_k scaled to typical datasheet cycle life to 80 %:
+ * LFP ~6000, NMC ~2500, lead-acid ~600 full cycles. */
+static const battery_health_params_t health_params[] = {
+    [BAT_CHEM_LFP]       = { .cycle_k = 3.7e-5, .cycle_exp = 1.3, .calendar_k = 4.14e-10,
+                             .soc_k = 1.04, .temp_k = 0.0693, .c_rate_k = 0.3,
+                             .sei_a = 5.75e-2, .sei_b = 121.0 },
+    [BAT_CHEM_NMC]       = { .cycle_k = 8.9e-5, .cycle_exp = 1.6, .calendar_k = 6.0e-10,
+                             .soc_k = 1.04, .temp_k = 0.0693, .c_rate_k = 0.4,
+                             .sei_a = 5.75e-2, .sei_b = 121.0 },
+    [BAT_CHEM_LEAD_ACID] = { .cycle_k = 3.7e-4, .cycle_exp = 1.2, .calendar_k = 1.5e-9,
+                             .soc_k = -1.5, .temp_k = 0.0693, .c_rate_k = 0.2,
+                             .sei_a = 0.0, .sei_b = 1.0 },
+};
+
+#define HEALTH_CHEMISTRY_COUNT (int)(sizeof(health_params) / sizeof(health_params[0]))
+
+#define HEALTH_AVERAGE_S        3600.0  // stress average time constant
+#define HEALTH_MAX_STEP_S       3600.0  // longer gaps (downtime) only age on the calendar
+
+const battery_health_params_t* battery_health_params(battery_chemistry_e chemistry) {
+    if ((int)chemistry < 0 || (int)chemistry >= HEALTH_CHEMISTRY_COUNT) return NULL;
+    return &health_params[chemistry];
+}
+
+void battery_health_init(battery_health_t* health) {
+    if (!health) return;
+
+    memset(health, 0, sizeof(*health));
+    health->temp_avg_c = 25.0;
+}
+
+static double health_soc_stress(const battery_health_params_t* p, double soc_fraction) {
+    return exp(p->soc_k * (soc_fraction - 0.5));
+}
+
+static double health_temp_stress(const battery_health_params_t* p, double temp_c) {
+    return exp(p->temp_k * (temp_c - 25.0));
+}
+
+/* Book `count` cycles (0.5 or 1) between two reversals */
+static void health_count_cycle(battery_health_t* h, const battery_health_params_t* p,
+                               double from, double to, double count) {
+    double dod = fabs(to - from) / 100.0;
+    double mean = (from + to) / 200.0;
+
+    if (dod <= 0.0) return;
+
+    double stress = p->cycle_k * pow(dod, p->cycle_exp) *
+                    health_soc_stress(p, mean) *
+                    health_temp_stress(p, h->temp_avg_c) *
+                    (1.0 + p->c_rate_k * fmax(0.0, h->c_rate_avg - 0.5));
+
+    h->cycle_damage += count * stress;
+    h->full_cycles += count * dod;
+
+    int bin = (int)(dod * BATTERY_HEALTH_DOD_BINS);
+    if (bin >= BATTERY_HEALTH_DOD_BINS) bin = BATTERY_HEALTH_DOD_BINS - 1;
+    h->dod_cycles[bin] += count;
+}
+
+/* Three-point rainflow (ASTM E1049) on the reversal stack: X is the newest
+ * range, Y the one before it. While X >= Y, Y is counted: as a half cycle
+ * if it includes the starting point, otherwise as a full cycle. Each
+ * reversal is pushed once and popped at most once, so the loop is O(1)
+ * amortized. */
+static void health_push_reversal(battery_health_t* h, const battery_health_params_t* p, double soc) {
+    float* r = h->reversals;
+
+    // Stack full (long converging sequence): retire the oldest range as a half cycle
+    if (h->reversal_count == BATTERY_RAINFLOW_DEPTH) {
+        health_count_cycle(h, p, r[0], r[1], 0.5);
+        memmove(r, r + 1, (BATTERY_RAINFLOW_DEPTH - 1) * sizeof(r[0]));
+        h->reversal_count--;
+    }
+
+    r[h->reversal_count++] = (float)soc;
+
+    while (h->reversal_count >= 3) {
+        int n = h->reversal_count;
+        double x = fabs(r[n-1] - r[n-2]);
+        double y = fabs(r[n-2] - r[n-3]);
+
+        if (x < y) break;
+
+        if (n == 3) {
+            // Range includes the starting point: half cycle, drop the start
+            health_count_cycle(h, p, r[0], r[1], 0.5);
+            r[0] = r[1];
+            r[1] = r[2];
+            h->reversal_count = 2;
+        } else {
+            health_count_cycle(h, p, r[n-3], r[n-2], 1.0);
+            r[n-3] = r[n-1];
+            h->reversal_count -= 2;
+        }
+    }
+}
+
+/* Feed one SOC sample (%) for a bank */
+void battery_health_update(battery_health_t* health, battery_chemistry_e chemistry, double soc,
+                           double current_a, double capacity_ah, double temp_c, time_t now) {
+    const battery_health_params_t* p = battery_health_params(chemistry);
+    if (!health || !p) return;
+
+    if (health->last_ts == 0) {
+        health->last_ts = now;
+        health->extreme = soc;
+        health_push_reversal(health, p, soc);
+        return;
+    }
+
+    double dt = difftime(now, health->last_ts);
+    if (dt <= 0.0) return;
+    health->last_ts = now;
+
+    // Calendar ageing at the current SOC and temperature
+    health->calendar_damage += p->calendar_k * dt *
+                               health_soc_stress(p, soc / 100.0) * health_temp_stress(p, temp_c);
+    health->operating_s += dt;
+
+    if (dt > HEALTH_MAX_STEP_S) dt = HEALTH_MAX_STEP_S;
+
+    // Time-weighted stress averages; rest periods do not dilute the C-rate
+    double w = fmin(1.0, dt / HEALTH_AVERAGE_S);
+    double c_rate = capacity_ah > 0.0 ? fabs(current_a) / capacity_ah : 0.0;
+    if (c_rate > 0.01) health->c_rate_avg += (c_rate - health->c_rate_avg) * w;
+    health->temp_avg_c += (temp_c - health->temp_avg_c) * w;
+    health->throughput_ah += fabs(current_a) * dt / 3600.0;
+
+    // Reversal detection with hysteresis
+    if (health->direction >= 0 && soc > health->extreme) {
+        health->extreme = soc;
+        if (health->direction == 0 && soc - health->reversals[0] >= BATTERY_RAINFLOW_HYSTERESIS)
+            health->direction = 1;
+    } else if (health->direction <= 0 && soc < health->extreme) {
+        health->extreme = soc;
+        if (health->direction == 0 && health->reversals[0] - soc >= BATTERY_RAINFLOW_HYSTERESIS)
+            health->direction = -1;
+    } else if (fabs(soc - health->extreme) >= BATTERY_RAINFLOW_HYSTERESIS) {
+        health_push_reversal(health, p, health->extreme);
+        health->direction = soc > health->extreme ? 1 : -1;
+        health->extreme = soc;
+    }
+
+    double d = health->cycle_damage + health->calendar_damage;
+    health->fade = 1.0 - p->sei_a * exp(-p->sei_b * d) - (1.0 - p->sei_a) * exp(-d);
+}
+
+double battery_health_percent(const battery_health_t* health) {
+    if (!health) return 100.0;
+    return fmax(0.0, 100.0 * (1.0 - health->fade));
+}
@@ -0,0 +1,119 @@
+#include "battery_limits.h"
+#include <math.h>
+#include <string.h>
+
+/* Current limits are relative to the rating: trip at 120 %, clear below 110 % */
+#define LIMIT_CURRENT_RULES \
+    { LIMIT_SIGNAL_BANK_CHARGE_CURRENT,    LIMIT_FAULT_OVERCURRENT, false, 1.2, 0.1, 0.0, "charge overcurrent" }, \
+    { LIMIT_SIGNAL_BANK_DISCHARGE_CURRENT, LIMIT_FAULT_OVERCURRENT, false, 1.2, 0.1, 0.0, "discharge overcurrent" }, \
+    { LIMIT_SIGNAL_PACK_CHARGE_CURRENT,    LIMIT_FAULT_OVERCURRENT, false, 1.2, 0.1, 0.0, "charge overcurrent" }, \
+    { LIMIT_SIGNAL_PACK_DISCHARGE_CURRENT, LIMIT_FAULT_OVERCURRENT, false, 1.2, 0.1, 0.0, "discharge overcurrent" }
+
+static const battery_limit_rule_t lfp_rules[] = {
+    { LIMIT_SIGNAL_CELL_VOLTAGE_MAX, LIMIT_FAULT_OVERVOLTAGE,     false, 3.65, 0.05, 2.0, "cell overvoltage" },
+    { LIMIT_SIGNAL_CELL_VOLTAGE_MIN, LIMIT_FAULT_UNDERVOLTAGE,    true,  2.50, 0.10, 2.0, "cell undervoltage" },
+    { LIMIT_SIGNAL_CELL_TEMPERATURE, LIMIT_FAULT_OVERTEMPERATURE, false, 60.0, 5.0,  5.0, "overtemperature" },
+    LIMIT_CURRENT_RULES,
+};
+
+static const battery_limit_rule_t nmc_rules[] = {
+    { LIMIT_SIGNAL_CELL_VOLTAGE_MAX, LIMIT_FAULT_OVERVOLTAGE,     false, 4.20, 0.05, 2.0, "cell overvoltage" },
+    { LIMIT_SIGNAL_CELL_VOLTAGE_MIN, LIMIT_FAULT_UNDERVOLTAGE,    true,  3.00, 0.10, 2.0, "cell undervoltage" },
+    { LIMIT_SIGNAL_CELL_TEMPERATURE, LIMIT_FAULT_OVERTEMPERATURE, false, 60.0, 5.0,  5.0, "overtemperature" },
+    LIMIT_CURRENT_RULES,
+};
+
+static const battery_limit_rule_t lead_acid_rules[] = {
+    { LIMIT_SIGNAL_CELL_VOLTAGE_MAX, LIMIT_FAULT_OVERVOLTAGE,     false, 2.45, 0.05, 2.0, "cell overvoltage" },
+    { LIMIT_SIGNAL_CELL_VOLTAGE_MIN, LIMIT_FAULT_UNDERVOLTAGE,    true,  1.75, 0.05, 2.0, "cell undervoltage" },
+    { LIMIT_SIGNAL_CELL_TEMPERATURE, LIMIT_FAULT_OVERTEMPERATURE, false, 60.0, 5.0,  5.0, "overtemperature" },
+    LIMIT_CURRENT_RULES,
+};
+
+typedef struct {
+    const battery_limit_rule_t* rules;
+    int count;
+} limit_table_t;
+
+#define LIMIT_TABLE(t) { t, (int)(sizeof(t) / sizeof(t[0])) }
+
+static const limit_table_t limit_tables[] = {
+    [BAT_CHEM_LFP]       = LIMIT_TABLE(lfp_rules),
+    [BAT_CHEM_NMC]       = LIMIT_TABLE(nmc_rules),
+    [BAT_CHEM_LEAD_ACID] = LIMIT_TABLE(lead_acid_rules),
+};
+
+#define LIMIT_CHEMISTRY_COUNT (int)(sizeof(limit_tables) / sizeof(limit_tables[0]))
+
+_Static_assert(sizeof(lfp_rules) / sizeof(lfp_rules[0]) <= BATTERY_LIMIT_MAX_RULES, "LFP limit table too large");
+_Static_assert(sizeof(nmc_rules) / sizeof(nmc_rules[0]) <= BATTERY_LIMIT_MAX_RULES, "NMC limit table too large");
+_Static_assert(sizeof(lead_acid_rules) / sizeof(lead_acid_rules[0]) <= BATTERY_LIMIT_MAX_RULES,
+               "Lead-acid limit table too large");
+
+/* Unknown chemistries get the LFP table */
+const battery_limit_rule_t* battery_limit_rules(battery_chemistry_e chemistry, int* count) {
+    const limit_table_t* t = &limit_tables[BAT_CHEM_LFP];
+    if ((int)chemistry >= 0 && (int)chemistry < LIMIT_CHEMISTRY_COUNT) t = &limit_tables[chemistry];
+
+    if (count) *count = t->count;
+    return t->rules;
+}
+
+bool battery_limit_signal_per_bank(battery_limit_signal_t signal) {
+    switch (signal) {
+        case LIMIT_SIGNAL_CELL_VOLTAGE_MAX:
+        case LIMIT_SIGNAL_CELL_VOLTAGE_MIN:
+        case LIMIT_SIGNAL_CELL_TEMPERATURE:
+        case LIMIT_SIGNAL_BANK_CHARGE_CURRENT:
+        case LIMIT_SIGNAL_BANK_DISCHARGE_CURRENT:
+            return true;
+        case LIMIT_SIGNAL_PACK_CHARGE_CURRENT:
+        case LIMIT_SIGNAL_PACK_DISCHARGE_CURRENT:
+            return false;
+    }
+    return false;
+}
+
+const char* battery_limit_fault_str(battery_limit_fault_t fault) {
+    switch (fault) {
+        case LIMIT_FAULT_OVERVOLTAGE: return "OVERVOLTAGE";
+        case LIMIT_FAULT_UNDERVOLTAGE: return "UNDERVOLTAGE";
+        case LIMIT_FAULT_OVERCURRENT: return "OVERCURRENT";
+        case LIMIT_FAULT_OVERTEMPERATURE: return "OVERTEMPERATURE";
+    }
+    return "UNKNOWN";
+}
+
+void battery_limits_init(battery_limits_t* limits) {
+    if (!limits) return;
+    memset(limits, 0, sizeof(*limits));
+}
+
+/* Advance one rule instance by one sample. Non-finite samples change nothing. */
+battery_limit_event_t battery_limit_step(const battery_limit_rule_t* rule, battery_limit_state_t* state,
+                                         double value, time_t now) {
+    if (!rule || !state || !isfinite(value)) return LIMIT_EVENT_NONE;
+
+    bool beyond = rule->trip_below ? value < rule->threshold : value > rule->threshold;
+
+    if (state->active) {
+        bool inside = rule->trip_below ? value > rule->threshold + rule->hysteresis
+                                       : value < rule->threshold - rule->hysteresis;
+        if (!inside) return LIMIT_EVENT_NONE;
+
+        state->active = false;
+        return LIMIT_EVENT_CLEAR;
+    }
+
+    if (!beyond) {
+        state->pending_since = 0;
+        return LIMIT_EVENT_NONE;
+    }
+
+    if (state->pending_since == 0) state->pending_since = now;
+    if (difftime(now, state->pending_since) < rule->debounce_s) return LIMIT_EVENT_NONE;
+
+    state->active = true;
+    state->pending_since = 0;
+    return LIMIT_EVENT_TRIP;
+}
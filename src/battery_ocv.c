@@ -0,0 +1,185 @@
+#include "battery_ocv.h"
+#include <math.h>
+#include <pthread.h>
+
+/* Source curve point: single-cell open-circuit voltage (V) at 25 °C -> SOC (%) */
+typedef struct {
+    double v;
+    double soc;
+} ocv_point_t;
+
+typedef struct {
+    const ocv_point_t* points;
+    int count;
+    double temp_coeff;              // OCV shift per cell, V/K (relative to 25 °C)
+} ocv_curve_t;
+
+/* Values approximate common LFP / NMC / lead-acid curves */
+static const ocv_point_t lfp_ocv_points[] = {
+    {2.80, 0.0}, {3.00, 2.0}, {3.10, 10.0}, {3.20, 30.0},
+    {3.25, 50.0}, {3.30, 70.0}, {3.35, 85.0}, {3.40, 95.0}, {3.45, 100.0}
+};
+
+static const ocv_point_t nmc_ocv_points[] = {
+    {3.00, 0.0}, {3.40, 10.0}, {3.60, 30.0}, {3.70, 50.0},
+    {3.85, 70.0}, {4.00, 85.0}, {4.10, 95.0}, {4.20, 100.0}
+};
+
+static const ocv_point_t lead_acid_ocv_points[] = {
+    {1.75, 0.0}, {1.95, 20.0}, {2.05, 50.0}, {2.15, 80.0},
+    {2.25, 95.0}, {2.35, 100.0}
+};
+
+#define OCV_CURVE(points, coeff) { points, (int)(sizeof(points) / sizeof(points[0])), coeff }
+
+static const ocv_curve_t ocv_curves[] = {
+    [BAT_CHEM_LFP]       = OCV_CURVE(lfp_ocv_points,       -0.0001),
+    [BAT_CHEM_NMC]       = OCV_CURVE(nmc_ocv_points,       -0.0002),
+    [BAT_CHEM_LEAD_ACID] = OCV_CURVE(lead_acid_ocv_points,  0.0002),
+};
+
+#define OCV_CHEMISTRY_COUNT (int)(sizeof(ocv_curves) / sizeof(ocv_curves[0]))
+
+static battery_ocv_table_t ocv_tables[OCV_CHEMISTRY_COUNT];
+static pthread_once_t ocv_once = PTHREAD_ONCE_INIT;
+
+/* Piecewise-linear interpolation on the source curve (init only) */
+static double ocv_curve_soc(const ocv_curve_t* curve, double cell_v) {
+    const ocv_point_t* p = curve->points;
+    int n = curve->count;
+
+    if (cell_v <= p[0].v) return p[0].soc;
+    if (cell_v >= p[n-1].v) return p[n-1].soc;
+
+    for (int i = 1; i < n; ++i) {
+        if (cell_v <= p[i].v) {
+            double t = (cell_v - p[i-1].v) / (p[i].v - p[i-1].v);
+            return p[i-1].soc + t * (p[i].soc - p[i-1].soc);
+        }
+    }
+    return p[n-1].soc;
+}
+
+static void ocv_build_table(const ocv_curve_t* curve, battery_ocv_table_t* table) {
+    // Cover the curve shifted to both ends of the temperature range
+    double max_shift = fabs(curve->temp_coeff) *
+        fmax(25.0 - BATTERY_OCV_TEMP_MIN_C,
+             BATTERY_OCV_TEMP_MIN_C + BATTERY_OCV_TEMP_STEP_C * (BATTERY_OCV_TEMP_ROWS - 1) - 25.0);
+    double v_min = curve->points[0].v - max_shift;
+    double v_max = curve->points[curve->count - 1].v + max_shift;
+    double step = (v_max - v_min) / (BATTERY_OCV_GRID_POINTS - 1);
+
+    table->v_min = (float)v_min;
+    table->inv_step = (float)(1.0 / step);
+
+    for (int r = 0; r < BATTERY_OCV_TEMP_ROWS; r++) {
+        double shift = curve->temp_coeff * (BATTERY_OCV_TEMP_MIN_C + r * BATTERY_OCV_TEMP_STEP_C - 25.0);
+
+        for (int i = 0; i < BATTERY_OCV_GRID_POINTS; i++)
+            table->soc[r][i] = (float)ocv_curve_soc(curve, v_min + i * step - shift);
+
+        for (int i = 0; i < BATTERY_OCV_GRID_POINTS - 1; i++)
+            table->slope[r][i] = table->soc[r][i + 1] - table->soc[r][i];
+        table->slope[r][BATTERY_OCV_GRID_POINTS - 1] = 0.0f;
+    }
+}
+
+static void ocv_build_all(void) {
+    for (int c = 0; c < OCV_CHEMISTRY_COUNT; c++)
+        ocv_build_table(&ocv_curves[c], &ocv_tables[c]);
+}
+
+/* Build the tables (idempotent, thread-safe) */
+void battery_ocv_init(void) {
+    pthread_once(&ocv_once, ocv_build_all);
+}
+
+const battery_ocv_table_t* battery_ocv_table(battery_chemistry_e chemistry) {
+    if ((int)chemistry < 0 || (int)chemistry >= OCV_CHEMISTRY_COUNT) return NULL;
+
+    battery_ocv_init();
+    return &ocv_tables[chemistry];
+}
+
+/* Nearest temperature row */
+static int ocv_temp_row(double temp_c) {
+    double r = (temp_c - BATTERY_OCV_TEMP_MIN_C) / BATTERY_OCV_TEMP_STEP_C + 0.5;
+    r = r >= 0.0 ? r : 0.0;
+    r = r <= BATTERY_OCV_TEMP_ROWS - 1 ? r : BATTERY_OCV_TEMP_ROWS - 1;
+    return (int)r;
+}
+
+/* Single cell voltage -> SOC (%) */
+double battery_ocv_soc(battery_chemistry_e chemistry, double cell_v, double temp_c) {
+    const battery_ocv_table_t* t = battery_ocv_table(chemistry);
+    if (!t) return 0.0;
+
+    int row = ocv_temp_row(temp_c);
+    double x = (cell_v - t->v_min) * t->inv_step;
+
+    // Clamp into the grid; the last slope is zero so the top end needs no branch
+    // (written so a NaN reading lands on index 0 instead of out of bounds)
+    x = x >= 0.0 ? x : 0.0;
+    x = x <= BATTERY_OCV_GRID_POINTS - 1 ? x : BATTERY_OCV_GRID_POINTS - 1;
+
+    int i = (int)x;
+#ifdef FP_FAST_FMA
+    return fma(t->slope[row][i], x - i, t->soc[row][i]);
+#else
+    return t->soc[row][i] + t->slope[row][i] * (x - i);
+#endif
+}
+
+/* Convert an array of cell voltages at one temperature. Branch-free body
+ * written for the auto-vectorizer; the table reads become gathers where the
+ * target has them (AVX2, SVE) and scalar loads otherwise. */
+void battery_ocv_soc_batch(battery_chemistry_e chemistry, double temp_c,
+                           const float* restrict cell_v, float* restrict soc, size_t count)
+{
+    const battery_ocv_table_t* t = battery_ocv_table(chemistry);
+    if (!t || !cell_v || !soc) return;
+
+    int row = ocv_temp_row(temp_c);
+    const float* restrict base = t->soc[row];
+    const float* restrict slope = t->slope[row];
+    const float v_min = t->v_min;
+    const float inv_step = t->inv_step;
+    const float x_max = (float)(BATTERY_OCV_GRID_POINTS - 1);
+
+    for (size_t k = 0; k < count; k++) {
+        float x = (cell_v[k] - v_min) * inv_step;
+        x = x >= 0.0f ? x : 0.0f;
+        x = x <= x_max ? x : x_max;
+
+        int i = (int)x;
+#ifdef FP_FAST_FMAF
+        soc[k] = fmaf(slope[i], x - (float)i, base[i]);
+#else
+        soc[k] = base[i] + slope[i] * (x - (float)i);
+#endif
+    }
+}
+
+/* SOC (%) -> single cell OCV, with the local slope dV/dSOC (V per %) for
+ * model-based estimators. Evaluated on the source curve: a handful of points,
+ * so a scan is cheaper than another table. Outside 0..100 % the end segment
+ * slope is kept so the estimator never sees a flat curve. */
+double battery_ocv_voltage(battery_chemistry_e chemistry, double soc, double temp_c, double* dv_dsoc)
+{
+    if ((int)chemistry < 0 || (int)chemistry >= OCV_CHEMISTRY_COUNT) {
+        if (dv_dsoc) *dv_dsoc = 0.0;
+        return 0.0;
+    }
+
+    const ocv_curve_t* curve = &ocv_curves[chemistry];
+    const ocv_point_t* p = curve->points;
+    int i = 1;
+
+    while (i < curve->count - 1 && soc > p[i].soc)
+        i++;
+
+    double slope = (p[i].v - p[i-1].v) / (p[i].soc - p[i-1].soc);
+    if (dv_dsoc) *dv_dsoc = slope;
+
+    return p[i-1].v + slope * (soc - p[i-1].soc) + curve->temp_coeff * (temp_c - 25.0);
+}
@@ -0,0 +1,214 @@
+#include "battery_soc.h"
+#include "battery_ocv.h"
+#include <math.h>
+#include <string.h>
+
+/* Values approximate published LFP / NMC / lead-acid cell fits */
+static const soc_ekf_params_t ekf_params[] = {
+    [BAT_CHEM_LFP]       = { .r0 = 0.10, .r1 = 0.04, .tau1 = 20.0, .r2 = 0.05, .tau2 = 400.0,
+                             .q_soc = 1e-10, .q_rc = 1e-8, .r_meas = 2.5e-5 },
+    [BAT_CHEM_NMC]       = { .r0 = 0.14, .r1 = 0.06, .tau1 = 15.0, .r2 = 0.06, .tau2 = 300.0,
+                             .q_soc = 1e-10, .q_rc = 1e-8, .r_meas = 2.5e-5 },
+    [BAT_CHEM_LEAD_ACID] = { .r0 = 0.60, .r1 = 0.40, .tau1 = 60.0, .r2 = 0.0,  .tau2 = 1.0,
+                             .q_soc = 1e-10, .q_rc = 1e-8, .r_meas = 1e-4 },
+};
+
+#define EKF_CHEMISTRY_COUNT (int)(sizeof(ekf_params) / sizeof(ekf_params[0]))
+
+const soc_ekf_params_t* soc_ekf_params(battery_chemistry_e chemistry) {
+    if ((int)chemistry < 0 || (int)chemistry >= EKF_CHEMISTRY_COUNT) return NULL;
+    return &ekf_params[chemistry];
+}
+
+/* Start from a SOC guess (%) with a wide SOC variance so the filter converges quickly */
+void soc_ekf_reset(soc_ekf_t* ekf, double soc) {
+    if (!ekf) return;
+
+    memset(ekf, 0, sizeof(*ekf));
+    ekf->x[0] = fmin(fmax(soc / 100.0, 0.0), 1.0);
+    ekf->p[0][0] = 0.01;            // 10 % standard deviation
+    ekf->p[1][1] = 1e-4;
+    ekf->p[2][2] = 1e-4;
+    ekf->initialized = true;
+}
+
+/* Predict with the coulomb-counted SOC and RC relaxation, then correct with
+ * the terminal voltage. Returns SOC in %. */
+double soc_ekf_step(soc_ekf_t* ekf, battery_chemistry_e chemistry, const soc_ekf_input_t* in) {
+    if (!ekf) return 0.0;
+
+    const soc_ekf_params_t* prm = soc_ekf_params(chemistry);
+    if (!prm || !in || in->capacity_ah <= 0.0 || in->dt_s <= 0.0) return ekf->x[0] * 100.0;
+
+    double* x = ekf->x;
+    double (*p)[SOC_EKF_STATES] = ekf->p;
+    double cur = in->current;
+    double r0 = prm->r0 / in->capacity_ah;
+    double r1 = prm->r1 / in->capacity_ah;
+    double r2 = prm->r2 / in->capacity_ah;
+    double a1 = exp(-in->dt_s / prm->tau1);
+    double a2 = r2 > 0.0 ? exp(-in->dt_s / prm->tau2) : 0.0;
+    double eta = cur > 0.0 ? in->charge_efficiency : 1.0;
+
+    // Predict: x' = F x + B u, P' = F P F^T + Q (F is diagonal)
+    const double f[SOC_EKF_STATES] = { 1.0, a1, a2 };
+
+    x[0] += eta * cur * in->dt_s / (3600.0 * in->capacity_ah);
+    x[1] = a1 * x[1] + r1 * (1.0 - a1) * cur;
+    x[2] = a2 * x[2] + r2 * (1.0 - a2) * cur;
+
+    for (int r = 0; r < SOC_EKF_STATES; r++)
+        for (int c = 0; c < SOC_EKF_STATES; c++)
+            p[r][c] *= f[r] * f[c];
+
+    p[0][0] += prm->q_soc * in->dt_s;
+    p[1][1] += prm->q_rc * in->dt_s;
+    if (r2 > 0.0) p[2][2] += prm->q_rc * in->dt_s;
+
+    // Correct: V = OCV(SOC, T) + V1 + V2 + R0 * I
+    double slope = 0.0;
+    double ocv = battery_ocv_voltage(chemistry, x[0] * 100.0, in->temperature_c, &slope);
+    const double h[SOC_EKF_STATES] = { slope * 100.0, 1.0, r2 > 0.0 ? 1.0 : 0.0 };
+    double y = in->cell_voltage - (ocv + x[1] + x[2] + r0 * cur);
+
+    double ph[SOC_EKF_STATES];
+    double s = prm->r_meas;
+    for (int r = 0; r < SOC_EKF_STATES; r++) {
+        ph[r] = p[r][0] * h[0] + p[r][1] * h[1] + p[r][2] * h[2];
+        s += h[r] * ph[r];
+    }
+
+    double k[SOC_EKF_STATES];
+    for (int r = 0; r < SOC_EKF_STATES; r++) {
+        k[r] = ph[r] / s;
+        x[r] += k[r] * y;
+    }
+
+    // P = (I - K H) P, kept symmetric against rounding drift
+    for (int r = 0; r < SOC_EKF_STATES; r++)
+        for (int c = 0; c < SOC_EKF_STATES; c++)
+            p[r][c] -= k[r] * ph[c];
+    for (int r = 0; r < SOC_EKF_STATES; r++)
+        for (int c = r + 1; c < SOC_EKF_STATES; c++)
+            p[r][c] = p[c][r] = 0.5 * (p[r][c] + p[c][r]);
+
+    x[0] = fmin(fmax(x[0], 0.0), 1.0);
+    ekf->innovation = y;
+
+    return x[0] * 100.0;
+}
+
+/* Capacity-weighted mean of a per-bank SOC value over enabled banks */
+static double soc_pack_mean(const battery_system_t* bat, const double* bank_value, double fallback) {
+    double capacity = 0.0, weighted = 0.0;
+
+    for (int b = 0; b < bat->bank_count; b++) {
+        if (!bat->banks[b].enabled || bat->bank_state[b].capacity_ah <= 0.0) continue;
+        capacity += bat->bank_state[b].capacity_ah;
+        weighted += bank_value[b] * bat->bank_state[b].capacity_ah;
+    }
+
+    return capacity > 0.0 ? weighted / capacity : fallback;
+}
+
+/* Fusion: each bank's coulomb count weighted against OCV when the bank is near rest */
+static void soc_fusion_reset(battery_system_t* bat, double soc) {
+    (void)bat;
+    (void)soc;
+}
+
+static double soc_fusion_update(battery_system_t* bat, const system_measurements_t* measurements, double dt_s) {
+    (void)measurements;
+    (void)dt_s;
+
+    double soc_v[MAX_BATTERY_BANKS] = {0};
+    double soc[MAX_BATTERY_BANKS] = {0};
+
+    for (int b = 0; b < bat->bank_count; b++) {
+        battery_bank_t* bank = &bat->banks[b];
+        battery_bank_state_t* st = &bat->bank_state[b];
+        if (!bank->enabled) continue;
+
+        // Voltage-based SOC (OCV)
+        soc_v[b] = battery_ocv_soc(bat->chemistry, st->cell_voltage, bank->temperature_c);
+
+        // Dynamic fusion
+        double wv = bat->soc_voltage_weight;
+        double max_charge_a = bank->nominal_voltage > 0.0 ? bank->max_charge_power / bank->nominal_voltage : 0.0;
+
+        // Completely disable voltage SOC under significant load/charge
+        if (fabs(st->current_a) > max_charge_a * 0.05)
+            wv = 0.0;
+
+        // Reduce weight in temperature extremes
+        if (bank->temperature_c < 10 || bank->temperature_c > 40)
+            wv *= 0.3;
+
+        if (wv < 0) wv = 0;
+        if (wv > 1) wv = 1;
+
+        soc[b] = st->soc_coulomb * (1.0 - wv) + soc_v[b] * wv;
+
+        // Large discrepancy correction
+        if (wv > 0.8 && fabs(st->soc_coulomb - soc_v[b]) > 18.0)
+            st->accumulated_ah = (soc_v[b] / 100.0) * st->capacity_ah;
+
+        bank->bank_soc = soc[b];
+    }
+
+    bat->soc_voltage = soc_pack_mean(bat, soc_v, bat->soc_voltage);
+    return soc_pack_mean(bat, soc, bat->soc_estimated);
+}
+
+/* EKF: one filter per enabled bank */
+static void soc_ekf_reset_banks(battery_system_t* bat, double soc) {
+    for (int b = 0; b < MAX_BATTERY_BANKS; b++)
+        soc_ekf_reset(&bat->soc_ekf[b], soc);
+}
+
+static double soc_ekf_update(battery_system_t* bat, const system_measurements_t* measurements, double dt_s) {
+    (void)measurements;
+
+    double soc[MAX_BATTERY_BANKS] = {0};
+
+    for (int b = 0; b < bat->bank_count; b++) {
+        battery_bank_t* bank = &bat->banks[b];
+        const battery_bank_state_t* st = &bat->bank_state[b];
+
+        if (!bank->enabled || st->capacity_ah <= 0.0) continue;
+
+        soc_ekf_input_t in = {
+            .cell_voltage = st->cell_voltage,
+            .current = st->current_a,
+            .temperature_c = bank->temperature_c,
+            .capacity_ah = st->capacity_ah,
+            .charge_efficiency = bat->coulomb_efficiency,
+            .dt_s = dt_s,
+        };
+
+        if (!bat->soc_ekf[b].initialized) soc_ekf_reset(&bat->soc_ekf[b], bat->soc_smoothed);
+
+        soc[b] = soc_ekf_step(&bat->soc_ekf[b], bat->chemistry, &in);
+        bank->bank_soc = soc[b];
+    }
+
+    return soc_pack_mean(bat, soc, bat->soc_estimated);
+}
+
+static const battery_soc_estimator_t soc_estimators[] = {
+    [SOC_ESTIMATOR_FUSION] = { "FUSION", true,  soc_fusion_reset,    soc_fusion_update },
+    [SOC_ESTIMATOR_EKF]    = { "EKF",    false, soc_ekf_reset_banks, soc_ekf_update },
+};
+
+#define SOC_ESTIMATOR_COUNT (int)(sizeof(soc_estimators) / sizeof(soc_estimators[0]))
+
+/* Unknown ids fall back to fusion */
+const battery_soc_estimator_t* battery_soc_estimator(soc_estimator_t id) {
+    if ((int)id < 0 || (int)id >= SOC_ESTIMATOR_COUNT) return &soc_estimators[SOC_ESTIMATOR_FUSION];
+    return &soc_estimators[id];
+}
+
+const char* battery_soc_estimator_str(soc_estimator_t id) {
+    if ((int)id < 0 || (int)id >= SOC_ESTIMATOR_COUNT) return "UNKNOWN";
+    return soc_estimators[id].name;
+}
@@ -0,0 +1,40 @@
+#include "battery_thermal.h"
+#include <math.h>
+
+/* Pack-level figures: ~100 Wh/kg at ~1 kJ/(kg K) for lithium, ~35 Wh/kg at
+ * ~0.8 kJ/(kg K) for lead-acid; cabinet exchange of a few W/K per 10 kWh,
+ * roughly four times that with forced-air cooling. */
+static const battery_thermal_params_t thermal_params[] = {
+    [BAT_CHEM_LFP]       = { .heat_capacity = 10.0, .conductance = 0.5, .cooling_conductance = 1.5 },
+    [BAT_CHEM_NMC]       = { .heat_capacity = 8.0,  .conductance = 0.5, .cooling_conductance = 1.5 },
+    [BAT_CHEM_LEAD_ACID] = { .heat_capacity = 23.0, .conductance = 0.6, .cooling_conductance = 1.5 },
+};
+
+#define THERMAL_CHEMISTRY_COUNT (int)(sizeof(thermal_params) / sizeof(thermal_params[0]))
+
+/* Unknown chemistries get the LFP figures */
+const battery_thermal_params_t* battery_thermal_params(battery_chemistry_e chemistry) {
+    if ((int)chemistry < 0 || (int)chemistry >= THERMAL_CHEMISTRY_COUNT) return &thermal_params[BAT_CHEM_LFP];
+    return &thermal_params[chemistry];
+}
+
+/* Temperature after horizon_s at constant heat input */
+double battery_thermal_predict(double temp_c, double ambient_c, double heat_w,
+                               double heat_capacity_jk, double conductance_wk, double horizon_s) {
+    if (heat_capacity_jk <= 0.0 || horizon_s <= 0.0) return temp_c;
+    if (conductance_wk <= 0.0) return temp_c + heat_w * horizon_s / heat_capacity_jk;
+
+    double steady = ambient_c + heat_w / conductance_wk;
+    return steady + (temp_c - steady) * exp(-horizon_s * conductance_wk / heat_capacity_jk);
+}
+
+/* Largest constant heat input (W) that ends the horizon at limit_c; negative
+ * if the bank would exceed the limit even with no load */
+double battery_thermal_heat_budget(double temp_c, double ambient_c, double limit_c,
+                                   double heat_capacity_jk, double conductance_wk, double horizon_s) {
+    if (heat_capacity_jk <= 0.0 || horizon_s <= 0.0) return limit_c > temp_c ? INFINITY : -INFINITY;
+    if (conductance_wk <= 0.0) return (limit_c - temp_c) * heat_capacity_jk / horizon_s;
+
+    double decay = exp(-horizon_s * conductance_wk / heat_capacity_jk);
+    return conductance_wk * (limit_c - ambient_c - (temp_c - ambient_c) * decay) / (1.0 - decay);
+}
@@ -0,0 +1,55 @@
+#include "clock.h"
+#include <stdatomic.h>
+#include <stdint.h>
+
+static atomic_bool clock_virtual;
+static _Atomic int64_t clock_virtual_us;    // unix time, microseconds
+
+static double clock_virtual_s(void) {
+    return (double)atomic_load(&clock_virtual_us) / 1e6;
+}
+
+/* Wall time, whole seconds */
+time_t clock_now(void) {
+    if (atomic_load(&clock_virtual)) return (time_t)(atomic_load(&clock_virtual_us) / 1000000);
+    return time(NULL);
+}
+
+/* Wall time with sub-second resolution */
+double clock_now_s(void) {
+    if (atomic_load(&clock_virtual)) return clock_virtual_s();
+
+    struct timespec ts;
+    if (clock_gettime(CLOCK_REALTIME, &ts) != 0) return (double)time(NULL);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Seconds on a clock that never steps back; the virtual clock qualifies */
+double clock_monotonic(void) {
+    if (atomic_load(&clock_virtual)) return clock_virtual_s();
+
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) return (double)time(NULL);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Freeze time at start (unix seconds); only clock_advance() moves it */
+void clock_use_virtual(double start) {
+    atomic_store(&clock_virtual_us, (int64_t)(start * 1e6));
+    atomic_store(&clock_virtual, true);
+}
+
+void clock_use_system(void) {
+    atomic_store(&clock_virtual, false);
+}
+
+bool clock_is_virtual(void) {
+    return atomic_load(&clock_virtual);
+}
+
+/* Step the virtual clock; returns the new time. No effect on the system clock. */
+double clock_advance(double seconds) {
+    if (!atomic_load(&clock_virtual)) return clock_now_s();
+    if (seconds > 0.0) atomic_fetch_add(&clock_virtual_us, (int64_t)(seconds * 1e6 + 0.5));
+    return clock_virtual_s();
+}
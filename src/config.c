@@ -6,405 +6,1104 @@
 #include <ctype.h>
 #include <errno.h>
 #include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <limits.h>
+
+#define CONFIG_MAX_DEPTH        64      // nesting limit for skipped values
+#define CONFIG_MAX_NUMBER_LEN   64      // longest numeric token accepted
+#define CONFIG_KEY_TABLE_SIZE   256     // power of two, > number of keys
+
+/* Every key understood by any config object. Object parsers switch on the id
+ * and skip keys that do not belong to them (plain integer so the switches can
+ * use a default label under -Wswitch-enum). */
+typedef uint8_t config_key_t;
+
+enum {
+    CONFIG_KEY_UNKNOWN = 0,
+    CONFIG_KEY_SYSTEM_NAME,
+    CONFIG_KEY_NOMINAL_VOLTAGE,
+    CONFIG_KEY_MAX_GRID_IMPORT,
+    CONFIG_KEY_MAX_GRID_EXPORT,
+    CONFIG_KEY_BATTERY_SOC_MIN,
+    CONFIG_KEY_BATTERY_SOC_MAX,
+    CONFIG_KEY_BATTERY_TEMP_MAX,
+    CONFIG_KEY_BATTERY_RESERVE_SOC,
+    CONFIG_KEY_PV_CURTAIL_START,
+    CONFIG_KEY_PV_CURTAIL_MAX,
+    CONFIG_KEY_CONTROL_INTERVAL,
+    CONFIG_KEY_MEASUREMENT_INTERVAL,
+    CONFIG_KEY_HYSTERESIS,
+    CONFIG_KEY_IRRIGATION_MODE,
+    CONFIG_KEY_IRRIGATION_POWER_LIMIT,
+    CONFIG_KEY_EV_CHARGE_POWER_LIMIT,
+    CONFIG_KEY_LOADS,
+    CONFIG_KEY_ZONES,
+    CONFIG_KEY_EV_CHARGERS,
+    CONFIG_KEY_BATTERIES,
+    CONFIG_KEY_ID,
+    CONFIG_KEY_RATED_POWER,
+    CONFIG_KEY_PRIORITY,
+    CONFIG_KEY_IS_DEFERRABLE,
+    CONFIG_KEY_IS_SHEDDABLE,
+    CONFIG_KEY_MIN_ON_TIME,
+    CONFIG_KEY_MIN_OFF_TIME,
+    CONFIG_KEY_DAILY_ENERGY_WH,
+    CONFIG_KEY_DEADLINE_HOUR,
+    CONFIG_KEY_ZONE_ID,
+    CONFIG_KEY_AREA_SQFT,
+    CONFIG_KEY_WATER_FLOW_RATE,
+    CONFIG_KEY_POWER_CONSUMPTION,
+    CONFIG_KEY_SOIL_MOISTURE,
+    CONFIG_KEY_MOISTURE_THRESHOLD,
+    CONFIG_KEY_WATERING_DURATION,
+    CONFIG_KEY_ENABLED,
+    CONFIG_KEY_EV_ID,
+    CONFIG_KEY_MAX_CHARGE_RATE,
+    CONFIG_KEY_MIN_CHARGE_RATE,
+    CONFIG_KEY_TARGET_SOC,
+    CONFIG_KEY_CURRENT_SOC,
+    CONFIG_KEY_CHARGING_ENABLED,
+    CONFIG_KEY_FAST_CHARGE_REQUESTED,
+    CONFIG_KEY_BANK_ID,
+    CONFIG_KEY_CAPACITY_WH,
+    CONFIG_KEY_CELLS_IN_SERIES,
+    CONFIG_KEY_MAX_CHARGE_POWER,
+    CONFIG_KEY_MAX_DISCHARGE_POWER,
+    CONFIG_KEY_BANKS,
+    CONFIG_KEY_BATTERY_SOC_ESTIMATOR,
+    CONFIG_KEY_PV_STRING_COUNT,
+    CONFIG_KEY_PV_MPPT_RATE_HZ,
+    CONFIG_KEY_PV_TILT,
+    CONFIG_KEY_PV_AZIMUTH,
+    CONFIG_KEY_PV_TEMP_COEFFICIENT,
+    CONFIG_KEY_SITE_LATITUDE,
+    CONFIG_KEY_SITE_LONGITUDE,
+    CONFIG_KEY_GRID_IMPORT_PRICE,
+    CONFIG_KEY_GRID_EXPORT_PRICE,
+    CONFIG_KEY_DISPATCH_HORIZON_HOURS,
+    CONFIG_KEY_DISPATCH_STEP_MINUTES,
+    CONFIG_KEY_DISPATCH_INTERVAL_CYCLES,
+    CONFIG_KEY_TARIFF,
+    CONFIG_KEY_PERIODS,
+    CONFIG_KEY_DAYS,
+    CONFIG_KEY_START_HOUR,
+    CONFIG_KEY_END_HOUR,
+    CONFIG_KEY_IMPORT_PRICE,
+    CONFIG_KEY_EXPORT_PRICE,
+    CONFIG_KEY_DEMAND_CHARGE,
+    CONFIG_KEY_FEED_IN_LIMIT,
+    CONFIG_KEY_COUNT
+};
+typedef struct {
+    const char* name;
+    uint8_t length;
+    config_key_t key;
+} config_key_entry_t;
+
+/* Perfect hash over the key set: config_key_hash() maps each known key to its
+ * own slot. Generated offline by searching for a seed with no collisions;
+ * when adding a key, append it to config_key_t and re-run the seed search
+ * (a DEBUG build verifies the table on first use). */
+#define CONFIG_KEY_HASH_SEED    35031u
+
+static const config_key_entry_t config_key_table[CONFIG_KEY_TABLE_SIZE] = {
+    [  1] = {"rated_power",              11, CONFIG_KEY_RATED_POWER},
+    [  5] = {"nominal_voltage",          15, CONFIG_KEY_NOMINAL_VOLTAGE},
+    [  6] = {"water_flow_rate",          15, CONFIG_KEY_WATER_FLOW_RATE},
+    [  9] = {"feed_in_limit",            13, CONFIG_KEY_FEED_IN_LIMIT},
+    [ 11] = {"charging_enabled",         16, CONFIG_KEY_CHARGING_ENABLED},
+    [ 14] = {"dispatch_horizon_hours",   22, CONFIG_KEY_DISPATCH_HORIZON_HOURS},
+    [ 16] = {"system_name",              11, CONFIG_KEY_SYSTEM_NAME},
+    [ 29] = {"min_off_time",             12, CONFIG_KEY_MIN_OFF_TIME},
+    [ 32] = {"dispatch_interval_cycles", 24, CONFIG_KEY_DISPATCH_INTERVAL_CYCLES},
+    [ 33] = {"batteries",                 9, CONFIG_KEY_BATTERIES},
+    [ 34] = {"export_price",             12, CONFIG_KEY_EXPORT_PRICE},
+    [ 39] = {"capacity_wh",              11, CONFIG_KEY_CAPACITY_WH},
+    [ 42] = {"priority",                  8, CONFIG_KEY_PRIORITY},
+    [ 45] = {"grid_export_price",        17, CONFIG_KEY_GRID_EXPORT_PRICE},
+    [ 46] = {"days",                      4, CONFIG_KEY_DAYS},
+    [ 51] = {"area_sqft",                 9, CONFIG_KEY_AREA_SQFT},
+    [ 55] = {"watering_duration",        17, CONFIG_KEY_WATERING_DURATION},
+    [ 59] = {"import_price",             12, CONFIG_KEY_IMPORT_PRICE},
+    [ 61] = {"deadline_hour",            13, CONFIG_KEY_DEADLINE_HOUR},
+    [ 63] = {"banks",                     5, CONFIG_KEY_BANKS},
+    [ 64] = {"enabled",                   7, CONFIG_KEY_ENABLED},
+    [ 65] = {"battery_reserve_soc",      19, CONFIG_KEY_BATTERY_RESERVE_SOC},
+    [ 71] = {"ev_id",                     5, CONFIG_KEY_EV_ID},
+    [ 76] = {"ev_chargers",              11, CONFIG_KEY_EV_CHARGERS},
+    [ 83] = {"control_interval",         16, CONFIG_KEY_CONTROL_INTERVAL},
+    [ 84] = {"fast_charge_requested",    21, CONFIG_KEY_FAST_CHARGE_REQUESTED},
+    [ 85] = {"current_soc",              11, CONFIG_KEY_CURRENT_SOC},
+    [ 86] = {"min_charge_rate",          15, CONFIG_KEY_MIN_CHARGE_RATE},
+    [ 92] = {"max_charge_power",         16, CONFIG_KEY_MAX_CHARGE_POWER},
+    [ 94] = {"pv_mppt_rate_hz",          15, CONFIG_KEY_PV_MPPT_RATE_HZ},
+    [ 97] = {"zones",                     5, CONFIG_KEY_ZONES},
+    [118] = {"irrigation_mode",          15, CONFIG_KEY_IRRIGATION_MODE},
+    [127] = {"periods",                   7, CONFIG_KEY_PERIODS},
+    [129] = {"grid_import_price",        17, CONFIG_KEY_GRID_IMPORT_PRICE},
+    [131] = {"min_on_time",              11, CONFIG_KEY_MIN_ON_TIME},
+    [133] = {"target_soc",               10, CONFIG_KEY_TARGET_SOC},
+    [138] = {"max_discharge_power",      19, CONFIG_KEY_MAX_DISCHARGE_POWER},
+    [142] = {"site_longitude",           14, CONFIG_KEY_SITE_LONGITUDE},
+    [143] = {"soil_moisture",            13, CONFIG_KEY_SOIL_MOISTURE},
+    [150] = {"battery_temp_max",         16, CONFIG_KEY_BATTERY_TEMP_MAX},
+    [152] = {"demand_charge",            13, CONFIG_KEY_DEMAND_CHARGE},
+    [154] = {"measurement_interval",     20, CONFIG_KEY_MEASUREMENT_INTERVAL},
+    [158] = {"is_deferrable",            13, CONFIG_KEY_IS_DEFERRABLE},
+    [161] = {"irrigation_power_limit",   22, CONFIG_KEY_IRRIGATION_POWER_LIMIT},
+    [162] = {"is_sheddable",             12, CONFIG_KEY_IS_SHEDDABLE},
+    [163] = {"ev_charge_power_limit",    21, CONFIG_KEY_EV_CHARGE_POWER_LIMIT},
+    [170] = {"hysteresis",               10, CONFIG_KEY_HYSTERESIS},
+    [174] = {"pv_tilt",                   7, CONFIG_KEY_PV_TILT},
+    [180] = {"zone_id",                   7, CONFIG_KEY_ZONE_ID},
+    [181] = {"loads",                     5, CONFIG_KEY_LOADS},
+    [183] = {"id",                        2, CONFIG_KEY_ID},
+    [186] = {"pv_string_count",          15, CONFIG_KEY_PV_STRING_COUNT},
+    [189] = {"daily_energy_wh",          15, CONFIG_KEY_DAILY_ENERGY_WH},
+    [190] = {"site_latitude",            13, CONFIG_KEY_SITE_LATITUDE},
+    [195] = {"moisture_threshold",       18, CONFIG_KEY_MOISTURE_THRESHOLD},
+    [203] = {"pv_curtail_start",         16, CONFIG_KEY_PV_CURTAIL_START},
+    [204] = {"start_hour",               10, CONFIG_KEY_START_HOUR},
+    [207] = {"tariff",                    6, CONFIG_KEY_TARIFF},
+    [208] = {"end_hour",                  8, CONFIG_KEY_END_HOUR},
+    [210] = {"battery_soc_max",          15, CONFIG_KEY_BATTERY_SOC_MAX},
+    [212] = {"bank_id",                   7, CONFIG_KEY_BANK_ID},
+    [217] = {"battery_soc_estimator",    21, CONFIG_KEY_BATTERY_SOC_ESTIMATOR},
+    [218] = {"cells_in_series",          15, CONFIG_KEY_CELLS_IN_SERIES},
+    [222] = {"max_grid_export",          15, CONFIG_KEY_MAX_GRID_EXPORT},
+    [225] = {"pv_curtail_max",           14, CONFIG_KEY_PV_CURTAIL_MAX},
+    [229] = {"power_consumption",        17, CONFIG_KEY_POWER_CONSUMPTION},
+    [230] = {"battery_soc_min",          15, CONFIG_KEY_BATTERY_SOC_MIN},
+    [234] = {"dispatch_step_minutes",    21, CONFIG_KEY_DISPATCH_STEP_MINUTES},
+    [241] = {"max_grid_import",          15, CONFIG_KEY_MAX_GRID_IMPORT},
+    [244] = {"pv_azimuth",               10, CONFIG_KEY_PV_AZIMUTH},
+    [254] = {"max_charge_rate",          15, CONFIG_KEY_MAX_CHARGE_RATE},
+    [255] = {"pv_temp_coefficient",      19, CONFIG_KEY_PV_TEMP_COEFFICIENT},
+};
+
+/* Parse cursor: all reads are bounds-checked against end, the input is never
+ * modified or required to be NUL-terminated */
+typedef struct {
+    const char* begin;
+    const char* pos;
+    const char* end;
+    const char* error_at;
+    const char* error_msg;
+} config_cursor_t;
+
+typedef config_error_t (*config_object_parser_t)(config_cursor_t* cur, void* obj);
+
+static _Thread_local config_parse_error_t config_error_info;
+
+static inline uint32_t config_key_hash(const char* s, size_t len) {
+    uint32_t h = 2166136261u ^ CONFIG_KEY_HASH_SEED;   // FNV-1a
+
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)s[i];
+        h *= 16777619u;
+    }
+    return (h >> 16) & (CONFIG_KEY_TABLE_SIZE - 1);
+}
 
-/* Forward declarations */
-static void skip_whitespace(char** pos);
-static char* parse_string(char** pos, char* buffer, size_t max_len);
-static double parse_number(char** pos);
-static int parse_boolean(char** pos);
-static void skip_value(char** pos);
-
-/* Generic object parsers with void* */
-static config_error_t parse_load_object(char** pos, void* obj_ptr);
-static config_error_t parse_zone_object(char** pos, void* obj_ptr);
-static config_error_t parse_ev_charger_object(char** pos, void* obj_ptr);
-static config_error_t parse_battery_object(char** pos, void* obj_ptr);
-
-/* Generic array parser */
-static config_error_t parse_array_generic(char** pos, void* array, int* count, int max_count,
-    size_t struct_size, config_error_t (*parser)(char**, void*)) 
-{
-    skip_whitespace(pos);
-    if (**pos != '[') return CONFIG_PARSE_ERROR;
-    (*pos)++; // Skip '['
+#ifdef DEBUG
+static void config_key_table_verify(void) {
+    static bool verified = false;
+    if (verified) return;
 
-    *count = 0;
-    while (**pos && **pos != ']' && *count < max_count) {
-        skip_whitespace(pos);
-        void* obj_ptr = (char*)array + (*count) * struct_size;
-        if (**pos == '{') {
-            if (parser(pos, obj_ptr) != CONFIG_SUCCESS) return CONFIG_PARSE_ERROR;
-            (*count)++;
-        }
-        skip_whitespace(pos);
-        if (**pos == ',') (*pos)++;
-        else if (**pos != ']') return CONFIG_PARSE_ERROR;
+    int entries = 0;
+    for (int slot = 0; slot < CONFIG_KEY_TABLE_SIZE; slot++) {
+        const config_key_entry_t* e = &config_key_table[slot];
+        if (!e->name) continue;
+
+        entries++;
+        if (e->length != strlen(e->name) || config_key_hash(e->name, e->length) != (uint32_t)slot)
+            LOG_ERROR("Config key table: \"%s\" is not at its hash slot %d, regenerate the table", e->name, slot);
     }
 
-    if (**pos != ']') return CONFIG_PARSE_ERROR;
-    (*pos)++; // Skip ']'
-    return CONFIG_SUCCESS;
+    if (entries != CONFIG_KEY_COUNT - 1)
+        LOG_ERROR("Config key table has %d entries, expected %d", entries, CONFIG_KEY_COUNT - 1);
+
+    verified = true;
 }
+#endif
 
+static config_key_t config_key_lookup(const char* s, size_t len) {
+    const config_key_entry_t* e = &config_key_table[config_key_hash(s, len)];
 
-/* Default configuration values */
-int config_set_defaults(system_config_t* config) {
-    if (!config) return -1;
-    memset(config, 0, sizeof(system_config_t));
+    if (e->name && e->length == len && memcmp(e->name, s, len) == 0)
+        return e->key;
+    return CONFIG_KEY_UNKNOWN;
+}
 
-    strcpy(config->system_name, "Solarize Energy Solutions");
-    config->nominal_voltage = 240.0;
-    config->max_grid_import = 10000.0;
-    config->max_grid_export = 5000.0;
+/* Record the first error; the position is turned into line/column only on failure */
+static config_error_t cursor_fail(config_cursor_t* cur, const char* msg) {
+    if (!cur->error_msg) {
+        cur->error_at = cur->pos;
+        cur->error_msg = msg;
+    }
+    return CONFIG_PARSE_ERROR;
+}
 
-    config->battery_soc_min = 20.0;
-    config->battery_soc_max = 95.0;
-    config->battery_temp_max = 45.0;
-    config->battery_reserve_soc = 30.0;
+static void cursor_skip_whitespace(config_cursor_t* cur) {
+    while (cur->pos < cur->end &&
+           (*cur->pos == ' ' || *cur->pos == '\t' || *cur->pos == '\n' || *cur->pos == '\r'))
+        cur->pos++;
+}
 
-    config->pv_curtail_start = 90.0;
-    config->pv_curtail_max = 50.0;
+static int cursor_peek(config_cursor_t* cur) {
+    cursor_skip_whitespace(cur);
+    return cur->pos < cur->end ? (unsigned char)*cur->pos : -1;
+}
 
-    config->load_count = 0;
-    config->zone_count = 0;
-    config->bank_count = MAX_BATTERY_BANKS;
-    config->ev_charger_count = 0;
+static config_error_t cursor_expect(config_cursor_t* cur, char c, const char* msg) {
+    if (cursor_peek(cur) != (unsigned char)c) return cursor_fail(cur, msg);
+    cur->pos++;
+    return CONFIG_SUCCESS;
+}
 
-    config->irrigation_mode = IRRIGATION_AUTO;
-    config->irrigation_power_limit = 2000.0;
-    config->ev_charge_power_limit = 7000.0;
+static bool cursor_match(config_cursor_t* cur, const char* word, size_t len) {
+    if ((size_t)(cur->end - cur->pos) < len || memcmp(cur->pos, word, len) != 0) return false;
+    cur->pos += len;
+    return true;
+}
 
-    config->control_interval = 1.0;
-    config->measurement_interval = 0.5;
-    config->hysteresis = 2.0;
+/* Scan a string token without copying; out/len cover the raw (still escaped) bytes */
+static config_error_t cursor_string_raw(config_cursor_t* cur, const char** out, size_t* len, bool* escaped) {
+    if (cursor_peek(cur) != '"') return cursor_fail(cur, "expected string");
 
-    // Initialize battery banks with default values
-    // for (int i = 0; i < MAX_BATTERY_BANKS; i++) {
-    //     battery_bank_t* bat = &config->batteries[i];
-    //     snprintf(bat->bank_id, sizeof(bat->bank_id), "BAT%02d", i+1);
-    //     bat->capacity_wh = 10.0;           // default 10 kWh
-    //     // bat->current_soc = 50.0;            // default 50% SOC
-    //     bat->max_charge_power = 5000.0;     // default 5 kW
-    //     bat->max_discharge_power = 5000.0;  // default 5 kW
-    // }
+    const char* start = ++cur->pos;
+    *escaped = false;
 
-    return 0;
-}
+    while (cur->pos < cur->end && *cur->pos != '"') {
+        if ((unsigned char)*cur->pos < 0x20) return cursor_fail(cur, "control character in string");
+        if (*cur->pos == '\\') {
+            *escaped = true;
+            if (++cur->pos >= cur->end) break;
+        }
+        cur->pos++;
+    }
 
+    if (cur->pos >= cur->end) return cursor_fail(cur, "unterminated string");
 
-/* Skip whitespace */
-static void skip_whitespace(char** pos) {
-    while (**pos && isspace((unsigned char)**pos)) (*pos)++;
+    *out = start;
+    *len = (size_t)(cur->pos - start);
+    cur->pos++; // closing quote
+    return CONFIG_SUCCESS;
 }
 
-/* Parse string safely */
-static char* parse_string(char** pos, char* buffer, size_t max_len) {
-    if (**pos != '"') return NULL;
-    (*pos)++;
-    size_t i = 0;
-    while (**pos && **pos != '"' && (buffer == NULL || i < max_len - 1)) {
-        if (**pos == '\\') {
-            (*pos)++;
-            char c = **pos;
-            (*pos)++;
-            if (!buffer) continue;
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/* Decode escapes of a raw string slice into buffer (truncating), returns decoded length */
+static size_t string_unescape(const char* s, size_t len, char* buffer, size_t max_len) {
+    size_t o = 0;
+
+    for (size_t i = 0; i < len && o + 1 < max_len; i++) {
+        char c = s[i];
+
+        if (c == '\\' && i + 1 < len) {
+            c = s[++i];
             switch (c) {
-                case 'n': buffer[i++] = '\n'; break;
-                case 't': buffer[i++] = '\t'; break;
-                case 'r': buffer[i++] = '\r'; break;
-                case 'b': buffer[i++] = '\b'; break;
-                case 'f': buffer[i++] = '\f'; break;
-                case '\\': buffer[i++] = '\\'; break;
-                case '/': buffer[i++] = '/'; break;
-                case '"': buffer[i++] = '"'; break;
-                default: buffer[i++] = c; break;
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'u': {
+                    unsigned cp = 0;
+                    for (int k = 0; k < 4 && i + 1 < len; k++) {
+                        int v = hex_value(s[++i]);
+                        cp = (cp << 4) | (unsigned)(v < 0 ? 0 : v);
+                    }
+                    // ids and names are expected to be ASCII; anything else becomes '?'
+                    c = cp < 0x80 ? (char)cp : '?';
+                    break;
+                }
+                default: break;   // \\ \" \/ map to themselves
             }
-        } else {
-            if (buffer) buffer[i++] = **pos;
-            (*pos)++;
         }
+        buffer[o++] = c;
     }
 
-    if (buffer) buffer[i] = '\0';
-    if (**pos == '"') (*pos)++;
-    return buffer;
+    buffer[o] = '\0';
+    return o;
+}
+
+static config_error_t cursor_string(config_cursor_t* cur, char* buffer, size_t max_len) {
+    const char* s;
+    size_t len;
+    bool escaped;
+
+    config_error_t res = cursor_string_raw(cur, &s, &len, &escaped);
+    if (res != CONFIG_SUCCESS) return res;
+
+    string_unescape(s, len, buffer, max_len);
+    return CONFIG_SUCCESS;
 }
 
-/* Parse number */
-static double parse_number(char** pos) {
-    char buffer[64];
+static config_error_t cursor_number(config_cursor_t* cur, double* out) {
+    char buffer[CONFIG_MAX_NUMBER_LEN];
     size_t i = 0;
 
-    while (**pos && (isdigit((unsigned char)**pos) || **pos == '.' || **pos == '-' || **pos == '+' || **pos == 'e' || **pos == 'E') && i < sizeof(buffer) - 1) {
-        buffer[i++] = **pos;
-        (*pos)++;
-    }
+    cursor_skip_whitespace(cur);
+    const char* start = cur->pos;
 
+    while (cur->pos < cur->end &&
+           (isdigit((unsigned char)*cur->pos) || *cur->pos == '.' || *cur->pos == '-' ||
+            *cur->pos == '+' || *cur->pos == 'e' || *cur->pos == 'E')) {
+        if (i >= sizeof(buffer) - 1) return cursor_fail(cur, "number too long");
+        buffer[i++] = *cur->pos++;
+    }
     buffer[i] = '\0';
-    return atof(buffer);
+
+    char* num_end;
+    errno = 0;
+    *out = strtod(buffer, &num_end);
+
+    if (i == 0 || num_end != buffer + i || errno == ERANGE) {
+        cur->pos = start;
+        return cursor_fail(cur, "invalid number");
+    }
+    return CONFIG_SUCCESS;
 }
 
-/* Parse boolean */
-static int parse_boolean(char** pos) {
-    if (strncmp(*pos, "true", 4) == 0) { *pos += 4; return 1; }
-    if (strncmp(*pos, "false", 5) == 0) { *pos += 5; return 0; }
-    return 0;
+/* Booleans also accept 0/1 as older configs did */
+static config_error_t cursor_boolean(config_cursor_t* cur, bool* out) {
+    int c = cursor_peek(cur);
+
+    if (c == 't' && cursor_match(cur, "true", 4)) { *out = true; return CONFIG_SUCCESS; }
+    if (c == 'f' && cursor_match(cur, "false", 5)) { *out = false; return CONFIG_SUCCESS; }
+
+    double v;
+    if (cursor_number(cur, &v) != CONFIG_SUCCESS) return cursor_fail(cur, "expected boolean");
+    *out = v != 0.0;
+    return CONFIG_SUCCESS;
+}
+
+static config_error_t cursor_integer(config_cursor_t* cur, int* out) {
+    double v;
+    config_error_t res = cursor_number(cur, &v);
+    if (res == CONFIG_SUCCESS) *out = (int)v;
+    return res;
+}
+
+static config_error_t cursor_skip_value(config_cursor_t* cur, int depth);
+
+static config_error_t cursor_skip_container(config_cursor_t* cur, char close, int depth) {
+    cur->pos++; // opening bracket
+    if (cursor_peek(cur) == (unsigned char)close) { cur->pos++; return CONFIG_SUCCESS; }
+
+    for (;;) {
+        if (close == '}') {
+            const char* s; size_t len; bool escaped;
+            if (cursor_string_raw(cur, &s, &len, &escaped) != CONFIG_SUCCESS) return CONFIG_PARSE_ERROR;
+            if (cursor_expect(cur, ':', "expected ':'") != CONFIG_SUCCESS) return CONFIG_PARSE_ERROR;
+        }
+        if (cursor_skip_value(cur, depth + 1) != CONFIG_SUCCESS) return CONFIG_PARSE_ERROR;
+
+        int c = cursor_peek(cur);
+        if (c == ',') { cur->pos++; continue; }
+        if (c == (unsigned char)close) { cur->pos++; return CONFIG_SUCCESS; }
+        return cursor_fail(cur, close == '}' ? "expected ',' or '}'" : "expected ',' or ']'");
+    }
 }
 
-/* Skip any value */
-static void skip_value(char** pos) {
-    skip_whitespace(pos);
-    if (**pos == '"') { parse_string(pos, NULL, 0); }
-    else if (**pos == '{') { (*pos)++; while (**pos && **pos != '}') { skip_value(pos); if (**pos==':') (*pos)++; skip_value(pos); if (**pos==',') (*pos)++; } if (**pos=='}') (*pos)++; }
-    else if (**pos == '[') { (*pos)++; while (**pos && **pos!=']') { skip_value(pos); if (**pos==',') (*pos)++; } if (**pos==']') (*pos)++; }
-    else if (isdigit((unsigned char)**pos) || **pos=='-' || **pos=='.') parse_number(pos);
-    else if (strncmp(*pos,"true",4)==0 || strncmp(*pos,"false",5)==0) parse_boolean(pos);
-    else if (strncmp(*pos,"null",4)==0) *pos+=4;
+/* Skip any value (used for unknown keys and metadata) */
+static config_error_t cursor_skip_value(config_cursor_t* cur, int depth) {
+    if (depth > CONFIG_MAX_DEPTH) return cursor_fail(cur, "nesting too deep");
+
+    int c = cursor_peek(cur);
+    const char* s; size_t len; bool escaped;
+    double v;
+
+    switch (c) {
+        case '"': return cursor_string_raw(cur, &s, &len, &escaped);
+        case '{': return cursor_skip_container(cur, '}', depth);
+        case '[': return cursor_skip_container(cur, ']', depth);
+        case 't': if (cursor_match(cur, "true", 4)) return CONFIG_SUCCESS; break;
+        case 'f': if (cursor_match(cur, "false", 5)) return CONFIG_SUCCESS; break;
+        case 'n': if (cursor_match(cur, "null", 4)) return CONFIG_SUCCESS; break;
+        case -1: return cursor_fail(cur, "unexpected end of input");
+        default: return cursor_number(cur, &v);
+    }
+    return cursor_fail(cur, "invalid literal");
+}
+
+/* Object member iterator: returns 1 with *key set, 0 at '}', -1 on error */
+static int cursor_next_member(config_cursor_t* cur, bool* first, config_key_t* key) {
+    int c = cursor_peek(cur);
+
+    if (c == '}') { cur->pos++; return 0; }
+    if (!*first) {
+        if (c != ',') { cursor_fail(cur, "expected ',' or '}'"); return -1; }
+        cur->pos++;
+    }
+    *first = false;
+
+    const char* s; size_t len; bool escaped;
+    if (cursor_string_raw(cur, &s, &len, &escaped) != CONFIG_SUCCESS) return -1;
+
+    if (escaped) {
+        char decoded[64];
+        len = string_unescape(s, len, decoded, sizeof(decoded));
+        *key = config_key_lookup(decoded, len);
+    } else {
+        *key = config_key_lookup(s, len);
+    }
+
+    if (cursor_expect(cur, ':', "expected ':' after key") != CONFIG_SUCCESS) return -1;
+    return 1;
+}
+
+/* Parse an array of objects; entries beyond max_count are skipped with a warning */
+static config_error_t parse_object_array(config_cursor_t* cur, void* array, int* count, int max_count,
+    size_t struct_size, config_object_parser_t parser, const char* what)
+{
+    if (cursor_expect(cur, '[', "expected array") != CONFIG_SUCCESS) return CONFIG_PARSE_ERROR;
+
+    int total = 0;
+    *count = 0;
+
+    if (cursor_peek(cur) == ']') { cur->pos++; return CONFIG_SUCCESS; }
+
+    for (;;) {
+        if (cursor_peek(cur) != '{') return cursor_fail(cur, "expected object in array");
+
+        if (*count < max_count) {
+            void* obj = (char*)array + (size_t)(*count) * struct_size;
+            if (parser(cur, obj) != CONFIG_SUCCESS) return CONFIG_PARSE_ERROR;
+            (*count)++;
+        } else if (cursor_skip_value(cur, 1) != CONFIG_SUCCESS) {
+            return CONFIG_PARSE_ERROR;
+        }
+        total++;
+
+        int c = cursor_peek(cur);
+        if (c == ',') { cur->pos++; continue; }
+        if (c == ']') { cur->pos++; break; }
+        return cursor_fail(cur, "expected ',' or ']'");
+    }
+
+    if (total > max_count)
+        LOG_WARNING("Config lists %d %s, only the first %d are used", total, what, max_count);
+
+    return CONFIG_SUCCESS;
 }
 
 /* Object parsers */
-static config_error_t parse_load_object(char** pos, void* obj_ptr) {
-    load_definition_t* load = (load_definition_t*)obj_ptr;
+static config_error_t parse_load_object(config_cursor_t* cur, void* obj) {
+    load_definition_t* load = (load_definition_t*)obj;
     memset(load, 0, sizeof(*load));
-    if (**pos != '{') return CONFIG_PARSE_ERROR;
-    (*pos)++;
-
-    while (**pos && **pos != '}') {
-        skip_whitespace(pos);
-        char key[64];
-        if (**pos != '"') return CONFIG_PARSE_ERROR;
-        if (!parse_string(pos, key, sizeof(key))) return CONFIG_PARSE_ERROR;
-        skip_whitespace(pos); if (**pos != ':') return CONFIG_PARSE_ERROR; (*pos)++;
-        skip_whitespace(pos);
-
-        if (strcmp(key, "id") == 0) parse_string(pos, load->id, sizeof(load->id));
-        else if (strcmp(key, "rated_power") == 0) load->rated_power = parse_number(pos);
-        else if (strcmp(key, "priority") == 0) load->priority = (load_priority_t)(int)parse_number(pos);
-        else if (strcmp(key, "is_deferrable") == 0) load->is_deferrable = (**pos=='t'||**pos=='f')?parse_boolean(pos):(int)parse_number(pos);
-        else if (strcmp(key, "is_sheddable") == 0) load->is_sheddable = (**pos=='t'||**pos=='f')?parse_boolean(pos):(int)parse_number(pos);
-        else if (strcmp(key, "min_on_time") == 0) load->min_on_time = parse_number(pos);
-        else if (strcmp(key, "min_off_time") == 0) load->min_off_time = parse_number(pos);
-        else skip_value(pos);
-
-        skip_whitespace(pos);
-        if (**pos == ',') (*pos)++;
+
+    if (cursor_expect(cur, '{', "expected load object") != CONFIG_SUCCESS) return CONFIG_PARSE_ERROR;
+
+    bool first = true;
+    config_key_t key;
+    config_error_t res = CONFIG_SUCCESS;
+    int r;
+    int priority = 0;
+
+    while (res == CONFIG_SUCCESS && (r = cursor_next_member(cur, &first, &key)) > 0) {
+        switch (key) {
+            case CONFIG_KEY_ID:            res = cursor_string(cur, load->id, sizeof(load->id)); break;
+            case CONFIG_KEY_RATED_POWER:   res = cursor_number(cur, &load->rated_power); break;
+            case CONFIG_KEY_PRIORITY:
+                res = cursor_integer(cur, &priority);
+                load->priority = (load_priority_t)priority;
+                break;
+            case CONFIG_KEY_IS_DEFERRABLE: res = cursor_boolean(cur, &load->is_deferrable); break;
+            case CONFIG_KEY_IS_SHEDDABLE:  res = cursor_boolean(cur, &load->is_sheddable); break;
+            case CONFIG_KEY_MIN_ON_TIME:   res = cursor_number(cur, &load->min_on_time); break;
+            case CONFIG_KEY_MIN_OFF_TIME:  res = cursor_number(cur, &load->min_off_time); break;
+            case CONFIG_KEY_DAILY_ENERGY_WH: res = cursor_number(cur, &load->daily_energy_wh); break;
+            case CONFIG_KEY_DEADLINE_HOUR: res = cursor_number(cur, &load->deadline_hour); break;
+            default:                       res = cursor_skip_value(cur, 1); break;
+        }
     }
 
-    if (**pos != '}') return CONFIG_PARSE_ERROR;
-    (*pos)++;
-    return CONFIG_SUCCESS;
+    return (res == CONFIG_SUCCESS && r == 0) ? CONFIG_SUCCESS : CONFIG_PARSE_ERROR;
 }
 
-static config_error_t parse_zone_object(char** pos, void* obj_ptr) {
-    irrigation_zone_t* zone = (irrigation_zone_t*)obj_ptr;
+static config_error_t parse_zone_object(config_cursor_t* cur, void* obj) {
+    irrigation_zone_t* zone = (irrigation_zone_t*)obj;
     memset(zone, 0, sizeof(*zone));
 
-    if (**pos != '{') return CONFIG_PARSE_ERROR;
-    (*pos)++;
-
-    while (**pos && **pos != '}') {
-        skip_whitespace(pos);
-        char key[64];
-        if (**pos != '"') return CONFIG_PARSE_ERROR;
-        if (!parse_string(pos, key, sizeof(key))) return CONFIG_PARSE_ERROR;
-        skip_whitespace(pos); if (**pos != ':') return CONFIG_PARSE_ERROR; (*pos)++; skip_whitespace(pos);
-
-        if (strcmp(key, "zone_id") == 0) parse_string(pos, zone->zone_id, sizeof(zone->zone_id));
-        else if (strcmp(key, "area_sqft") == 0) zone->area_sqft = parse_number(pos);
-        else if (strcmp(key, "water_flow_rate") == 0) zone->water_flow_rate = parse_number(pos);
-        else if (strcmp(key, "power_consumption") == 0) zone->power_consumption = parse_number(pos);
-        else if (strcmp(key, "soil_moisture") == 0) zone->soil_moisture = parse_number(pos);
-        else if (strcmp(key, "moisture_threshold") == 0) zone->moisture_threshold = parse_number(pos);
-        else if (strcmp(key, "watering_duration") == 0) zone->watering_duration = parse_number(pos);
-        else if (strcmp(key, "enabled") == 0) zone->enabled = (**pos=='t'||**pos=='f')?parse_boolean(pos):(int)parse_number(pos);
-        else skip_value(pos);
-
-        skip_whitespace(pos);
-        if (**pos == ',') (*pos)++;
+    if (cursor_expect(cur, '{', "expected zone object") != CONFIG_SUCCESS) return CONFIG_PARSE_ERROR;
+
+    bool first = true;
+    config_key_t key;
+    config_error_t res = CONFIG_SUCCESS;
+    int r;
+
+    while (res == CONFIG_SUCCESS && (r = cursor_next_member(cur, &first, &key)) > 0) {
+        switch (key) {
+            case CONFIG_KEY_ZONE_ID:            res = cursor_string(cur, zone->zone_id, sizeof(zone->zone_id)); break;
+            case CONFIG_KEY_AREA_SQFT:          res = cursor_number(cur, &zone->area_sqft); break;
+            case CONFIG_KEY_WATER_FLOW_RATE:    res = cursor_number(cur, &zone->water_flow_rate); break;
+            case CONFIG_KEY_POWER_CONSUMPTION:  res = cursor_number(cur, &zone->power_consumption); break;
+            case CONFIG_KEY_SOIL_MOISTURE:      res = cursor_number(cur, &zone->soil_moisture); break;
+            case CONFIG_KEY_MOISTURE_THRESHOLD: res = cursor_number(cur, &zone->moisture_threshold); break;
+            case CONFIG_KEY_WATERING_DURATION:  res = cursor_number(cur, &zone->watering_duration); break;
+            case CONFIG_KEY_ENABLED:            res = cursor_boolean(cur, &zone->enabled); break;
+            default:                            res = cursor_skip_value(cur, 1); break;
+        }
     }
 
-    if (**pos != '}') return CONFIG_PARSE_ERROR;
-    (*pos)++;
-    return CONFIG_SUCCESS;
+    return (res == CONFIG_SUCCESS && r == 0) ? CONFIG_SUCCESS : CONFIG_PARSE_ERROR;
 }
 
-static config_error_t parse_ev_charger_object(char** pos, void* obj_ptr) {
-    ev_charger_t* ev = (ev_charger_t*)obj_ptr;
+static config_error_t parse_ev_charger_object(config_cursor_t* cur, void* obj) {
+    ev_charger_t* ev = (ev_charger_t*)obj;
     memset(ev, 0, sizeof(*ev));
 
-    if (**pos != '{') return CONFIG_PARSE_ERROR;
-    (*pos)++;
-
-    while (**pos && **pos != '}') {
-        skip_whitespace(pos);
-        char key[64];
-        if (**pos != '"') return CONFIG_PARSE_ERROR;
-        if (!parse_string(pos, key, sizeof(key))) return CONFIG_PARSE_ERROR;
-        skip_whitespace(pos); if (**pos != ':') return CONFIG_PARSE_ERROR; (*pos)++; skip_whitespace(pos);
-
-        if (strcmp(key, "ev_id") == 0) parse_string(pos, ev->ev_id, sizeof(ev->ev_id));
-        else if (strcmp(key, "max_charge_rate") == 0) ev->max_charge_rate = parse_number(pos);
-        else if (strcmp(key, "min_charge_rate") == 0) ev->min_charge_rate = parse_number(pos);
-        else if (strcmp(key, "target_soc") == 0) ev->target_soc = parse_number(pos);
-        else if (strcmp(key, "current_soc") == 0) ev->current_soc = parse_number(pos);
-        else if (strcmp(key, "charging_enabled") == 0) ev->charging_enabled = (**pos=='t'||**pos=='f')?parse_boolean(pos):(int)parse_number(pos);
-        else if (strcmp(key, "fast_charge_requested") == 0) ev->fast_charge_requested = (**pos=='t'||**pos=='f')?parse_boolean(pos):(int)parse_number(pos);
-        else skip_value(pos);
-
-        skip_whitespace(pos);
-        if (**pos == ',') (*pos)++;
+    if (cursor_expect(cur, '{', "expected EV charger object") != CONFIG_SUCCESS) return CONFIG_PARSE_ERROR;
+
+    bool first = true;
+    config_key_t key;
+    config_error_t res = CONFIG_SUCCESS;
+    int r;
+
+    while (res == CONFIG_SUCCESS && (r = cursor_next_member(cur, &first, &key)) > 0) {
+        switch (key) {
+            case CONFIG_KEY_EV_ID:                 res = cursor_string(cur, ev->ev_id, sizeof(ev->ev_id)); break;
+            case CONFIG_KEY_MAX_CHARGE_RATE:       res = cursor_number(cur, &ev->max_charge_rate); break;
+            case CONFIG_KEY_MIN_CHARGE_RATE:       res = cursor_number(cur, &ev->min_charge_rate); break;
+            case CONFIG_KEY_TARGET_SOC:            res = cursor_number(cur, &ev->target_soc); break;
+            case CONFIG_KEY_CURRENT_SOC:           res = cursor_number(cur, &ev->current_soc); break;
+            case CONFIG_KEY_CHARGING_ENABLED:      res = cursor_boolean(cur, &ev->charging_enabled); break;
+            case CONFIG_KEY_FAST_CHARGE_REQUESTED: res = cursor_boolean(cur, &ev->fast_charge_requested); break;
+            default:                               res = cursor_skip_value(cur, 1); break;
+        }
     }
 
-    if (**pos != '}') return CONFIG_PARSE_ERROR;
-    (*pos)++;
-    return CONFIG_SUCCESS;
+    return (res == CONFIG_SUCCESS && r == 0) ? CONFIG_SUCCESS : CONFIG_PARSE_ERROR;
 }
 
-/* New battery parser */
-static config_error_t parse_battery_object(char** pos, void* obj_ptr) {
-    battery_bank_t* bat = (battery_bank_t*)obj_ptr;
+static config_error_t parse_battery_object(config_cursor_t* cur, void* obj) {
+    battery_bank_t* bat = (battery_bank_t*)obj;
     memset(bat, 0, sizeof(*bat));
 
-    if (**pos != '{') return CONFIG_PARSE_ERROR;
+    if (cursor_expect(cur, '{', "expected battery bank object") != CONFIG_SUCCESS) return CONFIG_PARSE_ERROR;
+
+    bool first = true;
+    config_key_t key;
+    config_error_t res = CONFIG_SUCCESS;
+    int r;
+
+    while (res == CONFIG_SUCCESS && (r = cursor_next_member(cur, &first, &key)) > 0) {
+        switch (key) {
+            case CONFIG_KEY_BANK_ID:             res = cursor_string(cur, bat->bank_id, sizeof(bat->bank_id)); break;
+            case CONFIG_KEY_CAPACITY_WH:         res = cursor_number(cur, &bat->capacity_wh); break;
+            case CONFIG_KEY_CELLS_IN_SERIES:     res = cursor_integer(cur, &bat->cells_in_series); break;
+            case CONFIG_KEY_NOMINAL_VOLTAGE:     res = cursor_number(cur, &bat->nominal_voltage); break;
+            case CONFIG_KEY_MAX_CHARGE_POWER:    res = cursor_number(cur, &bat->max_charge_power); break;
+            case CONFIG_KEY_MAX_DISCHARGE_POWER: res = cursor_number(cur, &bat->max_discharge_power); break;
+            default:                             res = cursor_skip_value(cur, 1); break;
+        }
+    }
 
-    (*pos)++;
+    return (res == CONFIG_SUCCESS && r == 0) ? CONFIG_SUCCESS : CONFIG_PARSE_ERROR;
+}
 
-    while (**pos && **pos != '}') {
-        skip_whitespace(pos);
+static config_error_t parse_tariff_period_object(config_cursor_t* cur, void* obj) {
+    tariff_period_t* period = (tariff_period_t*)obj;
+    memset(period, 0, sizeof(*period));
+    period->days = TARIFF_ALL_DAYS;
+    period->end_hour = 24.0;
+
+    if (cursor_expect(cur, '{', "expected tariff period object") != CONFIG_SUCCESS) return CONFIG_PARSE_ERROR;
+
+    bool first = true;
+    config_key_t key;
+    config_error_t res = CONFIG_SUCCESS;
+    int r;
+    int days = 0;
+
+    while (res == CONFIG_SUCCESS && (r = cursor_next_member(cur, &first, &key)) > 0) {
+        switch (key) {
+            case CONFIG_KEY_DAYS:
+                res = cursor_integer(cur, &days);
+                // out-of-range masks are kept as 0 so validation rejects them
+                period->days = (days > 0 && days <= TARIFF_ALL_DAYS) ? (uint8_t)days : 0;
+                break;
+            case CONFIG_KEY_START_HOUR:   res = cursor_number(cur, &period->start_hour); break;
+            case CONFIG_KEY_END_HOUR:     res = cursor_number(cur, &period->end_hour); break;
+            case CONFIG_KEY_IMPORT_PRICE: res = cursor_number(cur, &period->import_price); break;
+            case CONFIG_KEY_EXPORT_PRICE: res = cursor_number(cur, &period->export_price); break;
+            default:                      res = cursor_skip_value(cur, 1); break;
+        }
+    }
 
-        char key[64];
+    return (res == CONFIG_SUCCESS && r == 0) ? CONFIG_SUCCESS : CONFIG_PARSE_ERROR;
+}
 
-        if (**pos != '"') return CONFIG_PARSE_ERROR;
-        if (!parse_string(pos, key, sizeof(key))) return CONFIG_PARSE_ERROR;
+/* "tariff": { "demand_charge": ..., "feed_in_limit": ..., "periods": [ ... ] } */
+static config_error_t parse_tariff_object(config_cursor_t* cur, system_config_t* config) {
+    if (cursor_expect(cur, '{', "expected tariff object") != CONFIG_SUCCESS) return CONFIG_PARSE_ERROR;
+
+    bool first = true;
+    config_key_t key;
+    config_error_t res = CONFIG_SUCCESS;
+    int r;
+
+    while (res == CONFIG_SUCCESS && (r = cursor_next_member(cur, &first, &key)) > 0) {
+        switch (key) {
+            case CONFIG_KEY_IMPORT_PRICE:  res = cursor_number(cur, &config->grid_import_price); break;
+            case CONFIG_KEY_EXPORT_PRICE:  res = cursor_number(cur, &config->grid_export_price); break;
+            case CONFIG_KEY_DEMAND_CHARGE: res = cursor_number(cur, &config->demand_charge); break;
+            case CONFIG_KEY_FEED_IN_LIMIT: res = cursor_number(cur, &config->feed_in_limit); break;
+            case CONFIG_KEY_PERIODS:
+                res = parse_object_array(cur, config->tariff_periods, &config->tariff_period_count,
+                                         CONFIG_MAX_TARIFF_PERIODS, sizeof(tariff_period_t),
+                                         parse_tariff_period_object, "tariff periods");
+                break;
+            default:                       res = cursor_skip_value(cur, 1); break;
+        }
+    }
 
-        skip_whitespace(pos);
+    return (res == CONFIG_SUCCESS && r == 0) ? CONFIG_SUCCESS : CONFIG_PARSE_ERROR;
+}
 
-        if (**pos != ':') return CONFIG_PARSE_ERROR;
+/* "batteries": { ...pack metadata..., "banks": [ ... ] } */
+static config_error_t parse_batteries_object(config_cursor_t* cur, system_config_t* config) {
+    if (cursor_expect(cur, '{', "expected batteries object") != CONFIG_SUCCESS) return CONFIG_PARSE_ERROR;
 
-        (*pos)++;
+    bool first = true;
+    config_key_t key;
+    config_error_t res = CONFIG_SUCCESS;
+    int r;
 
-        skip_whitespace(pos);
+    while (res == CONFIG_SUCCESS && (r = cursor_next_member(cur, &first, &key)) > 0) {
+        if (key == CONFIG_KEY_BANKS) {
+            res = parse_object_array(cur, config->batteries, &config->bank_count, MAX_BATTERY_BANKS,
+                                     sizeof(battery_bank_t), parse_battery_object, "battery banks");
+        } else {
+            // Pack metadata (chemistry, thermal limits...) is not part of system_config_t yet
+            res = cursor_skip_value(cur, 1);
+        }
+    }
 
-        if (strcmp(key, "bank_id") == 0) parse_string(pos, bat->bank_id, sizeof(bat->bank_id));
-        else if (strcmp(key, "capacity_wh") == 0) bat->capacity_wh = parse_number(pos);
-        else if (strcmp(key, "cells_in_series") == 0) bat->cells_in_series = parse_number(pos);
-        else if (strcmp(key, "nominal_voltage") == 0) bat->nominal_voltage = parse_number(pos);
-        else if (strcmp(key, "max_charge_power") == 0) bat->max_charge_power = parse_number(pos);
-        else if (strcmp(key, "max_discharge_power") == 0) bat->max_discharge_power = parse_number(pos);
-        else skip_value(pos);
+    return (res == CONFIG_SUCCESS && r == 0) ? CONFIG_SUCCESS : CONFIG_PARSE_ERROR;
+}
 
-        skip_whitespace(pos);
+/* Parse main JSON object */
+static config_error_t parse_json_object(config_cursor_t* cur, system_config_t* config) {
+    if (cursor_expect(cur, '{', "expected '{' at start of configuration") != CONFIG_SUCCESS)
+        return CONFIG_PARSE_ERROR;
+
+    bool first = true;
+    config_key_t key;
+    config_error_t res = CONFIG_SUCCESS;
+    int r;
+    int mode = 0;
+    int estimator = 0;
+
+    while (res == CONFIG_SUCCESS && (r = cursor_next_member(cur, &first, &key)) > 0) {
+        switch (key) {
+            case CONFIG_KEY_SYSTEM_NAME:            res = cursor_string(cur, config->system_name, sizeof(config->system_name)); break;
+            case CONFIG_KEY_NOMINAL_VOLTAGE:        res = cursor_number(cur, &config->nominal_voltage); break;
+            case CONFIG_KEY_MAX_GRID_IMPORT:        res = cursor_number(cur, &config->max_grid_import); break;
+            case CONFIG_KEY_MAX_GRID_EXPORT:        res = cursor_number(cur, &config->max_grid_export); break;
+            case CONFIG_KEY_GRID_IMPORT_PRICE:      res = cursor_number(cur, &config->grid_import_price); break;
+            case CONFIG_KEY_GRID_EXPORT_PRICE:      res = cursor_number(cur, &config->grid_export_price); break;
+            case CONFIG_KEY_BATTERY_SOC_MIN:        res = cursor_number(cur, &config->battery_soc_min); break;
+            case CONFIG_KEY_BATTERY_SOC_MAX:        res = cursor_number(cur, &config->battery_soc_max); break;
+            case CONFIG_KEY_BATTERY_TEMP_MAX:       res = cursor_number(cur, &config->battery_temp_max); break;
+            case CONFIG_KEY_BATTERY_RESERVE_SOC:    res = cursor_number(cur, &config->battery_reserve_soc); break;
+            case CONFIG_KEY_BATTERY_SOC_ESTIMATOR:
+                res = cursor_integer(cur, &estimator);
+                config->battery_soc_estimator = (soc_estimator_t)estimator;
+                break;
+            case CONFIG_KEY_PV_CURTAIL_START:       res = cursor_number(cur, &config->pv_curtail_start); break;
+            case CONFIG_KEY_PV_CURTAIL_MAX:         res = cursor_number(cur, &config->pv_curtail_max); break;
+            case CONFIG_KEY_PV_STRING_COUNT:        res = cursor_integer(cur, &config->pv_string_count); break;
+            case CONFIG_KEY_PV_MPPT_RATE_HZ:        res = cursor_integer(cur, &config->pv_mppt_rate_hz); break;
+            case CONFIG_KEY_PV_TILT:                res = cursor_number(cur, &config->pv_tilt); break;
+            case CONFIG_KEY_PV_AZIMUTH:             res = cursor_number(cur, &config->pv_azimuth); break;
+            case CONFIG_KEY_PV_TEMP_COEFFICIENT:    res = cursor_number(cur, &config->pv_temp_coefficient); break;
+            case CONFIG_KEY_SITE_LATITUDE:          res = cursor_number(cur, &config->site_latitude); break;
+            case CONFIG_KEY_SITE_LONGITUDE:         res = cursor_number(cur, &config->site_longitude); break;
+            case CONFIG_KEY_CONTROL_INTERVAL:       res = cursor_number(cur, &config->control_interval); break;
+            case CONFIG_KEY_MEASUREMENT_INTERVAL:   res = cursor_number(cur, &config->measurement_interval); break;
+            case CONFIG_KEY_HYSTERESIS:             res = cursor_number(cur, &config->hysteresis); break;
+            case CONFIG_KEY_DISPATCH_HORIZON_HOURS: res = cursor_integer(cur, &config->dispatch_horizon_hours); break;
+            case CONFIG_KEY_DISPATCH_STEP_MINUTES:  res = cursor_integer(cur, &config->dispatch_step_minutes); break;
+            case CONFIG_KEY_DISPATCH_INTERVAL_CYCLES:
+                res = cursor_integer(cur, &config->dispatch_interval_cycles);
+                break;
+            case CONFIG_KEY_IRRIGATION_MODE:
+                res = cursor_integer(cur, &mode);
+                config->irrigation_mode = (irrigation_mode_t)mode;
+                break;
+            case CONFIG_KEY_IRRIGATION_POWER_LIMIT: res = cursor_number(cur, &config->irrigation_power_limit); break;
+            case CONFIG_KEY_EV_CHARGE_POWER_LIMIT:  res = cursor_number(cur, &config->ev_charge_power_limit); break;
+            case CONFIG_KEY_LOADS:
+                res = parse_object_array(cur, config->loads, &config->load_count, CONFIG_MAX_LOADS,
+                                         sizeof(load_definition_t), parse_load_object, "loads");
+                break;
+            case CONFIG_KEY_ZONES:
+                res = parse_object_array(cur, config->zones, &config->zone_count, CONFIG_MAX_ZONES,
+                                         sizeof(irrigation_zone_t), parse_zone_object, "irrigation zones");
+                break;
+            case CONFIG_KEY_EV_CHARGERS:
+                res = parse_object_array(cur, config->ev_chargers, &config->ev_charger_count, CONFIG_MAX_EV_CHARGERS,
+                                         sizeof(ev_charger_t), parse_ev_charger_object, "EV chargers");
+                break;
+            case CONFIG_KEY_BATTERIES:              res = parse_batteries_object(cur, config); break;
+            case CONFIG_KEY_TARIFF:                 res = parse_tariff_object(cur, config); break;
+            default:                                res = cursor_skip_value(cur, 1); break;
+        }
+    }
 
-        if (**pos == ',') (*pos)++; }
-        if (**pos != '}') return CONFIG_PARSE_ERROR;
+    if (res != CONFIG_SUCCESS || r != 0) return CONFIG_PARSE_ERROR;
 
-        (*pos)++;
+    if (cursor_peek(cur) != -1) return cursor_fail(cur, "trailing data after configuration");
 
-        return CONFIG_SUCCESS;
+    LOG_INFO("JSON parsed: %d loads, %d zones, %d EV chargers, %d batteries.", 
+        config->load_count, config->zone_count, config->ev_charger_count, config->bank_count);
+    return CONFIG_SUCCESS;
 }
 
+/* Run the parser over a buffer and translate a failure into line/column */
+static config_error_t config_parse_buffer(const char* text, size_t length, system_config_t* config,
+                                          const char* source)
+{
+#ifdef DEBUG
+    config_key_table_verify();
+#endif
+
+    config_cursor_t cur = {
+        .begin = text,
+        .pos = text,
+        .end = text + length,
+        .error_at = NULL,
+        .error_msg = NULL,
+    };
+
+    memset(&config_error_info, 0, sizeof(config_error_info));
+    config_set_defaults(config);
 
+    config_error_t res = parse_json_object(&cur, config);
+    if (res == CONFIG_SUCCESS) return CONFIG_SUCCESS;
 
-static config_error_t parse_batteries_object(char** pos, system_config_t* config) {
-    if (**pos != '{') return CONFIG_PARSE_ERROR;
-    (*pos)++;
+    const char* at = cur.error_at ? cur.error_at : cur.pos;
+    int line = 1, column = 1;
 
-    while (**pos && **pos != '}') {
-        skip_whitespace(pos);
-        char key[64];
-        if (**pos != '"') return CONFIG_PARSE_ERROR;
-        if (!parse_string(pos, key, sizeof(key))) return CONFIG_PARSE_ERROR;
-        skip_whitespace(pos); if (**pos != ':') return CONFIG_PARSE_ERROR; (*pos)++; skip_whitespace(pos);
+    for (const char* p = text; p < at; p++) {
+        if (*p == '\n') { line++; column = 1; }
+        else column++;
+    }
 
-        if (strcmp(key, "banks") == 0) {
-            // Parse the banks array
-            parse_array_generic(pos, config->batteries, &config->bank_count, MAX_BATTERY_BANKS,
-                                sizeof(battery_bank_t), parse_battery_object);
-        } else {
-            // Skip any metadata fields like chemistry, nominal_voltage, etc.
-            skip_value(pos);
-        }
+    config_error_info.line = line;
+    config_error_info.column = column;
+    snprintf(config_error_info.message, sizeof(config_error_info.message), "%s",
+             cur.error_msg ? cur.error_msg : "syntax error");
 
-        skip_whitespace(pos);
-        if (**pos == ',') (*pos)++;
+    LOG_ERROR("Config parse error in %s at line %d, column %d: %s",
+        source, line, column, config_error_info.message);
+    return res;
+}
+
+int config_set_defaults(system_config_t* config) {
+    if (!config) return -1;
+    memset(config, 0, sizeof(system_config_t));
+
+    strcpy(config->system_name, "Solarize Energy Solutions");
+    config->nominal_voltage = 240.0;
+    config->max_grid_import = 10000.0;
+    config->max_grid_export = 5000.0;
+    config->grid_import_price = 0.30;
+    config->grid_export_price = 0.05;
+    config->tariff_period_count = 0;
+    config->demand_charge = 0.0;
+    config->feed_in_limit = 0.0;
+
+    config->battery_soc_min = 20.0;
+    config->battery_soc_max = 95.0;
+    config->battery_temp_max = 45.0;
+    config->battery_reserve_soc = 30.0;
+    config->battery_soc_estimator = SOC_ESTIMATOR_FUSION;
+
+    config->pv_curtail_start = 90.0;
+    config->pv_curtail_max = 50.0;
+    config->pv_string_count = MAX_PV_STRINGS;
+    config->pv_mppt_rate_hz = PV_MPPT_RATE_DEFAULT_HZ;
+    config->pv_tilt = 15.0;
+    config->pv_azimuth = 180.0;
+    config->pv_temp_coefficient = -0.35;
+    config->site_latitude = 0.0;
+    config->site_longitude = 0.0;
+
+    config->load_count = 0;
+    config->zone_count = 0;
+    config->bank_count = MAX_BATTERY_BANKS;
+    config->ev_charger_count = 0;
+
+    config->irrigation_mode = IRRIGATION_AUTO;
+    config->irrigation_power_limit = 2000.0;
+    config->ev_charge_power_limit = 7000.0;
+
+    config->control_interval = 1.0;
+    config->measurement_interval = 0.5;
+    config->hysteresis = 2.0;
+    config->dispatch_horizon_hours = 24;
+    config->dispatch_step_minutes = 15;
+    config->dispatch_interval_cycles = 60;
+
+    // Initialize battery banks with default values
+    // for (int i = 0; i < MAX_BATTERY_BANKS; i++) {
+    //     battery_bank_t* bat = &config->batteries[i];
+    //     snprintf(bat->bank_id, sizeof(bat->bank_id), "BAT%02d", i+1);
+    //     bat->capacity_wh = 10.0;           // default 10 kWh
+    //     // bat->current_soc = 50.0;            // default 50% SOC
+    //     bat->max_charge_power = 5000.0;     // default 5 kW
+    //     bat->max_discharge_power = 5000.0;  // default 5 kW
+    // }
+
+    return 0;
+}
+
+/* 64-bit word-at-a-time hash used for the cache key and payload checksum */
+static uint64_t config_hash64(const void* data, size_t len, uint64_t seed) {
+    const uint8_t* p = (const uint8_t*)data;
+    uint64_t h = seed ^ (len * 0x9E3779B97F4A7C15ull);
+
+    while (len >= 8) {
+        uint64_t w;
+        memcpy(&w, p, sizeof(w));
+        h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+        p += 8;
+        len -= 8;
     }
 
-    if (**pos != '}') return CONFIG_PARSE_ERROR;
-    (*pos)++;
-    return CONFIG_SUCCESS;
+    uint64_t tail = 0;
+    memcpy(&tail, p, len);
+    h = (h ^ tail) * 0xC4CEB9FE1A85EC53ull;
+
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return h;
 }
 
+static void config_cache_path(const char* filename, char* path, size_t max_len) {
+    snprintf(path, max_len, "%s%s", filename, CONFIG_CACHE_SUFFIX);
+}
+
+/* Load the cached image if it was built from exactly this source and layout */
+static bool config_cache_read(const char* cache_path, uint64_t source_hash, uint64_t source_size,
+                              system_config_t* config)
+{
+    int fd = open(cache_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size != sizeof(config_cache_header_t) + sizeof(system_config_t)) {
+        close(fd);
+        return false;
+    }
 
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
 
+    const config_cache_header_t* hdr = (const config_cache_header_t*)map;
+    const uint8_t* payload = (const uint8_t*)map + sizeof(config_cache_header_t);
+    bool valid = hdr->magic == CONFIG_CACHE_MAGIC &&
+                 hdr->layout_version == CONFIG_LAYOUT_VERSION &&
+                 hdr->header_size == sizeof(config_cache_header_t) &&
+                 hdr->config_size == sizeof(system_config_t) &&
+                 hdr->source_size == source_size &&
+                 hdr->source_hash == source_hash &&
+                 hdr->payload_checksum == config_hash64(payload, sizeof(system_config_t), CONFIG_CACHE_MAGIC);
 
-/* Parse main JSON object */
-static config_error_t parse_json_object(char** pos, system_config_t* config) {
-    skip_whitespace(pos);
-
-    if (**pos != '{') return CONFIG_PARSE_ERROR;
-    (*pos)++;
-
-    while (**pos && **pos != '}') {
-        skip_whitespace(pos);
-        if (**pos == '"') {
-            char key[64];
-            if (!parse_string(pos, key, sizeof(key))) return CONFIG_PARSE_ERROR;
-            skip_whitespace(pos); if (**pos != ':') return CONFIG_PARSE_ERROR; (*pos)++; skip_whitespace(pos);
-
-            if (strcmp(key, "system_name") == 0) parse_string(pos, config->system_name, sizeof(config->system_name));
-            else if (strcmp(key, "nominal_voltage") == 0) config->nominal_voltage = parse_number(pos);
-            else if (strcmp(key, "max_grid_import") == 0) config->max_grid_import = parse_number(pos);
-            else if (strcmp(key, "max_grid_export") == 0) config->max_grid_export = parse_number(pos);
-            else if (strcmp(key, "battery_soc_min") == 0) config->battery_soc_min = parse_number(pos);
-            else if (strcmp(key, "battery_soc_max") == 0) config->battery_soc_max = parse_number(pos);
-            else if (strcmp(key, "battery_temp_max") == 0) config->battery_temp_max = parse_number(pos);
-            else if (strcmp(key, "battery_reserve_soc") == 0) config->battery_reserve_soc = parse_number(pos);
-            else if (strcmp(key, "pv_curtail_start") == 0) config->pv_curtail_start = parse_number(pos);
-            else if (strcmp(key, "pv_curtail_max") == 0) config->pv_curtail_max = parse_number(pos);
-            else if (strcmp(key, "control_interval") == 0) config->control_interval = parse_number(pos);
-            else if (strcmp(key, "measurement_interval") == 0) config->measurement_interval = parse_number(pos);
-            else if (strcmp(key, "hysteresis") == 0) config->hysteresis = parse_number(pos);
-            else if (strcmp(key, "irrigation_mode") == 0) config->irrigation_mode = (irrigation_mode_t)(int)parse_number(pos);
-            else if (strcmp(key, "irrigation_power_limit") == 0) config->irrigation_power_limit = parse_number(pos);
-            else if (strcmp(key, "ev_charge_power_limit") == 0) config->ev_charge_power_limit = parse_number(pos);
-            else if (strcmp(key, "loads") == 0) parse_array_generic(pos, config->loads, &config->load_count, MAX_CONTROLLABLE_LOADS, sizeof(load_definition_t), parse_load_object);
-            else if (strcmp(key, "zones") == 0) parse_array_generic(pos, config->zones, &config->zone_count, MAX_IRRIGATION_ZONES, sizeof(irrigation_zone_t), parse_zone_object);
-            else if (strcmp(key, "ev_chargers") == 0) parse_array_generic(pos, config->ev_chargers, &config->ev_charger_count, MAX_EV_CHARGERS, sizeof(ev_charger_t), parse_ev_charger_object);
-            else if (strcmp(key, "batteries") == 0) parse_batteries_object(pos, config);
-            else skip_value(pos);
-        }
-        skip_whitespace(pos); if (**pos == ',') (*pos)++;
+    if (valid) memcpy(config, payload, sizeof(system_config_t));
+
+    munmap(map, (size_t)st.st_size);
+    return valid;
+}
+
+/* Write the image to a temp file and rename it over the cache, so readers
+ * never see a partial file. Failure only costs a JSON parse next time. */
+static void config_cache_write(const char* cache_path, uint64_t source_hash, uint64_t source_size,
+                               const system_config_t* config)
+{
+    char tmp_path[PATH_MAX + 32];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", cache_path, (long)getpid());
+
+    config_cache_header_t hdr = {
+        .magic = CONFIG_CACHE_MAGIC,
+        .layout_version = CONFIG_LAYOUT_VERSION,
+        .header_size = sizeof(config_cache_header_t),
+        .config_size = sizeof(system_config_t),
+        .source_size = source_size,
+        .source_hash = source_hash,
+        .payload_checksum = config_hash64(config, sizeof(system_config_t), CONFIG_CACHE_MAGIC),
+    };
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG_DEBUG("Config cache %s not writable: %s", cache_path, strerror(errno));
+        return;
     }
 
-    if (**pos != '}') return CONFIG_PARSE_ERROR;
-    (*pos)++;
+    bool ok = write(fd, &hdr, sizeof(hdr)) == (ssize_t)sizeof(hdr) &&
+              write(fd, config, sizeof(system_config_t)) == (ssize_t)sizeof(system_config_t) &&
+              fdatasync(fd) == 0;
+    close(fd);
 
-    LOG_INFO("JSON parsed: %d loads, %d zones, %d EV chargers, %d batteries.", 
-        config->load_count, config->zone_count, config->ev_charger_count, config->bank_count);
-    return CONFIG_SUCCESS;
+    if (!ok || rename(tmp_path, cache_path) != 0) {
+        LOG_WARNING("Failed to write config cache %s: %s", cache_path, strerror(errno));
+        unlink(tmp_path);
+        return;
+    }
+
+    LOG_DEBUG("Config cache written to %s", cache_path);
 }
 
-/* Load configuration from file */
+/* Load configuration from file (mapped read-only, parsed in place). A
+ * validated binary image is kept next to the file and used instead of
+ * parsing while the source content is unchanged. */
 config_error_t config_load(const char* filename, system_config_t* config) {
     if (!filename || !config) return CONFIG_VALIDATION_ERROR;
 
-    FILE* f = fopen(filename, "r");
-    if (!f) { LOG_ERROR("Failed to open %s\n", filename); return CONFIG_FILE_NOT_FOUND; }
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f); fseek(f, 0, SEEK_SET);
-    if (size > CONFIG_MAX_SIZE) { fclose(f); LOG_ERROR("File too large\n"); return CONFIG_FILE_TOO_LARGE; }
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { LOG_ERROR("Failed to open %s: %s", filename, strerror(errno)); return CONFIG_FILE_NOT_FOUND; }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        LOG_ERROR("Failed to stat %s", filename);
+        close(fd);
+        return CONFIG_FILE_NOT_FOUND;
+    }
+
+    if (st.st_size == 0) {
+        close(fd);
+        config_set_defaults(config);
+        config_error_info = (config_parse_error_t){ .line = 1, .column = 1, .message = "empty file" };
+        LOG_ERROR("Config parse error in %s: empty file", filename);
+        return CONFIG_PARSE_ERROR;
+    }
 
-    char* buf = malloc(size + 1); 
-    if (!buf) { fclose(f); return CONFIG_MEMORY_ERROR; }
-    fread(buf, 1, size, f); fclose(f); buf[size] = '\0';
+    size_t size = (size_t)st.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        LOG_ERROR("Failed to map %s: %s", filename, strerror(errno));
+        return CONFIG_MEMORY_ERROR;
+    }
+
+    posix_madvise(map, size, POSIX_MADV_SEQUENTIAL);
+
+    char cache_path[PATH_MAX];
+    config_cache_path(filename, cache_path, sizeof(cache_path));
+    uint64_t source_hash = config_hash64(map, size, 0);
+
+    if (config_cache_read(cache_path, source_hash, size, config)) {
+        munmap(map, size);
+        memset(&config_error_info, 0, sizeof(config_error_info));
+        LOG_INFO("Config loaded from cache %s: %d loads, %d zones, %d EV chargers, %d batteries.",
+            cache_path, config->load_count, config->zone_count, config->ev_charger_count, config->bank_count);
+        return CONFIG_SUCCESS;
+    }
+
+    config_error_t res = config_parse_buffer((const char*)map, size, config, filename);
+    munmap(map, size);
+
+    // Only images that pass validation are cached
+    if (res == CONFIG_SUCCESS && config_validate(config) == CONFIG_SUCCESS)
+        config_cache_write(cache_path, source_hash, size, config);
 
-    config_set_defaults(config);
-    char* pos = buf;
-    config_error_t res = parse_json_object(&pos, config);
-    free(buf);
     return res;
 }
 
+/* Parse configuration from an in-memory JSON document (e.g. an API request body) */
+config_error_t config_parse(const char* text, size_t length, system_config_t* config) {
+    if (!text || !config) return CONFIG_VALIDATION_ERROR;
+    return config_parse_buffer(text, length, config, "request");
+}
+
+/* Location of the last parse error on this thread */
+const config_parse_error_t* config_last_error(void) {
+    return &config_error_info;
+}
+
+/* Compare two configurations; returns a mask of CONFIG_SECTION_* that differ */
+uint32_t config_diff(const system_config_t* a, const system_config_t* b) {
+    if (!a || !b) return CONFIG_SECTION_ALL;
+
+    uint32_t diff = 0;
+
+    if (strcmp(a->system_name, b->system_name) != 0 ||
+        a->nominal_voltage != b->nominal_voltage ||
+        a->max_grid_import != b->max_grid_import ||
+        a->max_grid_export != b->max_grid_export)
+        diff |= CONFIG_SECTION_GENERAL;
+
+    if (a->grid_import_price != b->grid_import_price ||
+        a->grid_export_price != b->grid_export_price ||
+        a->demand_charge != b->demand_charge ||
+        a->feed_in_limit != b->feed_in_limit ||
+        a->tariff_period_count != b->tariff_period_count ||
+        memcmp(a->tariff_periods, b->tariff_periods, sizeof(a->tariff_periods)) != 0)
+        diff |= CONFIG_SECTION_TARIFF;
+
+    if (a->battery_soc_min != b->battery_soc_min ||
+        a->battery_soc_max != b->battery_soc_max ||
+        a->battery_temp_max != b->battery_temp_max ||
+        a->battery_reserve_soc != b->battery_reserve_soc ||
+        a->battery_soc_estimator != b->battery_soc_estimator ||
+        a->bank_count != b->bank_count ||
+        memcmp(a->batteries, b->batteries, sizeof(a->batteries)) != 0)
+        diff |= CONFIG_SECTION_BATTERY;
+
+    if (a->pv_curtail_start != b->pv_curtail_start ||
+        a->pv_curtail_max != b->pv_curtail_max ||
+        a->pv_string_count != b->pv_string_count ||
+        a->pv_mppt_rate_hz != b->pv_mppt_rate_hz ||
+        a->pv_tilt != b->pv_tilt ||
+        a->pv_azimuth != b->pv_azimuth ||
+        a->pv_temp_coefficient != b->pv_temp_coefficient ||
+        a->site_latitude != b->site_latitude ||
+        a->site_longitude != b->site_longitude)
+        diff |= CONFIG_SECTION_PV;
+
+    // Both sides come from config_set_defaults + parse, so unused slots are zeroed
+    if (a->load_count != b->load_count ||
+        memcmp(a->loads, b->loads, sizeof(a->loads)) != 0)
+        diff |= CONFIG_SECTION_LOADS;
+
+    if (a->zone_count != b->zone_count ||
+        a->irrigation_mode != b->irrigation_mode ||
+        a->irrigation_power_limit != b->irrigation_power_limit ||
+        memcmp(a->zones, b->zones, sizeof(a->zones)) != 0)
+        diff |= CONFIG_SECTION_IRRIGATION;
+
+    if (a->ev_charger_count != b->ev_charger_count ||
+        a->ev_charge_power_limit != b->ev_charge_power_limit ||
+        memcmp(a->ev_chargers, b->ev_chargers, sizeof(a->ev_chargers)) != 0)
+        diff |= CONFIG_SECTION_EV;
+
+    if (a->control_interval != b->control_interval ||
+        a->measurement_interval != b->measurement_interval ||
+        a->hysteresis != b->hysteresis ||
+        a->dispatch_horizon_hours != b->dispatch_horizon_hours ||
+        a->dispatch_step_minutes != b->dispatch_step_minutes ||
+        a->dispatch_interval_cycles != b->dispatch_interval_cycles)
+        diff |= CONFIG_SECTION_CONTROL;
+
+    return diff;
+}
+
 /* Validate configuration */
 config_error_t config_validate(const system_config_t* config) {
     if (!config) return CONFIG_VALIDATION_ERROR;
@@ -412,6 +1111,37 @@ config_error_t config_validate(const system_config_t* config) {
     if (config->battery_soc_min < 0 || config->battery_soc_min > 50) return CONFIG_VALIDATION_ERROR;
     if (config->battery_soc_max < 50 || config->battery_soc_max > 100) return CONFIG_VALIDATION_ERROR;
     if (config->battery_soc_min >= config->battery_soc_max) return CONFIG_VALIDATION_ERROR;
+    if (config->battery_soc_estimator != SOC_ESTIMATOR_FUSION &&
+        config->battery_soc_estimator != SOC_ESTIMATOR_EKF) return CONFIG_VALIDATION_ERROR;
+    if (config->pv_string_count < 1 || config->pv_string_count > CONFIG_MAX_PV_STRINGS) return CONFIG_VALIDATION_ERROR;
+    if (config->pv_mppt_rate_hz < PV_MPPT_RATE_MIN_HZ || config->pv_mppt_rate_hz > PV_MPPT_RATE_MAX_HZ)
+        return CONFIG_VALIDATION_ERROR;
+    if (config->pv_tilt < 0 || config->pv_tilt > 90) return CONFIG_VALIDATION_ERROR;
+    if (config->pv_azimuth < 0 || config->pv_azimuth >= 360) return CONFIG_VALIDATION_ERROR;
+    if (config->pv_temp_coefficient < -1 || config->pv_temp_coefficient > 0) return CONFIG_VALIDATION_ERROR;
+    if (config->site_latitude < -90 || config->site_latitude > 90) return CONFIG_VALIDATION_ERROR;
+    if (config->site_longitude < -180 || config->site_longitude > 180) return CONFIG_VALIDATION_ERROR;
+    if (config->grid_import_price < 0 || config->grid_export_price < 0) return CONFIG_VALIDATION_ERROR;
+    if (config->demand_charge < 0 || config->feed_in_limit < 0) return CONFIG_VALIDATION_ERROR;
+    for (int i = 0; i < config->tariff_period_count; i++) {
+        const tariff_period_t* p = &config->tariff_periods[i];
+        if (p->days == 0 || p->days > TARIFF_ALL_DAYS) return CONFIG_VALIDATION_ERROR;
+        if (p->start_hour < 0 || p->start_hour >= 24 || p->end_hour <= 0 || p->end_hour > 24 ||
+            p->start_hour == p->end_hour)
+            return CONFIG_VALIDATION_ERROR;
+        if (p->import_price < 0 || p->export_price < 0) return CONFIG_VALIDATION_ERROR;
+    }
+    for (int i = 0; i < config->load_count; i++) {
+        const load_definition_t* l = &config->loads[i];
+        if (l->daily_energy_wh < 0 || l->deadline_hour < 0 || l->deadline_hour >= 24) return CONFIG_VALIDATION_ERROR;
+    }
+    if (config->dispatch_horizon_hours < DISPATCH_HORIZON_MIN_H || config->dispatch_horizon_hours > DISPATCH_HORIZON_MAX_H)
+        return CONFIG_VALIDATION_ERROR;
+    // Slots must tile the hour so plans line up with tariff and forecast slots
+    if (config->dispatch_step_minutes < DISPATCH_STEP_MIN_MIN || config->dispatch_step_minutes > DISPATCH_STEP_MAX_MIN ||
+        60 % config->dispatch_step_minutes != 0)
+        return CONFIG_VALIDATION_ERROR;
+    if (config->dispatch_interval_cycles < 0) return CONFIG_VALIDATION_ERROR;
     return CONFIG_SUCCESS;
 }
 
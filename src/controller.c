@@ -1,8 +1,12 @@
 // controller.c
 
 #include "controller.h"
+#include "clock.h"
 #include "logging.h"
+#include "journal.h"
+#include "config.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <math.h>
@@ -12,16 +16,61 @@ static const char* controller_mode_str[] = {
     "AUTO", "MANUAL", "TEST", "SAFE"
 };
 
+// Alarm engine callback: runs once per debounced transition, never per cycle
+static void controller_alarm_transition(const alarm_transition_t* t, void* user_data) {
+    system_controller_t* ctrl = (system_controller_t*)user_data;
+    const alarm_definition_t* def = alarm_get_definition(t->code);
+
+    switch (t->to) {
+        case ALARM_STATE_ACTIVE:
+            journal_append(JOURNAL_EVENT_FAULT_RAISED, (uint16_t)t->code, t->value, def->name);
+            LOG_WARNING("[ALARM] %s raised (%s, occurrence %u, value %.1f)",
+                def->name, alarm_severity_str(def->severity), t->occurrence_count, t->value);
+
+            ctrl->last_fault_time = t->timestamp;
+            snprintf(ctrl->last_fault_description, sizeof(ctrl->last_fault_description),
+                     "%s (%s)", def->name, alarm_severity_str(def->severity));
+            break;
+
+        case ALARM_STATE_ACKNOWLEDGED:
+            journal_append(JOURNAL_EVENT_ALARM_ACKNOWLEDGED, (uint16_t)t->code, t->value, def->name);
+            LOG_INFO("[ALARM] %s acknowledged", def->name);
+            break;
+
+        case ALARM_STATE_CLEARED:
+        case ALARM_STATE_INACTIVE:
+            if (t->from == ALARM_STATE_CLEARED) {
+                journal_append(JOURNAL_EVENT_ALARM_ACKNOWLEDGED, (uint16_t)t->code, t->value, def->name);
+                LOG_INFO("[ALARM] %s acknowledged", def->name);
+            } else {
+                journal_append(JOURNAL_EVENT_FAULT_CLEARED, (uint16_t)t->code, t->value, def->name);
+                LOG_INFO("[ALARM] %s cleared", def->name);
+            }
+            break;
+    }
+}
+
+// Subsystems drive a fixed number of devices; say so when the config lists more
+static void controller_check_capacity(const system_config_t* config) {
+    if (config->zone_count > MAX_IRRIGATION_ZONES)
+        LOG_WARNING("Config lists %d zones, controlling the first %d", config->zone_count, MAX_IRRIGATION_ZONES);
+    if (config->ev_charger_count > MAX_EV_CHARGERS)
+        LOG_WARNING("Config lists %d EV chargers, controlling the first %d", config->ev_charger_count, MAX_EV_CHARGERS);
+}
+
 // Initialize controller and subsystems
 int controller_init(system_controller_t* ctrl, const system_config_t* config) {
     if (!ctrl || !config) return -1;
 
     memset(ctrl, 0, sizeof(system_controller_t));
+    pthread_mutex_init(&ctrl->state_lock, NULL);
 
     // Basic controller state
     ctrl->mode = CTRL_MODE_AUTO;
+    memcpy(&ctrl->config, config, sizeof(system_config_t));
+    controller_check_capacity(config);
     ctrl->control_interval = config->control_interval;
-    ctrl->last_control_cycle = time(NULL);
+    ctrl->last_control_cycle = clock_now();
     ctrl->cycle_count = 0;
 
     // Initialize subsystems and fail fast if any init fails
@@ -49,6 +98,14 @@ int controller_init(system_controller_t* ctrl, const system_config_t* config) {
         LOG_ERROR("Failed to initialize EV controller");
         return -1;
     }
+    ctrl->ev_system.pv_forecast = &ctrl->pv_system.forecast;
+
+    if (tariff_init(&ctrl->tariff, config) != 0) {
+        LOG_ERROR("Failed to initialize tariff");
+        return -1;
+    }
+
+    alarm_engine_init(&ctrl->alarms, controller_alarm_transition, ctrl);
 
     // System status defaults
     ctrl->status.mode = MODE_NORMAL;
@@ -58,9 +115,10 @@ int controller_init(system_controller_t* ctrl, const system_config_t* config) {
     ctrl->status.pv_available = true;
     ctrl->status.critical_loads_on = true;
     ctrl->status.battery_soc_category = SOC_MEDIUM;
-    ctrl->status.alarms = 0;
+    ctrl->status.active_alarms = 0;
+    ctrl->status.unacked_alarms = 0;
     ctrl->status.warnings = 0;
-    ctrl->status.last_mode_change = time(NULL);
+    ctrl->status.last_mode_change = clock_now();
     ctrl->status.uptime = 0;
 
     // Control parameters
@@ -69,7 +127,7 @@ int controller_init(system_controller_t* ctrl, const system_config_t* config) {
     ctrl->grid_import_limit = config->max_grid_import;
     ctrl->grid_export_limit = config->max_grid_export;
 
-    ctrl->battery_soc_target = 70.0;
+    ctrl->battery_soc_target = config->battery_reserve_soc;    // until the first tariff schedule
     ctrl->pv_self_consumption_target = 90.0;
 
     // Safety limits
@@ -78,7 +136,7 @@ int controller_init(system_controller_t* ctrl, const system_config_t* config) {
     ctrl->max_load_power = 15000.0;
 
     // Statistics & logging
-    ctrl->statistics.stats_start_time = time(NULL);
+    ctrl->statistics.stats_start_time = clock_now();
     ctrl->log_level = 2;
     ctrl->verbose = false;
     ctrl->log_file = stdout;
@@ -90,7 +148,7 @@ int controller_init(system_controller_t* ctrl, const system_config_t* config) {
 int controller_run_cycle(system_controller_t* ctrl) {
     if (!ctrl) return -1;
 
-    time_t now = time(NULL);
+    time_t now = clock_now();
     double elapsed = difftime(now, ctrl->last_control_cycle);
 
     // Allow fractional intervals by comparing elapsed as double
@@ -119,6 +177,19 @@ int controller_run_cycle(system_controller_t* ctrl) {
     // Determine operational mode from current measurements
     controller_determine_mode(ctrl);
 
+    // Apply debounced alarm transitions (only alarms whose input changed)
+    alarm_engine_process(&ctrl->alarms, now);
+    ctrl->status.active_alarms = (uint16_t)ctrl->alarms.active_count;
+    ctrl->status.unacked_alarms = (uint16_t)ctrl->alarms.unacked_count;
+
+    // Plan the battery against the tariff, then pick up a new dispatch plan
+    // and re-plan every few cycles
+    controller_schedule_battery(ctrl);
+    controller_plan_dispatch(ctrl);
+
+    // Run the deferrable loads into the forecast surplus
+    controller_schedule_deferrable(ctrl);
+
     // Run energy optimization & action planning
     controller_optimize_energy_flow(ctrl);
 
@@ -135,11 +206,85 @@ int controller_run_cycle(system_controller_t* ctrl) {
         pv_log_status(&ctrl->pv_system);
         battery_log_status(&ctrl->battery_system);
         loads_log_status(&ctrl->load_manager);
+        tariff_log_status(&ctrl->tariff, &ctrl->schedule);
+
+        if (ctrl->alarms.active_count || ctrl->alarms.unacked_count)
+            alarm_engine_log_status(&ctrl->alarms);
     }
 
     return 0;
 }
 
+// Swap a reloaded configuration into the subsystems. Must be called between
+// cycles on the control thread; sections that did not change are left alone
+// so their runtime state (shed loads, watering zones, EV sessions) survives.
+// The swap is all or nothing: the battery bank set is checked and the PV
+// and load tables, the only steps that allocate, are built first; nothing
+// changes unless all of them succeed.
+int controller_apply_config(system_controller_t* ctrl, const system_config_t* config) {
+    if (!ctrl || !config) return -1;
+
+    uint32_t diff = config_diff(&ctrl->config, config);
+
+    if (diff == 0) {
+        LOG_INFO("Configuration reload: no changes");
+        return 0;
+    }
+
+    controller_check_capacity(config);
+
+    pv_config_stage_t pv_stage = {0};
+    loads_config_stage_t loads_stage = {0};
+
+    if ((diff & CONFIG_SECTION_BATTERY) && battery_prepare_config(&ctrl->battery_system, config) != 0) {
+        LOG_ERROR("Failed to prepare battery configuration, keeping the running one");
+        return -1;
+    }
+
+    if ((diff & CONFIG_SECTION_PV) && pv_prepare_config(&ctrl->pv_system, config, &pv_stage) != 0) {
+        LOG_ERROR("Failed to prepare PV configuration, keeping the running one");
+        return -1;
+    }
+
+    if ((diff & CONFIG_SECTION_LOADS) && loads_prepare_config(&ctrl->load_manager, config, &loads_stage) != 0) {
+        LOG_ERROR("Failed to prepare load configuration, keeping the running one");
+        pv_discard_config(&pv_stage);
+        return -1;
+    }
+
+    // Nothing below can fail: the remaining apply calls only reject NULL arguments
+    if (diff & CONFIG_SECTION_GENERAL) {
+        ctrl->grid_import_limit = config->max_grid_import;
+        ctrl->grid_export_limit = config->max_grid_export;
+    }
+
+    if (diff & CONFIG_SECTION_CONTROL) {
+        ctrl->control_interval = config->control_interval;
+    }
+
+    if (diff & CONFIG_SECTION_TARIFF) tariff_apply_config(&ctrl->tariff, config);
+
+    // Prices or battery limits changed: re-plan at the next cycle
+    if (diff & (CONFIG_SECTION_TARIFF | CONFIG_SECTION_BATTERY)) {
+        ctrl->schedule.valid = false;
+        ctrl->schedule.start = 0;
+    }
+
+    if (diff & CONFIG_SECTION_BATTERY) battery_apply_config(&ctrl->battery_system, config);
+    if (diff & CONFIG_SECTION_PV) pv_commit_config(&ctrl->pv_system, config, &pv_stage);
+    if (diff & CONFIG_SECTION_LOADS) loads_commit_config(&ctrl->load_manager, &loads_stage);
+    if (diff & CONFIG_SECTION_IRRIGATION) agriculture_apply_config(&ctrl->agriculture_system, config);
+    if (diff & CONFIG_SECTION_EV) ev_apply_config(&ctrl->ev_system, config);
+
+    memcpy(&ctrl->config, config, sizeof(system_config_t));
+
+    journal_append(JOURNAL_EVENT_CONFIG_RELOAD, (uint16_t)diff, 0.0, "reload");
+    LOG_INFO("Configuration reloaded (changed sections 0x%02x): %d loads, %d zones, %d chargers",
+        diff, ctrl->load_manager.load_count, ctrl->agriculture_system.zone_count, ctrl->ev_system.charger_count);
+
+    return 0;
+}
+
 // Ask each subsystem to update the shared measurements structure
 void controller_update_measurements(system_controller_t* ctrl) {
     if (!ctrl) return;
@@ -151,8 +296,12 @@ void controller_update_measurements(system_controller_t* ctrl) {
     agriculture_update_measurements(&ctrl->agriculture_system, &ctrl->measurements);
     ev_update_measurements(&ctrl->ev_system, &ctrl->measurements);
 
-    // Grid handling: assume grid_power = consumption - generation - battery
-    if (ctrl->status.grid_available) {
+    // Grid handling: a meter reading is taken as is, otherwise assume
+    // grid_power = consumption - generation - battery
+    if (ctrl->measurements.measured & MEASURED_GRID) {
+        LOG_DEBUG("grid meter: %.1f W at %.1f V, %.2f Hz", ctrl->measurements.grid_power,
+            ctrl->measurements.grid_voltage, ctrl->measurements.grid_frequency);
+    } else if (ctrl->status.grid_available) {
         ctrl->measurements.grid_voltage = ctrl->measurements.grid_voltage > 0 ? ctrl->measurements.grid_voltage : 240.0;
         ctrl->measurements.grid_frequency = ctrl->measurements.grid_frequency > 0 ? ctrl->measurements.grid_frequency : 60.0;
 
@@ -185,7 +334,13 @@ void controller_update_measurements(system_controller_t* ctrl) {
 
 
     // Timestamp this measurement update
-    ctrl->measurements.timestamp = time(NULL);
+    ctrl->measurements.timestamp = clock_now();
+
+    // Demand forecast needs all three consumers, so it runs after them
+    loads_update_forecast(&ctrl->load_manager, &ctrl->measurements);
+
+    // Meter grid energy and demand against the tariff
+    tariff_update(&ctrl->tariff, ctrl->measurements.timestamp, ctrl->measurements.grid_power);
 }
 
 // Decide if we're islanded or normal and update SOC category and alarms
@@ -201,22 +356,26 @@ void controller_determine_mode(system_controller_t* ctrl) {
     if (!ctrl->status.grid_available && grid_was_available) {
         // grid lost
         new_mode = MODE_ISLAND;
-        ctrl->status.last_mode_change = time(NULL);
+        ctrl->status.last_mode_change = clock_now();
         ctrl->statistics.grid_outage_count++;
         ctrl->statistics.island_count++;
-        ctrl->status.alarms |= (1 << ALARM_GRID_FAILURE);
     } else if (ctrl->status.grid_available && !grid_was_available) {
         // grid restored
         new_mode = MODE_NORMAL;
-        ctrl->status.last_mode_change = time(NULL);
-        ctrl->status.alarms &= ~(1 << ALARM_GRID_FAILURE);
+        ctrl->status.last_mode_change = clock_now();
     }
 
+    time_t now = ctrl->measurements.timestamp;
+    alarm_engine_update(&ctrl->alarms, ALARM_GRID_FAILURE, !ctrl->status.grid_available,
+        ctrl->measurements.grid_voltage, now);
+
     // Critical battery SOC handling
-    if (ctrl->measurements.battery_soc < 20.0 && !ctrl->status.grid_available) {
+    bool soc_critical = ctrl->measurements.battery_soc < 20.0 && !ctrl->status.grid_available;
+    if (soc_critical)
         new_mode = MODE_CRITICAL;
-        ctrl->status.alarms |= (1 << ALARM_BATTERY_LOW_SOC);
-    }
+
+    alarm_engine_update(&ctrl->alarms, ALARM_BATTERY_LOW_SOC, soc_critical,
+        ctrl->measurements.battery_soc, now);
 
     // Update SOC category (ordered thresholds)
     if (ctrl->measurements.battery_soc < 20.0) {
@@ -231,9 +390,187 @@ void controller_determine_mode(system_controller_t* ctrl) {
         ctrl->status.battery_soc_category = SOC_FULL;
     }
 
+    if (new_mode != ctrl->status.mode)
+        journal_append(JOURNAL_EVENT_MODE_CHANGE, (uint16_t)new_mode, (double)ctrl->status.mode, "controller");
+
     ctrl->status.mode = new_mode;
 }
 
+// Average forecast power (W) over [from, to) from one of the two forecasts.
+// Both cover 24 h from their current slot; later times reuse the same time
+// of day from within that window
+double controller_forecast_w(const pv_forecast_t* pv, const load_forecast_t* load, time_t from, time_t to) {
+    time_t end = pv ? (time_t)(pv->first_slot + PV_FORECAST_SLOTS) * PV_FORECAST_STEP_S
+                    : (time_t)(load->first_slot + LOAD_FORECAST_SLOTS) * LOAD_FORECAST_STEP_S;
+    double wh = 0.0;
+
+    for (time_t t = from; t < to; ) {
+        time_t shift = t >= end ? ((t - end) / 86400 + 1) * 86400 : 0;
+        time_t piece = to < end + shift ? to : end + shift;
+
+        wh += pv ? pv_forecast_energy(pv, t - shift, piece - shift)
+                 : load_forecast_energy(load, t - shift, piece - shift);
+        t = piece;
+    }
+
+    return wh * 3600.0 / (double)(to - from);
+}
+
+// Snapshot the horizon for the dispatch optimizer
+static void controller_build_dispatch_input(system_controller_t* ctrl, time_t now, dispatch_input_t* in) {
+    battery_system_t* bat = &ctrl->battery_system;
+    const system_config_t* config = &ctrl->config;
+    bool grid = ctrl->status.grid_available;
+
+    in->step_s = config->dispatch_step_minutes * 60;
+    in->slots = config->dispatch_horizon_hours * 3600 / in->step_s;
+    if (in->slots > DISPATCH_MAX_SLOTS) in->slots = DISPATCH_MAX_SLOTS;
+    in->start = now - now % in->step_s;
+
+    in->energy_wh = bat->capacity_remaining_wh;
+    in->capacity_wh = bat->capacity_nominal_wh;
+    in->reserve_wh = config->battery_reserve_soc / 100.0 * bat->capacity_nominal_wh;
+    in->max_energy_wh = bat->max_operating_soc / 100.0 * bat->capacity_nominal_wh;
+    in->max_charge_w = battery_calculate_max_charge(bat);
+    in->max_discharge_w = battery_calculate_max_discharge(bat);
+    in->import_limit_w = grid && ctrl->grid_import_allowed ? ctrl->grid_import_limit : 0.0;
+    in->export_limit_w = grid && ctrl->grid_export_allowed ? ctrl->grid_export_limit : 0.0;
+    in->deferrable_power_w = ctrl->load_manager.deferred_power;
+    in->deferrable_energy_wh = ctrl->load_manager.deferred_power * DISPATCH_DEFERRED_RUN_H;
+
+    for (int t = 0; t < in->slots; t++) {
+        time_t from = in->start + (time_t)t * in->step_s;
+        time_t to = from + in->step_s;
+
+        in->load_w[t] = (float)(controller_forecast_w(NULL, &ctrl->load_manager.forecast, from, to) +
+                                loads_plan_power_w(&ctrl->load_manager, from, to));
+        in->pv_w[t] = (float)controller_forecast_w(&ctrl->pv_system.forecast, NULL, from, to);
+
+        // Slots longer than the tariff's average its prices
+        double import_price = 0.0, export_price = 0.0;
+        int parts = 0;
+        for (time_t p = from; p < to; p += TARIFF_STEP_S, parts++) {
+            import_price += tariff_import_price(&ctrl->tariff, p);
+            export_price += tariff_export_price(&ctrl->tariff, p);
+        }
+        in->import_price[t] = (float)(import_price / parts);
+        in->export_price[t] = (float)(export_price / parts);
+    }
+
+    // Export above the feed-in cap earns nothing, so curtailing it costs the
+    // same; import above the schedule's cap would raise the demand charge
+    if (config->feed_in_limit > 0.0 && in->export_limit_w > config->feed_in_limit)
+        in->export_limit_w = config->feed_in_limit;
+    if (ctrl->tariff.demand_charge > 0.0 && ctrl->schedule.valid && in->import_limit_w > ctrl->schedule.import_cap_w)
+        in->import_limit_w = ctrl->schedule.import_cap_w;
+
+    // The slot under way is better known from measurement than from forecast
+    in->load_w[0] = (float)(ctrl->measurements.load_power_total + ctrl->measurements.irrigation_power +
+                            ctrl->measurements.ev_charging_power);
+    in->pv_w[0] = (float)ctrl->measurements.pv_power_total;
+}
+
+// Take the latest plan from the dispatch worker; submit a new problem every
+// dispatch_interval_cycles cycles
+void controller_plan_dispatch(system_controller_t* ctrl) {
+    if (!ctrl || !ctrl->dispatch) return;
+
+    dispatch_plan_t* plan = dispatch_take(ctrl->dispatch);
+    if (plan) {
+        free(ctrl->plan);
+        ctrl->plan = plan;
+        LOG_DEBUG("Dispatch plan: %d slots, cost %.2f, %s after %d iterations in %.2f ms",
+            plan->slots, plan->cost, qp_status_str(plan->status), plan->iterations, plan->solve_ms);
+    }
+
+    int interval = ctrl->config.dispatch_interval_cycles;
+    if (interval <= 0 || (ctrl->cycle_count - 1) % (uint64_t)interval != 0) return;
+
+    controller_build_dispatch_input(ctrl, ctrl->measurements.timestamp, &ctrl->dispatch_input);
+    dispatch_submit(ctrl->dispatch, &ctrl->dispatch_input);
+}
+
+// Re-plan the battery against the tariff at the start of every tariff slot
+// while grid-connected; the schedule's SOC at the end of the slot under way
+// becomes the battery target
+void controller_schedule_battery(system_controller_t* ctrl) {
+    if (!ctrl) return;
+
+    time_t now = ctrl->measurements.timestamp;
+    time_t start = now - now % TARIFF_STEP_S;
+
+    if (ctrl->status.grid_available && ctrl->schedule.start != start) {
+        battery_system_t* bat = &ctrl->battery_system;
+        const system_config_t* config = &ctrl->config;
+        tariff_battery_t limits = {
+            .energy_wh = bat->capacity_remaining_wh,
+            .capacity_wh = bat->capacity_nominal_wh,
+            .min_energy_wh = config->battery_reserve_soc / 100.0 * bat->capacity_nominal_wh,
+            .max_energy_wh = bat->max_operating_soc / 100.0 * bat->capacity_nominal_wh,
+            .max_charge_w = battery_calculate_max_charge(bat),
+            .max_discharge_w = battery_calculate_max_discharge(bat),
+            .import_limit_w = ctrl->grid_import_allowed ? ctrl->grid_import_limit : 0.0,
+            .export_limit_w = ctrl->grid_export_allowed ? ctrl->grid_export_limit : 0.0,
+        };
+        float load_w[TARIFF_SCHEDULE_SLOTS], pv_w[TARIFF_SCHEDULE_SLOTS];
+
+        for (int t = 0; t < TARIFF_SCHEDULE_SLOTS; t++) {
+            time_t from = start + (time_t)t * TARIFF_STEP_S;
+
+            load_w[t] = (float)(controller_forecast_w(NULL, &ctrl->load_manager.forecast, from, from + TARIFF_STEP_S) +
+                                loads_plan_power_w(&ctrl->load_manager, from, from + TARIFF_STEP_S));
+            pv_w[t] = (float)controller_forecast_w(&ctrl->pv_system.forecast, NULL, from, from + TARIFF_STEP_S);
+        }
+        load_w[0] = (float)(ctrl->measurements.load_power_total + ctrl->measurements.irrigation_power +
+                            ctrl->measurements.ev_charging_power);
+        pv_w[0] = (float)ctrl->measurements.pv_power_total;
+
+        if (tariff_schedule_battery(&ctrl->tariff, &limits, load_w, pv_w, start, &ctrl->schedule) == 0)
+            LOG_DEBUG("Tariff schedule: cost %.2f, saves %.2f, import cap %.0f W, SOC target %.1f%%",
+                ctrl->schedule.cost, ctrl->schedule.savings, ctrl->schedule.import_cap_w, ctrl->schedule.soc[0]);
+        else
+            LOG_DEBUG("Tariff schedule unavailable (battery span too small)");
+
+        // Attempted once per slot, also when it failed
+        ctrl->schedule.start = start;
+    }
+
+    int slot = tariff_schedule_slot(&ctrl->schedule, now);
+    if (slot >= 0) ctrl->battery_soc_target = ctrl->schedule.soc[slot];
+}
+
+// Re-plan the deferrable loads at the start of every planner slot, or when
+// a deadline rolled over, against the PV forecast less the other loads (the
+// load forecast is learned net of the planned loads); then switch them to
+// the plan every cycle
+void controller_schedule_deferrable(system_controller_t* ctrl) {
+    if (!ctrl) return;
+
+    load_manager_t* lm = &ctrl->load_manager;
+    time_t now = ctrl->measurements.timestamp;
+    time_t start = now - now % DEFER_PLAN_STEP_S;
+
+    if (lm->defer_planner.start != start || lm->defer_replan) {
+        float surplus_w[DEFER_PLAN_SLOTS];
+
+        for (int t = 0; t < DEFER_PLAN_SLOTS; t++) {
+            time_t from = start + (time_t)t * DEFER_PLAN_STEP_S;
+
+            surplus_w[t] = (float)(controller_forecast_w(&ctrl->pv_system.forecast, NULL, from, from + DEFER_PLAN_STEP_S) -
+                                   controller_forecast_w(NULL, &lm->forecast, from, from + DEFER_PLAN_STEP_S));
+        }
+        // The planned loads' own runs are the plan's, not the others' demand
+        surplus_w[0] = (float)(ctrl->measurements.pv_power_total - ctrl->measurements.load_power_total +
+                               loads_planned_power(lm) - ctrl->measurements.irrigation_power -
+                               ctrl->measurements.ev_charging_power);
+
+        if (loads_plan_deferrable(lm, start, surplus_w) == 0)
+            LOG_DEBUG("Deferrable plan: %d loads in %.0f us", lm->defer_planner.count, lm->defer_planner.last_plan_s * 1e6);
+    }
+
+    loads_run_deferrable(lm, now);
+}
+
 // High-level optimizer that issues subsystem commands
 void controller_optimize_energy_flow(system_controller_t* ctrl) {
     if (!ctrl) return;
@@ -249,8 +586,24 @@ void controller_optimize_energy_flow(system_controller_t* ctrl) {
     // Reset output commands
     memset(&ctrl->commands, 0, sizeof(control_commands_t));
 
-    // Battery control
-    if (total_generation > total_consumption) {
+    // Battery control: follow the dispatch plan's grid trajectory while
+    // grid-connected, so forecast error is absorbed by the battery
+    int slot = grid_available && ctrl->config.dispatch_interval_cycles > 0
+        ? dispatch_plan_slot(ctrl->plan, ctrl->measurements.timestamp) : -1;
+    int tariff_slot = grid_available ? tariff_schedule_slot(&ctrl->schedule, ctrl->measurements.timestamp) : -1;
+
+    if (slot >= 0) {
+        double setpoint = total_consumption - total_generation - ctrl->plan->grid_w[slot];
+        battery_follow_setpoint(&ctrl->battery_system, setpoint);
+
+    } else if (tariff_slot >= 0) {
+        // No optimizer plan: steer along the tariff schedule's SOC targets
+        battery_system_t* bat = &ctrl->battery_system;
+        double setpoint = tariff_schedule_setpoint(&ctrl->schedule, tariff_slot, ctrl->measurements.timestamp,
+            bat->capacity_remaining_wh, bat->capacity_nominal_wh, total_consumption - total_generation);
+        battery_follow_setpoint(&ctrl->battery_system, setpoint);
+
+    } else if (total_generation > total_consumption) {
         double excess = total_generation - total_consumption;
         battery_manage_charging(&ctrl->battery_system, excess, total_consumption);
 
@@ -271,9 +624,11 @@ void controller_optimize_energy_flow(system_controller_t* ctrl) {
     loads_manage_shedding(&ctrl->load_manager, available_power, total_consumption,
         ctrl->measurements.battery_soc, grid_available);
 
-    // Propagate load shed flags to commands
-    for (int i = 0; i < MAX_CONTROLLABLE_LOADS; i++) {
-        ctrl->commands.load_shed[i] = (ctrl->load_manager.load_states[i] == LOAD_STATE_SHED);
+    // Propagate load shed flags to commands; deferred loads are off until their run
+    for (int i = 0; i < CONFIG_MAX_LOADS; i++) {
+        ctrl->commands.load_shed[i] = i < ctrl->load_manager.load_count &&
+            (ctrl->load_manager.load_states[i] == LOAD_STATE_SHED ||
+             ctrl->load_manager.load_states[i] == LOAD_STATE_DEFERRED);
     }
 
     // Agriculture and EV decisions
@@ -289,8 +644,11 @@ void controller_optimize_energy_flow(system_controller_t* ctrl) {
     ctrl->commands.island = !grid_available ||
         ctrl->status.mode == MODE_ISLAND || ctrl->status.mode == MODE_CRITICAL;
 
-    // Set battery setpoint to current measurement by default
-    ctrl->commands.battery_setpoint = ctrl->measurements.battery_power;
+    // Split the battery manager's request across banks
+    battery_system_t* bat = &ctrl->battery_system;
+    ctrl->commands.battery_setpoint = battery_dispatch(bat, bat->power_setpoint_w);
+    for (int i = 0; i < bat->bank_count && i < MAX_BATTERY_BANKS; i++)
+        ctrl->commands.battery_bank_setpoint[i] = bat->bank_state[i].setpoint_w;
 }
 
 // Update grid connection status (simulation of action effects)
@@ -305,52 +663,41 @@ void controller_manage_grid_connection(system_controller_t* ctrl) {
     }
 }
 
-/* Aggregate faults from subsystems and system checks */
+/* Feed subsystem fault conditions into the alarm engine.
+ * Conditions are reported every cycle; the engine only reacts to changes. */
 void controller_handle_faults(system_controller_t* ctrl) {
     if (!ctrl) return;
 
-    uint32_t new_faults = 0;
+    alarm_engine_t* alarms = &ctrl->alarms;
+    time_t now = ctrl->measurements.timestamp;
+    battery_system_t* bat = &ctrl->battery_system;
 
-    if (pv_detect_faults(&ctrl->pv_system, &ctrl->measurements))
-        new_faults |= (1 << ALARM_PV_DISCONNECT);
+    bool pv_fault = pv_detect_faults(&ctrl->pv_system, &ctrl->measurements);
+    alarm_engine_update(alarms, ALARM_PV_DISCONNECT, pv_fault, ctrl->measurements.pv_power_total, now);
 
-    if (battery_check_limits(&ctrl->battery_system, &ctrl->measurements)) {
-        if (ctrl->battery_system.overtemperature_fault)
-            new_faults |= (1 << ALARM_BATTERY_OVER_TEMP);
-    }
+    bool battery_fault = battery_check_limits(bat, &ctrl->measurements);
+    alarm_engine_update(alarms, ALARM_BATTERY_OVER_TEMP, battery_fault && bat->overtemperature_fault,
+        ctrl->measurements.battery_temp, now);
+    alarm_engine_update(alarms, ALARM_BATTERY_OVER_VOLTAGE, battery_fault && bat->overvoltage_fault,
+        ctrl->measurements.battery_voltage, now);
+    alarm_engine_update(alarms, ALARM_BATTERY_UNDER_VOLTAGE, battery_fault && bat->undervoltage_fault,
+        ctrl->measurements.battery_voltage, now);
+    alarm_engine_update(alarms, ALARM_BATTERY_OVER_CURRENT, battery_fault && bat->overcurrent_fault,
+        ctrl->measurements.battery_current, now);
 
-    if (agriculture_check_faults(&ctrl->agriculture_system))
-        new_faults |= (1 << ALARM_IRRIGATION_FAULT);
+    bool irrigation_fault = agriculture_check_faults(&ctrl->agriculture_system);
+    alarm_engine_update(alarms, ALARM_IRRIGATION_FAULT, irrigation_fault,
+        ctrl->measurements.irrigation_power, now);
 
-    if (ev_check_faults(&ctrl->ev_system))
-        new_faults |= (1 << ALARM_EV_CHARGER_FAULT);
+    bool ev_fault = ev_check_faults(&ctrl->ev_system);
+    alarm_engine_update(alarms, ALARM_EV_CHARGER_FAULT, ev_fault,
+        ctrl->measurements.ev_charging_power, now);
 
     // Overload detection
     double total_power = ctrl->measurements.load_power_total +
         ctrl->measurements.irrigation_power + ctrl->measurements.ev_charging_power;
-    
-    if (total_power > ctrl->max_total_power)
-        new_faults |= (1 << ALARM_OVERLOAD);
-
-    if (new_faults != 0) {
-        ctrl->fault_mask |= new_faults;
-        ctrl->status.alarms |= new_faults;
-        ctrl->last_fault_time = time(NULL);
 
-        char tsbuf[32];
-        struct tm tm_info;
-        time_t t = ctrl->last_fault_time;
-        localtime_r(&t, &tm_info);
-        strftime(tsbuf, sizeof(tsbuf), "%Y-%m-%d %H:%M:%S", &tm_info);
-
-        snprintf(ctrl->last_fault_description, sizeof(ctrl->last_fault_description),
-                 "Faults detected: 0x%08X at %s", new_faults, tsbuf);
-
-        if (ctrl->log_file) {
-            fprintf(ctrl->log_file, "[FAULT] %s: %s\n", tsbuf, ctrl->last_fault_description);
-            fflush(ctrl->log_file);
-        }
-    }
+    alarm_engine_update(alarms, ALARM_OVERLOAD, total_power > ctrl->max_total_power, total_power, now);
 }
 
 /* Update energy & event statistics using actual elapsed time */
@@ -390,7 +737,7 @@ void controller_update_statistics(system_controller_t* ctrl) {
 void controller_log_status(system_controller_t* ctrl) {
     if (!ctrl) return;
 
-    time_t now = time(NULL);
+    time_t now = clock_now();
     struct tm tm_info;
     localtime_r(&now, &tm_info);
     char time_str[26];
@@ -408,11 +755,16 @@ void controller_log_status(system_controller_t* ctrl) {
         ctrl->measurements.load_power_total, ctrl->measurements.load_power_critical);
     printf("Irrigation: %.0f W\n", ctrl->measurements.irrigation_power);
     printf("EV Charging: %.0f W\n", ctrl->measurements.ev_charging_power);
+    if (ctrl->plan)
+        printf("Dispatch: %d slots from %ld, cost %.2f, %s (%d it, %.2f ms)\n",
+            ctrl->plan->slots, (long)ctrl->plan->start, ctrl->plan->cost,
+            qp_status_str(ctrl->plan->status), ctrl->plan->iterations, ctrl->plan->solve_ms);
     printf("Cycle Count: %lu\n", ctrl->cycle_count);
     printf("Uptime: %.1f hours\n", ctrl->status.uptime / 3600.0);
 
-    if (ctrl->status.alarms)
-        printf("\nACTIVE ALARMS: 0x%08X\n", ctrl->status.alarms);
+    if (ctrl->status.active_alarms || ctrl->status.unacked_alarms)
+        printf("\nALARMS: %u active, %u unacknowledged\n",
+            ctrl->status.active_alarms, ctrl->status.unacked_alarms);
 
     if (ctrl->status.warnings)
         printf("ACTIVE WARNINGS: 0x%08X\n", ctrl->status.warnings);
@@ -426,8 +778,8 @@ void controller_emergency_shutdown(system_controller_t* ctrl) {
 
     LOG_WARNING("[EMERGENCY] Safety limits exceeded! Initiating shutdown...\n");
 
-    Force all loads OFF (shed)
-    for (int i = 0; i < MAX_CONTROLLABLE_LOADS; i++) {
+    // Force all loads OFF (shed)
+    for (int i = 0; i < CONFIG_MAX_LOADS; i++) {
         ctrl->commands.load_shed[i] = true;
     }
 
@@ -444,12 +796,15 @@ void controller_emergency_shutdown(system_controller_t* ctrl) {
     ctrl->commands.island = true;
 
     // Set safe modes
+    if (ctrl->status.mode != MODE_EMERGENCY)
+        journal_append(JOURNAL_EVENT_MODE_CHANGE, MODE_EMERGENCY, (double)ctrl->status.mode, "safety");
+
     ctrl->mode = CTRL_MODE_SAFE;
     ctrl->status.mode = MODE_EMERGENCY;
 
     // Log the event with timestamp
     if (ctrl->log_file) {
-        time_t now = time(NULL);
+        time_t now = clock_now();
         struct tm tm_info;
         char tsbuf[32];
         localtime_r(&now, &tm_info);
@@ -496,10 +851,25 @@ bool controller_check_safety_limits(system_controller_t* ctrl) {
     return true;
 }
 
+/* Serialise access to the controller state with the control loop, which
+ * holds the lock for a whole cycle or configuration swap */
+void controller_lock(system_controller_t* ctrl) {
+    pthread_mutex_lock(&ctrl->state_lock);
+}
+
+void controller_unlock(system_controller_t* ctrl) {
+    pthread_mutex_unlock(&ctrl->state_lock);
+}
+
 // Clean up controller — reset commands and print message
 void controller_cleanup(system_controller_t* ctrl) {
     if (!ctrl) return;
 
     memset(&ctrl->commands, 0, sizeof(control_commands_t));
+    pv_cleanup(&ctrl->pv_system);
+    loads_cleanup(&ctrl->load_manager);
+    free(ctrl->plan);
+    ctrl->plan = NULL;
+    pthread_mutex_destroy(&ctrl->state_lock);
     LOG_INFO("Controller shutdown complete.\n");
 }
@@ -0,0 +1,234 @@
+#include "defer_planner.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFER_STATES            ((DEFER_PLAN_SLOTS + 1) * (DEFER_MAX_RUN_SLOTS + 1))
+#define DEFER_SLOT_EPSILON_WH   1e-3    // every slot on costs a little, so ties run less
+#define DEFER_INVALID_END       1e9     // a run cut below its minimum length at the deadline
+
+/* How a state was reached: the action in the slot before it, whether the
+ * energy count was already capped at the need, and for a run at its minimum
+ * length whether it was already there */
+enum {
+    DEFER_STAY_OFF = 0,
+    DEFER_STOP,
+    DEFER_START,
+    DEFER_CONTINUE
+};
+#define DEFER_ACTION_MASK       0x3
+#define DEFER_FROM_CAPPED       0x4
+#define DEFER_FROM_FULL_RUN     0x8
+
+int defer_planner_init(defer_planner_t* planner, int capacity) {
+    if (!planner || capacity < 0) return -1;
+
+    memset(planner, 0, sizeof(defer_planner_t));
+    size_t n = capacity > 0 ? (size_t)capacity : 1;
+
+    planner->jobs = calloc(n, sizeof(defer_job_t));
+    planner->order = malloc(n * sizeof(int));
+    planner->cost = malloc(2 * DEFER_STATES * sizeof(double));
+    planner->choice = malloc((size_t)DEFER_PLAN_SLOTS * DEFER_STATES);
+
+    if (!planner->jobs || !planner->order || !planner->cost || !planner->choice) {
+        defer_planner_free(planner);
+        return -1;
+    }
+
+    planner->capacity = capacity;
+    return 0;
+}
+
+void defer_planner_free(defer_planner_t* planner) {
+    if (!planner) return;
+
+    free(planner->jobs);
+    free(planner->order);
+    free(planner->cost);
+    free(planner->choice);
+    memset(planner, 0, sizeof(defer_planner_t));
+}
+
+/* Slot of the plan a time falls in, -1 outside it */
+int defer_planner_slot(const defer_planner_t* planner, time_t t) {
+    if (!planner || planner->start == 0 || t < planner->start) return -1;
+
+    long slot = (long)((t - planner->start) / DEFER_PLAN_STEP_S);
+    return slot < DEFER_PLAN_SLOTS ? (int)slot : -1;
+}
+
+/* Earliest deadline first, the larger load first on a tie */
+static int defer_job_compare(const defer_job_t* ja, const defer_job_t* jb) {
+    if (ja->deadline != jb->deadline) return ja->deadline < jb->deadline ? -1 : 1;
+    if (ja->power_w != jb->power_w) return ja->power_w > jb->power_w ? -1 : 1;
+    return ja->id - jb->id;
+}
+
+/* Insertion sort over indices: a handful of jobs, and their order is the caller's */
+static void defer_sort_jobs(defer_planner_t* planner) {
+    for (int k = 0; k < planner->count; k++) planner->order[k] = k;
+
+    for (int k = 1; k < planner->count; k++) {
+        int key = planner->order[k], pos = k;
+
+        while (pos > 0 && defer_job_compare(&planner->jobs[planner->order[pos - 1]], &planner->jobs[key]) > 0) {
+            planner->order[pos] = planner->order[pos - 1];
+            pos--;
+        }
+        planner->order[pos] = key;
+    }
+}
+
+/* Runs of one job against the surplus left by the jobs before it */
+static void defer_plan_job(defer_planner_t* planner, defer_job_t* job) {
+    const double step_h = DEFER_PLAN_STEP_S / 3600.0;
+    double slot_wh = job->power_w * step_h;
+    int horizon = job->deadline < DEFER_PLAN_SLOTS ? job->deadline : DEFER_PLAN_SLOTS;
+    int m = job->min_run < 1 ? 1 : job->min_run > DEFER_MAX_RUN_SLOTS ? DEFER_MAX_RUN_SLOTS : job->min_run;
+    int n = job->need_wh > 0.0 ? (int)ceil(job->need_wh / slot_wh - 1e-9) : 0;
+    int r0 = job->running < 0 ? 0 : job->running > m ? m : job->running;
+    int width = m + 1;
+
+    memset(job->on, 0, sizeof(job->on));
+    job->starts = 0;
+    job->surplus_wh = 0.0;
+    job->shortfall_wh = fmax(job->need_wh, 0.0);
+
+    if (horizon <= 0 || slot_wh <= 0.0) return;
+    if (n > horizon) n = horizon;
+
+    int states = (n + 1) * width;
+    double* cur = planner->cost;
+    double* next = planner->cost + DEFER_STATES;
+
+    for (int st = 0; st < states; st++) cur[st] = INFINITY;
+    cur[r0] = 0.0;
+
+    for (int s = 0; s < horizon; s++) {
+        uint8_t* choice = &planner->choice[(size_t)s * DEFER_STATES];
+        double surplus = fmax(planner->remaining_w[s], 0.0);
+        double on_cost = fmax(job->power_w - surplus, 0.0) * step_h + DEFER_SLOT_EPSILON_WH;
+        bool may_start = s >= job->earliest_start;
+
+        for (int st = 0; st < states; st++) next[st] = INFINITY;
+
+        for (int k = 0; k <= n; k++) {
+            int k_on = k < n ? k + 1 : n;
+            uint8_t capped = k == n ? DEFER_FROM_CAPPED : 0;
+
+            for (int r = 0; r <= m; r++) {
+                double c = cur[k * width + r];
+                if (!isfinite(c)) continue;
+
+                int to;
+                if (r == 0) {
+                    to = k * width;
+                    if (c < next[to]) { next[to] = c; choice[to] = DEFER_STAY_OFF; }
+
+                    if (may_start) {
+                        to = k_on * width + 1;
+                        if (c + on_cost + DEFER_START_PENALTY_WH < next[to]) {
+                            next[to] = c + on_cost + DEFER_START_PENALTY_WH;
+                            choice[to] = DEFER_START | capped;
+                        }
+                    }
+                    continue;
+                }
+
+                if (r == m) {
+                    to = k * width;
+                    if (c < next[to]) { next[to] = c; choice[to] = DEFER_STOP; }
+                }
+
+                to = k_on * width + (r < m ? r + 1 : m);
+                if (c + on_cost < next[to]) {
+                    next[to] = c + on_cost;
+                    choice[to] = DEFER_CONTINUE | capped | (r == m ? DEFER_FROM_FULL_RUN : 0);
+                }
+            }
+        }
+
+        double* swap = cur;
+        cur = next;
+        next = swap;
+    }
+
+    // Least cost at the deadline, undelivered energy and cut runs included
+    int best = -1;
+    double best_cost = INFINITY;
+
+    for (int k = 0; k <= n; k++) {
+        double shortfall = fmax(job->need_wh - k * slot_wh, 0.0);
+
+        for (int r = 0; r <= m; r++) {
+            double c = cur[k * width + r];
+            if (!isfinite(c)) continue;
+
+            c += DEFER_MISS_WEIGHT * shortfall + (r == 0 || r == m ? 0.0 : DEFER_INVALID_END);
+            if (c < best_cost) {
+                best_cost = c;
+                best = k * width + r;
+            }
+        }
+    }
+
+    if (best < 0) return;
+
+    int k = best / width;
+    job->shortfall_wh = fmax(job->need_wh - k * slot_wh, 0.0);
+
+    for (int s = horizon - 1, st = best; s >= 0; s--) {
+        uint8_t how = planner->choice[(size_t)s * DEFER_STATES + st];
+        int r = st % width;
+        int k_prev = st / width;
+
+        switch (how & DEFER_ACTION_MASK) {
+            case DEFER_STAY_OFF:
+                break;
+            case DEFER_STOP:
+                st = k_prev * width + m;
+                break;
+            case DEFER_START:
+                if (!(how & DEFER_FROM_CAPPED)) k_prev--;
+                st = k_prev * width;
+                job->on[s] = 1;
+                job->starts++;
+                break;
+            case DEFER_CONTINUE:
+                if (!(how & DEFER_FROM_CAPPED)) k_prev--;
+                st = k_prev * width + (r < m ? r - 1 : (how & DEFER_FROM_FULL_RUN) ? m : m - 1);
+                job->on[s] = 1;
+                break;
+        }
+    }
+
+    // Take the job's power off what is left for the next ones
+    for (int s = 0; s < horizon; s++) {
+        if (!job->on[s]) continue;
+
+        job->surplus_wh += fmin(fmax(planner->remaining_w[s], 0.0), job->power_w) * step_h;
+        planner->remaining_w[s] -= (float)job->power_w;
+    }
+}
+
+/* Plan every job from start on. surplus_w[s] is the forecast surplus (PV
+ * less the other loads) of slot s, DEFER_PLAN_SLOTS of them. */
+int defer_planner_solve(defer_planner_t* planner, time_t start, const float* surplus_w) {
+    if (!planner || !surplus_w) return -1;
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    planner->start = start;
+    memcpy(planner->remaining_w, surplus_w, sizeof(planner->remaining_w));
+
+    defer_sort_jobs(planner);
+    for (int k = 0; k < planner->count; k++) defer_plan_job(planner, &planner->jobs[planner->order[k]]);
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    planner->last_plan_s = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    planner->plans++;
+
+    return 0;
+}
@@ -0,0 +1,328 @@
+#include "dispatch.h"
+#include "clock.h"
+#include "logging.h"
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Variable offsets within a slot */
+enum {
+    DISPATCH_VAR_CHARGE = 0,
+    DISPATCH_VAR_DISCHARGE,
+    DISPATCH_VAR_IMPORT,
+    DISPATCH_VAR_EXPORT,
+    DISPATCH_VAR_DEFERRABLE,
+    DISPATCH_VAR_UNSERVED,
+    DISPATCH_VAR_ENERGY,
+    DISPATCH_VAR_SERVED
+};
+
+#define DISPATCH_VAR(t, v)  ((t) * DISPATCH_VARS_PER_SLOT + (v))
+
+int dispatch_solver_init(dispatch_solver_t* solver, int max_slots) {
+    if (!solver || max_slots <= 0 || max_slots > DISPATCH_MAX_SLOTS) return -1;
+
+    memset(solver, 0, sizeof(*solver));
+
+    int n = max_slots * DISPATCH_VARS_PER_SLOT;
+    int rows = max_slots * DISPATCH_ROWS_PER_SLOT;
+    int nnz = max_slots * (6 + 4 + 3 + DISPATCH_VARS_PER_SLOT);
+
+    if (qp_alloc(&solver->qp, n, rows, nnz, DISPATCH_BANDWIDTH) != 0) return -1;
+
+    solver->qp.eps_abs = DISPATCH_TOLERANCE;
+    solver->qp.eps_rel = DISPATCH_TOLERANCE;
+
+    solver->max_slots = max_slots;
+    return 0;
+}
+
+void dispatch_solver_free(dispatch_solver_t* solver) {
+    if (!solver) return;
+
+    qp_free(&solver->qp);
+    memset(solver, 0, sizeof(*solver));
+}
+
+/* Fill P, q and the rows for one input; all quantities in kW / kWh */
+static int dispatch_build(qp_t* qp, const dispatch_input_t* in) {
+    double tau = in->step_s / 3600.0;
+    double eta = DISPATCH_EFFICIENCY;
+    double e_now = in->energy_wh / 1000.0;
+    double e_max = fmax(in->max_energy_wh, in->energy_wh) / 1000.0;
+    double e_min = fmin(in->reserve_wh, in->energy_wh) / 1000.0;
+    double def_energy = in->deferrable_energy_wh / 1000.0;
+
+    // Deferrable energy is worth slightly more than the dearest import, so it
+    // always runs when supply allows, in the cheapest slots; stored energy
+    // left at the end is worth what it would save at the cheapest import
+    double max_import = 0.0, min_import = INFINITY;
+    for (int t = 0; t < in->slots; t++) {
+        max_import = fmax(max_import, in->import_price[t]);
+        min_import = fmin(min_import, in->import_price[t]);
+    }
+    double deferrable_value = max_import + 0.01;
+    double terminal_value = eta * min_import;
+
+    int n = qp->n;
+    memset(qp->q, 0, (size_t)n * sizeof(double));
+    memset(qp->p_diag, 0, (size_t)n * sizeof(double));
+    qp_clear_rows(qp);
+
+    for (int t = 0; t < in->slots; t++) {
+        double load = in->load_w[t] / 1000.0;
+        double pv = in->pv_w[t] > 0.0f ? in->pv_w[t] / 1000.0 : 0.0;
+
+        qp->q[DISPATCH_VAR(t, DISPATCH_VAR_CHARGE)] = tau * DISPATCH_WEAR_COST;
+        qp->q[DISPATCH_VAR(t, DISPATCH_VAR_DISCHARGE)] = tau * DISPATCH_WEAR_COST;
+        qp->q[DISPATCH_VAR(t, DISPATCH_VAR_IMPORT)] = tau * in->import_price[t];
+        qp->q[DISPATCH_VAR(t, DISPATCH_VAR_EXPORT)] = -tau * in->export_price[t];
+        qp->q[DISPATCH_VAR(t, DISPATCH_VAR_DEFERRABLE)] = -tau * deferrable_value;
+        qp->q[DISPATCH_VAR(t, DISPATCH_VAR_UNSERVED)] = tau * DISPATCH_UNSERVED_COST;
+        qp->p_diag[DISPATCH_VAR(t, DISPATCH_VAR_CHARGE)] = tau * DISPATCH_SMOOTHING;
+        qp->p_diag[DISPATCH_VAR(t, DISPATCH_VAR_DISCHARGE)] = tau * DISPATCH_SMOOTHING;
+        qp->p_diag[DISPATCH_VAR(t, DISPATCH_VAR_IMPORT)] = tau * DISPATCH_SMOOTHING;
+
+        // Power balance; supply may exceed demand by up to the PV output,
+        // which is then curtailed
+        int bc[6] = {
+            DISPATCH_VAR(t, DISPATCH_VAR_CHARGE), DISPATCH_VAR(t, DISPATCH_VAR_DISCHARGE),
+            DISPATCH_VAR(t, DISPATCH_VAR_IMPORT), DISPATCH_VAR(t, DISPATCH_VAR_EXPORT),
+            DISPATCH_VAR(t, DISPATCH_VAR_DEFERRABLE), DISPATCH_VAR(t, DISPATCH_VAR_UNSERVED)
+        };
+        double bv[6] = { -1.0, 1.0, 1.0, -1.0, -1.0, 1.0 };
+        if (qp_add_row(qp, bc, bv, 6, load - pv, load) != 0) return -1;
+
+        // Stored energy; slot 0 starts from the measured value
+        int ec[4] = {
+            DISPATCH_VAR(t, DISPATCH_VAR_CHARGE), DISPATCH_VAR(t, DISPATCH_VAR_DISCHARGE),
+            DISPATCH_VAR(t, DISPATCH_VAR_ENERGY), DISPATCH_VAR(t - 1, DISPATCH_VAR_ENERGY)
+        };
+        double ev[4] = { -tau * eta, tau / eta, 1.0, -1.0 };
+        int ecount = t > 0 ? 4 : 3;
+        double e_rhs = t > 0 ? 0.0 : e_now;
+        if (qp_add_row(qp, ec, ev, ecount, e_rhs, e_rhs) != 0) return -1;
+
+        // Deferrable energy served
+        int dc[3] = {
+            DISPATCH_VAR(t, DISPATCH_VAR_DEFERRABLE), DISPATCH_VAR(t, DISPATCH_VAR_SERVED),
+            DISPATCH_VAR(t - 1, DISPATCH_VAR_SERVED)
+        };
+        double dv[3] = { -tau, 1.0, -1.0 };
+        if (qp_add_row(qp, dc, dv, t > 0 ? 3 : 2, 0.0, 0.0) != 0) return -1;
+
+        // Bounds, one identity row per variable
+        double lower[DISPATCH_VARS_PER_SLOT] = { 0, 0, 0, 0, 0, 0, e_min, 0 };
+        double upper[DISPATCH_VARS_PER_SLOT] = {
+            [DISPATCH_VAR_CHARGE] = in->max_charge_w / 1000.0,
+            [DISPATCH_VAR_DISCHARGE] = in->max_discharge_w / 1000.0,
+            [DISPATCH_VAR_IMPORT] = in->import_limit_w / 1000.0,
+            [DISPATCH_VAR_EXPORT] = in->export_limit_w / 1000.0,
+            [DISPATCH_VAR_DEFERRABLE] = in->deferrable_power_w / 1000.0,
+            [DISPATCH_VAR_UNSERVED] = QP_INFINITY,
+            [DISPATCH_VAR_ENERGY] = e_max,
+            [DISPATCH_VAR_SERVED] = def_energy
+        };
+        double one = 1.0;
+        for (int v = 0; v < DISPATCH_VARS_PER_SLOT; v++) {
+            int c = DISPATCH_VAR(t, v);
+            if (qp_add_row(qp, &c, &one, 1, lower[v], fmax(upper[v], lower[v])) != 0) return -1;
+        }
+    }
+
+    qp->q[DISPATCH_VAR(in->slots - 1, DISPATCH_VAR_ENERGY)] = -terminal_value;
+    return 0;
+}
+
+/* Solve one horizon; warm-starts from the previous solve when the layout
+ * matches and the horizon has only moved forward by whole slots */
+int dispatch_solve(dispatch_solver_t* solver, const dispatch_input_t* input, dispatch_plan_t* plan) {
+    if (!solver || !input || !plan) return -1;
+    if (input->slots <= 0 || input->slots > solver->max_slots || input->step_s <= 0) return -1;
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    qp_t* qp = &solver->qp;
+    qp->n = input->slots * DISPATCH_VARS_PER_SLOT;
+
+    long moved = solver->slots ? (long)difftime(input->start, solver->start) / input->step_s : -1;
+
+    if (solver->slots != input->slots || solver->step_s != input->step_s ||
+        moved < 0 || moved >= input->slots || (input->start - solver->start) % input->step_s) {
+        qp_cold_start(qp);
+    } else if (moved > 0) {
+        qp_shift(qp, (int)moved * DISPATCH_VARS_PER_SLOT, (int)moved * DISPATCH_ROWS_PER_SLOT);
+    }
+
+    if (dispatch_build(qp, input) != 0) {
+        LOG_ERROR("Dispatch problem does not fit the solver layout");
+        solver->slots = 0;
+        return -1;
+    }
+
+    qp_status_t status = qp_solve(qp);
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    if (status == QP_NUMERICAL_ERROR || status == QP_INVALID) {
+        solver->slots = 0;
+        return -1;
+    }
+
+    solver->slots = input->slots;
+    solver->step_s = input->step_s;
+    solver->start = input->start;
+
+    plan->start = input->start;
+    plan->created = clock_now();
+    plan->step_s = input->step_s;
+    plan->slots = input->slots;
+    plan->status = status;
+    plan->iterations = qp->iterations;
+    plan->cost = qp->objective;
+    plan->solve_ms = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+
+    for (int t = 0; t < input->slots; t++) {
+        const double* x = &qp->x[DISPATCH_VAR(t, 0)];
+
+        plan->battery_w[t] = (float)((x[DISPATCH_VAR_DISCHARGE] - x[DISPATCH_VAR_CHARGE]) * 1000.0);
+        plan->grid_w[t] = (float)((x[DISPATCH_VAR_IMPORT] - x[DISPATCH_VAR_EXPORT]) * 1000.0);
+        plan->deferrable_w[t] = (float)(fmax(x[DISPATCH_VAR_DEFERRABLE], 0.0) * 1000.0);
+        double supply = x[DISPATCH_VAR_IMPORT] - x[DISPATCH_VAR_EXPORT] - x[DISPATCH_VAR_CHARGE] +
+                        x[DISPATCH_VAR_DISCHARGE] - x[DISPATCH_VAR_DEFERRABLE] + x[DISPATCH_VAR_UNSERVED];
+        double curtail = supply * 1000.0 - (input->load_w[t] - fmax(input->pv_w[t], 0.0f));
+        plan->curtail_w[t] = (float)(curtail > 0.0 ? curtail : 0.0);
+        plan->unserved_w[t] = (float)(fmax(x[DISPATCH_VAR_UNSERVED], 0.0) * 1000.0);
+        plan->soc[t] = input->capacity_wh > 0.0
+            ? (float)(x[DISPATCH_VAR_ENERGY] * 1000.0 / input->capacity_wh * 100.0) : 0.0f;
+    }
+
+    return 0;
+}
+
+static void* dispatch_worker(void* arg) {
+    dispatch_worker_t* worker = (dispatch_worker_t*)arg;
+
+    while (atomic_load(&worker->running)) {
+        if (sem_wait(&worker->wakeup) != 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (!atomic_load(&worker->running)) break;
+
+        pthread_mutex_lock(&worker->input_lock);
+        bool have = worker->pending_set;
+        if (have) memcpy(&worker->work, &worker->pending, sizeof(dispatch_input_t));
+        worker->pending_set = false;
+        pthread_mutex_unlock(&worker->input_lock);
+
+        if (!have) continue;
+
+        dispatch_plan_t* plan = malloc(sizeof(dispatch_plan_t));
+        if (!plan) {
+            atomic_fetch_add(&worker->fail_count, 1);
+            continue;
+        }
+
+        if (dispatch_solve(&worker->solver, &worker->work, plan) != 0) {
+            LOG_WARNING("Dispatch solve failed, keeping the previous plan");
+            atomic_fetch_add(&worker->fail_count, 1);
+            free(plan);
+            continue;
+        }
+
+        atomic_fetch_add(&worker->solve_count, 1);
+        atomic_store(&worker->last_iterations, (unsigned)plan->iterations);
+        atomic_store(&worker->last_solve_us, (unsigned)(plan->solve_ms * 1000.0));
+
+        if (plan->status != QP_SOLVED)
+            LOG_DEBUG("Dispatch stopped at %d iterations unconverged", plan->iterations);
+
+        free(atomic_exchange(&worker->published, plan));
+    }
+
+    return NULL;
+}
+
+int dispatch_start(dispatch_worker_t* worker) {
+    if (!worker) return -1;
+
+    memset(worker, 0, sizeof(dispatch_worker_t));
+
+    if (dispatch_solver_init(&worker->solver, DISPATCH_MAX_SLOTS) != 0) return -1;
+
+    atomic_init(&worker->running, true);
+    atomic_init(&worker->published, NULL);
+    atomic_init(&worker->solve_count, 0);
+    atomic_init(&worker->fail_count, 0);
+    atomic_init(&worker->last_iterations, 0);
+    atomic_init(&worker->last_solve_us, 0);
+
+    if (sem_init(&worker->wakeup, 0, 0) != 0) {
+        LOG_ERROR_ERRNO("Failed to create dispatch semaphore");
+        dispatch_solver_free(&worker->solver);
+        atomic_store(&worker->running, false);
+        return -1;
+    }
+
+    pthread_mutex_init(&worker->input_lock, NULL);
+
+    if (pthread_create(&worker->thread, NULL, dispatch_worker, worker) != 0) {
+        LOG_ERROR("Failed to start dispatch thread");
+        pthread_mutex_destroy(&worker->input_lock);
+        sem_destroy(&worker->wakeup);
+        dispatch_solver_free(&worker->solver);
+        atomic_store(&worker->running, false);
+        return -1;
+    }
+
+    return 0;
+}
+
+void dispatch_stop(dispatch_worker_t* worker) {
+    if (!worker || !atomic_exchange(&worker->running, false)) return;
+
+    sem_post(&worker->wakeup);
+    pthread_join(worker->thread, NULL);
+
+    free(atomic_exchange(&worker->published, NULL));
+    dispatch_solver_free(&worker->solver);
+
+    pthread_mutex_destroy(&worker->input_lock);
+    sem_destroy(&worker->wakeup);
+}
+
+/* Queue a problem (control thread). A newer submission replaces one the
+ * worker has not started on. */
+int dispatch_submit(dispatch_worker_t* worker, const dispatch_input_t* input) {
+    if (!worker || !input || !atomic_load(&worker->running)) return -1;
+
+    pthread_mutex_lock(&worker->input_lock);
+    memcpy(&worker->pending, input, sizeof(dispatch_input_t));
+    worker->pending_set = true;
+    pthread_mutex_unlock(&worker->input_lock);
+
+    sem_post(&worker->wakeup);
+    return 0;
+}
+
+/* Control thread: returns a newly published plan (caller frees) or NULL */
+dispatch_plan_t* dispatch_take(dispatch_worker_t* worker) {
+    if (!worker) return NULL;
+
+    if (!atomic_load_explicit(&worker->published, memory_order_relaxed)) return NULL;
+
+    return atomic_exchange(&worker->published, NULL);
+}
+
+/* Slot of the plan covering now, or -1 when the plan is stale or does not cover it */
+int dispatch_plan_slot(const dispatch_plan_t* plan, time_t now) {
+    if (!plan || plan->step_s <= 0 || now < plan->start) return -1;
+    if (difftime(now, plan->created) > DISPATCH_MAX_PLAN_AGE_S) return -1;
+
+    long slot = (long)((now - plan->start) / plan->step_s);
+    return slot < plan->slots ? (int)slot : -1;
+}
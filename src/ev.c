@@ -1,4 +1,6 @@
 #include "ev.h"
+#include "clock.h"
+#include "journal.h"
 #include <string.h>
 #include <time.h>
 #include <math.h>
@@ -17,11 +19,11 @@ int ev_init(ev_charging_system_t* ev, const system_config_t* config) {
     
     memset(ev, 0, sizeof(ev_charging_system_t));
     
-    ev->charger_count = config->ev_charger_count;
+    ev->charger_count = config->ev_charger_count < MAX_EV_CHARGERS ? config->ev_charger_count : MAX_EV_CHARGERS;
     ev->max_total_power = config->ev_charge_power_limit;
     
     // Copy charger config
-    for (int i = 0; i < config->ev_charger_count && i < MAX_EV_CHARGERS; i++) {
+    for (int i = 0; i < ev->charger_count; i++) {
         memcpy(&ev->chargers[i], &config->ev_chargers[i], sizeof(ev_charger_t));
         ev->charger_states[i] = EV_STATE_DISCONNECTED;
         ev->charge_modes[i] = EV_MODE_SMART;
@@ -46,7 +48,7 @@ int ev_init(ev_charging_system_t* ev, const system_config_t* config) {
     ev->allow_solar_charging = true;
     
     // Set preferred charging window (11 PM to 6 AM)
-    time_t now = time(NULL);
+    time_t now = clock_now();
     struct tm* tm_info = localtime(&now);
     tm_info->tm_hour = 23;
     tm_info->tm_min = 0;
@@ -62,6 +64,66 @@ int ev_init(ev_charging_system_t* ev, const system_config_t* config) {
     return 0;
 }
 
+/* Apply a reloaded charger table; chargers matched by id keep their session */
+int ev_apply_config(ev_charging_system_t* ev, const system_config_t* config) {
+    if (!ev || !config) return -1;
+
+    ev_charger_t chargers[MAX_EV_CHARGERS];
+    ev_state_t states[MAX_EV_CHARGERS];
+    ev_charge_mode_t modes[MAX_EV_CHARGERS];
+    time_t departure[MAX_EV_CHARGERS];
+    int count = config->ev_charger_count < MAX_EV_CHARGERS ? config->ev_charger_count : MAX_EV_CHARGERS;
+    // Chargers removed from the config end their session here
+    for (int j = 0; j < ev->charger_count; j++) {
+        bool present = false;
+
+        for (int i = 0; i < count && !present; i++)
+            present = strcmp(ev->chargers[j].ev_id, config->ev_chargers[i].ev_id) == 0;
+
+        if (!present && ev->charger_states[j] == EV_STATE_CHARGING)
+            journal_append(JOURNAL_EVENT_EV_SESSION_PAUSE, (uint16_t)j, 0.0, ev->chargers[j].ev_id);
+    }
+
+    for (int i = 0; i < count; i++) {
+        memcpy(&chargers[i], &config->ev_chargers[i], sizeof(ev_charger_t));
+        states[i] = EV_STATE_DISCONNECTED;
+        modes[i] = EV_MODE_SMART;
+        departure[i] = 0;
+
+        if (chargers[i].max_charge_rate == 0) {
+            chargers[i].max_charge_rate = 7000.0;  // 7kW default
+        }
+        if (chargers[i].min_charge_rate == 0) {
+            chargers[i].min_charge_rate = 1500.0;  // 1.5kW default
+        }
+        if (chargers[i].target_soc == 0) {
+            chargers[i].target_soc = 80.0;  // 80% default target
+        }
+
+        for (int j = 0; j < ev->charger_count; j++) {
+            if (strcmp(ev->chargers[j].ev_id, chargers[i].ev_id) != 0) continue;
+
+            states[i] = ev->charger_states[j];
+            modes[i] = ev->charge_modes[j];
+            departure[i] = ev->departure_time[j];
+            chargers[i].current_soc = ev->chargers[j].current_soc;
+            chargers[i].charging_enabled = ev->chargers[j].charging_enabled;
+            chargers[i].fast_charge_requested = ev->chargers[j].fast_charge_requested;
+            chargers[i].charge_start_time = ev->chargers[j].charge_start_time;
+            break;
+        }
+    }
+
+    memcpy(ev->chargers, chargers, count * sizeof(ev_charger_t));
+    memcpy(ev->charger_states, states, count * sizeof(ev_state_t));
+    memcpy(ev->charge_modes, modes, count * sizeof(ev_charge_mode_t));
+    memcpy(ev->departure_time, departure, count * sizeof(time_t));
+    ev->charger_count = count;
+    ev->max_total_power = config->ev_charge_power_limit;
+
+    return 0;
+}
+
 void ev_update_measurements(ev_charging_system_t* ev, system_measurements_t* measurements) {
     if (!ev || !measurements) return;
     
@@ -90,6 +152,8 @@ void ev_update_measurements(ev_charging_system_t* ev, system_measurements_t* mea
             if (ev_check_charging_complete(ev, i)) {
                 ev->charger_states[i] = EV_STATE_COMPLETE;
                 ev->chargers[i].charging_enabled = false;
+                journal_append(JOURNAL_EVENT_EV_SESSION_COMPLETE, (uint16_t)i,
+                               ev->chargers[i].current_soc, ev->chargers[i].ev_id);
             }
         }
     }
@@ -98,12 +162,27 @@ void ev_update_measurements(ev_charging_system_t* ev, system_measurements_t* mea
     ev->current_total_power = total_ev_power;
 }
 
+/* Will forecast PV cover the rest of this session before departure? With no
+ * forecast, assume it will (wait for surplus, as before). */
+static bool ev_solar_covers_session(const ev_charging_system_t* ev, int charger_index, time_t now) {
+    if (!ev->pv_forecast) return true;
+
+    const ev_charger_t* charger = &ev->chargers[charger_index];
+    double needed_wh = (charger->target_soc - charger->current_soc) / 100.0 * EV_DEFAULT_BATTERY_WH;
+    if (needed_wh <= 0.0) return true;
+
+    time_t departure = ev->departure_time[charger_index] > now ? ev->departure_time[charger_index]
+                                                               : now + EV_DEFAULT_DWELL_S;
+
+    return pv_forecast_energy(ev->pv_forecast, now, departure) * EV_FORECAST_PV_SHARE >= needed_wh;
+}
+
 bool ev_manage_charging(ev_charging_system_t* ev, double available_power, 
                        double battery_soc, bool grid_available) {
     if (!ev) return false;
     
     bool charging_changed = false;
-    time_t now = time(NULL);
+    time_t now = clock_now();
     
     /* Check for faults first */
     if (ev_check_faults(ev)) {
@@ -131,6 +210,8 @@ bool ev_manage_charging(ev_charging_system_t* ev, double available_power,
                 ev->charger_states[i] = EV_STATE_COMPLETE;
                 charger->charging_enabled = false;
                 charging_changed = true;
+                journal_append(JOURNAL_EVENT_EV_SESSION_COMPLETE, (uint16_t)i,
+                               charger->current_soc, charger->ev_id);
             }
             continue;
         }
@@ -181,9 +262,16 @@ bool ev_manage_charging(ev_charging_system_t* ev, double available_power,
                 continue;
             }
             
-            /* Check available power */
-            if (optimal_rate > available_power * 0.8) {  /* Use 80% of available */
-                optimal_rate = available_power * 0.8;
+            /* Check available power; top up from the grid only when the
+             * forecast will not cover the session before departure */
+            double solar_rate = available_power * 0.8;  /* Use 80% of available */
+            if (optimal_rate > solar_rate) {
+                if (grid_available && ev->allow_grid_charging && !ev_solar_covers_session(ev, i, now)) {
+                    if (optimal_rate > solar_rate + ev->grid_power_limit)
+                        optimal_rate = solar_rate + ev->grid_power_limit;
+                } else {
+                    optimal_rate = solar_rate;
+                }
             }
             
             /* Check if we should charge now or defer */
@@ -204,6 +292,10 @@ bool ev_manage_charging(ev_charging_system_t* ev, double available_power,
                 charger->charging_enabled = true;
                 charger->charge_start_time = now;
                 charging_changed = true;
+                ev->charge_session_count++;
+                ev->last_charge_session = now;
+                journal_append(JOURNAL_EVENT_EV_SESSION_START, (uint16_t)i,
+                               optimal_rate, charger->ev_id);
             }
             
             ev_set_charge_rate(ev, i, optimal_rate);
@@ -237,6 +329,11 @@ void ev_pause_charging(ev_charging_system_t* ev, int charger_index) {
         return;
     }
     
+    if (ev->charger_states[charger_index] == EV_STATE_CHARGING) {
+        journal_append(JOURNAL_EVENT_EV_SESSION_PAUSE, (uint16_t)charger_index,
+                       ev->chargers[charger_index].current_soc, ev->chargers[charger_index].ev_id);
+    }
+    
     ev->charger_states[charger_index] = EV_STATE_PAUSED;
     ev->chargers[charger_index].charging_enabled = false;
 }
@@ -273,7 +370,7 @@ bool ev_check_faults(ev_charging_system_t* ev) {
     
     /* Check for communication faults */
     static time_t last_communication[MAX_EV_CHARGERS] = {0};
-    time_t now = time(NULL);
+    time_t now = clock_now();
     
     for (int i = 0; i < ev->charger_count; i++) {
         if (ev->charger_states[i] != EV_STATE_DISCONNECTED) {
@@ -283,6 +380,9 @@ bool ev_check_faults(ev_charging_system_t* ev) {
                 strncpy(ev->last_fault_reason, "Communication timeout", 
                         sizeof(ev->last_fault_reason) - 1);
                 fault_detected = true;
+                if (ev->charger_states[i] != EV_STATE_FAULT) {
+                    journal_append(JOURNAL_EVENT_EV_FAULT, (uint16_t)i, 0.0, ev->chargers[i].ev_id);
+                }
                 ev->charger_states[i] = EV_STATE_FAULT;
             }
             last_communication[i] = now;
@@ -361,7 +461,7 @@ double ev_calculate_optimal_rate(ev_charging_system_t* ev, int charger_index,
     }
 
     ev_charger_t* charger = &ev->chargers[charger_index];
-    time_t now = time(NULL);
+    time_t now = clock_now();
 
     double hours_until_departure = 8.0;  // Default
     if (ev->departure_time[charger_index] > now) {
@@ -369,7 +469,7 @@ double ev_calculate_optimal_rate(ev_charging_system_t* ev, int charger_index,
     }
     if (hours_until_departure <= 0) return 0;
 
-    double battery_capacity = 75000.0;  // Wh
+    double battery_capacity = EV_DEFAULT_BATTERY_WH;
     double energy_needed = (charger->target_soc - battery_soc) / 100.0 * battery_capacity;
 
     double required_rate = energy_needed / hours_until_departure;  // W
@@ -1,4 +1,9 @@
-/* Integration layer: ems_hal_integration.c */
+/* Integration layer: ems_hal_integration.c
+ *
+ * Not built: HAL_SRCS is commented out in the Makefile and this file does
+ * not compile against the current HAL headers (the device context is private
+ * to hal.c). The per-cell, per-bank and per-string feeds below are therefore
+ * untested; the twin (twin.c) is what exercises the same ingest calls. */
 
 #include "controller.h"
 #include "hal.h"
@@ -17,14 +22,29 @@ static void convert_pv_measurements(uint32_t inverter_id,
     }
 }
 
+/* One HAL battery device per bank; pack values are accumulated across banks
+ * (the caller clears them first). HAL current is positive on discharge, the
+ * EMS counts charging current as positive. Untested: twin_read_batteries()
+ * is the built equivalent, see the note at the top. */
 static void convert_battery_measurements(uint32_t battery_id,
                                         battery_measurement_t* hal_meas,
                                         system_measurements_t* ems_meas) {
-    ems_meas->battery_power = hal_meas->power;
+    double current = -hal_meas->current;
+    
+    ems_meas->battery_power += hal_meas->power;
+    ems_meas->battery_current += current;
     ems_meas->battery_voltage = hal_meas->voltage;
-    ems_meas->battery_current = hal_meas->current;
     ems_meas->battery_soc = hal_meas->soc;
-    ems_meas->battery_temp = hal_meas->temperature;
+    if (hal_meas->temperature > ems_meas->battery_temp)
+        ems_meas->battery_temp = hal_meas->temperature;
+    
+    if (battery_id < MAX_BATTERY_BANKS) {
+        ems_meas->battery_bank_voltage[battery_id] = hal_meas->voltage;
+        ems_meas->battery_bank_current[battery_id] = current;
+        ems_meas->battery_bank_temp[battery_id] = hal_meas->temperature;
+        if (battery_id + 1 > ems_meas->battery_bank_count)
+            ems_meas->battery_bank_count = (uint8_t)(battery_id + 1);
+    }
 }
 
 static void convert_meter_measurements(uint32_t meter_id,
@@ -42,6 +62,65 @@ static void convert_meter_measurements(uint32_t meter_id,
     }
 }
 
+/* Transpose the inverter's string records into the PV string telemetry.
+ * Mirrors twin_read_pv(); untested here, see the note at the top. */
+static void update_pv_strings(uint32_t inverter_id, const pv_inverter_measurement_t* hal_meas,
+                              pv_string_telemetry_t* telemetry) {
+    float voltage[8];
+    float current[8];
+    uint8_t count = hal_meas->string_count;
+
+    if (inverter_id >= PV_MAX_STRING_GROUPS) return;
+    if (count > 8) count = 8;
+
+    for (uint8_t i = 0; i < count; i++) {
+        voltage[i] = hal_meas->strings[i].voltage;
+        current[i] = hal_meas->strings[i].current;
+    }
+
+    pv_strings_ingest(telemetry, (int)inverter_id, voltage, current, count, hal_meas->timestamp);
+}
+
+/* Per-inverter MPPT threads, started once the HAL has enumerated the inverters */
+static pv_mppt_worker_t mppt_worker;
+
+/* MPPT worker read hook: one inverter's DC side, called from the worker threads */
+static int mppt_read_inverter(void* ctx, int inverter, double* dc_voltage, double* dc_power) {
+    pv_inverter_measurement_t pv_meas;
+    (void)ctx;
+
+    if (hal_pv_get_measurements((uint32_t)inverter, &pv_meas) != HAL_SUCCESS) return -1;
+
+    *dc_voltage = pv_meas.dc_voltage;
+    *dc_power = pv_meas.dc_power;
+    return 0;
+}
+
+/* Transpose BMS cell records into the battery module's per-bank arrays.
+ * Mirrors twin_read_batteries(); untested here, see the note at the top. */
+static void update_battery_cells(uint32_t battery_id, battery_cells_t* cells) {
+    static battery_cell_t hal_cells[BATTERY_CELLS_MAX_PER_BANK];
+    static float voltage[BATTERY_CELLS_MAX_PER_BANK];
+    static float temperature[BATTERY_CELLS_MAX_PER_BANK];
+    uint16_t count = BATTERY_CELLS_MAX_PER_BANK;
+
+    if (battery_id >= MAX_BATTERY_BANKS) return;
+
+    if (hal_battery_get_cell_info(battery_id, hal_cells, &count) != HAL_SUCCESS) {
+        battery_cells_clear(cells, (int)battery_id);
+        return;
+    }
+
+    if (count > BATTERY_CELLS_MAX_PER_BANK) count = BATTERY_CELLS_MAX_PER_BANK;
+
+    for (uint16_t i = 0; i < count; i++) {
+        voltage[i] = hal_cells[i].voltage;
+        temperature[i] = hal_cells[i].temperature;
+    }
+
+    battery_cells_ingest(cells, (int)battery_id, voltage, temperature, count, time(NULL));
+}
+
 /* HAL measurement callback - called by HAL when new measurements arrive */
 static void hal_measurement_callback(uint32_t device_id, measurement_t* measurement) {
     /* Determine device type and update EMS measurements */
@@ -94,6 +173,27 @@ int ems_hal_integration_init(void) {
     return 0;
 }
 
+/* Start one MPPT thread per inverter and hand tracking to them. The HAL has
+ * no DC voltage setpoint, so inverters keep their internal tracker and the
+ * workers sample the operating point at the tracking rate. */
+int ems_hal_mppt_start(system_controller_t* controller) {
+    if (!controller) return -1;
+
+    uint32_t count = g_hal_context.devices.inverter_count;
+    if (count == 0) return 0;
+    if (count > PV_MAX_STRING_GROUPS) count = PV_MAX_STRING_GROUPS;
+
+    pv_mppt_io_t io = { .read = mppt_read_inverter, .set_voltage = NULL, .ctx = NULL };
+
+    if (pv_mppt_start(&mppt_worker, (int)count, controller->config.pv_mppt_rate_hz,
+                      controller->pv_system.mppt_algorithm,
+                      controller->pv_system.strings[0].max_voltage, &io) != 0)
+        return -1;
+
+    pv_attach_mppt(&controller->pv_system, &mppt_worker);
+    return 0;
+}
+
 /* Update EMS controller with hardware measurements */
 void ems_hal_update_measurements(system_controller_t* controller) {
     if (!controller) return;
@@ -103,15 +203,23 @@ void ems_hal_update_measurements(system_controller_t* controller) {
         pv_inverter_measurement_t pv_meas;
         if (hal_pv_get_measurements(i, &pv_meas) == HAL_SUCCESS) {
             convert_pv_measurements(i, &pv_meas, &controller->measurements);
+            update_pv_strings(i, &pv_meas, &controller->pv_system.telemetry);
+        } else {
+            pv_strings_clear(&controller->pv_system.telemetry, (int)i);
         }
     }
     
     /* Get battery measurements */
+    controller->measurements.battery_power = 0.0;
+    controller->measurements.battery_current = 0.0;
+    controller->measurements.battery_temp = -273.15;
+    controller->measurements.battery_bank_count = 0;
     for (uint32_t i = 0; i < g_hal_context.devices.battery_count; i++) {
         battery_measurement_t battery_meas;
         if (hal_battery_get_measurements(i, &battery_meas) == HAL_SUCCESS) {
             convert_battery_measurements(i, &battery_meas, &controller->measurements);
         }
+        update_battery_cells(i, &controller->battery_system.cells);
     }
     
     /* Get meter measurements */
@@ -129,25 +237,26 @@ void ems_hal_update_measurements(system_controller_t* controller) {
 void ems_hal_execute_commands(system_controller_t* controller) {
     if (!controller) return;
     
-    /* Execute battery commands */
-    if (fabs(controller->commands.battery_setpoint) > 0.1) {
+    /* Execute battery commands: each bank gets its dispatched share
+     * (untested here; twin_send_commands() does the same in the twin) */
+    for (uint32_t i = 0; i < g_hal_context.devices.battery_count && i < MAX_BATTERY_BANKS; i++) {
+        double setpoint = controller->commands.battery_bank_setpoint[i];
+        double voltage = controller->battery_system.bank_state[i].voltage;
         battery_command_t bat_cmd = {0};
         
-        if (controller->commands.battery_setpoint > 0) {
+        if (fabs(setpoint) <= 0.1 || voltage <= 0.0) continue;
+        
+        if (setpoint > 0) {
             /* Discharge battery */
             bat_cmd.enable_discharge = true;
-            bat_cmd.discharge_current = controller->commands.battery_setpoint / 
-                                      controller->measurements.battery_voltage;
+            bat_cmd.discharge_current = setpoint / voltage;
         } else {
             /* Charge battery */
             bat_cmd.enable_charge = true;
-            bat_cmd.charge_current = -controller->commands.battery_setpoint / 
-                                   controller->measurements.battery_voltage;
+            bat_cmd.charge_current = -setpoint / voltage;
         }
         
-        for (uint32_t i = 0; i < g_hal_context.devices.battery_count; i++) {
-            hal_battery_send_command(i, &bat_cmd);
-        }
+        hal_battery_send_command(i, &bat_cmd);
     }
     
     /* Execute PV curtailment */
@@ -161,15 +270,16 @@ void ems_hal_execute_commands(system_controller_t* controller) {
     }
     
     /* Execute load shedding commands */
-    for (uint8_t i = 0; i < MAX_CONTROLLABLE_LOADS; i++) {
+    for (int i = 0; i < controller->load_manager.load_count && i <= UINT8_MAX; i++) {
         if (controller->commands.load_shed[i]) {
             /* Turn off load */
-            hal_relay_set_state(0, i, RELAY_STATE_OFF);
+            hal_relay_set_state(0, (uint8_t)i, RELAY_STATE_OFF);
         }
     }
 }
 
 /* Shutdown EMS-HAL integration */
 void ems_hal_integration_shutdown(void) {
+    pv_mppt_stop(&mppt_worker);
     hal_shutdown();
 }
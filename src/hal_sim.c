@@ -0,0 +1,679 @@
+#include "hal_sim.h"
+#include "hal_pv.h"
+#include "hal_battery.h"
+#include "hal_meter.h"
+#include "hal_relay.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Status bits reported by the simulated devices */
+#define HAL_SIM_STATUS_THROTTLED    (1u << 0)
+#define HAL_SIM_STATUS_CHARGE_OFF   (1u << 1)
+#define HAL_SIM_STATUS_DISCHARGE_OFF (1u << 2)
+#define HAL_SIM_STATUS_GRID_DOWN    (1u << 3)
+
+/* Simulated backend context */
+typedef struct {
+    plant_t* plant;
+
+    /* Devices handed out by the init calls */
+    uint32_t inverters_claimed;
+    uint32_t batteries_claimed;
+    uint32_t meters_claimed;
+    uint32_t relay_modules_claimed;
+
+    /* Counters the twin does not keep */
+    pv_inverter_stats_t pv_stats[PLANT_MAX_INVERTERS];
+    battery_stats_t battery_stats[MAX_BATTERY_BANKS];
+    meter_config_t meter_config[HAL_SIM_METER_COUNT];
+    double meter_import_base[HAL_SIM_METER_COUNT];     // Wh at the last energy reset
+    double meter_export_base[HAL_SIM_METER_COUNT];
+    double load_energy_wh;
+    double load_energy_t;
+    relay_module_stats_t relay_stats[HAL_SIM_MAX_RELAY_MODULES];
+    time_t last_reset;
+} hal_sim_context_t;
+
+static hal_sim_context_t g_sim = {0};
+
+static time_t hal_sim_time(void) {
+    return (time_t)g_sim.plant->t;
+}
+
+static void hal_sim_device_info(device_info_t* info, const char* model, uint32_t id) {
+    memset(info, 0, sizeof(*info));
+    snprintf(info->manufacturer, sizeof(info->manufacturer), "Solarize");
+    snprintf(info->model, sizeof(info->model), "%s", model);
+    snprintf(info->serial_number, sizeof(info->serial_number), "SIM-%s-%u", model, id);
+    snprintf(info->firmware_version, sizeof(info->firmware_version), "twin");
+    info->device_id = id;
+    info->last_communication = hal_sim_time();
+    info->state = DEVICE_STATE_ACTIVE;
+}
+
+/* Route the HAL device calls to a plant twin */
+hal_error_t hal_sim_attach(plant_t* plant) {
+    if (!plant) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    memset(&g_sim, 0, sizeof(g_sim));
+    g_sim.plant = plant;
+    g_sim.last_reset = (time_t)plant->t;
+    g_sim.load_energy_t = plant->t;
+
+    g_sim.meter_config[HAL_SIM_METER_GRID].measurement_type = METER_MEASUREMENT_GRID;
+    g_sim.meter_config[HAL_SIM_METER_LOAD].measurement_type = METER_MEASUREMENT_LOAD;
+    for (int m = 0; m < HAL_SIM_METER_COUNT; m++) {
+        g_sim.meter_config[m].meter_type = METER_GENERIC;
+        g_sim.meter_config[m].device_id = (uint32_t)m;
+        g_sim.meter_config[m].phase_count = 1;
+        g_sim.meter_config[m].rated_voltage = PLANT_GRID_VOLTAGE;
+        g_sim.meter_config[m].ct_ratio = 1.0f;
+        g_sim.meter_config[m].pt_ratio = 1.0f;
+    }
+
+    return HAL_SUCCESS;
+}
+
+void hal_sim_detach(void) {
+    g_sim.plant = NULL;
+}
+
+uint32_t hal_sim_inverter_count(void) {
+    return g_sim.plant ? (uint32_t)g_sim.plant->inverter_count : 0;
+}
+
+uint32_t hal_sim_battery_count(void) {
+    return g_sim.plant ? (uint32_t)g_sim.plant->bank_count : 0;
+}
+
+static plant_inverter_t* hal_sim_inverter(uint32_t id) {
+    if (!g_sim.plant || id >= (uint32_t)g_sim.plant->inverter_count) return NULL;
+    return &g_sim.plant->inverters[id];
+}
+
+static plant_bank_t* hal_sim_bank(uint32_t id) {
+    if (!g_sim.plant || id >= (uint32_t)g_sim.plant->bank_count) return NULL;
+    return &g_sim.plant->banks[id];
+}
+
+/* PV inverters */
+
+hal_error_t hal_pv_init_inverter(const pv_inverter_config_t* config, uint32_t* inverter_id) {
+    if (!config || !inverter_id) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    if (!hal_sim_inverter(g_sim.inverters_claimed)) {
+        return HAL_ERROR_INIT_FAILED;
+    }
+
+    *inverter_id = g_sim.inverters_claimed++;
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_pv_get_measurements(uint32_t inverter_id, pv_inverter_measurement_t* measurements) {
+    const plant_inverter_t* inv = hal_sim_inverter(inverter_id);
+    if (!inv || !measurements) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    memset(measurements, 0, sizeof(*measurements));
+    measurements->dc_voltage = (float)inv->dc_voltage;
+    measurements->dc_current = (float)inv->dc_current;
+    measurements->dc_power = (float)inv->dc_power;
+    measurements->ac_voltage = g_sim.plant->grid.available ? (float)g_sim.plant->grid.voltage : (float)PLANT_GRID_VOLTAGE;
+    measurements->ac_power = (float)inv->ac_power;
+    measurements->ac_current = measurements->ac_voltage > 0.0f ? measurements->ac_power / measurements->ac_voltage : 0.0f;
+    measurements->ac_frequency = g_sim.plant->grid.available ? (float)g_sim.plant->grid.frequency : (float)PLANT_GRID_FREQUENCY;
+    measurements->efficiency = inv->dc_power > 0.0 ? (float)(100.0 * inv->ac_power / inv->dc_power) : 0.0f;
+    measurements->temperature = (float)inv->temperature_c;
+    measurements->timestamp = hal_sim_time();
+
+    if (!inv->enabled) measurements->mode = PV_MODE_OFF;
+    else if (inv->ac_power <= 0.0) measurements->mode = PV_MODE_STANDBY;
+    else if (inv->limit_percent < 100.0) measurements->mode = PV_MODE_THROTTLED;
+    else measurements->mode = PV_MODE_MPPT;
+    if (inv->limit_percent < 100.0) measurements->status |= HAL_SIM_STATUS_THROTTLED;
+
+    int count = inv->string_count < PLANT_STRINGS_REPORTED ? inv->string_count : PLANT_STRINGS_REPORTED;
+    for (int s = 0; s < count; s++) {
+        measurements->strings[s].voltage = inv->string_voltage[s];
+        measurements->strings[s].current = inv->string_current[s];
+        measurements->strings[s].power = inv->string_power[s];
+        measurements->strings[s].temperature = (float)inv->temperature_c;
+    }
+    measurements->string_count = (uint8_t)count;
+
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_pv_get_status(uint32_t inverter_id, device_info_t* info) {
+    if (!hal_sim_inverter(inverter_id) || !info) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    hal_sim_device_info(info, "PV", inverter_id);
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_pv_get_statistics(uint32_t inverter_id, pv_inverter_stats_t* stats) {
+    const plant_inverter_t* inv = hal_sim_inverter(inverter_id);
+    if (!inv || !stats) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    pv_inverter_stats_t* base = &g_sim.pv_stats[inverter_id];
+    memcpy(stats, base, sizeof(*stats));
+    stats->total_energy = (float)(inv->energy_wh / 1000.0) - base->total_energy;
+    stats->daily_energy = (float)(inv->daily_wh / 1000.0);
+    stats->start_count = inv->start_count - base->start_count;
+    stats->last_reset = g_sim.last_reset;
+
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_pv_send_command(uint32_t inverter_id, const pv_inverter_command_t* command) {
+    plant_inverter_t* inv = hal_sim_inverter(inverter_id);
+    if (!inv || !command) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    inv->limit_percent = fmin(fmax(command->power_limit, 0.0), 100.0);
+    inv->enabled = command->enable_output;
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_pv_set_power_limit(uint32_t inverter_id, float limit_percent) {
+    plant_inverter_t* inv = hal_sim_inverter(inverter_id);
+    if (!inv || limit_percent < 0.0f || limit_percent > 100.0f) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    inv->limit_percent = limit_percent;
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_pv_set_enabled(uint32_t inverter_id, bool enabled) {
+    plant_inverter_t* inv = hal_sim_inverter(inverter_id);
+    if (!inv) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    inv->enabled = enabled;
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_pv_clear_errors(uint32_t inverter_id) {
+    return hal_sim_inverter(inverter_id) ? HAL_SUCCESS : HAL_ERROR_INVALID_PARAM;
+}
+
+hal_error_t hal_pv_reset_statistics(uint32_t inverter_id) {
+    const plant_inverter_t* inv = hal_sim_inverter(inverter_id);
+    if (!inv) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    pv_inverter_stats_t* base = &g_sim.pv_stats[inverter_id];
+    memset(base, 0, sizeof(*base));
+    base->total_energy = (float)(inv->energy_wh / 1000.0);
+    base->start_count = inv->start_count;
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_pv_scan_inverters(uint32_t* count, uint32_t* inverter_ids) {
+    if (!count) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    *count = hal_sim_inverter_count();
+    for (uint32_t i = 0; inverter_ids && i < *count; i++) inverter_ids[i] = i;
+    return HAL_SUCCESS;
+}
+
+/* Batteries: HAL current is positive on discharge, the twin's on charge */
+
+hal_error_t hal_battery_init(const battery_config_t* config, uint32_t* battery_id) {
+    if (!config || !battery_id) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    if (!hal_sim_bank(g_sim.batteries_claimed)) {
+        return HAL_ERROR_INIT_FAILED;
+    }
+
+    *battery_id = g_sim.batteries_claimed++;
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_battery_get_measurements(uint32_t battery_id, battery_measurement_t* measurements) {
+    const plant_bank_t* pb = hal_sim_bank(battery_id);
+    if (!pb || !measurements) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    memset(measurements, 0, sizeof(*measurements));
+    measurements->voltage = (float)pb->voltage;
+    measurements->current = (float)-pb->current_a;
+    measurements->power = (float)(-pb->current_a * pb->voltage);
+    measurements->soh = 100.0f;
+    measurements->temperature = (float)pb->temperature_c;
+    measurements->timestamp = hal_sim_time();
+
+    if (pb->series > 0) {
+        double soc = 0.0;
+        float v_max = pb->cell_voltage[0], v_min = pb->cell_voltage[0];
+        float t_max = pb->temperature[0], t_min = pb->temperature[0];
+
+        for (int c = 0; c < pb->series; c++) {
+            soc += pb->soc[c];
+            v_max = fmaxf(v_max, pb->cell_voltage[c]);
+            v_min = fminf(v_min, pb->cell_voltage[c]);
+            t_max = fmaxf(t_max, pb->temperature[c]);
+            t_min = fminf(t_min, pb->temperature[c]);
+        }
+        measurements->soc = (float)(100.0 * soc / pb->series);
+        measurements->cell_voltage_max = v_max;
+        measurements->cell_voltage_min = v_min;
+        measurements->cell_temp_max = t_max;
+        measurements->cell_temp_min = t_min;
+    }
+
+    if (!pb->charge_enabled) measurements->status |= HAL_SIM_STATUS_CHARGE_OFF;
+    if (!pb->discharge_enabled) measurements->status |= HAL_SIM_STATUS_DISCHARGE_OFF;
+
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_battery_get_cell_info(uint32_t battery_id, battery_cell_t* cells, uint16_t* count) {
+    const plant_bank_t* pb = hal_sim_bank(battery_id);
+    if (!pb || !cells || !count) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    uint16_t n = pb->series < *count ? (uint16_t)pb->series : *count;
+    for (uint16_t c = 0; c < n; c++) {
+        cells[c].voltage = pb->cell_voltage[c];
+        cells[c].temperature = pb->temperature[c];
+        cells[c].balance_status = 0;
+    }
+    *count = n;
+
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_battery_get_status(uint32_t battery_id, device_info_t* info) {
+    if (!hal_sim_bank(battery_id) || !info) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    hal_sim_device_info(info, "BMS", battery_id);
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_battery_get_statistics(uint32_t battery_id, battery_stats_t* stats) {
+    const plant_bank_t* pb = hal_sim_bank(battery_id);
+    if (!pb || !stats) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    const battery_stats_t* base = &g_sim.battery_stats[battery_id];
+    memset(stats, 0, sizeof(*stats));
+    stats->total_charge_energy = (float)(pb->charge_wh / 1000.0) - base->total_charge_energy;
+    stats->total_discharge_energy = (float)(pb->discharge_wh / 1000.0) - base->total_discharge_energy;
+
+    double rated_kwh = pb->capacity_ah * pb->voltage / 1000.0;
+    stats->cycle_count = rated_kwh > 0.0 ? (uint32_t)(stats->total_discharge_energy / rated_kwh) : 0;
+    stats->last_full_charge = pb->last_full_charge;
+
+    return HAL_SUCCESS;
+}
+
+/* A discharge request wins over a charge request in the same command */
+hal_error_t hal_battery_send_command(uint32_t battery_id, const battery_command_t* command) {
+    plant_bank_t* pb = hal_sim_bank(battery_id);
+    if (!pb || !command) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    pb->charge_enabled = command->enable_charge;
+    pb->discharge_enabled = command->enable_discharge;
+
+    if (command->enable_discharge && command->discharge_current > 0.0f)
+        pb->command_a = -command->discharge_current;
+    else if (command->enable_charge && command->charge_current > 0.0f)
+        pb->command_a = command->charge_current;
+    else
+        pb->command_a = 0.0;
+
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_battery_set_charge_current(uint32_t battery_id, float current) {
+    plant_bank_t* pb = hal_sim_bank(battery_id);
+    if (!pb || current < 0.0f) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    pb->charge_limit_a = fmin(current, pb->max_charge_a);
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_battery_set_discharge_current(uint32_t battery_id, float current) {
+    plant_bank_t* pb = hal_sim_bank(battery_id);
+    if (!pb || current < 0.0f) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    pb->discharge_limit_a = fmin(current, pb->max_discharge_a);
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_battery_set_enabled(uint32_t battery_id, bool enabled) {
+    plant_bank_t* pb = hal_sim_bank(battery_id);
+    if (!pb) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    pb->enabled = enabled;
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_battery_clear_errors(uint32_t battery_id) {
+    return hal_sim_bank(battery_id) ? HAL_SUCCESS : HAL_ERROR_INVALID_PARAM;
+}
+
+hal_error_t hal_battery_reset_statistics(uint32_t battery_id) {
+    const plant_bank_t* pb = hal_sim_bank(battery_id);
+    if (!pb) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    battery_stats_t* base = &g_sim.battery_stats[battery_id];
+    memset(base, 0, sizeof(*base));
+    base->total_charge_energy = (float)(pb->charge_wh / 1000.0);
+    base->total_discharge_energy = (float)(pb->discharge_wh / 1000.0);
+    return HAL_SUCCESS;
+}
+
+/* Meters */
+
+hal_error_t hal_meter_init(const meter_config_t* config, uint32_t* meter_id) {
+    if (!config || !meter_id || !g_sim.plant) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    // Meters are matched by what they measure
+    uint32_t id = config->measurement_type == METER_MEASUREMENT_LOAD ? HAL_SIM_METER_LOAD : HAL_SIM_METER_GRID;
+    if (config->measurement_type != METER_MEASUREMENT_GRID && config->measurement_type != METER_MEASUREMENT_LOAD) {
+        return HAL_ERROR_NOT_SUPPORTED;
+    }
+
+    g_sim.meters_claimed |= 1u << id;
+    *meter_id = id;
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_meter_get_measurements(uint32_t meter_id, meter_measurement_t* measurements) {
+    if (!g_sim.plant || meter_id >= HAL_SIM_METER_COUNT || !measurements) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    const plant_t* plant = g_sim.plant;
+    const plant_grid_t* grid = &plant->grid;
+    bool load = meter_id == HAL_SIM_METER_LOAD;
+
+    // The load meter sees the islanded bus too; the grid meter sees nothing
+    double power = load ? plant->load_w : grid->power_w;
+    double voltage = grid->available ? grid->voltage : (load ? PLANT_GRID_VOLTAGE : 0.0);
+    double frequency = grid->available ? grid->frequency : (load ? PLANT_GRID_FREQUENCY : 0.0);
+
+    if (load) {
+        g_sim.load_energy_wh += plant->load_w * (plant->t - g_sim.load_energy_t) / 3600.0;
+        g_sim.load_energy_t = plant->t;
+    }
+    double import_wh = load ? g_sim.load_energy_wh : grid->import_wh;
+    double export_wh = load ? 0.0 : grid->export_wh;
+
+    memset(measurements, 0, sizeof(*measurements));
+    measurements->type = g_sim.meter_config[meter_id].measurement_type;
+    measurements->phase_l1.voltage = (float)voltage;
+    measurements->phase_l1.current = voltage > 0.0 ? (float)(fabs(power) / voltage) : 0.0f;
+    measurements->phase_l1.power = (float)power;
+    measurements->phase_l1.power_factor = 1.0f;
+    measurements->phase_l1.energy_import = (float)((import_wh - g_sim.meter_import_base[meter_id]) / 1000.0);
+    measurements->phase_l1.energy_export = (float)((export_wh - g_sim.meter_export_base[meter_id]) / 1000.0);
+    measurements->voltage_avg = measurements->phase_l1.voltage;
+    measurements->current_avg = measurements->phase_l1.current;
+    measurements->power_total = (float)power;
+    measurements->power_factor_avg = 1.0f;
+    measurements->frequency = (float)frequency;
+    measurements->energy_import_total = measurements->phase_l1.energy_import;
+    measurements->energy_export_total = measurements->phase_l1.energy_export;
+    measurements->status = grid->available ? 0 : HAL_SIM_STATUS_GRID_DOWN;
+    measurements->timestamp = hal_sim_time();
+
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_meter_get_status(uint32_t meter_id, device_info_t* info) {
+    if (!g_sim.plant || meter_id >= HAL_SIM_METER_COUNT || !info) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    hal_sim_device_info(info, meter_id == HAL_SIM_METER_LOAD ? "LOADMETER" : "GRIDMETER", meter_id);
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_meter_get_statistics(uint32_t meter_id, meter_stats_t* stats) {
+    if (!g_sim.plant || meter_id >= HAL_SIM_METER_COUNT || !stats) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    const plant_grid_t* grid = &g_sim.plant->grid;
+    memset(stats, 0, sizeof(*stats));
+    stats->last_reset = g_sim.last_reset;
+
+    if (meter_id == HAL_SIM_METER_GRID) {
+        stats->peak_power_import = (float)grid->peak_import_w;
+        stats->peak_power_export = (float)grid->peak_export_w;
+        stats->peak_time_import = grid->peak_import_time;
+        stats->peak_time_export = grid->peak_export_time;
+        stats->avg_power = (float)grid->power_w;
+        stats->outage_count = grid->outage_count;
+    } else {
+        stats->avg_power = (float)g_sim.plant->load_w;
+    }
+
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_meter_reset_energy(uint32_t meter_id) {
+    if (!g_sim.plant || meter_id >= HAL_SIM_METER_COUNT) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    const plant_grid_t* grid = &g_sim.plant->grid;
+    g_sim.meter_import_base[meter_id] = meter_id == HAL_SIM_METER_LOAD ? g_sim.load_energy_wh : grid->import_wh;
+    g_sim.meter_export_base[meter_id] = meter_id == HAL_SIM_METER_LOAD ? 0.0 : grid->export_wh;
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_meter_set_config(uint32_t meter_id, const meter_config_t* config) {
+    if (meter_id >= HAL_SIM_METER_COUNT || !config) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    // What a meter measures is fixed by where the twin puts it
+    meter_measurement_type_t type = g_sim.meter_config[meter_id].measurement_type;
+    g_sim.meter_config[meter_id] = *config;
+    g_sim.meter_config[meter_id].measurement_type = type;
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_meter_calibrate(uint32_t meter_id, float voltage_ref, float current_ref) {
+    (void)voltage_ref;
+    (void)current_ref;
+    return meter_id < HAL_SIM_METER_COUNT ? HAL_SUCCESS : HAL_ERROR_INVALID_PARAM;
+}
+
+/* Relays: module m, channel c switches controllable load m * HAL_SIM_RELAY_CHANNELS + c */
+
+static int hal_sim_module_channels(uint32_t module_id) {
+    if (!g_sim.plant || module_id >= HAL_SIM_MAX_RELAY_MODULES) return 0;
+
+    int first = (int)module_id * HAL_SIM_RELAY_CHANNELS;
+    int left = g_sim.plant->load_count - first;
+    return left <= 0 ? 0 : left < HAL_SIM_RELAY_CHANNELS ? left : HAL_SIM_RELAY_CHANNELS;
+}
+
+static plant_load_t* hal_sim_channel(uint32_t module_id, uint8_t channel) {
+    if (channel >= hal_sim_module_channels(module_id)) return NULL;
+    return &g_sim.plant->loads[module_id * HAL_SIM_RELAY_CHANNELS + channel];
+}
+
+uint32_t hal_sim_relay_module_count(void) {
+    if (!g_sim.plant) return 0;
+    return (uint32_t)(g_sim.plant->load_count + HAL_SIM_RELAY_CHANNELS - 1) / HAL_SIM_RELAY_CHANNELS;
+}
+
+hal_error_t hal_relay_init_module(const relay_config_t* config, uint32_t* module_id) {
+    if (!config || !module_id || !g_sim.plant) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    if (g_sim.relay_modules_claimed >= hal_sim_relay_module_count()) {
+        return HAL_ERROR_INIT_FAILED;
+    }
+
+    *module_id = g_sim.relay_modules_claimed++;
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_relay_set_state(uint32_t module_id, uint8_t channel, relay_state_t state) {
+    plant_load_t* load = hal_sim_channel(module_id, channel);
+    if (!load || (state != RELAY_STATE_ON && state != RELAY_STATE_OFF)) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    bool on = state == RELAY_STATE_ON;
+    if (load->relay_on != on) {
+        load->relay_on = on;
+        load->last_change = hal_sim_time();
+        if (on) load->on_count++;
+        g_sim.relay_stats[module_id].total_operations++;
+    }
+
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_relay_get_state(uint32_t module_id, uint8_t channel, relay_channel_state_t* state) {
+    const plant_load_t* load = hal_sim_channel(module_id, channel);
+    if (!load || !state) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    double voltage = g_sim.plant->grid.available ? g_sim.plant->grid.voltage : PLANT_GRID_VOLTAGE;
+
+    memset(state, 0, sizeof(*state));
+    state->state = load->relay_on ? RELAY_STATE_ON : RELAY_STATE_OFF;
+    state->commanded_state = load->relay_on;
+    state->voltage = (float)voltage;
+    state->current = (float)(load->power_w / voltage);
+    state->on_count = load->on_count;
+    state->fault_count = load->fault_count;
+    state->last_change = load->last_change;
+
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_relay_get_all_states(uint32_t module_id, relay_channel_state_t* states) {
+    int channels = hal_sim_module_channels(module_id);
+    if (channels == 0 || !states) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    for (int ch = 0; ch < channels; ch++)
+        hal_relay_get_state(module_id, (uint8_t)ch, &states[ch]);
+
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_relay_get_measurements(uint32_t module_id, relay_module_measurement_t* measurements) {
+    if (hal_sim_module_channels(module_id) == 0 || !measurements) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    memset(measurements, 0, sizeof(*measurements));
+    measurements->input_voltage = 24.0f;
+    measurements->temperature = (float)g_sim.plant->ambient_c;
+    measurements->timestamp = hal_sim_time();
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_relay_get_statistics(uint32_t module_id, relay_module_stats_t* stats) {
+    if (hal_sim_module_channels(module_id) == 0 || !stats) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    memcpy(stats, &g_sim.relay_stats[module_id], sizeof(*stats));
+    stats->last_reset = g_sim.last_reset;
+    return HAL_SUCCESS;
+}
+
+/* The twin has no sub-cycle timing; a pulse is an on-off pair counted as one */
+hal_error_t hal_relay_pulse(uint32_t module_id, uint8_t channel, uint32_t duration_ms) {
+    plant_load_t* load = hal_sim_channel(module_id, channel);
+    (void)duration_ms;
+    if (!load) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    load->on_count++;
+    g_sim.relay_stats[module_id].total_operations++;
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_relay_set_multiple(uint32_t module_id, uint8_t start_channel, uint8_t count, const relay_state_t* states) {
+    if (!states) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        hal_error_t ret = hal_relay_set_state(module_id, (uint8_t)(start_channel + i), states[i]);
+        if (ret != HAL_SUCCESS) return ret;
+    }
+
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_relay_get_status(uint32_t module_id, device_info_t* info) {
+    if (hal_sim_module_channels(module_id) == 0 || !info) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    hal_sim_device_info(info, "RELAY", module_id);
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_relay_clear_faults(uint32_t module_id) {
+    int channels = hal_sim_module_channels(module_id);
+    if (channels == 0) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    for (int ch = 0; ch < channels; ch++)
+        g_sim.plant->loads[module_id * HAL_SIM_RELAY_CHANNELS + ch].fault_count = 0;
+    return HAL_SUCCESS;
+}
+
+hal_error_t hal_relay_reset_statistics(uint32_t module_id) {
+    if (hal_sim_module_channels(module_id) == 0) {
+        return HAL_ERROR_INVALID_PARAM;
+    }
+
+    memset(&g_sim.relay_stats[module_id], 0, sizeof(g_sim.relay_stats[module_id]));
+    return HAL_SUCCESS;
+}
@@ -0,0 +1,482 @@
+#include "journal.h"
+#include "logging.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define JOURNAL_READ_CHUNK   128     // records per pread() when scanning
+#define JOURNAL_HIGH_WATER   (JOURNAL_QUEUE_CAPACITY / 2)
+
+static const char* journal_event_str[JOURNAL_EVENT_COUNT] = {
+    "FAULT_RAISED", "FAULT_CLEARED", "MODE_CHANGE", "LOAD_SHED", "LOAD_RESTORE",
+    "IRRIGATION_START", "IRRIGATION_STOP", "EV_SESSION_START", "EV_SESSION_PAUSE",
+    "EV_SESSION_COMPLETE", "EV_FAULT", "OPERATOR_COMMAND", "ALARM_ACKNOWLEDGED",
+    "CONFIG_RELOAD"
+};
+
+/* Sparse index entry: every record before record_no has timestamp <= prefix_max_ms */
+typedef struct {
+    uint64_t record_no;
+    int64_t prefix_max_ms;
+} journal_index_entry_t;
+
+/* Journal state (single process-wide journal, like the logger) */
+static struct {
+    int fd;
+    bool open;
+    char path[256];
+
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;            // producers -> writer
+    pthread_cond_t committed;       // writer -> journal_flush() waiters
+    bool stop;
+    bool flush_requested;
+
+    /* Pending records (ring buffer) */
+    journal_record_t queue[JOURNAL_QUEUE_CAPACITY];
+    size_t head;
+    size_t count;
+
+    /* Sequence tracking */
+    uint64_t next_seq;              // next sequence number to hand out
+    uint64_t attempted_seq;         // last seq the writer tried to commit
+    uint64_t committed_seq;         // last seq durably on disk
+    uint64_t record_count;          // records in the file
+    int64_t max_timestamp_ms;       // running max over committed records
+
+    /* Sparse time index */
+    journal_index_entry_t* index;
+    size_t index_count;
+    size_t index_capacity;
+
+    /* Statistics */
+    uint64_t commit_count;
+    uint64_t dropped_count;
+    uint64_t write_errors;
+} journal = {
+    .fd = -1,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .committed = PTHREAD_COND_INITIALIZER,
+};
+
+/* Writer-private batch buffer */
+static journal_record_t journal_batch[JOURNAL_QUEUE_CAPACITY];
+
+/* CRC-32 (IEEE 802.3, reflected) */
+static uint32_t journal_crc32(const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    uint32_t crc = 0xFFFFFFFFu;
+
+    for (size_t i = 0; i < len; i++) {
+        crc ^= p[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (uint32_t)-(int32_t)(crc & 1u));
+        }
+    }
+
+    return ~crc;
+}
+
+static uint32_t journal_record_crc(const journal_record_t* rec) {
+    journal_record_t tmp = *rec;
+    tmp.crc = 0;
+    return journal_crc32(&tmp, sizeof(tmp));
+}
+
+static int64_t journal_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Account one committed record in the sparse index. Caller holds the lock. */
+static void journal_index_record(const journal_record_t* rec) {
+    if ((journal.record_count % JOURNAL_INDEX_STRIDE) == 0) {
+        if (journal.index_count == journal.index_capacity) {
+            size_t new_capacity = journal.index_capacity ? journal.index_capacity * 2 : 256;
+            journal_index_entry_t* grown = realloc(journal.index, new_capacity * sizeof(*grown));
+
+            if (!grown) {
+                // Index is an accelerator only; readers fall back to a longer scan
+                journal.record_count++;
+                if (rec->timestamp_ms > journal.max_timestamp_ms)
+                    journal.max_timestamp_ms = rec->timestamp_ms;
+                return;
+            }
+
+            journal.index = grown;
+            journal.index_capacity = new_capacity;
+        }
+
+        journal.index[journal.index_count].record_no = journal.record_count;
+        journal.index[journal.index_count].prefix_max_ms = journal.max_timestamp_ms;
+        journal.index_count++;
+    }
+
+    journal.record_count++;
+    if (rec->timestamp_ms > journal.max_timestamp_ms)
+        journal.max_timestamp_ms = rec->timestamp_ms;
+}
+
+/* Scan the existing file, rebuild the index and cut off a torn tail */
+static int journal_recover(void) {
+    struct stat st;
+    if (fstat(journal.fd, &st) != 0) return -1;
+
+    uint64_t file_records = (uint64_t)st.st_size / JOURNAL_RECORD_SIZE;
+    uint64_t valid = 0;
+    uint64_t last_seq = 0;
+    journal_record_t buf[JOURNAL_READ_CHUNK];
+    bool corrupt = false;
+
+    while (valid < file_records && !corrupt) {
+        uint64_t want = file_records - valid;
+        if (want > JOURNAL_READ_CHUNK) want = JOURNAL_READ_CHUNK;
+
+        ssize_t n = pread(journal.fd, buf, want * JOURNAL_RECORD_SIZE,
+                          (off_t)(valid * JOURNAL_RECORD_SIZE));
+        if (n <= 0) break;
+
+        size_t got = (size_t)n / JOURNAL_RECORD_SIZE;
+        for (size_t i = 0; i < got; i++) {
+            if (buf[i].crc != journal_record_crc(&buf[i]) ||
+                (valid > 0 && buf[i].seq <= last_seq)) {
+                corrupt = true;
+                break;
+            }
+
+            last_seq = buf[i].seq;
+            journal_index_record(&buf[i]);
+            valid++;
+        }
+    }
+
+    off_t valid_size = (off_t)(valid * JOURNAL_RECORD_SIZE);
+    if (valid_size != st.st_size) {
+        LOG_WARNING("Journal %s: discarding %lld trailing bytes after record %llu",
+            journal.path, (long long)(st.st_size - valid_size), (unsigned long long)valid);
+
+        if (ftruncate(journal.fd, valid_size) != 0) return -1;
+    }
+
+    journal.next_seq = last_seq + 1;
+    journal.attempted_seq = last_seq;
+    journal.committed_seq = last_seq;
+
+    return 0;
+}
+
+static int journal_write_all(int fd, const void* data, size_t len) {
+    const char* p = (const char*)data;
+
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+
+    return 0;
+}
+
+/* Background writer: drains the queue and commits each batch with one fdatasync */
+static void* journal_writer_thread(void* arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&journal.lock);
+
+    for (;;) {
+        while (journal.count == 0 && !journal.stop) {
+            pthread_cond_wait(&journal.wake, &journal.lock);
+        }
+
+        if (journal.count == 0 && journal.stop) break;
+
+        // Group commit window: let a burst accumulate before paying for fsync
+        if (!journal.stop && !journal.flush_requested && journal.count < JOURNAL_HIGH_WATER) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += (long)JOURNAL_COMMIT_INTERVAL_MS * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+                deadline.tv_nsec %= 1000000000L;
+            }
+            pthread_cond_timedwait(&journal.wake, &journal.lock, &deadline);
+        }
+
+        size_t n = journal.count;
+        for (size_t i = 0; i < n; i++) {
+            journal_batch[i] = journal.queue[(journal.head + i) % JOURNAL_QUEUE_CAPACITY];
+        }
+        journal.head = (journal.head + n) % JOURNAL_QUEUE_CAPACITY;
+        journal.count = 0;
+        journal.flush_requested = false;
+
+        pthread_mutex_unlock(&journal.lock);
+
+        int rc = journal_write_all(journal.fd, journal_batch, n * sizeof(journal_record_t));
+        if (rc == 0) rc = fdatasync(journal.fd);
+
+        pthread_mutex_lock(&journal.lock);
+
+        journal.attempted_seq = journal_batch[n - 1].seq;
+
+        if (rc == 0) {
+            for (size_t i = 0; i < n; i++) {
+                journal_index_record(&journal_batch[i]);
+            }
+            journal.committed_seq = journal_batch[n - 1].seq;
+            journal.commit_count++;
+        } else {
+            // Roll back any partial write so the file stays record aligned
+            journal.write_errors++;
+            if (ftruncate(journal.fd, (off_t)(journal.record_count * JOURNAL_RECORD_SIZE)) != 0) {
+                LOG_ERROR("Journal truncate after failed commit failed");
+            }
+            LOG_ERROR("Journal commit of %zu records failed: %s", n, strerror(errno));
+        }
+
+        pthread_cond_broadcast(&journal.committed);
+    }
+
+    pthread_cond_broadcast(&journal.committed);
+    pthread_mutex_unlock(&journal.lock);
+
+    return NULL;
+}
+
+/* Open (or create) the journal file and start the writer */
+int journal_open(const char* path) {
+    if (!path || path[0] == '\0') return -1;
+
+    pthread_mutex_lock(&journal.lock);
+
+    if (journal.open) {
+        pthread_mutex_unlock(&journal.lock);
+        return 0;
+    }
+
+    snprintf(journal.path, sizeof(journal.path), "%s", path);
+
+    journal.fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0640);
+    if (journal.fd < 0) {
+        pthread_mutex_unlock(&journal.lock);
+        LOG_ERROR_ERRNO("Failed to open event journal %s", path);
+        return -1;
+    }
+
+    journal.head = 0;
+    journal.count = 0;
+    journal.record_count = 0;
+    journal.index_count = 0;
+    journal.max_timestamp_ms = INT64_MIN;
+    journal.stop = false;
+    journal.flush_requested = false;
+
+    if (journal_recover() != 0) {
+        close(journal.fd);
+        journal.fd = -1;
+        pthread_mutex_unlock(&journal.lock);
+        LOG_ERROR_ERRNO("Failed to recover event journal %s", path);
+        return -1;
+    }
+
+    if (pthread_create(&journal.writer, NULL, journal_writer_thread, NULL) != 0) {
+        close(journal.fd);
+        journal.fd = -1;
+        pthread_mutex_unlock(&journal.lock);
+        LOG_ERROR("Failed to start journal writer thread");
+        return -1;
+    }
+
+    journal.open = true;
+    pthread_mutex_unlock(&journal.lock);
+
+    LOG_INFO("Event journal %s opened (%llu records)", path,
+        (unsigned long long)journal.record_count);
+
+    return 0;
+}
+
+/* Commit everything still queued, stop the writer and close the file */
+void journal_close(void) {
+    pthread_mutex_lock(&journal.lock);
+
+    if (!journal.open) {
+        pthread_mutex_unlock(&journal.lock);
+        return;
+    }
+
+    journal.open = false;
+    journal.stop = true;
+    pthread_cond_signal(&journal.wake);
+    pthread_mutex_unlock(&journal.lock);
+
+    pthread_join(journal.writer, NULL);
+
+    close(journal.fd);
+    journal.fd = -1;
+
+    free(journal.index);
+    journal.index = NULL;
+    journal.index_count = 0;
+    journal.index_capacity = 0;
+}
+
+/* Queue an event. Never blocks on I/O; returns -1 if closed or the queue is full. */
+int journal_append(journal_event_type_t type, uint16_t code, double value, const char* source) {
+    journal_record_t rec;
+    memset(&rec, 0, sizeof(rec));
+
+    rec.timestamp_ms = journal_now_ms();
+    rec.type = (uint16_t)type;
+    rec.code = code;
+    rec.value = value;
+    if (source) {
+        strncpy(rec.source, source, sizeof(rec.source) - 1);
+    }
+
+    pthread_mutex_lock(&journal.lock);
+
+    if (!journal.open) {
+        pthread_mutex_unlock(&journal.lock);
+        return -1;
+    }
+
+    if (journal.count == JOURNAL_QUEUE_CAPACITY) {
+        journal.dropped_count++;
+        pthread_mutex_unlock(&journal.lock);
+        return -1;
+    }
+
+    rec.seq = journal.next_seq++;
+    rec.crc = journal_record_crc(&rec);
+
+    journal.queue[(journal.head + journal.count) % JOURNAL_QUEUE_CAPACITY] = rec;
+    journal.count++;
+
+    if (journal.count == 1 || journal.count >= JOURNAL_HIGH_WATER) {
+        pthread_cond_signal(&journal.wake);
+    }
+
+    pthread_mutex_unlock(&journal.lock);
+
+    return 0;
+}
+
+/* Block until everything appended so far is durable */
+int journal_flush(void) {
+    pthread_mutex_lock(&journal.lock);
+
+    if (!journal.open) {
+        pthread_mutex_unlock(&journal.lock);
+        return -1;
+    }
+
+    uint64_t target = journal.next_seq - 1;
+
+    journal.flush_requested = true;
+    pthread_cond_signal(&journal.wake);
+
+    while (journal.attempted_seq < target && !journal.stop) {
+        pthread_cond_wait(&journal.committed, &journal.lock);
+    }
+
+    int rc = (journal.committed_seq >= target) ? 0 : -1;
+    pthread_mutex_unlock(&journal.lock);
+
+    return rc;
+}
+
+/* Copy committed records with timestamp >= since_ms, oldest first */
+size_t journal_read_since(int64_t since_ms, journal_record_t* out, size_t max_records) {
+    if (!out || max_records == 0) return 0;
+
+    char path[sizeof(journal.path)];
+    uint64_t start = 0;
+    uint64_t end;
+
+    pthread_mutex_lock(&journal.lock);
+
+    if (journal.fd < 0) {
+        pthread_mutex_unlock(&journal.lock);
+        return 0;
+    }
+
+    end = journal.record_count;
+
+    // Last index entry whose prefix maximum is still before `since`
+    size_t lo = 0, hi = journal.index_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (journal.index[mid].prefix_max_ms < since_ms) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo > 0) start = journal.index[lo - 1].record_no;
+
+    memcpy(path, journal.path, sizeof(path));
+    pthread_mutex_unlock(&journal.lock);
+
+    // Separate descriptor so readers never contend with the writer or close()
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+
+    journal_record_t buf[JOURNAL_READ_CHUNK];
+    size_t found = 0;
+    uint64_t pos = start;
+
+    while (pos < end && found < max_records) {
+        uint64_t want = end - pos;
+        if (want > JOURNAL_READ_CHUNK) want = JOURNAL_READ_CHUNK;
+
+        ssize_t n = pread(fd, buf, want * JOURNAL_RECORD_SIZE, (off_t)(pos * JOURNAL_RECORD_SIZE));
+        if (n <= 0) break;
+
+        size_t got = (size_t)n / JOURNAL_RECORD_SIZE;
+        for (size_t i = 0; i < got && found < max_records; i++) {
+            if (buf[i].timestamp_ms >= since_ms && buf[i].crc == journal_record_crc(&buf[i])) {
+                out[found++] = buf[i];
+            }
+        }
+
+        pos += got;
+    }
+
+    close(fd);
+
+    return found;
+}
+
+const char* journal_event_type_str(journal_event_type_t type) {
+    if ((int)type < 0 || type >= JOURNAL_EVENT_COUNT) return "UNKNOWN";
+    return journal_event_str[type];
+}
+
+void journal_log_status(void) {
+    pthread_mutex_lock(&journal.lock);
+
+    printf("=== Event Journal Status ===\n");
+    printf("File: %s (%s)\n", journal.path[0] ? journal.path : "-", journal.open ? "open" : "closed");
+    printf("Records: %llu\n", (unsigned long long)journal.record_count);
+    printf("Pending: %zu\n", journal.count);
+    printf("Commits: %llu\n", (unsigned long long)journal.commit_count);
+    printf("Dropped: %llu\n", (unsigned long long)journal.dropped_count);
+    printf("Write Errors: %llu\n", (unsigned long long)journal.write_errors);
+    printf("============================\n");
+
+    pthread_mutex_unlock(&journal.lock);
+}
@@ -0,0 +1,153 @@
+#include "load_forecast.h"
+#include <math.h>
+#include <string.h>
+
+static long load_slot_of(time_t t) {
+    long slot = (long)(t / LOAD_FORECAST_STEP_S);
+    return (t < 0 && t % LOAD_FORECAST_STEP_S) ? slot - 1 : slot;
+}
+
+void load_forecast_init(load_forecast_t* fc) {
+    if (!fc) return;
+
+    memset(fc, 0, sizeof(*fc));
+    fc->slot = -1;
+    fc->first_slot = -1;
+}
+
+/* Profile power of one component; unseen slots fall back to the
+ * weekday-agnostic profile, then to the last observed power */
+static double load_profile(const load_forecast_t* fc, int c, int weekday, int tod) {
+    if (fc->weekly_seen[weekday][tod]) return fc->weekly[c][weekday][tod];
+    if (fc->daily_seen[tod]) return fc->daily[c][tod];
+    return fc->last_power[c];
+}
+
+static float load_blend(float avg, double sample, bool seen, double alpha) {
+    return seen ? avg + (float)(alpha * (sample - avg)) : (float)sample;
+}
+
+/* Fold the finished slot's averages into the profiles and the level */
+static void load_close_slot(load_forecast_t* fc) {
+    if (fc->seconds <= 0.0) return;
+
+    int wd = fc->weekday, tod = fc->time_of_day;
+    bool weekly_seen = fc->weekly_seen[wd][tod] > 0;
+    bool daily_seen = fc->daily_seen[tod] > 0;
+
+    for (int c = 0; c < LOAD_COMPONENT_COUNT; c++) {
+        double avg = fc->energy[c] / fc->seconds;
+        double deviation = avg - load_profile(fc, c, wd, tod);
+
+        fc->level[c] = fc->level_valid ? fc->level[c] + LOAD_FORECAST_LEVEL_ALPHA * (deviation - fc->level[c])
+                                       : deviation;
+        fc->weekly[c][wd][tod] = load_blend(fc->weekly[c][wd][tod], avg, weekly_seen, LOAD_FORECAST_WEEKLY_ALPHA);
+        fc->daily[c][tod] = load_blend(fc->daily[c][tod], avg, daily_seen, LOAD_FORECAST_DAILY_ALPHA);
+    }
+
+    fc->level_valid = true;
+    if (fc->weekly_seen[wd][tod] < UINT16_MAX) fc->weekly_seen[wd][tod]++;
+    if (fc->daily_seen[tod] < UINT16_MAX) fc->daily_seen[tod]++;
+}
+
+static void load_rebuild(load_forecast_t* fc, time_t now) {
+    int wd = fc->weekday, tod = fc->time_of_day;
+
+    for (int h = 0; h < LOAD_FORECAST_SLOTS; h++) {
+        time_t mid = (time_t)(fc->slot + h) * LOAD_FORECAST_STEP_S + LOAD_FORECAST_STEP_S / 2;
+        double decay = fc->level_valid ? exp(-(mid > now ? (double)(mid - now) : 0.0) / LOAD_FORECAST_LEVEL_TAU_S)
+                                       : 0.0;
+        float total = 0.0f;
+
+        for (int c = 0; c < LOAD_COMPONENT_COUNT; c++) {
+            double p = load_profile(fc, c, wd, tod) + decay * fc->level[c];
+            fc->component[c][h] = (float)(p > 0.0 ? p : 0.0);
+            total += fc->component[c][h];
+        }
+        fc->total[h] = total;
+
+        if (++tod == LOAD_FORECAST_SLOTS) {
+            tod = 0;
+            wd = (wd + 1) % LOAD_FORECAST_WEEKDAYS;
+        }
+    }
+
+    fc->first_slot = fc->slot;
+}
+
+/* Accumulate one cycle's consumption and rebuild the forecast */
+void load_forecast_update(load_forecast_t* fc, time_t now, double base_w, double irrigation_w, double ev_w) {
+    if (!fc) return;
+
+    double power[LOAD_COMPONENT_COUNT] = {
+        [LOAD_COMPONENT_BASE] = isfinite(base_w) && base_w > 0.0 ? base_w : 0.0,
+        [LOAD_COMPONENT_IRRIGATION] = isfinite(irrigation_w) && irrigation_w > 0.0 ? irrigation_w : 0.0,
+        [LOAD_COMPONENT_EV] = isfinite(ev_w) && ev_w > 0.0 ? ev_w : 0.0,
+    };
+
+    long slot = load_slot_of(now);
+
+    if (slot != fc->slot) {
+        if (fc->slot >= 0) load_close_slot(fc);
+
+        struct tm local;
+        localtime_r(&now, &local);
+
+        fc->slot = slot;
+        fc->weekday = local.tm_wday;
+        fc->time_of_day = (local.tm_hour * 3600 + local.tm_min * 60) / LOAD_FORECAST_STEP_S;
+        fc->seconds = 0.0;
+        memset(fc->energy, 0, sizeof(fc->energy));
+    } else {
+        double dt = difftime(now, fc->last_sample);
+        if (dt > 0.0) {
+            for (int c = 0; c < LOAD_COMPONENT_COUNT; c++) fc->energy[c] += power[c] * dt;
+            fc->seconds += dt;
+        }
+    }
+
+    fc->last_sample = now;
+    memcpy(fc->last_power, power, sizeof(power));
+    load_rebuild(fc, now);
+}
+
+/* Forecast total power (W) of the slot containing t; 0 outside the horizon */
+double load_forecast_power_at(const load_forecast_t* fc, time_t t) {
+    if (!fc || fc->first_slot < 0) return 0.0;
+
+    long h = load_slot_of(t) - fc->first_slot;
+    if (h < 0 || h >= LOAD_FORECAST_SLOTS) return 0.0;
+
+    return fc->total[h];
+}
+
+/* Forecast energy (Wh) over [from, to), partial slots pro rata */
+double load_forecast_energy(const load_forecast_t* fc, time_t from, time_t to) {
+    if (!fc || fc->first_slot < 0 || to <= from) return 0.0;
+
+    double wh = 0.0;
+    time_t t = from;
+
+    while (t < to) {
+        time_t slot_end = ((time_t)load_slot_of(t) + 1) * LOAD_FORECAST_STEP_S;
+        time_t end = slot_end < to ? slot_end : to;
+
+        wh += load_forecast_power_at(fc, t) * (double)(end - t) / 3600.0;
+        t = end;
+    }
+
+    return wh;
+}
+
+/* Highest slot average (W) touching [from, to) */
+double load_forecast_peak(const load_forecast_t* fc, time_t from, time_t to) {
+    if (!fc || fc->first_slot < 0 || to <= from) return 0.0;
+
+    double peak = 0.0;
+    for (time_t t = from; t < to; t = ((time_t)load_slot_of(t) + 1) * LOAD_FORECAST_STEP_S) {
+        double p = load_forecast_power_at(fc, t);
+        if (p > peak) peak = p;
+    }
+
+    return peak;
+}
@@ -1,5 +1,8 @@
 #include "loads.h"
+#include "clock.h"
 #include "logging.h"
+#include "journal.h"
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <math.h>
@@ -9,71 +12,550 @@ static const char* load_state_str[] = {
     "OFF", "ON", "SHED", "DEFERRED", "FAULT"
 };
 
-int loads_init(load_manager_t* lm, const system_config_t* config) {
-    if (!lm || !config) return -1;
+static int load_priority(const load_definition_t* load) {
+    int p = (int)load->priority;
+    return p < 0 ? 0 : p >= LOAD_PRIORITY_LEVELS ? LOAD_PRIORITY_LEVELS - 1 : p;
+}
 
-    memset(lm, 0, sizeof(load_manager_t));
+/* Switching heaps: smallest key first, the larger load on a tie */
+
+static bool load_heap_before(const load_manager_t* lm, const load_heap_t* h, int a, int b) {
+    if (h->key[a] != h->key[b]) return h->key[a] < h->key[b];
+    return lm->loads[h->load[a]].rated_power > lm->loads[h->load[b]].rated_power;
+}
 
-    lm->load_count = config->load_count;
+static void load_heap_swap(load_heap_t* h, int a, int b) {
+    double key = h->key[a];
+    int load = h->load[a];
 
-    for (int i = 0; i < lm->load_count && i < MAX_CONTROLLABLE_LOADS; i++) {
-        memcpy(&lm->loads[i], &config->loads[i], sizeof(load_definition_t));
+    h->key[a] = h->key[b];
+    h->load[a] = h->load[b];
+    h->key[b] = key;
+    h->load[b] = load;
+    h->slot[h->load[a]] = a;
+    h->slot[h->load[b]] = b;
+}
 
-        lm->load_states[i] = LOAD_STATE_ON;
-        lm->loads[i].last_state_change = time(NULL);
-        lm->loads[i].current_state = false;
+static void load_heap_up(const load_manager_t* lm, load_heap_t* h, int pos) {
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (!load_heap_before(lm, h, pos, parent)) break;
+        load_heap_swap(h, pos, parent);
+        pos = parent;
     }
+}
+
+static void load_heap_down(const load_manager_t* lm, load_heap_t* h, int pos) {
+    for (;;) {
+        int first = pos, left = 2 * pos + 1, right = left + 1;
+
+        if (left < h->count && load_heap_before(lm, h, left, first)) first = left;
+        if (right < h->count && load_heap_before(lm, h, right, first)) first = right;
+        if (first == pos) break;
 
-    for (int p = 0; p < 5; p++) {
-        lm->priority_power[p] = 0;
-        lm->priority_count[p] = 0;
+        load_heap_swap(h, pos, first);
+        pos = first;
     }
+}
 
-    for (int i = 0; i < lm->load_count; i++) {
-        int p = lm->loads[i].priority;
+static void load_heap_push(const load_manager_t* lm, load_heap_t* h, int load, double key) {
+    if (h->count >= h->capacity) return;    // sized for every load that can be in it
+
+    int pos = h->count++;
+    h->key[pos] = key;
+    h->load[pos] = load;
+    h->slot[load] = pos;
+    load_heap_up(lm, h, pos);
+}
+
+static void load_heap_remove(const load_manager_t* lm, load_heap_t* h, int load) {
+    int pos = h->slot[load];
+    int last = --h->count;
+
+    h->slot[load] = -1;
+    if (pos == last) return;
+
+    h->key[pos] = h->key[last];
+    h->load[pos] = h->load[last];
+    h->slot[h->load[pos]] = pos;
+    load_heap_down(lm, h, pos);
+    load_heap_up(lm, h, pos);
+}
+
+static int load_heap_alloc(load_heap_t* h, int capacity) {
+    memset(h, 0, sizeof(*h));
+    if (capacity == 0) return 0;
+
+    h->key = malloc((size_t)capacity * sizeof(double));
+    h->load = malloc((size_t)capacity * sizeof(int));
+    if (!h->key || !h->load) return -1;
+
+    h->capacity = capacity;
+    return 0;
+}
+
+static void load_heap_free(load_heap_t* h) {
+    free(h->key);
+    free(h->load);
+    memset(h, 0, sizeof(*h));
+}
+
+/* Seconds the load has spent shed, the current spell included */
+static double loads_deprivation(const load_manager_t* lm, int i, time_t now) {
+    double seconds = lm->shed_seconds[i];
+
+    if (lm->load_states[i] == LOAD_STATE_SHED) seconds += difftime(now, lm->loads[i].last_state_change);
+    return seconds;
+}
+
+/* Key once free to switch: least shed first among loads ON, most deprived
+ * first among loads SHED (their current spell grows alike, so the start of
+ * the spell less the earlier spells orders them for good) */
+static double loads_ready_key(const load_manager_t* lm, int i) {
+    if (lm->load_states[i] == LOAD_STATE_SHED)
+        return (double)lm->loads[i].last_state_change - lm->shed_seconds[i];
+    return lm->shed_seconds[i];
+}
+
+/* Put a load in the heaps for its state: sheddable loads while ON, any load
+ * while SHED (so a load shed by hand is restored like the rest). Until its
+ * minimum on/off time runs out it waits in sheddable[]/shed[], keyed on when
+ * that happens; after that it is in to_shed[]/to_restore[]. */
+static void loads_enqueue(load_manager_t* lm, int i, time_t now) {
+    const load_definition_t* load = &lm->loads[i];
+    load_state_t state = lm->load_states[i];
+    int p = load_priority(load);
+    load_heap_t* waiting;
+    load_heap_t* ready;
+
+    if (state == LOAD_STATE_SHED) {
+        load_heap_push(lm, &lm->spell, i, (double)load->last_state_change);
+        waiting = &lm->shed[p];
+        ready = &lm->to_restore[p];
+    } else if (state == LOAD_STATE_ON && load->is_sheddable && load->priority != PRIORITY_CRITICAL) {
+        waiting = &lm->sheddable[p];
+        ready = &lm->to_shed[p];
+    } else {
+        return;
+    }
+
+    double hold = state == LOAD_STATE_ON ? load->min_on_time : load->min_off_time;
+    double expires = (double)load->last_state_change + hold;
+
+    lm->heap_of[i] = expires <= (double)now ? ready : waiting;
+    load_heap_push(lm, lm->heap_of[i], i, expires <= (double)now ? loads_ready_key(lm, i) : expires);
+}
+
+static void loads_dequeue(load_manager_t* lm, int i) {
+    if (lm->heap_of[i]) load_heap_remove(lm, lm->heap_of[i], i);
+    if (lm->spell_slot[i] >= 0) load_heap_remove(lm, &lm->spell, i);
+    lm->heap_of[i] = NULL;
+}
 
-        if (p >= 0 && p < 5) {
-            lm->priority_power[p] += lm->loads[i].rated_power;
-            lm->priority_count[p]++;
+/* Move the loads whose minimum on/off time has run out to the ready heaps */
+static void loads_promote(load_manager_t* lm, time_t now) {
+    for (int p = 0; p < LOAD_PRIORITY_LEVELS; p++) {
+        load_heap_t* waiting[2] = { &lm->sheddable[p], &lm->shed[p] };
+        load_heap_t* ready[2] = { &lm->to_shed[p], &lm->to_restore[p] };
+
+        for (int k = 0; k < 2; k++) {
+            while (waiting[k]->count > 0 && waiting[k]->key[0] <= (double)now) {
+                int i = waiting[k]->load[0];
+
+                load_heap_remove(lm, waiting[k], i);
+                load_heap_push(lm, ready[k], i, loads_ready_key(lm, i));
+                lm->heap_of[i] = ready[k];
+            }
         }
     }
+}
+
+static void loads_account(load_manager_t* lm, int i, load_state_t state, int sign) {
+    const load_definition_t* load = &lm->loads[i];
+    double power = sign * load->rated_power;
+
+    switch (state) {
+        case LOAD_STATE_ON:
+            lm->priority_power[load_priority(load)] += power;
+            lm->priority_count[load_priority(load)] += sign;
+            if (load->is_deferrable) lm->deferrable_power += power;
+            break;
+        case LOAD_STATE_SHED:
+            lm->shed_power += power;
+            lm->shed_count += sign;
+            break;
+        case LOAD_STATE_DEFERRED:
+            lm->deferred_power += power;
+            break;
+        case LOAD_STATE_OFF:
+        case LOAD_STATE_FAULT:
+            break;
+    }
+}
+
+/* Every state change goes through here to keep heaps, aggregates and the
+ * outage accounting current */
+static void loads_switch(load_manager_t* lm, int i, load_state_t state, time_t now) {
+    load_state_t old = lm->load_states[i];
+
+    if (old == LOAD_STATE_SHED) lm->shed_seconds[i] += difftime(now, lm->loads[i].last_state_change);
+
+    loads_dequeue(lm, i);
+    loads_account(lm, i, old, -1);
+
+    lm->load_states[i] = state;
+    lm->loads[i].current_state = state == LOAD_STATE_ON;
+    lm->loads[i].last_state_change = now;
+
+    loads_account(lm, i, state, 1);
+    loads_enqueue(lm, i, now);
+}
+
+static double loads_on_power(const load_manager_t* lm) {
+    double power = 0.0;
+
+    for (int p = 0; p < LOAD_PRIORITY_LEVELS; p++) power += lm->priority_power[p];
+    return power;
+}
+
+/* Deferrable loads with a daily energy are run by the planner */
+static bool loads_planned(const load_definition_t* load) {
+    return load->is_deferrable && load->daily_energy_wh > 0.0 && load->rated_power > 0.0;
+}
+
+/* Demand of the planned loads running or shed, W: what the load forecast
+ * leaves out */
+static double loads_planned_demand(const load_manager_t* lm) {
+    double power = 0.0;
+
+    for (int i = 0; i < lm->load_count; i++) {
+        load_state_t state = lm->load_states[i];
+        if ((state == LOAD_STATE_ON || state == LOAD_STATE_SHED) && loads_planned(&lm->loads[i]))
+            power += lm->loads[i].rated_power;
+    }
+    return power;
+}
+
+/* Next local time of day at deadline_hour after now */
+static time_t loads_next_due(const load_definition_t* load, time_t now) {
+    struct tm tm_info;
+    localtime_r(&now, &tm_info);
+
+    int minutes = (int)(load->deadline_hour * 60.0 + 0.5);
+    tm_info.tm_hour = minutes / 60;
+    tm_info.tm_min = minutes % 60;
+    tm_info.tm_sec = 0;
+    tm_info.tm_isdst = -1;
+
+    time_t due = mktime(&tm_info);
+    if (due <= now) {
+        tm_info.tm_mday++;
+        tm_info.tm_isdst = -1;
+        due = mktime(&tm_info);
+    }
+    return due;
+}
+
+static void loads_free_tables(load_manager_t* lm) {
+    free(lm->loads);
+    free(lm->load_states);
+    free(lm->shed_seconds);
+    free(lm->heap_slot);
+    free(lm->heap_of);
+    free(lm->spell_slot);
+    free(lm->scratch);
+    free(lm->delivered_wh);
+    free(lm->defer_due);
+    free(lm->defer_job);
+    lm->loads = NULL;
+    lm->load_states = NULL;
+    lm->shed_seconds = NULL;
+    lm->heap_slot = NULL;
+    lm->heap_of = NULL;
+    lm->spell_slot = NULL;
+    lm->scratch = NULL;
+    lm->delivered_wh = NULL;
+    lm->defer_due = NULL;
+    lm->defer_job = NULL;
+    lm->load_count = 0;
+
+    for (int p = 0; p < LOAD_PRIORITY_LEVELS; p++) {
+        load_heap_free(&lm->sheddable[p]);
+        load_heap_free(&lm->shed[p]);
+        load_heap_free(&lm->to_shed[p]);
+        load_heap_free(&lm->to_restore[p]);
+    }
+    load_heap_free(&lm->spell);
+    shed_solver_free(&lm->shed_solver);
+    defer_planner_free(&lm->defer_planner);
+}
+
+/* Allocate a manager for a copy of the given load table, heaps, solver and
+ * planner sized to it. States and runtime fields are left to the caller. */
+static load_manager_t* loads_build(const load_definition_t* defs, int count) {
+    load_manager_t* next = calloc(1, sizeof(load_manager_t));
+    int per_priority[LOAD_PRIORITY_LEVELS] = {0};
+    size_t n = count > 0 ? (size_t)count : 1;
+
+    if (!next) return NULL;
+
+    next->loads = calloc(n, sizeof(load_definition_t));
+    next->load_states = calloc(n, sizeof(load_state_t));
+    next->shed_seconds = calloc(n, sizeof(double));
+    next->delivered_wh = calloc(n, sizeof(double));
+    next->heap_slot = malloc(n * sizeof(int));
+    next->heap_of = calloc(n, sizeof(load_heap_t*));
+    next->spell_slot = malloc(n * sizeof(int));
+    next->scratch = malloc(n * sizeof(int));
+    next->defer_due = calloc(n, sizeof(time_t));
+    next->defer_job = malloc(n * sizeof(int));
+    next->load_count = count;
+    bool ok = next->loads && next->load_states && next->shed_seconds && next->delivered_wh &&
+              next->heap_slot && next->heap_of && next->spell_slot && next->scratch &&
+              next->defer_due && next->defer_job;
+
+    ok &= shed_solver_init(&next->shed_solver, count) == 0;
+    ok &= defer_planner_init(&next->defer_planner, count) == 0;
+    ok &= load_heap_alloc(&next->spell, count) == 0;
+
+    for (int i = 0; ok && i < count; i++) {
+        memcpy(&next->loads[i], &defs[i], sizeof(load_definition_t));
+        per_priority[load_priority(&defs[i])]++;
+    }
+
+    for (int p = 0; p < LOAD_PRIORITY_LEVELS; p++) {
+        ok &= load_heap_alloc(&next->sheddable[p], per_priority[p]) == 0;
+        ok &= load_heap_alloc(&next->shed[p], per_priority[p]) == 0;
+        ok &= load_heap_alloc(&next->to_shed[p], per_priority[p]) == 0;
+        ok &= load_heap_alloc(&next->to_restore[p], per_priority[p]) == 0;
+    }
+
+    if (!ok) {
+        LOG_ERROR("Failed to allocate the load table for %d loads", count);
+        loads_free_tables(next);
+        free(next);
+        return NULL;
+    }
+
+    return next;
+}
+
+/* Replace the load table with a built one and rebuild its heaps and
+ * aggregates; cannot fail. next is consumed. */
+static void loads_take(load_manager_t* lm, load_manager_t* next, time_t now) {
+    loads_free_tables(lm);
+
+    lm->loads = next->loads;
+    lm->load_states = next->load_states;
+    lm->shed_seconds = next->shed_seconds;
+    lm->heap_slot = next->heap_slot;
+    lm->heap_of = next->heap_of;
+    lm->spell_slot = next->spell_slot;
+    lm->scratch = next->scratch;
+    lm->delivered_wh = next->delivered_wh;
+    lm->defer_due = next->defer_due;
+    lm->defer_job = next->defer_job;
+    lm->load_count = next->load_count;
+    lm->shed_solver = next->shed_solver;
+    lm->defer_planner = next->defer_planner;
+    lm->defer_replan = true;
+    lm->spell = next->spell;
+    lm->spell.slot = lm->spell_slot;
+
+    for (int p = 0; p < LOAD_PRIORITY_LEVELS; p++) {
+        lm->sheddable[p] = next->sheddable[p];
+        lm->shed[p] = next->shed[p];
+        lm->to_shed[p] = next->to_shed[p];
+        lm->to_restore[p] = next->to_restore[p];
+        lm->sheddable[p].slot = lm->heap_slot;
+        lm->shed[p].slot = lm->heap_slot;
+        lm->to_shed[p].slot = lm->heap_slot;
+        lm->to_restore[p].slot = lm->heap_slot;
+    }
+    free(next);
+
+    memset(lm->priority_power, 0, sizeof(lm->priority_power));
+    memset(lm->priority_count, 0, sizeof(lm->priority_count));
+    lm->deferrable_power = 0.0;
+    lm->shed_power = 0.0;
+    lm->shed_count = 0;
+    lm->deferred_power = 0.0;
+
+    for (int i = 0; i < lm->load_count; i++) {
+        load_definition_t* load = &lm->loads[i];
+
+        lm->heap_slot[i] = -1;
+        lm->spell_slot[i] = -1;
+        lm->defer_job[i] = -1;
+        lm->defer_due[i] = loads_planned(load) ? loads_next_due(load, now) : 0;
+        load->current_state = lm->load_states[i] == LOAD_STATE_ON;
+        loads_account(lm, i, lm->load_states[i], 1);
+        loads_enqueue(lm, i, now);
+    }
+}
+
+int loads_init(load_manager_t* lm, const system_config_t* config) {
+    if (!lm || !config) return -1;
+
+    memset(lm, 0, sizeof(load_manager_t));
+
+    time_t now = clock_now();
+    load_manager_t* next = loads_build(config->loads, config->load_count);
+    if (!next) return -1;
+
+    for (int i = 0; i < next->load_count; i++) {
+        load_definition_t* load = &next->loads[i];
+
+        // Planned loads wait for their first plan, free to start on it
+        next->load_states[i] = loads_planned(load) ? LOAD_STATE_DEFERRED : LOAD_STATE_ON;
+        load->last_state_change = next->load_states[i] == LOAD_STATE_DEFERRED ? now - (time_t)load->min_off_time : now;
+    }
+
+    loads_take(lm, next, now);
 
     lm->shedding_active = true;
     lm->shed_power_target = 0;
     lm->shedding_start_time = 0;
-    lm->deferred_power = 0;
-    lm->next_deferrable_start = time(NULL) + 300;
+    lm->defer_update_ts = now;
+    lm->energy_update_ts = now;
 
     lm->min_shed_duration = 60.0;
     lm->max_shed_duration = 1800.0;
     lm->load_rotation_interval = 300.0;
 
+    load_forecast_init(&lm->forecast);
+
     return 0;
 }
 
-void loads_update_measurements(load_manager_t* lm, system_measurements_t* measurements) {
-    if (!lm || !measurements) return;
-    
-    double critical_power = 0;
-    double deferrable_power = 0;
-    double total_power = 0;
-    
-    // Update power measurements based on load states
-    for (int i = 0; i < lm->load_count; i++) {
-        if (lm->load_states[i] == LOAD_STATE_ON) {
-            double load_power = lm->loads[i].rated_power;
-            total_power += load_power;
-            
-            if (lm->loads[i].priority == PRIORITY_CRITICAL) {
-                critical_power += load_power;
-            }
-            
-            if (lm->loads[i].is_deferrable) {
-                deferrable_power += load_power;
+/* Build a reloaded load table without touching the running one; loads
+ * matched by id carry their runtime state over. Nothing changes until
+ * loads_commit_config, so a reload can prepare every subsystem first. */
+int loads_prepare_config(const load_manager_t* lm, const system_config_t* config, loads_config_stage_t* stage) {
+    if (!lm || !config || !stage) return -1;
+
+    time_t now = clock_now();
+    load_manager_t* next = loads_build(config->loads, config->load_count);
+
+    stage->next = next;
+    stage->kept = 0;
+    if (!next) return -1;
+
+    for (int i = 0; i < next->load_count; i++) {
+        load_definition_t* load = &next->loads[i];
+        bool planned = loads_planned(load);
+
+        next->load_states[i] = planned ? LOAD_STATE_DEFERRED : LOAD_STATE_ON;
+        load->last_state_change = planned ? now - (time_t)load->min_off_time : now;
+
+        int j = loads_find(lm, load->id);
+        if (j >= 0) {
+            next->load_states[i] = lm->load_states[j];
+            load->last_state_change = lm->loads[j].last_state_change;
+            next->shed_seconds[i] = lm->shed_seconds[j];
+            next->delivered_wh[i] = lm->delivered_wh[j];
+            stage->kept++;
+
+            // No longer planned: nothing would start it again
+            if (!planned && next->load_states[i] == LOAD_STATE_DEFERRED) {
+                next->load_states[i] = LOAD_STATE_ON;
+                load->last_state_change = now;
             }
         }
     }
+
+    return 0;
+}
+
+/* Install a prepared load table; cannot fail */
+void loads_commit_config(load_manager_t* lm, loads_config_stage_t* stage) {
+    if (!lm || !stage || !stage->next) return;
+
+    load_manager_t* next = stage->next;
+
+    // Loads dropped from the config are released, so restore anything we had shed
+    for (int j = 0; j < lm->load_count; j++) {
+        bool present = false;
+
+        for (int i = 0; i < next->load_count && !present; i++)
+            present = strcmp(lm->loads[j].id, next->loads[i].id) == 0;
+
+        if (!present && lm->load_states[j] == LOAD_STATE_SHED) {
+            journal_append(JOURNAL_EVENT_LOAD_RESTORE, (uint16_t)j, lm->loads[j].rated_power, lm->loads[j].id);
+            LOG_INFO("Load %s removed by reload, releasing shed", lm->loads[j].id);
+        }
+    }
+
+    loads_take(lm, next, clock_now());
+    stage->next = NULL;
+
+    if (lm->shed_count == 0) {
+        lm->shedding_active = false;
+        lm->shed_power_target = 0;
+    }
+
+    LOG_INFO("Loads reconfigured: %d loads (%d kept state)", lm->load_count, stage->kept);
+}
+
+void loads_discard_config(loads_config_stage_t* stage) {
+    if (!stage || !stage->next) return;
+
+    loads_free_tables(stage->next);
+    free(stage->next);
+    stage->next = NULL;
+}
+
+/* Apply a reloaded load table; loads matched by id keep their runtime state */
+int loads_apply_config(load_manager_t* lm, const system_config_t* config) {
+    loads_config_stage_t stage;
+
+    if (loads_prepare_config(lm, config, &stage) != 0) return -1;
+    loads_commit_config(lm, &stage);
+    return 0;
+}
+
+void loads_cleanup(load_manager_t* lm) {
+    if (!lm) return;
+
+    loads_free_tables(lm);
+}
+
+int loads_find(const load_manager_t* lm, const char* id) {
+    if (!lm || !id) return -1;
+
+    for (int i = 0; i < lm->load_count; i++) {
+        if (strcmp(lm->loads[i].id, id) == 0) return i;
+    }
+    return -1;
+}
+
+/* Switch a load from outside the manager (operator commands) */
+int loads_set_state(load_manager_t* lm, int load_index, load_state_t state) {
+    if (!lm || load_index < 0 || load_index >= lm->load_count) return -1;
+
+    loads_switch(lm, load_index, state, clock_now());
+    if (lm->shed_count == 0) {
+        lm->shedding_active = false;
+        lm->shed_power_target = 0;
+    }
+    return 0;
+}
+
+void loads_update_measurements(load_manager_t* lm, system_measurements_t* measurements) {
+    if (!lm || !measurements) return;
     
+    // Kept current by every state change, so no walk over the loads
+    double total_power = loads_on_power(lm);
+    double critical_power = lm->priority_power[PRIORITY_CRITICAL];
+    double deferrable_power = lm->deferrable_power;
+
+    // A load meter reading replaces the rated sum; the split stays nominal
+    if (measurements->measured & MEASURED_LOADS) {
+        total_power = measurements->load_power_total;
+        critical_power = fmin(critical_power, total_power);
+        deferrable_power = fmin(deferrable_power, total_power);
+    }
+
     measurements->load_power_total = total_power;
     measurements->load_power_critical = critical_power;
     measurements->load_power_deferrable = deferrable_power;
@@ -81,67 +563,187 @@ void loads_update_measurements(load_manager_t* lm, system_measurements_t* measur
     loads_update_energy_consumed(lm);
 }
 
+/* Learn from demand rather than what was served: shed loads count as
+ * consuming, otherwise every shedding episode would teach the forecast
+ * that the site needs less and the next one would start later. The planned
+ * deferrable loads are left out: the planner places them itself, and
+ * learning their runs would make it see less surplus in the slots it used
+ * before and drift away from them day after day. */
+void loads_update_forecast(load_manager_t* lm, const system_measurements_t* measurements) {
+    if (!lm || !measurements) return;
+
+    load_forecast_update(&lm->forecast, measurements->timestamp,
+                         fmax(measurements->load_power_total + lm->shed_power - loads_planned_demand(lm), 0.0),
+                         measurements->irrigation_power, measurements->ev_charging_power);
+}
+
+static void loads_shed(load_manager_t* lm, int i, time_t now) {
+    loads_switch(lm, i, LOAD_STATE_SHED, now);
+    journal_append(JOURNAL_EVENT_LOAD_SHED, (uint16_t)i,
+                   lm->loads[i].rated_power, lm->loads[i].id);
+}
+
+static void loads_restore(load_manager_t* lm, int i, time_t now) {
+    loads_switch(lm, i, LOAD_STATE_ON, now);
+    journal_append(JOURNAL_EVENT_LOAD_RESTORE, (uint16_t)i,
+                   lm->loads[i].rated_power, lm->loads[i].id);
+}
+
+/* Shed loads starting from lowest priority; each bucket yields the loads
+ * free to switch, least shed so far first */
+static double loads_shed_greedy(load_manager_t* lm, double target, time_t now) {
+    double power_shed = 0;
+
+    for (int priority = PRIORITY_NON_ESSENTIAL; priority > PRIORITY_CRITICAL && power_shed < target; priority--) {
+        load_heap_t* h = &lm->to_shed[priority];
+
+        while (h->count > 0 && power_shed < target) {
+            int i = h->load[0];
+
+            power_shed += lm->loads[i].rated_power;
+            loads_shed(lm, i, now);
+        }
+    }
+
+    return power_shed;
+}
+
+static double loads_shed_impact(const load_manager_t* lm, int i, double need, time_t now) {
+    static const double weight[LOAD_PRIORITY_LEVELS] = {
+        0.0,    // critical loads are never candidates
+        LOADS_SHED_WEIGHT_HIGH,
+        LOADS_SHED_WEIGHT_MEDIUM,
+        LOADS_SHED_WEIGHT_LOW,
+        LOADS_SHED_WEIGHT_NON_ESSENTIAL
+    };
+    const load_definition_t* load = &lm->loads[i];
+    double on_for = difftime(now, load->last_state_change);
+    double recent = on_for < lm->load_rotation_interval ? 1.0 - on_for / lm->load_rotation_interval : 0.0;
+
+    return weight[load_priority(load)] * (1.0 + recent) * (1.0 + lm->shed_seconds[i] / LOADS_SHED_FAIR_REF_S) *
+           (1.0 + load->min_off_time / LOADS_SHED_LOCKOUT_REF_S) +
+           LOADS_SHED_OVERSHOOT_WEIGHT * load->rated_power / need;
+}
+
+/* Least-impact set of loads covering the target, chosen among the sheddable
+ * loads free to switch. Returns the power shed, or -1 when the solver gave
+ * up and nothing was switched. */
+static double loads_shed_optimal(load_manager_t* lm, double target, time_t now) {
+    shed_solver_t* solver = &lm->shed_solver;
+
+    shed_solver_reset(solver);
+
+    for (int priority = PRIORITY_HIGH; priority <= PRIORITY_NON_ESSENTIAL; priority++) {
+        const load_heap_t* h = &lm->to_shed[priority];
+
+        for (int pos = 0; pos < h->count; pos++) {
+            int i = h->load[pos];
+            shed_solver_add(solver, i, lm->loads[i].rated_power, loads_shed_impact(lm, i, target, now));
+        }
+    }
+
+    if (solver->count == 0) return 0;
+    if (shed_solver_solve(solver, target, SHED_SOLVER_BUDGET_S) != 0) return -1;
+
+    double power_shed = 0;
+
+    // Heaps move as loads leave them; the candidates are kept by load index
+    for (int k = 0; k < solver->count; k++) {
+        if (!solver->picked[k]) continue;
+
+        power_shed += solver->power[k];
+        loads_shed(lm, solver->id[k], now);
+    }
+
+    return power_shed;
+}
+
+/* Loads shed for max_shed_duration that may come back (their minimum off
+ * time is over), longest spell first, into out. A load's children in the
+ * spell heap started later, so the walk only goes below loads overdue
+ * themselves and costs O(overdue). */
+static int loads_overdue(const load_manager_t* lm, time_t now, int* out) {
+    const load_heap_t* h = &lm->spell;
+    double cutoff = (double)now - lm->max_shed_duration;
+    int found = 0, pos = 0;
+
+    while (pos < h->count) {
+        if (h->key[pos] <= cutoff) {
+            int i = h->load[pos];
+            if (lm->heap_of[i] == &lm->to_restore[load_priority(&lm->loads[i])]) out[found++] = i;
+            if (2 * pos + 1 < h->count) {
+                pos = 2 * pos + 1;
+                continue;
+            }
+        }
+
+        // Next in pre-order: up past right children (a missing one included),
+        // then across to the right sibling
+        for (;;) {
+            while (pos > 0 && pos % 2 == 0) pos = (pos - 1) / 2;
+            if (pos == 0) {
+                pos = h->count;
+                break;
+            }
+            if (++pos < h->count) break;
+        }
+    }
+
+    for (int k = 1; k < found; k++) {
+        int i = out[k], at = k;
+
+        while (at > 0 && lm->loads[out[at - 1]].last_state_change > lm->loads[i].last_state_change) {
+            out[at] = out[at - 1];
+            at--;
+        }
+        out[at] = i;
+    }
+    return found;
+}
+
 bool loads_manage_shedding(load_manager_t* lm, double available_power, double total_load,
     double battery_soc, bool grid_available) {
     if (!lm || grid_available || battery_soc < 50) return false;
     
-    double power_deficit = total_load - available_power;
+    /* Plan for the coming peak; the forecast is of demand less the planned
+     * loads, so those are added back and loads already shed taken off */
+    time_t now = clock_now();
+    loads_promote(lm, now);
+
+    double expected_load = load_forecast_peak(&lm->forecast, now, now + LOADS_FORECAST_LOOKAHEAD_S) +
+                           loads_planned_demand(lm) - lm->shed_power;
+    if (expected_load < total_load) expected_load = total_load;
+
+    double power_deficit = expected_load - available_power;
     bool shedding_changed = false;
     
     /* Determine if shedding is needed */
     if (power_deficit > 100.0) {  /* At least 100W deficit */
         if (!lm->shedding_active) {
             lm->shedding_active = true;
-            lm->shedding_start_time = time(NULL);
-            lm->shed_power_target = power_deficit * 1.2;  /* Target 20% more than deficit */
+            lm->shedding_start_time = clock_now();
             lm->shed_event_count++;
         }
         
-        /* Shed loads starting from lowest priority */
-        double power_shed = 0;
-        
-        for (int priority = PRIORITY_NON_ESSENTIAL; priority >= PRIORITY_CRITICAL; priority--) {
-            for (int i = 0; i < lm->load_count; i++) {
-                if ((int)lm->loads[i].priority == priority && 
-                    lm->load_states[i] == LOAD_STATE_ON &&
-                    lm->loads[i].is_sheddable &&
-                    loads_can_shed_load(lm, i, available_power)) {
-                    
-                    /* Check timing constraints */
-                    if (!loads_check_timing_constraints(lm, i)) {
-                        continue;
-                    }
-                    
-                    /* Shed this load */
-                    lm->load_states[i] = LOAD_STATE_SHED;
-                    lm->loads[i].current_state = false;
-                    lm->loads[i].last_state_change = time(NULL);
-                    
-                    power_shed += lm->loads[i].rated_power;
-                    shedding_changed = true;
-                    
-                    /* Check if we've shed enough */
-                    if (power_shed >= lm->shed_power_target) {
-                        break;
-                    }
-                }
-            }
-            
-            if (power_shed >= lm->shed_power_target) {
-                break;
-            }
-        }
+        /* Cover what is still missing this cycle; loads shed earlier are
+         * already off the expected load */
+        lm->shed_power_target = power_deficit;
+
+        double power_shed = loads_shed_optimal(lm, lm->shed_power_target, now);
+        if (power_shed < 0) power_shed = loads_shed_greedy(lm, lm->shed_power_target, now);
+        if (power_shed > 0) shedding_changed = true;
         
     } else if (lm->shedding_active && power_deficit < -200.0) {
         /* Restore shed loads if we have excess power */
-        loads_restore_shed(lm, available_power);
+        loads_restore_shed(lm, -power_deficit);
+        shedding_changed = true;
     }
     
     /* Rotate shedding if active for too long */
     if (lm->shedding_active) {
-        double shedding_duration = difftime(time(NULL), lm->shedding_start_time);
-        if (shedding_duration > lm->load_rotation_interval) {
-            loads_rotate_shedding(lm);
+        double shedding_duration = difftime(now, lm->shedding_start_time);
+        if (shedding_duration > lm->load_rotation_interval || loads_overdue(lm, now, lm->scratch) > 0) {
+            loads_rotate_shedding(lm, -power_deficit);
             shedding_changed = true;
         }
     }
@@ -149,110 +751,229 @@ bool loads_manage_shedding(load_manager_t* lm, double available_power, double to
     return shedding_changed;
 }
 
-void loads_restore_shed(load_manager_t* lm, double available_power) {
+void loads_restore_shed(load_manager_t* lm, double excess_power) {
     if (!lm) return;
     
-    double excess_power = available_power;
-    
-    /* Restore loads starting from highest priority */
-    for (int priority = PRIORITY_CRITICAL; priority <= PRIORITY_NON_ESSENTIAL; priority++) {
-        for (int i = 0; i < lm->load_count; i++) {
-            if ((int)lm->loads[i].priority == priority && 
-                lm->load_states[i] == LOAD_STATE_SHED &&
-                loads_can_shed_load(lm, i, available_power)) {
-                
-                /* Check if we have enough power to restore */
-                if (lm->loads[i].rated_power <= excess_power) {
-                    /* Restore this load */
-                    lm->load_states[i] = LOAD_STATE_ON;
-                    lm->loads[i].current_state = true;
-                    lm->loads[i].last_state_change = time(NULL);
-                    
-                    excess_power -= lm->loads[i].rated_power;
-                    lm->restart_event_count++;
-                }
+    time_t now = clock_now();
+    loads_promote(lm, now);
+
+    /* Restore loads starting from highest priority, the most deprived of
+     * each first. Those that do not fit the excess are set aside and go back
+     * once the bucket is done. */
+    for (int priority = PRIORITY_CRITICAL; priority <= PRIORITY_NON_ESSENTIAL && excess_power > 0; priority++) {
+        load_heap_t* h = &lm->to_restore[priority];
+        int skipped = 0;
+
+        while (h->count > 0 && excess_power > 0) {
+            int i = h->load[0];
+
+            if (lm->loads[i].rated_power > excess_power) {
+                load_heap_remove(lm, h, i);
+                lm->scratch[skipped++] = i;
+                continue;
             }
+
+            loads_restore(lm, i, now);
+            excess_power -= lm->loads[i].rated_power;
+            lm->restart_event_count++;
+        }
+
+        for (int k = 0; k < skipped; k++) {
+            int i = lm->scratch[k];
+            load_heap_push(lm, h, i, loads_ready_key(lm, i));
         }
     }
     
     /* If all loads restored, stop shedding */
-    bool any_shed = false;
-    for (int i = 0; i < lm->load_count; i++) {
-        if (lm->load_states[i] == LOAD_STATE_SHED) {
-            any_shed = true;
-            break;
+    if (lm->shed_count == 0) {
+        lm->shedding_active = false;
+        lm->shed_power_target = 0;
+    }
+}
+
+/* The replacement for a load coming back: least shed so far of the least
+ * important bucket, and never more important than the load coming back */
+static int loads_rotation_candidate(const load_manager_t* lm, int i) {
+    for (int priority = PRIORITY_NON_ESSENTIAL; priority >= load_priority(&lm->loads[i]) &&
+         priority > PRIORITY_CRITICAL; priority--) {
+        if (lm->to_shed[priority].count > 0) return lm->to_shed[priority].load[0];
+    }
+    return -1;
+}
+
+/* Swap shed loads for loads that are on, a replacement never more
+ * important than the load it lets back. Every load shed for
+ * max_shed_duration comes back: swapped if there is a replacement, else
+ * on its own if headroom_w (power to spare) covers it. Failing those, once
+ * per rotation interval the most deprived load of the most important
+ * bucket comes back, provided its replacement has had less outage so far. */
+void loads_rotate_shedding(load_manager_t* lm, double headroom_w) {
+    if (!lm) return;
+    
+    time_t now = clock_now();
+    loads_promote(lm, now);
+
+    bool forced = false;
+    int overdue = loads_overdue(lm, now, lm->scratch);
+
+    // The list is taken first: loads shed below are not overdue
+    for (int k = 0; k < overdue; k++) {
+        int i = lm->scratch[k];
+        int j = loads_rotation_candidate(lm, i);
+
+        if (j >= 0) {
+            loads_restore(lm, i, now);
+            loads_shed(lm, j, now);
+            headroom_w += lm->loads[j].rated_power - lm->loads[i].rated_power;
+            forced = true;
+        } else if (lm->loads[i].rated_power <= headroom_w) {
+            loads_restore(lm, i, now);
+            headroom_w -= lm->loads[i].rated_power;
+            lm->restart_event_count++;
+            forced = true;
+        }
+    }
+
+    bool due = difftime(now, lm->shedding_start_time) > lm->load_rotation_interval;
+
+    for (int priority = PRIORITY_CRITICAL; priority <= PRIORITY_NON_ESSENTIAL && !forced && due; priority++) {
+        const load_heap_t* h = &lm->to_restore[priority];
+        if (h->count == 0) continue;
+
+        int i = h->load[0];
+        if (difftime(now, lm->loads[i].last_state_change) < lm->min_shed_duration) continue;
+
+        int j = loads_rotation_candidate(lm, i);
+        if (j >= 0 && lm->shed_seconds[j] < loads_deprivation(lm, i, now)) {
+            loads_restore(lm, i, now);
+            loads_shed(lm, j, now);
         }
+        break;  /* Rotate one load at a time */
     }
     
-    if (!any_shed) {
+    if (forced || due) lm->shedding_start_time = now;  /* Reset rotation timer */
+    if (lm->shed_count == 0) {
         lm->shedding_active = false;
         lm->shed_power_target = 0;
     }
 }
 
-void loads_rotate_shedding(load_manager_t* lm) {
+/* Hand the planned loads to the planner as jobs from start on (slot
+ * aligned), against the forecast surplus of the other loads. Loads shed,
+ * off or faulted are left out until they are back. */
+int loads_plan_deferrable(load_manager_t* lm, time_t start, const float* surplus_w) {
+    if (!lm || !surplus_w) return -1;
+
+    defer_planner_t* planner = &lm->defer_planner;
+    time_t now = clock_now();
+
+    planner->count = 0;
+    for (int i = 0; i < lm->load_count; i++) {
+        const load_definition_t* load = &lm->loads[i];
+        load_state_t state = lm->load_states[i];
+
+        lm->defer_job[i] = -1;
+        if (!loads_planned(load) || (state != LOAD_STATE_ON && state != LOAD_STATE_DEFERRED)) continue;
+
+        defer_job_t* job = &planner->jobs[planner->count];
+        double since = difftime(now, load->last_state_change);
+
+        job->id = i;
+        job->power_w = load->rated_power;
+        job->need_wh = fmax(load->daily_energy_wh - lm->delivered_wh[i], 0.0);
+        job->deadline = (int)(difftime(lm->defer_due[i], start) / DEFER_PLAN_STEP_S);
+        job->min_run = (int)ceil(load->min_on_time / DEFER_PLAN_STEP_S);
+        job->running = state == LOAD_STATE_ON ? (int)ceil(since / DEFER_PLAN_STEP_S) : 0;
+        if (state == LOAD_STATE_ON && job->running < 1) job->running = 1;
+        job->earliest_start = state == LOAD_STATE_ON || since >= load->min_off_time ? 0 :
+            (int)ceil(difftime(load->last_state_change + (time_t)load->min_off_time, start) / DEFER_PLAN_STEP_S);
+
+        lm->defer_job[i] = planner->count++;
+    }
+
+    lm->defer_replan = false;
+    if (defer_planner_solve(planner, start, surplus_w) != 0) return -1;
+
+    for (int k = 0; k < planner->count; k++) {
+        const defer_job_t* job = &planner->jobs[k];
+
+        LOG_DEBUG("Deferrable %s: %.0f Wh due in %d slots, %d runs, %.0f Wh from surplus, %.0f Wh short",
+            lm->loads[job->id].id, job->need_wh, job->deadline, job->starts, job->surplus_wh, job->shortfall_wh);
+    }
+    return 0;
+}
+
+/* Every cycle: count the energy delivered, roll deadlines over and switch
+ * the planned loads to the plan, minimum on/off times permitting */
+void loads_run_deferrable(load_manager_t* lm, time_t now) {
     if (!lm) return;
-    
-    time_t now = time(NULL);
-    
-    /* Find loads that have been shed for min_shed_duration */
+
+    double dt = difftime(now, lm->defer_update_ts);
+    int slot = defer_planner_slot(&lm->defer_planner, now);
+
+    lm->defer_update_ts = now;
+
     for (int i = 0; i < lm->load_count; i++) {
-        if (lm->load_states[i] == LOAD_STATE_SHED) {
-            double shed_duration = difftime(now, lm->loads[i].last_state_change);
-            if (shed_duration >= lm->min_shed_duration) {
-                /* Restore this load temporarily */
-                lm->load_states[i] = LOAD_STATE_ON;
-                lm->loads[i].current_state = true;
-                lm->loads[i].last_state_change = now;
-                
-                /* Find another load to shed instead */
-                for (int j = 0; j < lm->load_count; j++) {
-                    if (i != j && 
-                        lm->load_states[j] == LOAD_STATE_ON &&
-                        lm->loads[j].is_sheddable &&
-                        loads_can_shed_load(lm, j, 0)) {
-                        
-                        /* Check timing constraints */
-                        if (!loads_check_timing_constraints(lm, j)) {
-                            continue;
-                        }
-                        
-                        /* Shed the alternate load */
-                        lm->load_states[j] = LOAD_STATE_SHED;
-                        lm->loads[j].current_state = false;
-                        lm->loads[j].last_state_change = now;
-                        break;
-                    }
-                }
-                
-                break;  /* Rotate one load at a time */
+        const load_definition_t* load = &lm->loads[i];
+        if (!loads_planned(load)) continue;
+
+        if (lm->load_states[i] == LOAD_STATE_ON && dt > 0) lm->delivered_wh[i] += load->rated_power * dt / 3600.0;
+
+        if (now >= lm->defer_due[i]) {
+            if (lm->delivered_wh[i] < load->daily_energy_wh) {
+                lm->defer_missed++;
+                LOG_WARNING("Deferrable load %s missed its deadline: %.0f of %.0f Wh delivered",
+                    load->id, lm->delivered_wh[i], load->daily_energy_wh);
             }
+            lm->delivered_wh[i] = 0.0;
+            lm->defer_due[i] = loads_next_due(load, now);
+            lm->defer_replan = true;
+        }
+
+        int job = lm->defer_job[i];
+        bool run = slot >= 0 && job >= 0 && lm->defer_planner.jobs[job].on[slot] &&
+                   lm->delivered_wh[i] < load->daily_energy_wh;
+        double since = difftime(now, load->last_state_change);
+
+        if (lm->load_states[i] == LOAD_STATE_DEFERRED && run && since >= load->min_off_time) {
+            loads_switch(lm, i, LOAD_STATE_ON, now);
+        } else if (lm->load_states[i] == LOAD_STATE_ON && !run && since >= load->min_on_time) {
+            loads_switch(lm, i, LOAD_STATE_DEFERRED, now);
         }
     }
-    
-    lm->shedding_start_time = now;  /* Reset rotation timer */
 }
 
-void loads_prioritize_deferrable(load_manager_t* lm, double excess_power) {
-    if (!lm || excess_power <= 0) return;
-    
-    /* Enable deferrable loads if we have excess power */
-    for (int i = 0; i < lm->load_count; i++) {
-        if (lm->loads[i].is_deferrable && 
-            lm->load_states[i] == LOAD_STATE_DEFERRED &&
-            lm->loads[i].rated_power <= excess_power) {
-            
-            /* Check if it's time to start */
-            if (time(NULL) >= lm->next_deferrable_start) {
-                lm->load_states[i] = LOAD_STATE_ON;
-                lm->loads[i].current_state = true;
-                lm->loads[i].last_state_change = time(NULL);
-                
-                excess_power -= lm->loads[i].rated_power;
-                lm->deferred_power -= lm->loads[i].rated_power;
-            }
+/* Average power the deferrable plan draws over [from, to), W. The load
+ * forecast is learned without the planned loads, so whoever plans on it
+ * adds this back. */
+double loads_plan_power_w(const load_manager_t* lm, time_t from, time_t to) {
+    if (!lm || to <= from || lm->defer_planner.start == 0) return 0.0;
+
+    const defer_planner_t* planner = &lm->defer_planner;
+    double energy = 0.0;    // W·s
+
+    for (int s = 0; s < DEFER_PLAN_SLOTS; s++) {
+        time_t slot_from = planner->start + (time_t)s * DEFER_PLAN_STEP_S;
+        time_t lo = slot_from > from ? slot_from : from;
+        time_t hi = slot_from + DEFER_PLAN_STEP_S < to ? slot_from + DEFER_PLAN_STEP_S : to;
+        if (hi <= lo) continue;
+
+        for (int k = 0; k < planner->count; k++) {
+            if (planner->jobs[k].on[s]) energy += planner->jobs[k].power_w * difftime(hi, lo);
         }
     }
+    return energy / difftime(to, from);
+}
+
+/* Rated power of the planned loads that are ON, W */
+double loads_planned_power(const load_manager_t* lm) {
+    if (!lm) return 0;
+
+    double power = 0.0;
+    for (int i = 0; i < lm->load_count; i++) {
+        if (lm->load_states[i] == LOAD_STATE_ON && loads_planned(&lm->loads[i])) power += lm->loads[i].rated_power;
+    }
+    return power;
 }
 
 bool loads_check_timing_constraints(const load_manager_t* lm, int load_index) {
@@ -261,7 +982,7 @@ bool loads_check_timing_constraints(const load_manager_t* lm, int load_index) {
     }
     
     const load_definition_t* load = &lm->loads[load_index];
-    time_t now = time(NULL);
+    time_t now = clock_now();
     double time_since_change = difftime(now, load->last_state_change);
     
     if (load->current_state) {  /* Load is currently ON */
@@ -288,57 +1009,55 @@ void loads_log_status(const load_manager_t* lm) {
     printf("Deferred Power: %.0f W\n", lm->deferred_power);
     printf("Shed Events: %u\n", lm->shed_event_count);
     printf("Restart Events: %u\n", lm->restart_event_count);
+    printf("Shed Solver: %u solves, %u greedy fallbacks, worst %.0f us\n",
+           lm->shed_solver.solves, lm->shed_solver.fallbacks, lm->shed_solver.worst_solve_s * 1e6);
+    printf("Deferrable Plan: %d loads, %u plans, last %.0f us, %u deadlines missed\n",
+           lm->defer_planner.count, lm->defer_planner.plans, lm->defer_planner.last_plan_s * 1e6, lm->defer_missed);
     printf("Total Energy Needed: %.2f kWh\n", loads_calculate_power_needed(lm));
+    time_t now = clock_now();
+    printf("Forecast Demand: %.0f W peak next %d min, %.2f kWh next 24 h\n",
+           load_forecast_peak(&lm->forecast, now, now + LOADS_FORECAST_LOOKAHEAD_S),
+           LOADS_FORECAST_LOOKAHEAD_S / 60,
+           load_forecast_energy(&lm->forecast, now, now + 86400) / 1000.0);
     
     printf("\nLoad Details:\n");
-    printf("ID                   Priority State     Power(W) Deferrable\n");
-    printf("-----------------------------------------------------------\n");
+    printf("ID                   Priority State     Power(W) Deferrable Shed(s)\n");
+    printf("-------------------------------------------------------------------\n");
     
     for (int i = 0; i < lm->load_count; i++) {
         const load_definition_t* load = &lm->loads[i];
         
-        printf("%-20s %-9d %-9s %-9.0f %-9s\n",
+        printf("%-20s %-9d %-9s %-9.0f %-10s %-9.0f\n",
                load->id, load->priority, load_state_str[lm->load_states[i]],
-               load->rated_power, load->is_deferrable ? "YES" : "NO");
+               load->rated_power, load->is_deferrable ? "YES" : "NO", loads_deprivation(lm, i, now));
     }
     printf("=============================\n");
 }
 
+/* Accumulated outage of a load, the current spell included (s) */
+double loads_shed_seconds(const load_manager_t* lm, int load_index) {
+    if (!lm || load_index < 0 || load_index >= lm->load_count) return 0;
+
+    return loads_deprivation(lm, load_index, clock_now());
+}
+
 double loads_calculate_power_needed(const load_manager_t* lm) {
     if (!lm) return 0;
     
-    double power_needed = 0;
-    
-    /* Calculate power needed for all ON and deferred loads */
-    for (int i = 0; i < lm->load_count; i++) {
-        if (lm->load_states[i] == LOAD_STATE_ON || 
-            lm->load_states[i] == LOAD_STATE_DEFERRED) {
-            power_needed += lm->loads[i].rated_power;
-        }
-    }
-    
-    return power_needed;
+    /* Power needed for all ON and deferred loads */
+    return loads_on_power(lm) + lm->deferred_power;
 }
 
 
-/* Update total energy consumed for all loads (in watt-seconds) */
+/* Accumulate the energy drawn by the loads that are ON since the last update (kWh) */
 void loads_update_energy_consumed(load_manager_t* lm) {
     if (!lm) return;
 
-    time_t now = time(NULL);
-    double energy_consumed;
+    time_t now = clock_now();
+    double duration = difftime(now, lm->energy_update_ts);   // seconds
 
-    for (int i = 0; i < lm->load_count; i++) {
-        load_definition_t* load = &lm->loads[i];
-
-        /* Only count energy for loads that are ON */
-        if (load->current_state) {
-            double duration = difftime(now, load->last_state_change);   // seconds
-            energy_consumed += load->rated_power * duration;     // W * s
-            lm->total_energy_consumed = energy_consumed / 3600 / 1000;        // KWh
-            load->last_state_change = now;                              // reset timer
-        }
-    }
+    if (duration > 0) lm->total_energy_consumed += loads_on_power(lm) * duration / 3600 / 1000;
+    lm->energy_update_ts = now;
 }
 
 
@@ -11,22 +11,37 @@
 #include "config.h"
 #include "controller.h"
 #include "logging.h"
+#include "journal.h"
+#include "reload.h"
+#include "dispatch.h"
+#include "twin.h"
 
 // Application Config
 typedef struct {
     char *config_file;
     char *log_file;
+    char *journal_file;
     int debug_level;
+    bool simulate;              // run against the digital twin
+    double sim_speed;           // x real time, 0 = free-running
+    double outage_rate_per_day; // simulated random grid outages
+    double outage_mean_h;       // their mean length, 0 = the plant's default
+    double outage_at_h;         // simulated forced outage: local hour of day
+    double outage_for_h;        // and its length, 0 = none
 } app_config_t;
 
 // Global instances
 static volatile sig_atomic_t running = 1;
 static system_controller_t *system_ctrl = NULL;
 static system_config_t sys_config;
+static config_reload_t config_reloader;
+static dispatch_worker_t dispatcher;
+static twin_t twin;
 
 static app_config_t app_config = {
     .config_file = "config/default_config.json",
     .log_file = "log/solarize.log",
+    .journal_file = "log/solarize.journal",
     .debug_level = 1,
 };
 
@@ -36,11 +51,17 @@ static void signal_handler(int sig) {
     running = 0;
 }
 
+// SIGHUP: only wakes the reload worker, parsing happens off the control thread
+static void reload_signal_handler(int sig) {
+    (void)sig;
+    config_reload_request_file(&config_reloader);
+}
+
 // Argument Parsing
 static void parse_arguments(int argc, char *argv[]) {
     int opt;
 
-    while ((opt = getopt(argc, argv, "c:l:d:h")) != -1) {
+    while ((opt = getopt(argc, argv, "c:l:j:d:s:o:g:h")) != -1) {
         switch (opt) {
             case 'c':
                 app_config.config_file = optarg;
@@ -48,15 +69,40 @@ static void parse_arguments(int argc, char *argv[]) {
             case 'l':
                 app_config.log_file = optarg;
                 break;
+            case 'j':
+                app_config.journal_file = optarg;
+                break;
             case 'd':
                 app_config.debug_level = 1;
                 break;
+            case 's':
+                app_config.sim_speed = atof(optarg);
+                app_config.simulate = app_config.sim_speed >= 0.0;
+                break;
+            case 'o':
+                if (sscanf(optarg, "%lf,%lf", &app_config.outage_rate_per_day, &app_config.outage_mean_h) < 1 ||
+                    app_config.outage_rate_per_day < 0.0 || app_config.outage_mean_h < 0.0) {
+                    fprintf(stderr, "Invalid -o %s, expected <per day>[,<mean hours>]\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'g':
+                if (sscanf(optarg, "%lf,%lf", &app_config.outage_at_h, &app_config.outage_for_h) != 2 ||
+                    app_config.outage_at_h < 0.0 || app_config.outage_at_h >= 24.0 || app_config.outage_for_h <= 0.0) {
+                    fprintf(stderr, "Invalid -g %s, expected <hour of day>,<hours>\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
             case 'h':
                 printf("Usage: %s [options]\n", argv[0]);
                 printf("Options:\n");
                 printf("  -c <file>    Configuration file\n");
                 printf("  -l <file>    Log file\n");
+                printf("  -j <file>    Event journal file\n");
                 printf("  -d           Enable debug logging\n");
+                printf("  -s <speed>   Run against the simulated plant at speed x real time (0 = as fast as possible)\n");
+                printf("  -o <n>[,<h>] Simulated grid outages: n per day at random, h hours long on average\n");
+                printf("  -g <hh>,<h>  Simulated grid outage at local hour hh for h hours\n");
                 printf("  -h           Show this help\n");
                 exit(EXIT_SUCCESS);
         }
@@ -73,6 +119,10 @@ static int app_init(void) {
         return -1;
     }
 
+    // Event journal is an audit trail, not a control dependency
+    if (journal_open(app_config.journal_file) != 0)
+        LOG_WARNING("Event journal unavailable, continuing without it");
+
     // Setup signals
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
@@ -114,6 +164,32 @@ static int app_init(void) {
         return -1;
     }
 
+    // Live reload is a convenience; run without it if the worker cannot start
+    if (config_reload_start(&config_reloader, app_config.config_file) == 0) {
+        system_ctrl->reload = &config_reloader;
+        signal(SIGHUP, reload_signal_handler);
+    } else
+        LOG_WARNING("Configuration reload unavailable, SIGHUP ignored");
+
+    // Without the optimizer the controller falls back to its greedy rules
+    if (dispatch_start(&dispatcher) == 0)
+        system_ctrl->dispatch = &dispatcher;
+    else
+        LOG_WARNING("Dispatch optimizer unavailable, using rule-based dispatch");
+
+    // The plant replaces the hardware and the virtual clock drives the loop
+    if (app_config.simulate) {
+        if (twin_init(&twin, system_ctrl, (uint64_t)time(NULL)) != 0) {
+            LOG_ERROR("Failed to start the simulated plant");
+            return -1;
+        }
+        if (app_config.outage_rate_per_day > 0.0)
+            plant_set_outages(&twin.plant, app_config.outage_rate_per_day, app_config.outage_mean_h * 3600.0);
+        if (app_config.outage_for_h > 0.0)
+            twin_schedule_outage(&twin, app_config.outage_at_h, app_config.outage_for_h * 3600.0);
+        LOG_INFO("Simulating the plant at %gx real time", app_config.sim_speed);
+    }
+
     LOG_INFO("System init complete. Solarize now online.");
     LOG_DEBUG("Control interval: %d seconds", sys_config.control_interval);
 
@@ -125,17 +201,33 @@ static void app_run(void) {
     uint64_t cycle_count = 0;
 
     while (running) {
-        if (controller_run_cycle(system_ctrl) != 0)
+        // Swap in a reloaded configuration at the cycle boundary
+        system_config_t* reloaded = config_reload_take(&config_reloader);
+
+        controller_lock(system_ctrl);
+        if (reloaded) {
+            if (controller_apply_config(system_ctrl, reloaded) == 0)
+                memcpy(&sys_config, reloaded, sizeof(system_config_t));
+            free(reloaded);
+        }
+
+        int rc = app_config.simulate ? twin_step(&twin) : controller_run_cycle(system_ctrl);
+        controller_unlock(system_ctrl);
+        if (rc != 0)
             LOG_WARNING("Controller cycle %lu encountered an issue", cycle_count);
 
         cycle_count++;
 
+        double interval = sys_config.control_interval;
+        if (app_config.simulate)
+            interval = app_config.sim_speed > 0.0 ? interval / app_config.sim_speed : 0.0;
+
         struct timespec ts = {
-            .tv_sec = sys_config.control_interval,
-            .tv_nsec = 0
+            .tv_sec = (time_t)interval,
+            .tv_nsec = (long)((interval - (double)(time_t)interval) * 1e9)
         };
 
-        nanosleep(&ts, NULL);
+        if (interval > 0.0) nanosleep(&ts, NULL);
     }
 
     LOG_DEBUG("Total cycles completed: %lu", cycle_count);
@@ -143,12 +235,23 @@ static void app_run(void) {
 
 // Application Cleanup
 static void app_cleanup(void) {
+    signal(SIGHUP, SIG_IGN);
+    config_reload_stop(&config_reloader);
+    dispatch_stop(&dispatcher);
+
+    if (app_config.simulate) {
+        plant_log_status(&twin.plant);
+        twin_free(&twin);
+    }
+
     if (system_ctrl) {
         controller_cleanup(system_ctrl);
         free(system_ctrl);
         LOG_DEBUG("Controller cleaned up");
     }
 
+    journal_close();
+
     LOG_INFO("Shutdown complete");
     log_close();
 }
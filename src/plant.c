@@ -0,0 +1,515 @@
+#include "plant.h"
+#include "battery_limits.h"
+#include "battery_ocv.h"
+#include "battery_soc.h"
+#include "battery_thermal.h"
+#include "logging.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PLANT_PI                3.14159265358979323846
+#define PLANT_CHARGE_EFFICIENCY 0.995   // coulombic, on charge
+#define PLANT_BMS_MARGIN_V      0.02    // BMS cuts this far inside the controller's trip levels
+#define PLANT_VOC_RATIO         1.22    // Voc / Vmp of a crystalline string
+#define PLANT_VOLTAGE_COEFF     -0.0030 // string voltage per K of cell temperature
+
+static uint64_t plant_splitmix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+/* Uniform on (0, 1) */
+static double plant_uniform(plant_rng_t* rng) {
+    rng->state ^= rng->state >> 12;
+    rng->state ^= rng->state << 25;
+    rng->state ^= rng->state >> 27;
+    uint64_t x = rng->state * 0x2545F4914F6CDD1Dull;
+    return ((double)(x >> 11) + 0.5) * 0x1.0p-53;
+}
+
+static double plant_normal(plant_rng_t* rng) {
+    if (rng->has_spare) {
+        rng->has_spare = false;
+        return rng->spare;
+    }
+
+    double r = sqrt(-2.0 * log(plant_uniform(rng)));
+    double a = 2.0 * PLANT_PI * plant_uniform(rng);
+
+    rng->spare = r * sin(a);
+    rng->has_spare = true;
+    return r * cos(a);
+}
+
+static double plant_exponential(plant_rng_t* rng, double mean) {
+    return -mean * log(plant_uniform(rng));
+}
+
+/* Exact discretisation of an Ornstein-Uhlenbeck process over dt */
+static double plant_ou_step(plant_rng_t* rng, double x, double tau, double sigma, double dt) {
+    double a = exp(-dt / tau);
+    return a * x + sigma * sqrt(1.0 - a * a) * plant_normal(rng);
+}
+
+/* Mean solar time of day, hours */
+static double plant_solar_hour(const plant_t* plant) {
+    double h = fmod(plant->t / 3600.0 + plant->site.longitude / 15.0, 24.0);
+    return h < 0.0 ? h + 24.0 : h;
+}
+
+/* Daily consumption shape, morning and evening peaks, mean about 1 */
+static double plant_load_profile(double hour) {
+    double morning = exp(-pow((hour - 7.5) / 1.5, 2.0));
+    double evening = exp(-pow((hour - 19.0) / 2.5, 2.0));
+    return (0.6 + 0.5 * morning + 0.9 * evening) / 0.82;
+}
+
+static void plant_init_pv(plant_t* plant, const pv_system_t* pv) {
+    int count = pv->string_count;
+    int inverters = (count + PLANT_STRINGS_PER_INVERTER - 1) / PLANT_STRINGS_PER_INVERTER;
+    if (inverters > PLANT_MAX_INVERTERS) inverters = PLANT_MAX_INVERTERS;
+    if (inverters < 1) inverters = 1;
+
+    for (int i = 0; i < count; i++) {
+        const pv_string_t* str = &pv->strings[i];
+        double rated = str->enabled ? str->max_power : 0.0;
+
+        solar_array_set_plane(&plant->array, i, str->tilt, str->azimuth, plant->site.albedo,
+                              rated, str->temp_coefficient / 100.0);
+    }
+
+    // Strings are spread evenly; a large array puts more strings on each inverter
+    for (int k = 0; k < inverters; k++) {
+        plant_inverter_t* inv = &plant->inverters[k];
+        inv->first_string = (int)((long)count * k / inverters);
+        inv->string_count = (int)((long)count * (k + 1) / inverters) - inv->first_string;
+        inv->limit_percent = 100.0;
+        inv->enabled = true;
+
+        for (int i = inv->first_string; i < inv->first_string + inv->string_count; i++)
+            inv->rated_w += plant->array.rated_power[i];
+
+        double voc = count > 0 ? pv->strings[inv->first_string].max_voltage : 600.0;
+        inv->voc_stc = voc;
+        inv->vmp_stc = voc / PLANT_VOC_RATIO;
+    }
+    plant->inverter_count = inverters;
+}
+
+static void plant_init_bank(plant_t* plant, plant_bank_t* pb, const battery_bank_t* bank) {
+    const soc_ekf_params_t* ekf = soc_ekf_params(plant->chemistry);
+    const battery_thermal_params_t* thermal = battery_thermal_params(plant->chemistry);
+
+    pb->enabled = bank->enabled;
+    pb->series = bank->cells_in_series > 0 ? bank->cells_in_series : DEFAULT_BANK_SERIES_CELLS;
+    if (pb->series > PLANT_MAX_CELLS) pb->series = PLANT_MAX_CELLS;
+
+    double nominal_v = bank->nominal_voltage > 0.0 ? bank->nominal_voltage : DEFAULT_BANK_NOMINAL_V;
+    pb->capacity_ah = bank->capacity_wh * (bank->health_percent / 100.0) / nominal_v;
+    pb->max_charge_a = bank->max_charge_power / nominal_v;
+    pb->max_discharge_a = bank->max_discharge_power / nominal_v;
+    pb->charge_limit_a = pb->max_charge_a;
+    pb->discharge_limit_a = pb->max_discharge_a;
+
+    // The estimator's parameters are per Ah of bank capacity
+    double r0 = ekf->r0 / pb->capacity_ah;
+    pb->r1 = ekf->r1 / pb->capacity_ah;
+    pb->r2 = ekf->r2 / pb->capacity_ah;
+    pb->tau1 = ekf->tau1;
+    pb->tau2 = ekf->tau2;
+
+    for (int c = 0; c < pb->series; c++) {
+        pb->capacity[c] = (float)(pb->capacity_ah * (1.0 + PLANT_CELL_SPREAD * plant_normal(&plant->rng)));
+        pb->r0[c] = (float)(r0 * (1.0 + 5.0 * PLANT_CELL_SPREAD * plant_normal(&plant->rng)));
+        pb->soc[c] = (float)fmin(fmax(bank->bank_soc / 100.0 + 0.5 * PLANT_CELL_SPREAD * plant_normal(&plant->rng),
+                                      0.0), 1.0);
+    }
+
+    // BMS protects just inside the controller's trip levels
+    int rule_count = 0;
+    const battery_limit_rule_t* rules = battery_limit_rules(plant->chemistry, &rule_count);
+    pb->v_max_cell = 3.65;
+    pb->v_min_cell = 2.5;
+    for (int r = 0; rules && r < rule_count; r++) {
+        if (rules[r].signal == LIMIT_SIGNAL_CELL_VOLTAGE_MAX) pb->v_max_cell = rules[r].threshold - PLANT_BMS_MARGIN_V;
+        if (rules[r].signal == LIMIT_SIGNAL_CELL_VOLTAGE_MIN) pb->v_min_cell = rules[r].threshold + PLANT_BMS_MARGIN_V;
+    }
+
+    pb->temperature_c = plant->ambient_c;
+    pb->heat_capacity_jk = thermal->heat_capacity * bank->capacity_wh;
+    pb->conductance_wk = thermal->conductance * bank->capacity_wh / 1000.0;
+}
+
+/* Build the twin from the controller's nameplate data; start is unix seconds */
+int plant_init(plant_t* plant, const system_controller_t* ctrl, uint64_t seed, double start) {
+    if (!plant || !ctrl) return -1;
+
+    memset(plant, 0, sizeof(*plant));
+    plant->t = start;
+    plant->rng.state = plant_splitmix(seed) | 1u;
+
+    plant->site.latitude = ctrl->config.site_latitude;
+    plant->site.longitude = ctrl->config.site_longitude;
+    plant->site.albedo = SOLAR_DEFAULT_ALBEDO;
+    plant->sun.day = -1;
+    plant->clearness = PLANT_CLEARNESS_MEAN;
+    plant->ambient_c = 20.0;
+
+    const pv_system_t* pv = &ctrl->pv_system;
+    if (solar_array_alloc(&plant->array, pv->string_count > 0 ? pv->string_count : 1) != 0) return -1;
+    plant_init_pv(plant, pv);
+
+    battery_ocv_init();
+    const battery_system_t* bat = &ctrl->battery_system;
+    plant->chemistry = bat->chemistry;
+    plant->bank_count = bat->bank_count;
+    for (int b = 0; b < bat->bank_count; b++) plant_init_bank(plant, &plant->banks[b], &bat->banks[b]);
+
+    const load_manager_t* lm = &ctrl->load_manager;
+    plant->loads = calloc(lm->load_count > 0 ? (size_t)lm->load_count : 1, sizeof(plant_load_t));
+    if (!plant->loads) {
+        solar_array_free(&plant->array);
+        return -1;
+    }
+    plant->load_count = lm->load_count;
+    for (int i = 0; i < lm->load_count; i++) {
+        plant_load_t* load = &plant->loads[i];
+        load->rated_w = lm->loads[i].rated_power;
+        load->cycling = lm->loads[i].priority != PRIORITY_CRITICAL;
+        load->relay_on = true;
+        load->running = !load->cycling ||
+            plant_uniform(&plant->rng) < PLANT_LOAD_RUN_S / (PLANT_LOAD_RUN_S + PLANT_LOAD_IDLE_S);
+        load->last_change = (time_t)start;
+    }
+    plant->base_load_w = PLANT_BASE_LOAD_W;
+
+    plant->grid.available = true;
+    plant->grid.outage_rate_per_day = PLANT_OUTAGE_RATE_PER_DAY;
+    plant->grid.outage_mean_s = PLANT_OUTAGE_MEAN_S;
+    plant->grid.voltage = PLANT_GRID_VOLTAGE;
+    plant->grid.frequency = PLANT_GRID_FREQUENCY;
+
+    // Settle the cell voltages before the first reading
+    plant_step(plant, start);
+
+    LOG_INFO("Plant twin: %d inverters (%.0f W), %d banks, %d load channels",
+        plant->inverter_count, pv->total_capacity, plant->bank_count, plant->load_count);
+    return 0;
+}
+
+void plant_free(plant_t* plant) {
+    if (!plant) return;
+    solar_array_free(&plant->array);
+    free(plant->loads);
+    plant->loads = NULL;
+    plant->load_count = 0;
+}
+
+/* Force the grid down or let it back (random outages continue to apply) */
+void plant_set_grid(plant_t* plant, bool available) {
+    if (!plant) return;
+    if (!available && !plant->grid.forced_down) plant->grid.outage_count++;
+    plant->grid.forced_down = !available;
+}
+
+void plant_set_outages(plant_t* plant, double rate_per_day, double mean_s) {
+    if (!plant) return;
+
+    plant->grid.outage_rate_per_day = rate_per_day > 0.0 ? rate_per_day : 0.0;
+    plant->grid.outage_mean_s = mean_s > 0.0 ? mean_s : PLANT_OUTAGE_MEAN_S;
+    plant->grid.next_outage = rate_per_day > 0.0
+        ? plant->t + plant_exponential(&plant->rng, 86400.0 / rate_per_day) : 0.0;
+}
+
+/* Power drawn by consumers the twin does not model itself */
+void plant_set_external_load(plant_t* plant, double power_w) {
+    if (!plant) return;
+    plant->external_w = power_w > 0.0 ? power_w : 0.0;
+}
+
+static void plant_step_environment(plant_t* plant, double dt) {
+    double hour = plant_solar_hour(plant);
+
+    plant->ambient_c = 15.0 + 7.0 * sin(2.0 * PLANT_PI * (hour - 9.0) / 24.0);
+    plant->cloud = plant_ou_step(&plant->rng, plant->cloud, PLANT_CLOUD_TAU_S, PLANT_CLOUD_SIGMA, dt);
+    plant->clearness = fmin(PLANT_CLEARNESS_MEAN * exp(plant->cloud - 0.5 * PLANT_CLOUD_SIGMA * PLANT_CLOUD_SIGMA),
+                            1.0);
+
+    // Random outages
+    plant_grid_t* grid = &plant->grid;
+    if (grid->outage_rate_per_day > 0.0 && grid->next_outage > 0.0 && plant->t >= grid->next_outage) {
+        grid->outage_until = plant->t + plant_exponential(&plant->rng, grid->outage_mean_s);
+        grid->next_outage = grid->outage_until + plant_exponential(&plant->rng, 86400.0 / grid->outage_rate_per_day);
+        grid->outage_count++;
+    }
+
+    bool available = !grid->forced_down && plant->t >= grid->outage_until;
+    if (available && !grid->available) LOG_DEBUG("Plant: grid restored");
+    if (!available && grid->available) LOG_DEBUG("Plant: grid outage");
+    grid->available = available;
+}
+
+/* Available AC power of each inverter under its limit */
+static void plant_step_pv(plant_t* plant) {
+    solar_sample_t sample;
+
+    solar_table_refresh(&plant->sun, &plant->site, (time_t)plant->t);
+    solar_table_sample(&plant->sun, (time_t)plant->t, &sample);
+
+    // Clouds take the beam first; part of it comes back as diffuse
+    double kc = plant->clearness;
+    double beam = sample.dni * sample.sun_u;
+    sample.dni *= (float)(kc * kc);
+    sample.dhi = (float)(sample.dhi + 0.5 * beam * kc * (1.0 - kc));
+    sample.ghi = (float)(sample.dni * fmax(sample.sun_u, 0.0f) + sample.dhi);
+
+    solar_array_evaluate(&plant->array, &sample, plant->ambient_c);
+
+    plant->pv_w = 0.0;
+    for (int k = 0; k < plant->inverter_count; k++) {
+        plant_inverter_t* inv = &plant->inverters[k];
+        double dc = 0.0;
+
+        for (int i = inv->first_string; i < inv->first_string + inv->string_count; i++)
+            dc += plant->array.expected[i] * PLANT_DC_LOSSES;
+
+        double available = dc * PLANT_INVERTER_EFFICIENCY;
+        double limit = inv->rated_w * inv->limit_percent / 100.0;
+        double ac = inv->enabled ? fmin(available, limit) : 0.0;
+
+        if (ac > 0.0 && inv->ac_power <= 0.0) inv->start_count++;
+        inv->ac_power = ac;
+        inv->dc_power = ac / PLANT_INVERTER_EFFICIENCY;
+        plant->pv_w += ac;
+
+        // Cell temperature from the loading; throttling walks the strings towards Voc
+        double loading = inv->rated_w > 0.0 ? dc / inv->rated_w : 0.0;
+        inv->temperature_c = plant->ambient_c + SOLAR_CELL_RISE * SOLAR_STC_IRRADIANCE * loading;
+        double vmp = inv->vmp_stc * (1.0 + PLANT_VOLTAGE_COEFF * (inv->temperature_c - 25.0));
+        double voc = inv->voc_stc * (1.0 + PLANT_VOLTAGE_COEFF * (inv->temperature_c - 25.0));
+        double throttle = available > 0.0 ? 1.0 - ac / available : 0.0;
+        inv->dc_voltage = dc > 0.0 ? vmp + (voc - vmp) * throttle : 0.0;
+        inv->dc_current = inv->dc_voltage > 0.0 ? inv->dc_power / inv->dc_voltage : 0.0;
+
+        double share = dc > 0.0 ? inv->dc_power / dc : 0.0;
+        int reported = inv->string_count < PLANT_STRINGS_REPORTED ? inv->string_count : PLANT_STRINGS_REPORTED;
+        for (int s = 0; s < reported; s++) {
+            double p = plant->array.expected[inv->first_string + s] * PLANT_DC_LOSSES * share;
+            inv->string_power[s] = (float)p;
+            inv->string_voltage[s] = (float)inv->dc_voltage;
+            inv->string_current[s] = inv->dc_voltage > 0.0 ? (float)(p / inv->dc_voltage) : 0.0f;
+        }
+    }
+}
+
+static void plant_step_loads(plant_t* plant, double dt) {
+    plant->base_noise = plant_ou_step(&plant->rng, plant->base_noise, PLANT_LOAD_TAU_S, PLANT_LOAD_SIGMA, dt);
+    double load = plant->base_load_w * plant_load_profile(plant_solar_hour(plant)) *
+                  exp(plant->base_noise - 0.5 * PLANT_LOAD_SIGMA * PLANT_LOAD_SIGMA);
+
+    double p_stop = 1.0 - exp(-dt / PLANT_LOAD_RUN_S);
+    double p_start = 1.0 - exp(-dt / PLANT_LOAD_IDLE_S);
+
+    for (int i = 0; i < plant->load_count; i++) {
+        plant_load_t* ch = &plant->loads[i];
+
+        if (ch->cycling && plant_uniform(&plant->rng) < (ch->running ? p_stop : p_start))
+            ch->running = !ch->running;
+
+        ch->power_w = ch->relay_on && ch->running ? ch->rated_w * (0.9 + 0.1 * plant_uniform(&plant->rng)) : 0.0;
+        load += ch->power_w;
+    }
+    plant->load_w = load;
+}
+
+/* Current (A, positive = charging) a bank can take or give without a cell
+ * crossing the BMS cut-offs this step */
+static void plant_bank_headroom(const plant_t* plant, const plant_bank_t* pb, double* charge_a, double* discharge_a) {
+    double charge = pb->max_charge_a, discharge = pb->max_discharge_a;
+
+    for (int c = 0; c < pb->series; c++) {
+        double rest = battery_ocv_voltage(plant->chemistry, pb->soc[c] * 100.0, pb->temperature_c, NULL) +
+                      pb->v1[c] + pb->v2[c];
+        charge = pb->soc[c] >= 1.0f ? 0.0 : fmin(charge, (pb->v_max_cell - rest) / pb->r0[c]);
+        discharge = pb->soc[c] <= 0.0f ? 0.0 : fmin(discharge, (rest - pb->v_min_cell) / pb->r0[c]);
+    }
+
+    *charge_a = fmax(charge, 0.0);
+    *discharge_a = fmax(discharge, 0.0);
+}
+
+/* Integrate one bank at a constant current */
+static void plant_step_bank(plant_t* plant, plant_bank_t* pb, double current, double dt) {
+    double a1 = exp(-dt / pb->tau1);
+    double a2 = pb->r2 > 0.0 ? exp(-dt / pb->tau2) : 0.0;
+    double eta = current > 0.0 ? PLANT_CHARGE_EFFICIENCY : 1.0;
+    double voltage = 0.0, heat = 0.0;
+
+    for (int c = 0; c < pb->series; c++) {
+        double soc = pb->soc[c] + eta * current * dt / (3600.0 * pb->capacity[c]);
+        pb->soc[c] = (float)fmin(fmax(soc, 0.0), 1.0);
+        pb->v1[c] = (float)(a1 * pb->v1[c] + pb->r1 * (1.0 - a1) * current);
+        pb->v2[c] = (float)(a2 * pb->v2[c] + pb->r2 * (1.0 - a2) * current);
+
+        double v = battery_ocv_voltage(plant->chemistry, pb->soc[c] * 100.0, pb->temperature_c, NULL) +
+                   pb->v1[c] + pb->v2[c] + pb->r0[c] * current;
+        pb->cell_voltage[c] = (float)v;
+        voltage += v;
+        heat += (pb->r0[c] * current + pb->v1[c] + pb->v2[c]) * current;
+    }
+
+    pb->current_a = current;
+    pb->voltage = voltage;
+    pb->heat_w = fmax(heat, 0.0);
+    pb->temperature_c = battery_thermal_predict(pb->temperature_c, plant->ambient_c, pb->heat_w,
+        pb->heat_capacity_jk, pb->conductance_wk, dt);
+
+    // Cells in the middle of the string run warmer
+    for (int c = 0; c < pb->series; c++) {
+        double pos = pb->series > 1 ? (double)c / (pb->series - 1) : 0.5;
+        pb->temperature[c] = (float)(pb->temperature_c + 0.2 * (pb->temperature_c - plant->ambient_c) *
+                                     sin(PLANT_PI * pos));
+    }
+
+    double energy_wh = voltage * current * dt / 3600.0;
+    if (energy_wh > 0.0) pb->charge_wh += energy_wh;
+    else pb->discharge_wh -= energy_wh;
+    if (current > 0.0 && pb->soc[0] >= 0.999f) pb->last_full_charge = (time_t)plant->t;
+}
+
+/* Battery and grid balance. Grid-connected the banks follow their commands;
+ * islanded they carry the net load and PV or load gives way. */
+static void plant_step_balance(plant_t* plant, double dt) {
+    double charge_a[MAX_BATTERY_BANKS], discharge_a[MAX_BATTERY_BANKS];
+    double capacity = 0.0;
+
+    for (int b = 0; b < plant->bank_count; b++) {
+        plant_bank_t* pb = &plant->banks[b];
+        plant_bank_headroom(plant, pb, &charge_a[b], &discharge_a[b]);
+        if (!pb->enabled) charge_a[b] = discharge_a[b] = 0.0;
+        if (pb->enabled) capacity += pb->capacity_ah;
+    }
+
+    double net = plant->load_w + plant->external_w - plant->pv_w;
+    double battery = 0.0;
+    plant->curtailed_w = 0.0;
+    plant->unserved_w = 0.0;
+
+    for (int b = 0; b < plant->bank_count; b++) {
+        plant_bank_t* pb = &plant->banks[b];
+        double current;
+        double v = pb->voltage > 0.0 ? pb->voltage : pb->series * 3.2;
+
+        if (plant->grid.available) {
+            current = pb->command_a;
+            if (current > 0.0) current = pb->charge_enabled ? fmin(current, pb->charge_limit_a) : 0.0;
+            if (current < 0.0) current = pb->discharge_enabled ? fmax(current, -pb->discharge_limit_a) : 0.0;
+        } else {
+            double share = capacity > 0.0 ? pb->capacity_ah / capacity : 0.0;
+            current = -net * share / v;
+        }
+
+        current = fmin(fmax(current, -discharge_a[b]), charge_a[b]);
+        plant_step_bank(plant, pb, current, dt);
+        battery -= pb->voltage * current;
+    }
+    plant->battery_w = battery;
+
+    plant_grid_t* grid = &plant->grid;
+    if (grid->available) {
+        grid->power_w = net - battery;
+        grid->voltage = PLANT_GRID_VOLTAGE - 0.0002 * grid->power_w + 1.0 * plant_normal(&plant->rng);
+        grid->frequency = PLANT_GRID_FREQUENCY + 0.01 * plant_normal(&plant->rng);
+
+        double energy_wh = grid->power_w * dt / 3600.0;
+        if (energy_wh > 0.0) grid->import_wh += energy_wh;
+        else grid->export_wh -= energy_wh;
+
+        if (grid->power_w > grid->peak_import_w) {
+            grid->peak_import_w = grid->power_w;
+            grid->peak_import_time = (time_t)plant->t;
+        }
+        if (-grid->power_w > grid->peak_export_w) {
+            grid->peak_export_w = -grid->power_w;
+            grid->peak_export_time = (time_t)plant->t;
+        }
+        return;
+    }
+
+    grid->power_w = 0.0;
+    grid->voltage = 0.0;
+    grid->frequency = 0.0;
+
+    double residual = net - battery;
+    if (residual < 0.0) {
+        // Surplus the banks cannot take: throttle the inverters evenly
+        double scale = plant->pv_w > 0.0 ? fmax(1.0 + residual / plant->pv_w, 0.0) : 0.0;
+        for (int k = 0; k < plant->inverter_count; k++) plant->inverters[k].ac_power *= scale;
+        plant->curtailed_w = -residual;
+        plant->pv_w *= scale;
+    } else if (residual > 0.0) {
+        plant->unserved_w = residual;
+        plant->unserved_wh += residual * dt / 3600.0;
+        plant->load_w = fmax(plant->load_w - residual, 0.0);
+    }
+}
+
+/* Integrate the plant up to now (unix seconds) */
+void plant_step(plant_t* plant, double now) {
+    if (!plant) return;
+
+    double remaining = now - plant->t;
+
+    // Initial or zero-length step: refresh the readings without moving time
+    if (remaining <= 0.0) {
+        plant_step_pv(plant);
+        plant_step_loads(plant, 0.0);
+        plant_step_balance(plant, 1e-3);
+        return;
+    }
+
+    while (remaining > 0.0) {
+        double dt = fmin(remaining, PLANT_MAX_STEP_S);
+        long day = (long)floor((plant->t + plant->site.longitude * 240.0) / 86400.0);
+
+        plant->t += dt;
+        remaining -= dt;
+
+        plant_step_environment(plant, dt);
+        plant_step_pv(plant);
+        plant_step_loads(plant, dt);
+        plant_step_balance(plant, dt);
+
+        // Daily inverter yield resets at solar midnight
+        bool new_day = (long)floor((plant->t + plant->site.longitude * 240.0) / 86400.0) != day;
+        for (int k = 0; k < plant->inverter_count; k++) {
+            plant_inverter_t* inv = &plant->inverters[k];
+            if (new_day) inv->daily_wh = 0.0;
+            inv->energy_wh += inv->ac_power * dt / 3600.0;
+            inv->daily_wh += inv->ac_power * dt / 3600.0;
+        }
+    }
+}
+
+void plant_log_status(const plant_t* plant) {
+    if (!plant) return;
+
+    printf("\n=== Plant Twin ===\n");
+    printf("Clearness: %.2f, ambient %.1f °C\n", plant->clearness, plant->ambient_c);
+    printf("PV: %.0f W (curtailed %.0f W)  Load: %.0f W (+%.0f W external)  Battery: %.0f W\n",
+           plant->pv_w, plant->curtailed_w, plant->load_w, plant->external_w, plant->battery_w);
+    for (int b = 0; b < plant->bank_count; b++) {
+        const plant_bank_t* pb = &plant->banks[b];
+        printf("  Bank %d: %.1f V %.1f A, cell SOC %.1f %%, %.1f °C\n",
+               b, pb->voltage, pb->current_a, pb->soc[0] * 100.0, pb->temperature_c);
+    }
+    printf("Grid: %s, %.0f W at %.1f V, import %.2f kWh, export %.2f kWh, outages %u\n",
+           plant->grid.available ? "up" : "DOWN", plant->grid.power_w, plant->grid.voltage,
+           plant->grid.import_wh / 1000.0, plant->grid.export_wh / 1000.0, plant->grid.outage_count);
+    if (plant->unserved_wh > 0.0)
+        printf("Unserved: %.0f Wh\n", plant->unserved_wh);
+}
@@ -1,33 +1,114 @@
 #include "pv.h"
+#include "clock.h"
 #include "logging.h"
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdint.h>
 
-#define MPPT_PERTURB_INTERVAL_SEC 0.1  /* 100 ms */
-#define FAULT_VOLTAGE_THRESHOLD 0.3   /* 30% voltage deviation */
-#define FAULT_CURRENT_THRESHOLD 0.5   /* 50% current imbalance */
 #define MIN_VALID_VOLTAGE 0.1         /* minimal sensible PV voltage (V) */
 #define MIN_VALID_CURRENT 0.0         /* minimal sensible PV current (A) */
+#define PV_SOILING_FACTOR 0.98
+#define PV_WIRING_FACTOR  0.97
+#define PV_DETECT_MIN_SUN 0.087       /* sin(5 deg): below this, peer comparison is unreliable */
 
 static const char* pv_state_str[] = {
     "OFF", "STARTING", "MPPT", "CURTAILED", "FAULT", "MAINTENANCE"
 };
 
-static const char* mppt_algorithm_str[] = {
-    "OFF", "PERTURB_OBSERVE", "INCREMENTAL_CONDUCTANCE", "CONSTANT_VOLTAGE"
-};
+/* Site and plane geometry from the config into the clear-sky model; the
+ * sun table is rebuilt on the next update */
+static void pv_apply_geometry(pv_system_t* pv, const system_config_t* config) {
+    pv->site.latitude = config->site_latitude;
+    pv->site.longitude = config->site_longitude;
+    pv->site.albedo = SOLAR_DEFAULT_ALBEDO;
+    pv->sun.day = -1;
+
+    for (int i = 0; i < pv->string_count; ++i) {
+        pv_string_t* str = &pv->strings[i];
+
+        str->tilt = config->pv_tilt;
+        str->azimuth = config->pv_azimuth;
+        str->temp_coefficient = config->pv_temp_coefficient;
+
+        solar_array_set_plane(&pv->solar, i, str->tilt, str->azimuth, pv->site.albedo,
+                              str->max_power, str->temp_coefficient / 100.0);
+    }
+}
+
+/* Allocate a string table of count strings */
+static int pv_alloc_strings(pv_config_stage_t* stage, int count) {
+    memset(stage, 0, sizeof(*stage));
+
+    stage->strings = calloc((size_t)count, sizeof(pv_string_t));
+    if (!stage->strings) {
+        LOG_ERROR("Failed to allocate %d PV strings", count);
+        return -1;
+    }
+
+    if (pv_strings_alloc(&stage->telemetry, count) != 0) {
+        free(stage->strings);
+        stage->strings = NULL;
+        return -1;
+    }
 
-/* Helper: monotonic seconds as double */
-static double monotonic_seconds(void) {
-    struct timespec ts;
-    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
-        return ts.tv_sec + ts.tv_nsec / 1e9;
+    if (solar_array_alloc(&stage->solar, count) != 0) {
+        pv_strings_free(&stage->telemetry);
+        free(stage->strings);
+        stage->strings = NULL;
+        return -1;
     }
-    return (double)time(NULL);
+
+    stage->count = count;
+    return 0;
+}
+
+/* Replace the string table with an allocated one and set its defaults;
+ * cannot fail */
+static void pv_install_strings(pv_system_t* pv, const system_config_t* config, pv_config_stage_t* stage) {
+    int count = stage->count;
+
+    free(pv->strings);
+    pv_strings_free(&pv->telemetry);
+    solar_array_free(&pv->solar);
+    pv->strings = stage->strings;
+    pv->string_count = count;
+    pv->telemetry = stage->telemetry;
+    pv->solar = stage->solar;
+    memset(stage, 0, sizeof(*stage));
+
+    pv->active_string_count = 0;
+    pv->total_capacity = 0.0;
+
+    for (int i = 0; i < count; ++i) {
+        snprintf(pv->strings[i].string_id, sizeof(pv->strings[i].string_id),
+                 "PV_STRING_%d", i + 1);
+
+        pv->strings[i].max_power   = 5000.0; /* W */
+        pv->strings[i].max_voltage = 600.0;  /* V (Voc-like) */
+        pv->strings[i].max_current = 10.0;   /* A */
+        pv->strings[i].enabled     = true;
+        pv->strings[i].fault       = false;
+        pv->strings[i].efficiency  = 98.5;   /* percent-ish */
+
+        pv->telemetry.voltage_limit[i] = (float)pv->strings[i].max_voltage;
+        pv->telemetry.current_limit[i] = (float)pv->strings[i].max_current;
+
+        if (pv->strings[i].enabled && !pv->strings[i].fault) {
+            pv->active_string_count++;
+            pv->total_capacity += pv->strings[i].max_power;
+        }
+    }
+
+    pv->max_operating_power = pv->total_capacity;
+    pv_apply_geometry(pv, config);
+}
+
+static int pv_config_string_count(const system_config_t* config) {
+    return config->pv_string_count > 0 ? config->pv_string_count : MAX_PV_STRINGS;
 }
 
 /* Initialize PV system context with safe defaults */
@@ -39,14 +120,9 @@ int pv_init(pv_system_t* pv, const system_config_t* config) {
 
     pv->state = PV_STATE_MPPT;
     pv->mppt_algorithm = MPPT_PERTURB_OBSERVE;
-    pv->mppt_step_size = 0.5;          /* volts per step */
-    pv->mppt_voltage_ref = 0.0;
-    pv->mppt_power_ref = 0.0;
 
-    pv->active_string_count = 0;
-    pv->total_capacity = 0.0;
     pv->available_power = 0.0;
-    pv->max_operating_power = 0.0;
+    pv->ambient_temperature_c = 25.0;
 
     pv->daily_energy = 0.0;
     pv->monthly_energy = 0.0;
@@ -54,46 +130,136 @@ int pv_init(pv_system_t* pv, const system_config_t* config) {
 
     pv->fault_count = 0;
     pv->last_fault_time = 0;
-    pv->last_reset_time = time(NULL);
+    pv->last_reset_time = clock_now();
     pv->last_fault_reason[0] = '\0';
+    pv_forecast_init(&pv->forecast);
 
-    /* Initialize strings with sane defaults and accumulate capacity */
-    for (int i = 0; i < MAX_PV_STRINGS; ++i) {
-        /* Defensive: ensure string_id buffer exists in struct */
-        snprintf(pv->strings[i].string_id, sizeof(pv->strings[i].string_id),
-                 "PV_STRING_%d", i + 1);
+    pv_config_stage_t stage;
+    if (pv_alloc_strings(&stage, pv_config_string_count(config)) != 0) return -1;
+    pv_install_strings(pv, config, &stage);
 
-        pv->strings[i].max_power   = 5000.0; /* W */
-        pv->strings[i].max_voltage = 600.0;  /* V (Voc-like) */
-        pv->strings[i].max_current = 10.0;   /* A */
-        pv->strings[i].enabled     = true;
-        pv->strings[i].fault       = false;
-        pv->strings[i].efficiency  = 98.5;   /* percent-ish */
-        /* Optional sensible per-string defaults if those fields exist */
-        /* pv->strings[i].irradiance = 1000.0; pv->strings[i].temperature = 25.0; */
+    /* string 0's rating stands in for the array Voc */
+    pv_mppt_tracker_init(&pv->mppt_tracker, pv->mppt_algorithm, pv->strings[0].max_voltage);
+    return 0;
+}
 
-        if (pv->strings[i].enabled && !pv->strings[i].fault) {
-            pv->active_string_count++;
-            pv->total_capacity += pv->strings[i].max_power;
-        }
+/* Allocate the string table for a reload if the configured count changed;
+ * nothing changes until pv_commit_config */
+int pv_prepare_config(const pv_system_t* pv, const system_config_t* config, pv_config_stage_t* stage) {
+    if (!pv || !config || !stage) return -1;
+
+    int count = pv_config_string_count(config);
+    if (count == pv->string_count) {
+        memset(stage, 0, sizeof(*stage));
+        return 0;
     }
+    return pv_alloc_strings(stage, count);
+}
 
-    pv->max_operating_power = pv->total_capacity;
+/* Resize the string table when the configured count changed (string faults
+ * and detector history restart); otherwise only the geometry is refreshed.
+ * Cannot fail. */
+void pv_commit_config(pv_system_t* pv, const system_config_t* config, pv_config_stage_t* stage) {
+    if (!pv || !config || !stage) return;
+
+    if (pv->mppt) pv_mppt_set_rate(pv->mppt, config->pv_mppt_rate_hz);
+
+    if (stage->count == 0) {
+        pv_apply_geometry(pv, config);
+        return;
+    }
+
+    pv_install_strings(pv, config, stage);
+    LOG_INFO("PV reconfigured: %d strings, capacity %.0f W", pv->string_count, pv->total_capacity);
+}
+
+void pv_discard_config(pv_config_stage_t* stage) {
+    if (!stage || stage->count == 0) return;
 
+    free(stage->strings);
+    pv_strings_free(&stage->telemetry);
+    solar_array_free(&stage->solar);
+    memset(stage, 0, sizeof(*stage));
+}
+
+int pv_apply_config(pv_system_t* pv, const system_config_t* config) {
+    pv_config_stage_t stage;
+
+    if (pv_prepare_config(pv, config, &stage) != 0) return -1;
+    pv_commit_config(pv, config, &stage);
     return 0;
 }
 
+void pv_cleanup(pv_system_t* pv) {
+    if (!pv) return;
+
+    free(pv->strings);
+    pv->strings = NULL;
+    pv->string_count = 0;
+    pv_strings_free(&pv->telemetry);
+    solar_array_free(&pv->solar);
+}
+
+/* Clear-sky power of the healthy strings at another instant (forecast callback) */
+static double pv_clear_sky_at(void* ctx, time_t t) {
+    pv_system_t* pv = (pv_system_t*)ctx;
+    solar_sample_t sample;
+
+    solar_table_sample(&pv->sun, t, &sample);
+    const float* power = solar_array_evaluate_at(&pv->solar, &sample, pv->ambient_temperature_c);
+    if (!power) return 0.0;
+
+    double total = 0.0;
+    for (int i = 0; i < pv->string_count; ++i) {
+        if (pv->strings[i].enabled && !pv->strings[i].fault) total += power[i];
+    }
+    return total;
+}
+
+/* Clear-sky power of every string for this instant; the sun table is
+ * rebuilt when the UTC day changes */
+static void pv_update_solar(pv_system_t* pv, time_t now) {
+    solar_table_refresh(&pv->sun, &pv->site, now);
+    solar_table_sample(&pv->sun, now, &pv->sun_now);
+    solar_array_evaluate(&pv->solar, &pv->sun_now, pv->ambient_temperature_c);
+
+    double expected = 0.0;
+    for (int i = 0; i < pv->string_count; ++i) {
+        if (pv->strings[i].enabled && !pv->strings[i].fault) expected += pv->solar.expected[i];
+    }
+    pv->expected_power = expected;
+}
+
 // Update PV measurements and accumulate energy
 void pv_update_measurements(pv_system_t* pv, system_measurements_t* measurements) {
     if (!pv || !measurements) return;
 
     int active_strings = 0;
-    double available_power = pv_calculate_available_power(pv, measurements);
+    double now = clock_monotonic();
+    time_t wall = clock_now();
+    double available_power = 0.0, worker_energy = 0.0, Wh = 0.0;
+    bool observed = true;
+
+    pv_update_solar(pv, wall);
+
+    /* Inverter readings first, then the MPPT workers' tracked power, then the
+     * rating-based estimate */
+    if (measurements->measured & MEASURED_PV) {
+        available_power = measurements->pv_power_total;
+        if (pv->last_update_time > 0.0 && now > pv->last_update_time)
+            Wh = available_power * ((now - pv->last_update_time) / 3600.0);
+    } else if (pv->mppt && pv_mppt_collect(pv->mppt, &available_power, &worker_energy) > 0) {
+        if (worker_energy >= pv->mppt_energy_wh) Wh = worker_energy - pv->mppt_energy_wh;
+        pv->mppt_energy_wh = worker_energy;
+    } else {
+        observed = false;
+        available_power = pv_calculate_available_power(pv, measurements);
+        if (pv->last_update_time > 0.0 && now > pv->last_update_time)
+            Wh = available_power * ((now - pv->last_update_time) / 3600.0);
+    }
 
-    for (int i = 0; i < MAX_PV_STRINGS; ++i) {
-        measurements->pv_voltage[i] = 0.9;
-        measurements->pv_current[i] = 0.8;
-        active_strings++;
+    for (int i = 0; i < pv->string_count; ++i) {
+        if (pv->strings[i].enabled && !pv->strings[i].fault) active_strings++;
     }
 
     measurements->pv_power_total = available_power;
@@ -101,43 +267,22 @@ void pv_update_measurements(pv_system_t* pv, system_measurements_t* measurements
     pv->active_string_count = active_strings;
     pv->available_power = available_power;
 
-    // Energy integration (Wh) using monotonic time deltas
-    static double last_t = 0.0;
-    double now = monotonic_seconds();
+    pv->daily_energy += Wh;
+    pv->total_energy += Wh;
+    pv->last_update_time = now;
 
-    if (last_t > 0.0 && now > last_t) {
-        double dt = now - last_t;          // seconds
-        double Wh = available_power * (dt / 3600.0);
-        pv->daily_energy += Wh;
-        pv->total_energy += Wh;
-    }
-    
-    last_t = now;
+    // The forecast learns from real readings only and is rebuilt when a 15 min slot closes
+    bool slot_closed = observed && pv_forecast_observe(&pv->forecast, wall, available_power, pv->expected_power);
+    if (slot_closed || pv->forecast.first_slot < 0)
+        pv_forecast_predict(&pv->forecast, wall, pv_clear_sky_at, pv);
 }
 
-/* Estimate available power using derating factors */
+/* Estimate available power from the clear-sky model (refreshed by
+ * pv_update_measurements) with fixed soiling and wiring losses */
 double pv_calculate_available_power(pv_system_t* pv, system_measurements_t* measurements) {
     if (!pv || !measurements) return 0.0;
 
-    double available_power = 0.0;
-
-    for (int i = 0; i < MAX_PV_STRINGS; ++i) {
-        if (!pv->strings[i].enabled || pv->strings[i].fault) continue;
-
-        /* default derating factors; these can be replaced by real sensors later */
-        double irradiance_factor = 1.0;
-        double temp_factor = 1.0;
-        double soiling_factor = 0.98;
-        double wiring_loss = 0.97;
-
-        double max_string = pv->strings[i].max_power
-                            * irradiance_factor
-                            * temp_factor
-                            * soiling_factor
-                            * wiring_loss;
-
-        available_power += max_string;
-    }
+    double available_power = pv->expected_power * PV_SOILING_FACTOR * PV_WIRING_FACTOR;
 
     /* ensure we never claim more than installed capacity */
     if (available_power > pv->total_capacity) available_power = pv->total_capacity;
@@ -145,10 +290,11 @@ double pv_calculate_available_power(pv_system_t* pv, system_measurements_t* meas
     return available_power;
 }
 
-/* MPPT routine with monotonic timing and safety guards */
+/* Control-cycle MPPT on the aggregate DC input, for installs without the
+ * per-inverter workers; with a worker attached the workers own tracking */
 void pv_run_mppt(pv_system_t* pv, system_measurements_t* measurements) {
     if (!pv || !measurements) return;
-    if (pv->state != PV_STATE_MPPT) return;
+    if (pv->state != PV_STATE_MPPT || pv->mppt) return;
 
     /* Skip MPPT if there is effectively no PV production (night / sensor failure) */
     if (measurements->pv_power_total <= 0.1) {
@@ -156,98 +302,31 @@ void pv_run_mppt(pv_system_t* pv, system_measurements_t* measurements) {
         return;
     }
 
-    static double last_mppt_time = 0.0;
-    double now = monotonic_seconds();
-    if (last_mppt_time > 0.0 && (now - last_mppt_time) < MPPT_PERTURB_INTERVAL_SEC) {
-        return;
-    }
-    last_mppt_time = now;
-
-    /* Ensure there is at least one valid voltage to reference */
-    double v_ref_measure = 0.0;
-    bool have_voltage = false;
+    /* Track on the first valid DC voltage */
     for (int i = 0; i < MAX_PV_STRINGS; ++i) {
         double v = measurements->pv_voltage[i];
         if (isfinite(v) && v >= MIN_VALID_VOLTAGE) {
-            v_ref_measure = v;
-            have_voltage = true;
+            if (pv->mppt_tracker.algorithm != pv->mppt_algorithm)
+                pv_mppt_tracker_init(&pv->mppt_tracker, pv->mppt_algorithm, pv->strings[0].max_voltage);
+            pv_mppt_tracker_step(&pv->mppt_tracker, v, measurements->pv_power_total);
             break;
         }
     }
 
-    switch (pv->mppt_algorithm) {
-        case MPPT_PERTURB_OBSERVE: {
-            double current_power = measurements->pv_power_total;
-            double current_voltage = have_voltage ? v_ref_measure : pv->mppt_voltage_ref;
-
-            if (pv->mppt_power_ref <= 0.0) {
-                /* first-run initialization */
-                pv->mppt_power_ref = current_power;
-                pv->mppt_voltage_ref = current_voltage > 0.0 ? current_voltage : (pv->strings[0].max_voltage * 0.78);
-            } else {
-                if (current_power > pv->mppt_power_ref) {
-                    /* continue same direction */
-                    pv->mppt_voltage_ref += (current_voltage > pv->mppt_voltage_ref) ?
-                                            pv->mppt_step_size : -pv->mppt_step_size;
-                } else {
-                    /* reverse direction */
-                    pv->mppt_voltage_ref += (current_voltage > pv->mppt_voltage_ref) ?
-                                            -pv->mppt_step_size : pv->mppt_step_size;
-                }
-                pv->mppt_power_ref = current_power;
-            }
-            break;
-        }
-
-        case MPPT_INCREMENTAL_CONDUCTANCE: {
-            static double prev_power = 0.0;
-            static double prev_voltage = 0.0;
-
-            double prevP = prev_power;
-            double prevV = prev_voltage;
-            double curP = measurements->pv_power_total;
-            double curV = have_voltage ? v_ref_measure : prevV;
-
-            double deltaV = curV - prevV;
-            double deltaP = curP - prevP;
-
-            if (fabs(deltaV) > 1e-6 && fabs(curV) > 1e-6) {
-                double g = (curP / curV);
-                double dg = (deltaP / deltaV);
-
-                if (fabs(dg) > fabs(g)) {
-                    pv->mppt_voltage_ref += pv->mppt_step_size;
-                } else {
-                    pv->mppt_voltage_ref -= pv->mppt_step_size;
-                }
-            }
-            prev_power = curP;
-            prev_voltage = curV;
-            break;
-        }
-
-        case MPPT_CONSTANT_VOLTAGE:
-            /* typical constant fraction of Voc; use string max_voltage as proxy for Voc */
-            pv->mppt_voltage_ref = pv->strings[0].max_voltage * 0.78;
-            break;
-
-        case MPPT_OFF:
-        default:
-            pv->mppt_voltage_ref = 0.0;
-            break;
-    }
+    LOG_DEBUG("pv_run_mppt: alg=%s mppt_vref=%.3f",
+              pv_mppt_algorithm_str(pv->mppt_algorithm), pv->mppt_tracker.voltage_ref);
+}
 
-    /* Safe clamping: derive safe bounds from string ratings (use string 0 as proxy) */
-    double min_voltage = pv->strings[0].max_voltage * 0.5;
-    double max_voltage = pv->strings[0].max_voltage * 0.95;
+/* Hand MPPT to per-inverter workers (NULL to detach); the caller owns the worker */
+void pv_attach_mppt(pv_system_t* pv, pv_mppt_worker_t* worker) {
+    if (!pv) return;
 
-    if (pv->mppt_voltage_ref < min_voltage) pv->mppt_voltage_ref = min_voltage;
-    if (pv->mppt_voltage_ref > max_voltage) pv->mppt_voltage_ref = max_voltage;
+    pv->mppt = worker;
+    pv->mppt_energy_wh = 0.0;
+    if (!worker) return;
 
-    LOG_DEBUG("pv_run_mppt: alg=%s mppt_vref=%.3f mppt_pref=%.3f",
-              mppt_algorithm_str[pv->mppt_algorithm],
-              pv->mppt_voltage_ref,
-              pv->mppt_power_ref);
+    pv_mppt_set_algorithm(worker, pv->mppt_algorithm);
+    pv_mppt_collect(worker, NULL, &pv->mppt_energy_wh);
 }
 
 /* Apply curtailment percentage (0..100) */
@@ -259,7 +338,9 @@ void pv_apply_curtailment(pv_system_t* pv, double curtail_percent) {
     if (curtail_percent < 0.0) curtail_percent = 0.0;
     if (curtail_percent > 100.0) curtail_percent = 100.0;
 
-    pv->max_operating_power = pv->total_capacity * (1.0 - curtail_percent / 100.0);
+    /* The ceiling is what the array can make now, not its nameplate */
+    double ceiling = pv->expected_power < pv->total_capacity ? pv->expected_power : pv->total_capacity;
+    pv->max_operating_power = ceiling * (1.0 - curtail_percent / 100.0);
 
     if (curtail_percent > 0.0) {
         pv->state = PV_STATE_CURTAILED;
@@ -271,61 +352,33 @@ void pv_apply_curtailment(pv_system_t* pv, double curtail_percent) {
               curtail_percent, pv->max_operating_power, pv_state_str[pv->state]);
 }
 
-/* Fault detection with a small debounce (two consecutive readings) */
+/* Fault detection: every reporting string against the median of its
+ * inverter peers, debounced over PV_FAULT_DEBOUNCE readings */
 bool pv_detect_faults(pv_system_t* pv, system_measurements_t* measurements) {
     if (!pv || !measurements) return false;
 
+    pv_string_telemetry_t* t = &pv->telemetry;
     bool fault_detected = false;
-    static int consecutive_faults[MAX_PV_STRINGS] = {0};
-    const int debounce_count = 2;
 
-    for (int i = 0; i < MAX_PV_STRINGS; ++i) {
-        if (!pv->strings[i].enabled) {
-            consecutive_faults[i] = 0;
-            continue;
-        }
+    /* At night and with a low sun, peers see different light; skip the pass */
+    if (pv->sun_now.sun_u < PV_DETECT_MIN_SUN) return false;
 
-        bool this_cycle_fault = false;
-        double V = measurements->pv_voltage[i];
-        double I = measurements->pv_current[i];
+    if (pv_strings_detect(t) == 0) return false;
 
-        /* Overvoltage: use a margin over max_voltage */
-        if (isfinite(V) && V > (pv->strings[i].max_voltage * 1.1)) {
-            this_cycle_fault = true;
-            LOG_DEBUG("pv_detect_faults: string %d overvoltage V=%.3f limit=%.3f", i, V, pv->strings[i].max_voltage * 1.1);
-        }
+    for (int g = 0; g < t->group_count; g++) {
+        const pv_string_group_t* grp = &t->groups[g];
 
-        /* Overcurrent */
-        if (isfinite(I) && I > (pv->strings[i].max_current * 1.2)) {
-            this_cycle_fault = true;
-            LOG_DEBUG("pv_detect_faults: string %d overcurrent I=%.3f limit=%.3f", i, I, pv->strings[i].max_current * 1.2);
-        }
+        for (int k = 0; k < grp->count; k++) {
+            int i = grp->first + k;
+            if (!pv->strings[i].enabled || t->consecutive[i] < PV_FAULT_DEBOUNCE) continue;
 
-        /* Voltage imbalance relative to string 0 when index > 0 */
-        if (i > 0) {
-            double V0 = measurements->pv_voltage[0];
-            if (isfinite(V) && isfinite(V0) && V0 > MIN_VALID_VOLTAGE) {
-                double voltage_diff = fabs(V - V0);
-                if (voltage_diff > (V0 * FAULT_VOLTAGE_THRESHOLD)) {
-                    this_cycle_fault = true;
-                    LOG_DEBUG("pv_detect_faults: string %d voltage imbalance diff=%.3f base=%.3f", i, voltage_diff, V0);
-                }
-            }
-        }
-
-        if (this_cycle_fault) {
-            consecutive_faults[i] = (consecutive_faults[i] < debounce_count) ? (consecutive_faults[i] + 1) : debounce_count;
-        } else {
-            consecutive_faults[i] = 0;
-        }
-
-        if (consecutive_faults[i] >= debounce_count) {
             if (!pv->strings[i].fault) {
                 pv->strings[i].fault = true;
-                strncpy(pv->last_fault_reason, "String fault", sizeof(pv->last_fault_reason) - 1);
-                pv->last_fault_reason[sizeof(pv->last_fault_reason)-1] = '\0';
-                pv->last_fault_time = time(NULL);
-                LOG_DEBUG("pv_detect_faults: string %d marked fault", i);
+                snprintf(pv->last_fault_reason, sizeof(pv->last_fault_reason), "%s: %s",
+                         pv->strings[i].string_id, pv_string_signature_str(t->signature[i]));
+                pv->last_fault_time = clock_now();
+                LOG_DEBUG("pv_detect_faults: string %d marked fault (%s, dV %.2f dI %.2f)", i,
+                          pv_string_signature_str(t->signature[i]), t->v_dev[i], t->i_dev[i]);
             }
             fault_detected = true;
         }
@@ -344,7 +397,7 @@ bool pv_detect_faults(pv_system_t* pv, system_measurements_t* measurements) {
 void pv_clear_faults(pv_system_t* pv) {
     if (!pv) return;
 
-    for (int i = 0; i < MAX_PV_STRINGS; ++i) {
+    for (int i = 0; i < pv->string_count; ++i) {
         pv->strings[i].fault = false;
     }
 
@@ -364,10 +417,34 @@ void pv_log_status(const pv_system_t* pv) {
 
     printf("=== PV System Status ===\n");
     printf("State: %s\n", pv_state_str[pv->state]);
-    printf("MPPT Algorithm: %s\n", mppt_algorithm_str[pv->mppt_algorithm]);
-    printf("Active Strings: %d/%d\n", pv->active_string_count, MAX_PV_STRINGS);
+    printf("MPPT Algorithm: %s\n", pv_mppt_algorithm_str(pv->mppt_algorithm));
+    if (pv->mppt)
+        printf("MPPT Workers: %d inverter(s) at %d Hz\n",
+               pv->mppt->task_count, atomic_load(&pv->mppt->rate_hz));
+    printf("Active Strings: %d/%d\n", pv->active_string_count, pv->string_count);
+
+    const pv_string_telemetry_t* t = &pv->telemetry;
+    int shaded = 0, soiled = 0, faulty = 0, reporting = 0;
+    for (int g = 0; g < t->group_count; g++) {
+        reporting += t->groups[g].count;
+        for (int k = 0; k < t->groups[g].count; k++) {
+            uint8_t sig = t->signature[t->groups[g].first + k];
+            shaded += sig == PV_SIGNATURE_SHADED;
+            soiled += sig == PV_SIGNATURE_SOILED;
+            faulty += PV_SIGNATURE_IS_FAULT(sig);
+        }
+    }
+    if (reporting > 0)
+        printf("String Telemetry: %d reporting, %d shaded, %d soiled, %d faulty\n",
+               reporting, shaded, soiled, faulty);
     printf("Total Capacity: %.1f W\n", pv->total_capacity);
     printf("Available Power: %.1f W\n", pv->available_power);
+    printf("Clear-sky Power: %.1f W (sun elevation %.1f deg)\n", pv->expected_power,
+           solar_elevation_deg(&pv->sun_now));
+    time_t now = clock_now();
+    printf("Forecast: %.2f kWh next hour, %.2f kWh next 24 h\n",
+           pv_forecast_energy(&pv->forecast, now, now + 3600) / 1000.0,
+           pv_forecast_energy(&pv->forecast, now, now + 86400) / 1000.0);
     printf("Max Operating Power: %.1f W\n", pv->max_operating_power);
     printf("Daily Energy: %.2f kWh\n", pv->daily_energy / 1000.0);
     printf("Total Energy: %.2f kWh\n", pv->total_energy / 1000.0);
@@ -387,7 +464,7 @@ double pv_get_efficiency(const pv_system_t* pv) {
     double total_eff = 0.0;
     int count = 0;
 
-    for (int i = 0; i < MAX_PV_STRINGS; ++i) {
+    for (int i = 0; i < pv->string_count; ++i) {
         if (pv->strings[i].enabled && !pv->strings[i].fault) {
             total_eff += pv->strings[i].efficiency;
             count++;
@@ -0,0 +1,131 @@
+#include "pv_forecast.h"
+#include <math.h>
+#include <string.h>
+
+static long forecast_slot_of(time_t t) {
+    long slot = (long)(t / PV_FORECAST_STEP_S);
+    return (t < 0 && t % PV_FORECAST_STEP_S) ? slot - 1 : slot;
+}
+
+static int forecast_time_of_day(long slot) {
+    int tod = (int)(slot % PV_FORECAST_SLOTS);
+    return tod < 0 ? tod + PV_FORECAST_SLOTS : tod;
+}
+
+void pv_forecast_init(pv_forecast_t* fc) {
+    if (!fc) return;
+
+    memset(fc, 0, sizeof(*fc));
+    fc->slot = -1;
+    fc->first_slot = -1;
+}
+
+static double forecast_history(const pv_forecast_t* fc, int tod) {
+    return fc->history_days[tod] ? fc->k_history[tod] : PV_FORECAST_DEFAULT_INDEX;
+}
+
+/* Fold a finished slot into the anomaly and the time-of-day history */
+static void forecast_close_slot(pv_forecast_t* fc) {
+    if (fc->clear_wh < PV_FORECAST_MIN_CLEAR_WH) return;
+
+    double k = fc->measured_wh / fc->clear_wh;
+    if (k < 0.0) k = 0.0;
+    if (k > PV_FORECAST_MAX_INDEX) k = PV_FORECAST_MAX_INDEX;
+
+    int tod = forecast_time_of_day(fc->slot);
+    double anomaly = k - forecast_history(fc, tod);
+
+    fc->k_anomaly = fc->anomaly_valid ? fc->k_anomaly + PV_FORECAST_PERSIST_ALPHA * (anomaly - fc->k_anomaly)
+                                      : anomaly;
+    fc->anomaly_valid = true;
+
+    if (fc->history_days[tod] == 0) {
+        fc->k_history[tod] = (float)k;
+    } else {
+        fc->k_history[tod] += (float)(PV_FORECAST_HISTORY_ALPHA * (k - fc->k_history[tod]));
+    }
+    if (fc->history_days[tod] < UINT16_MAX) fc->history_days[tod]++;
+}
+
+/* Accumulate one cycle's production; returns true when a slot has closed
+ * (the caller should refresh the prediction) */
+bool pv_forecast_observe(pv_forecast_t* fc, time_t now, double measured_w, double clear_sky_w) {
+    if (!fc || !isfinite(measured_w) || !isfinite(clear_sky_w)) return false;
+
+    long slot = forecast_slot_of(now);
+    bool closed = false;
+
+    if (fc->slot >= 0 && slot != fc->slot) {
+        forecast_close_slot(fc);
+        closed = true;
+    }
+
+    if (slot != fc->slot) {
+        fc->slot = slot;
+        fc->measured_wh = 0.0;
+        fc->clear_wh = 0.0;
+        fc->last_sample = now;
+        return closed;
+    }
+
+    double dt = difftime(now, fc->last_sample);
+    if (dt > 0.0) {
+        fc->measured_wh += (measured_w > 0.0 ? measured_w : 0.0) * dt / 3600.0;
+        fc->clear_wh += (clear_sky_w > 0.0 ? clear_sky_w : 0.0) * dt / 3600.0;
+    }
+    fc->last_sample = now;
+    return closed;
+}
+
+/* Rebuild the ring from the current slot on */
+void pv_forecast_predict(pv_forecast_t* fc, time_t now, pv_forecast_clear_sky_fn clear_sky, void* ctx) {
+    if (!fc || !clear_sky) return;
+
+    long current = forecast_slot_of(now);
+
+    for (int h = 0; h < PV_FORECAST_SLOTS; h++) {
+        long slot = current + h;
+        int tod = forecast_time_of_day(slot);
+        time_t mid = (time_t)slot * PV_FORECAST_STEP_S + PV_FORECAST_STEP_S / 2;
+
+        double k = forecast_history(fc, tod);
+        if (fc->anomaly_valid) {
+            double ahead = mid > now ? (double)(mid - now) : 0.0;
+            k += exp(-ahead / PV_FORECAST_PERSIST_TAU_S) * fc->k_anomaly;
+        }
+        if (k < 0.0) k = 0.0;
+        if (k > PV_FORECAST_MAX_INDEX) k = PV_FORECAST_MAX_INDEX;
+
+        fc->predicted[slot % PV_FORECAST_SLOTS] = (float)(k * clear_sky(ctx, mid));
+    }
+
+    fc->first_slot = current;
+}
+
+/* Predicted average power (W) of the slot containing t; 0 outside the horizon */
+double pv_forecast_power_at(const pv_forecast_t* fc, time_t t) {
+    if (!fc || fc->first_slot < 0) return 0.0;
+
+    long slot = forecast_slot_of(t);
+    if (slot < fc->first_slot || slot >= fc->first_slot + PV_FORECAST_SLOTS) return 0.0;
+
+    return fc->predicted[slot % PV_FORECAST_SLOTS];
+}
+
+/* Predicted energy (Wh) over [from, to), partial slots pro rata */
+double pv_forecast_energy(const pv_forecast_t* fc, time_t from, time_t to) {
+    if (!fc || fc->first_slot < 0 || to <= from) return 0.0;
+
+    double wh = 0.0;
+    time_t t = from;
+
+    while (t < to) {
+        time_t slot_end = ((time_t)forecast_slot_of(t) + 1) * PV_FORECAST_STEP_S;
+        time_t end = slot_end < to ? slot_end : to;
+
+        wh += pv_forecast_power_at(fc, t) * (double)(end - t) / 3600.0;
+        t = end;
+    }
+
+    return wh;
+}
@@ -0,0 +1,310 @@
+#include "pv_mppt.h"
+#include "clock.h"
+#include "logging.h"
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#define MPPT_MIN_DELTA_V    1e-3    // V, smaller moves count as "voltage unchanged"
+#define MPPT_MIN_DELTA_P    1e-2    // W, likewise for power
+#define MPPT_SNAPSHOT_TRIES 8       // reader retries before giving up on a busy writer
+
+static const char* mppt_algorithm_names[] = {
+    "OFF", "PERTURB_OBSERVE", "INCREMENTAL_CONDUCTANCE", "CONSTANT_VOLTAGE"
+};
+
+static double mppt_seconds(const struct timespec* ts) {
+    return (double)ts->tv_sec + (double)ts->tv_nsec / 1e9;
+}
+
+static void mppt_advance(struct timespec* ts, long period_ns) {
+    ts->tv_nsec += period_ns;
+    while (ts->tv_nsec >= 1000000000L) {
+        ts->tv_nsec -= 1000000000L;
+        ts->tv_sec++;
+    }
+}
+
+static bool mppt_before(const struct timespec* a, const struct timespec* b) {
+    return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+static int mppt_clamp_rate(int rate_hz) {
+    if (rate_hz < PV_MPPT_RATE_MIN_HZ) return PV_MPPT_RATE_MIN_HZ;
+    if (rate_hz > PV_MPPT_RATE_MAX_HZ) return PV_MPPT_RATE_MAX_HZ;
+    return rate_hz;
+}
+
+void pv_mppt_tracker_init(pv_mppt_tracker_t* tracker, mppt_algorithm_t algorithm, double open_circuit_voltage) {
+    if (!tracker) return;
+
+    memset(tracker, 0, sizeof(*tracker));
+    tracker->algorithm = algorithm;
+    tracker->step_size = PV_MPPT_STEP_V;
+    tracker->voltage_min = open_circuit_voltage * 0.5;
+    tracker->voltage_max = open_circuit_voltage * 0.95;
+    tracker->voltage_ref = open_circuit_voltage * PV_MPPT_CV_FRACTION;
+    tracker->direction = 1.0;
+}
+
+/* One tracking step from a DC sample; returns the new voltage reference */
+double pv_mppt_tracker_step(pv_mppt_tracker_t* tracker, double voltage, double power) {
+    if (!tracker) return 0.0;
+    if (!isfinite(voltage) || !isfinite(power)) return tracker->voltage_ref;
+
+    double dv = voltage - tracker->prev_voltage;
+    double dp = power - tracker->prev_power;
+
+    switch (tracker->algorithm) {
+        case MPPT_PERTURB_OBSERVE:
+            // Keep moving while power rises, turn around when it falls
+            if (tracker->primed && dp < -MPPT_MIN_DELTA_P)
+                tracker->direction = -tracker->direction;
+            tracker->voltage_ref = voltage + tracker->direction * tracker->step_size;
+            break;
+
+        case MPPT_INCREMENTAL_CONDUCTANCE:
+            // dP/dV = 0 at the MPP: positive left of it, negative right of it
+            if (!tracker->primed || voltage <= MPPT_MIN_DELTA_V) {
+                tracker->voltage_ref = voltage > MPPT_MIN_DELTA_V ? voltage : tracker->voltage_ref;
+            } else if (fabs(dv) < MPPT_MIN_DELTA_V) {
+                // Same voltage, different power: irradiance changed, follow the current
+                if (dp > MPPT_MIN_DELTA_P) tracker->voltage_ref += tracker->step_size;
+                else if (dp < -MPPT_MIN_DELTA_P) tracker->voltage_ref -= tracker->step_size;
+            } else {
+                double slope = dp / dv;
+                if (slope > MPPT_MIN_DELTA_P) tracker->voltage_ref = voltage + tracker->step_size;
+                else if (slope < -MPPT_MIN_DELTA_P) tracker->voltage_ref = voltage - tracker->step_size;
+            }
+            break;
+
+        case MPPT_CONSTANT_VOLTAGE:
+            tracker->voltage_ref = (tracker->voltage_max / 0.95) * PV_MPPT_CV_FRACTION;
+            break;
+
+        case MPPT_OFF:
+            break;
+    }
+
+    if (tracker->voltage_ref < tracker->voltage_min) tracker->voltage_ref = tracker->voltage_min;
+    if (tracker->voltage_ref > tracker->voltage_max) tracker->voltage_ref = tracker->voltage_max;
+
+    tracker->prev_voltage = voltage;
+    tracker->prev_power = power;
+    tracker->primed = true;
+    return tracker->voltage_ref;
+}
+
+/* Sequence-lock write: readers retry while seq is odd or has moved */
+static void mppt_publish(pv_mppt_task_t* task, const pv_mppt_snapshot_t* s) {
+    unsigned seq = atomic_load_explicit(&task->seq, memory_order_relaxed);
+
+    atomic_store_explicit(&task->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&task->available_power, s->available_power, memory_order_relaxed);
+    atomic_store_explicit(&task->voltage, s->voltage, memory_order_relaxed);
+    atomic_store_explicit(&task->voltage_ref, s->voltage_ref, memory_order_relaxed);
+    atomic_store_explicit(&task->energy_wh, s->energy_wh, memory_order_relaxed);
+    atomic_store_explicit(&task->updated, s->updated, memory_order_relaxed);
+
+    atomic_store_explicit(&task->seq, seq + 2, memory_order_release);
+}
+
+static void* mppt_worker(void* arg) {
+    pv_mppt_task_t* task = (pv_mppt_task_t*)arg;
+    pv_mppt_worker_t* w = task->owner;
+
+    pv_mppt_tracker_t tracker;
+    pv_mppt_tracker_init(&tracker, (mppt_algorithm_t)atomic_load(&w->algorithm), w->open_circuit_voltage);
+
+    pv_mppt_snapshot_t out = { .voltage_ref = tracker.voltage_ref };
+    double last_sample = 0.0;
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (atomic_load(&w->running)) {
+        long period_ns = 1000000000L / atomic_load(&w->rate_hz);
+
+        mppt_algorithm_t algorithm = (mppt_algorithm_t)atomic_load(&w->algorithm);
+        if (algorithm != tracker.algorithm)
+            pv_mppt_tracker_init(&tracker, algorithm, w->open_circuit_voltage);
+
+        double voltage = 0.0, power = 0.0;
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        if (w->io.read(w->io.ctx, task->inverter, &voltage, &power) == 0 &&
+            isfinite(voltage) && isfinite(power)) {
+            double t = mppt_seconds(&now);
+            double t_ctrl = clock_monotonic();
+            if (power < 0.0) power = 0.0;
+
+            // Integrated here so cloud transients between control cycles are
+            // counted; on the control clock, which a simulation runs virtual
+            if (last_sample > 0.0 && t_ctrl > last_sample)
+                out.energy_wh += power * (t_ctrl - last_sample) / 3600.0;
+            last_sample = t_ctrl;
+
+            if (tracker.algorithm != MPPT_OFF) {
+                double ref = pv_mppt_tracker_step(&tracker, voltage, power);
+                if (w->io.set_voltage) w->io.set_voltage(w->io.ctx, task->inverter, ref);
+            }
+
+            out.available_power = power;
+            out.voltage = voltage;
+            out.voltage_ref = tracker.voltage_ref;
+            out.updated = t;
+            mppt_publish(task, &out);
+            atomic_fetch_add(&task->samples, 1);
+        } else {
+            // Stale snapshot ages out; energy integration restarts with the next sample
+            last_sample = 0.0;
+            atomic_fetch_add(&task->read_errors, 1);
+        }
+
+        // Absolute schedule; after an overrun, skip the missed periods instead of bursting
+        mppt_advance(&next, period_ns);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (mppt_before(&next, &now)) {
+            atomic_fetch_add(&task->overruns, 1);
+            next = now;
+            mppt_advance(&next, period_ns);
+        }
+
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR) {
+            if (!atomic_load(&w->running)) break;
+        }
+    }
+
+    return NULL;
+}
+
+int pv_mppt_start(pv_mppt_worker_t* worker, int inverter_count, int rate_hz, mppt_algorithm_t algorithm,
+                  double open_circuit_voltage, const pv_mppt_io_t* io) {
+    if (!worker || !io || !io->read) return -1;
+    if (inverter_count <= 0 || inverter_count > PV_MAX_STRING_GROUPS) return -1;
+
+    memset(worker, 0, sizeof(*worker));
+    worker->io = *io;
+    worker->open_circuit_voltage = open_circuit_voltage;
+    worker->task_count = inverter_count;
+
+    atomic_init(&worker->running, true);
+    atomic_init(&worker->rate_hz, mppt_clamp_rate(rate_hz));
+    atomic_init(&worker->algorithm, algorithm);
+
+    for (int i = 0; i < inverter_count; i++) {
+        pv_mppt_task_t* task = &worker->tasks[i];
+        task->inverter = i;
+        task->owner = worker;
+
+        atomic_init(&task->seq, 0);
+        atomic_init(&task->available_power, 0.0);
+        atomic_init(&task->voltage, 0.0);
+        atomic_init(&task->voltage_ref, 0.0);
+        atomic_init(&task->energy_wh, 0.0);
+        atomic_init(&task->updated, 0.0);
+        atomic_init(&task->samples, 0);
+        atomic_init(&task->read_errors, 0);
+        atomic_init(&task->overruns, 0);
+    }
+
+    for (int i = 0; i < inverter_count; i++) {
+        pv_mppt_task_t* task = &worker->tasks[i];
+
+        if (pthread_create(&task->thread, NULL, mppt_worker, task) != 0) {
+            LOG_ERROR("Failed to start MPPT thread for inverter %d", i);
+            pv_mppt_stop(worker);
+            return -1;
+        }
+        task->started = true;
+    }
+
+    LOG_INFO("MPPT: %d inverter thread(s) at %d Hz, %s", inverter_count,
+             atomic_load(&worker->rate_hz), pv_mppt_algorithm_str(algorithm));
+    return 0;
+}
+
+void pv_mppt_stop(pv_mppt_worker_t* worker) {
+    if (!worker) return;
+
+    atomic_store(&worker->running, false);
+
+    for (int i = 0; i < worker->task_count; i++) {
+        pv_mppt_task_t* task = &worker->tasks[i];
+        if (!task->started) continue;
+
+        pthread_join(task->thread, NULL);
+        task->started = false;
+    }
+}
+
+void pv_mppt_set_rate(pv_mppt_worker_t* worker, int rate_hz) {
+    if (!worker) return;
+    atomic_store(&worker->rate_hz, mppt_clamp_rate(rate_hz));
+}
+
+void pv_mppt_set_algorithm(pv_mppt_worker_t* worker, mppt_algorithm_t algorithm) {
+    if (!worker) return;
+    atomic_store(&worker->algorithm, algorithm);
+}
+
+/* Consistent read of one inverter's state; false if the worker kept it busy */
+bool pv_mppt_snapshot(const pv_mppt_worker_t* worker, int inverter, pv_mppt_snapshot_t* snapshot) {
+    if (!worker || !snapshot || inverter < 0 || inverter >= worker->task_count) return false;
+
+    const pv_mppt_task_t* task = &worker->tasks[inverter];
+
+    for (int tries = 0; tries < MPPT_SNAPSHOT_TRIES; tries++) {
+        unsigned before = atomic_load_explicit(&task->seq, memory_order_acquire);
+        if (before & 1u) continue;
+
+        snapshot->available_power = atomic_load_explicit(&task->available_power, memory_order_relaxed);
+        snapshot->voltage = atomic_load_explicit(&task->voltage, memory_order_relaxed);
+        snapshot->voltage_ref = atomic_load_explicit(&task->voltage_ref, memory_order_relaxed);
+        snapshot->energy_wh = atomic_load_explicit(&task->energy_wh, memory_order_relaxed);
+        snapshot->updated = atomic_load_explicit(&task->updated, memory_order_relaxed);
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&task->seq, memory_order_relaxed) == before) return true;
+    }
+    return false;
+}
+
+/* Sum power over inverters with a fresh snapshot and energy over all of them;
+ * returns the number of fresh inverters */
+int pv_mppt_collect(const pv_mppt_worker_t* worker, double* power, double* energy_wh) {
+    if (!worker) return 0;
+
+    // Staleness is about the worker threads, so it is judged on the system clock
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    double now = mppt_seconds(&ts);
+    double max_age = (double)PV_MPPT_STALE_PERIODS / atomic_load(&worker->rate_hz);
+    double p = 0.0, e = 0.0;
+    int fresh = 0;
+
+    for (int i = 0; i < worker->task_count; i++) {
+        pv_mppt_snapshot_t s;
+        if (!pv_mppt_snapshot(worker, i, &s)) continue;
+
+        e += s.energy_wh;
+        if (s.updated <= 0.0 || now - s.updated > max_age) continue;
+
+        p += s.available_power;
+        fresh++;
+    }
+
+    if (power) *power = p;
+    if (energy_wh) *energy_wh = e;
+    return fresh;
+}
+
+const char* pv_mppt_algorithm_str(mppt_algorithm_t algorithm) {
+    if ((int)algorithm < 0 || (int)algorithm >= (int)(sizeof(mppt_algorithm_names) / sizeof(mppt_algorithm_names[0])))
+        return "UNKNOWN";
+    return mppt_algorithm_names[algorithm];
+}
@@ -0,0 +1,222 @@
+#include "pv_strings.h"
+#include "logging.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PV_OVERVOLTAGE_MARGIN   1.1f    // of the string voltage rating
+#define PV_OVERCURRENT_MARGIN   1.2f    // of the string current rating
+#define PV_OPEN_FRACTION        0.05f   // of the peer median current
+
+int pv_strings_alloc(pv_string_telemetry_t* t, int capacity) {
+    if (!t || capacity <= 0) return -1;
+
+    memset(t, 0, sizeof(*t));
+
+    size_t n = (size_t)capacity;
+    t->voltage = calloc(n, sizeof(float));
+    t->current = calloc(n, sizeof(float));
+    t->voltage_limit = calloc(n, sizeof(float));
+    t->current_limit = calloc(n, sizeof(float));
+    t->v_dev = calloc(n, sizeof(float));
+    t->i_dev = calloc(n, sizeof(float));
+    t->i_dev_avg = calloc(n, sizeof(float));
+    t->signature = calloc(n, sizeof(uint8_t));
+    t->consecutive = calloc(n, sizeof(uint8_t));
+    t->scratch = calloc(n, sizeof(float));
+
+    if (!t->voltage || !t->current || !t->voltage_limit || !t->current_limit || !t->v_dev ||
+        !t->i_dev || !t->i_dev_avg || !t->signature || !t->consecutive || !t->scratch) {
+        LOG_ERROR("Failed to allocate telemetry for %d PV strings", capacity);
+        pv_strings_free(t);
+        return -1;
+    }
+
+    t->capacity = capacity;
+    return 0;
+}
+
+void pv_strings_free(pv_string_telemetry_t* t) {
+    if (!t) return;
+
+    free(t->voltage);
+    free(t->current);
+    free(t->voltage_limit);
+    free(t->current_limit);
+    free(t->v_dev);
+    free(t->i_dev);
+    free(t->i_dev_avg);
+    free(t->signature);
+    free(t->consecutive);
+    free(t->scratch);
+    memset(t, 0, sizeof(*t));
+}
+
+/* Replace one inverter's string readings. The group's range is reserved on
+ * its first report; later reports with more strings are truncated. */
+int pv_strings_ingest(pv_string_telemetry_t* t, int group, const float* voltage,
+                      const float* current, int count, time_t timestamp) {
+    if (!t || !voltage || !current) return -1;
+    if (group < 0 || group >= PV_MAX_STRING_GROUPS || count < 0) return -1;
+
+    pv_string_group_t* g = &t->groups[group];
+
+    if (g->capacity == 0) {
+        if (count > t->capacity - t->used) {
+            LOG_WARNING("Inverter %d reports %d strings, only %d unassigned; keeping the first %d",
+                        group, count, t->capacity - t->used, t->capacity - t->used);
+            count = t->capacity - t->used;
+        }
+        if (count == 0) return -1;
+
+        g->first = t->used;
+        g->capacity = count;
+        t->used += count;
+        if (group + 1 > t->group_count) t->group_count = group + 1;
+    } else if (count > g->capacity) {
+        LOG_WARNING("Inverter %d reports %d strings, keeping the first %d", group, count, g->capacity);
+        count = g->capacity;
+    }
+
+    memcpy(t->voltage + g->first, voltage, (size_t)count * sizeof(float));
+    memcpy(t->current + g->first, current, (size_t)count * sizeof(float));
+    g->count = count;
+    g->updated = timestamp;
+    return 0;
+}
+
+/* Forget a group's readings (inverter not reporting); its range stays reserved */
+void pv_strings_clear(pv_string_telemetry_t* t, int group) {
+    if (!t || group < 0 || group >= PV_MAX_STRING_GROUPS) return;
+
+    pv_string_group_t* g = &t->groups[group];
+    if (g->capacity == 0) return;
+
+    memset(t->signature + g->first, PV_SIGNATURE_NORMAL, (size_t)g->capacity);
+    memset(t->consecutive + g->first, 0, (size_t)g->capacity);
+    g->count = 0;
+}
+
+/* k-th smallest of x[0..n), reorders x */
+static float pv_select(float* x, int n, int k) {
+    int lo = 0, hi = n - 1;
+
+    while (lo < hi) {
+        float pivot = x[lo + (hi - lo) / 2];
+        int i = lo, j = hi;
+
+        while (i <= j) {
+            while (x[i] < pivot) i++;
+            while (x[j] > pivot) j--;
+            if (i <= j) {
+                float tmp = x[i];
+                x[i] = x[j];
+                x[j] = tmp;
+                i++;
+                j--;
+            }
+        }
+
+        if (k <= j) hi = j;
+        else if (k >= i) lo = i;
+        else break;
+    }
+    return x[k];
+}
+
+static float pv_median(const float* x, int n, float* scratch) {
+    if (n <= 0) return 0.0f;
+
+    memcpy(scratch, x, (size_t)n * sizeof(float));
+    float upper = pv_select(scratch, n, n / 2);
+    if (n % 2) return upper;
+
+    // Lower middle is the largest value left of the upper middle
+    float lower = scratch[0];
+    for (int i = 1; i < n / 2; i++) lower = scratch[i] > lower ? scratch[i] : lower;
+    return 0.5f * (lower + upper);
+}
+
+/* One branch-free pass over a group's range; returns strings at the debounce
+ * limit. The arrays are separate allocations, and restrict parameters let -O2
+ * vectorize without runtime alias checks. */
+static int pv_detect_range(const float* restrict v, const float* restrict c,
+                           const float* restrict v_lim, const float* restrict i_lim,
+                           float* restrict v_dev, float* restrict i_dev, float* restrict i_avg,
+                           uint8_t* restrict sig, uint8_t* restrict cons,
+                           int n, float v_med, float i_med, bool peers) {
+    float inv_v = v_med > 0.0f ? 1.0f / v_med : 0.0f;
+    float inv_i = i_med > 0.0f ? 1.0f / i_med : 0.0f;
+    uint8_t have_peers = peers && v_med > 0.0f && i_med > 0.0f;
+    int faulted = 0;
+
+    for (int k = 0; k < n; k++) {
+        float vd = (v[k] - v_med) * inv_v;
+        float id = (c[k] - i_med) * inv_i;
+        uint8_t cmp = have_peers & (i_med >= (float)PV_MIN_DETECT_FRACTION * i_lim[k]);
+
+        i_avg[k] += (id - i_avg[k]) * (PV_SOILING_ALPHA * (float)cmp);
+
+        uint8_t over = (v[k] > v_lim[k] * PV_OVERVOLTAGE_MARGIN) | (c[k] > i_lim[k] * PV_OVERCURRENT_MARGIN);
+        uint8_t open = cmp & (c[k] < i_med * PV_OPEN_FRACTION);
+        uint8_t v_mis = cmp & (fabsf(vd) > (float)FAULT_VOLTAGE_THRESHOLD);
+        uint8_t i_mis = cmp & (fabsf(id) > (float)FAULT_CURRENT_THRESHOLD);
+        uint8_t shaded = cmp & (id < -(float)PV_SHADING_THRESHOLD);
+        uint8_t soiled = cmp & (i_avg[k] < -(float)PV_SOILING_THRESHOLD);
+
+        // Highest matching signature, as max() so the loop stays branch-free
+        uint8_t s = soiled * PV_SIGNATURE_SOILED;
+        s = s > shaded * PV_SIGNATURE_SHADED ? s : shaded * PV_SIGNATURE_SHADED;
+        s = s > i_mis * PV_SIGNATURE_CURRENT_MISMATCH ? s : i_mis * PV_SIGNATURE_CURRENT_MISMATCH;
+        s = s > v_mis * PV_SIGNATURE_VOLTAGE_MISMATCH ? s : v_mis * PV_SIGNATURE_VOLTAGE_MISMATCH;
+        s = s > open * PV_SIGNATURE_OPEN ? s : open * PV_SIGNATURE_OPEN;
+        s = s > over * PV_SIGNATURE_OVER_LIMIT ? s : over * PV_SIGNATURE_OVER_LIMIT;
+
+        uint8_t fault = s >= PV_SIGNATURE_CURRENT_MISMATCH;
+        uint8_t next = cons[k] + (cons[k] < PV_FAULT_DEBOUNCE);
+
+        v_dev[k] = vd;
+        i_dev[k] = id;
+        sig[k] = s;
+        cons[k] = next * fault;
+        faulted += cons[k] >= PV_FAULT_DEBOUNCE;
+    }
+
+    return faulted;
+}
+
+/* Run the detector over every reporting group; returns the number of strings
+ * whose fault signature has persisted for PV_FAULT_DEBOUNCE samples */
+int pv_strings_detect(pv_string_telemetry_t* t) {
+    if (!t) return 0;
+
+    int faulted = 0;
+
+    for (int g = 0; g < t->group_count; g++) {
+        const pv_string_group_t* grp = &t->groups[g];
+        if (grp->count == 0) continue;
+
+        float v_med = pv_median(t->voltage + grp->first, grp->count, t->scratch);
+        float i_med = pv_median(t->current + grp->first, grp->count, t->scratch);
+
+        int f = grp->first;
+        faulted += pv_detect_range(t->voltage + f, t->current + f, t->voltage_limit + f, t->current_limit + f,
+                                   t->v_dev + f, t->i_dev + f, t->i_dev_avg + f, t->signature + f,
+                                   t->consecutive + f, grp->count, v_med, i_med, grp->count >= PV_MIN_PEERS);
+    }
+
+    return faulted;
+}
+
+const char* pv_string_signature_str(pv_string_signature_t signature) {
+    switch (signature) {
+        case PV_SIGNATURE_NORMAL: return "NORMAL";
+        case PV_SIGNATURE_SOILED: return "SOILED";
+        case PV_SIGNATURE_SHADED: return "SHADED";
+        case PV_SIGNATURE_VOLTAGE_MISMATCH: return "VOLTAGE_MISMATCH";
+        case PV_SIGNATURE_CURRENT_MISMATCH: return "CURRENT_MISMATCH";
+        case PV_SIGNATURE_OPEN: return "OPEN";
+        case PV_SIGNATURE_OVER_LIMIT: return "OVER_LIMIT";
+    }
+    return "UNKNOWN";
+}
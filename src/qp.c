@@ -0,0 +1,340 @@
+#include "qp.h"
+#include "logging.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* qp_status_names[] = {
+    "SOLVED", "MAX_ITER", "NUMERICAL_ERROR", "INVALID"
+};
+
+#define QP_BAND(qp, i, j)   ((qp)->band[(size_t)(i) * ((qp)->bandwidth + 1) + ((i) - (j))])
+
+int qp_alloc(qp_t* qp, int n, int max_rows, int max_nnz, int bandwidth) {
+    if (!qp || n <= 0 || max_rows <= 0 || max_nnz <= 0 || bandwidth < 0) return -1;
+
+    memset(qp, 0, sizeof(*qp));
+
+    size_t nv = (size_t)n, nr = (size_t)max_rows;
+    qp->p_diag = calloc(nv, sizeof(double));
+    qp->q = calloc(nv, sizeof(double));
+    qp->row_start = calloc(nr + 1, sizeof(int));
+    qp->col = calloc((size_t)max_nnz, sizeof(int));
+    qp->val = calloc((size_t)max_nnz, sizeof(double));
+    qp->l = calloc(nr, sizeof(double));
+    qp->u = calloc(nr, sizeof(double));
+    qp->x = calloc(nv, sizeof(double));
+    qp->z = calloc(nr, sizeof(double));
+    qp->y = calloc(nr, sizeof(double));
+    qp->rho_row = calloc(nr, sizeof(double));
+    qp->rho_inv = calloc(nr, sizeof(double));
+    qp->band = calloc(nv * (size_t)(bandwidth + 1), sizeof(double));
+    qp->diag_inv = calloc(nv, sizeof(double));
+    qp->rhs = calloc(nv, sizeof(double));
+    qp->x_tilde = calloc(nv, sizeof(double));
+    qp->z_tilde = calloc(nr, sizeof(double));
+
+    if (!qp->p_diag || !qp->q || !qp->row_start || !qp->col || !qp->val || !qp->l || !qp->u ||
+        !qp->x || !qp->z || !qp->y || !qp->rho_row || !qp->rho_inv || !qp->band || !qp->diag_inv ||
+        !qp->rhs || !qp->x_tilde || !qp->z_tilde) {
+        LOG_ERROR("Failed to allocate QP workspace (%d variables, %d rows)", n, max_rows);
+        qp_free(qp);
+        return -1;
+    }
+
+    qp->n = n;
+    qp->max_rows = max_rows;
+    qp->max_nnz = max_nnz;
+    qp->bandwidth = bandwidth;
+    qp->rho = QP_RHO_DEFAULT;
+    qp->eps_abs = QP_EPS_ABS;
+    qp->eps_rel = QP_EPS_REL;
+    qp->max_iter = QP_MAX_ITER;
+    return 0;
+}
+
+void qp_free(qp_t* qp) {
+    if (!qp) return;
+
+    free(qp->p_diag);
+    free(qp->q);
+    free(qp->row_start);
+    free(qp->col);
+    free(qp->val);
+    free(qp->l);
+    free(qp->u);
+    free(qp->x);
+    free(qp->z);
+    free(qp->y);
+    free(qp->rho_row);
+    free(qp->rho_inv);
+    free(qp->band);
+    free(qp->diag_inv);
+    free(qp->rhs);
+    free(qp->x_tilde);
+    free(qp->z_tilde);
+    memset(qp, 0, sizeof(*qp));
+}
+
+void qp_clear_rows(qp_t* qp) {
+    if (!qp) return;
+
+    qp->m = 0;
+    qp->row_start[0] = 0;
+}
+
+/* Append l <= sum vals[k] x[cols[k]] <= u; columns must be distinct and
+ * within the bandwidth of each other */
+int qp_add_row(qp_t* qp, const int* cols, const double* vals, int count, double lower, double upper) {
+    if (!qp || !cols || !vals || count <= 0 || lower > upper) return -1;
+    if (qp->m >= qp->max_rows || qp->row_start[qp->m] + count > qp->max_nnz) return -1;
+
+    int lo = cols[0], hi = cols[0];
+    for (int k = 0; k < count; k++) {
+        if (cols[k] < 0 || cols[k] >= qp->n) return -1;
+        if (cols[k] < lo) lo = cols[k];
+        if (cols[k] > hi) hi = cols[k];
+    }
+    if (hi - lo > qp->bandwidth) return -1;
+
+    int at = qp->row_start[qp->m];
+    memcpy(&qp->col[at], cols, (size_t)count * sizeof(int));
+    memcpy(&qp->val[at], vals, (size_t)count * sizeof(double));
+
+    qp->l[qp->m] = lower;
+    qp->u[qp->m] = upper;
+    qp->m++;
+    qp->row_start[qp->m] = at + count;
+    return 0;
+}
+
+void qp_cold_start(qp_t* qp) {
+    if (!qp) return;
+
+    memset(qp->x, 0, (size_t)qp->n * sizeof(double));
+    memset(qp->z, 0, (size_t)qp->max_rows * sizeof(double));
+    memset(qp->y, 0, (size_t)qp->max_rows * sizeof(double));
+    qp->rho = QP_RHO_DEFAULT;
+}
+
+/* Drop the first var_shift variables and row_shift rows of the iterates;
+ * the tail keeps its old values, i.e. the last block is repeated */
+void qp_shift(qp_t* qp, int var_shift, int row_shift) {
+    if (!qp || var_shift <= 0 || var_shift >= qp->n || row_shift <= 0 || row_shift >= qp->max_rows) return;
+
+    memmove(qp->x, qp->x + var_shift, (size_t)(qp->n - var_shift) * sizeof(double));
+    memmove(qp->z, qp->z + row_shift, (size_t)(qp->max_rows - row_shift) * sizeof(double));
+    memmove(qp->y, qp->y + row_shift, (size_t)(qp->max_rows - row_shift) * sizeof(double));
+}
+
+const char* qp_status_str(qp_status_t status) {
+    return status <= QP_INVALID ? qp_status_names[status] : "UNKNOWN";
+}
+
+static void qp_set_rho(qp_t* qp, double rho) {
+    qp->rho = rho;
+    for (int r = 0; r < qp->m; r++) {
+        qp->rho_row[r] = qp->l[r] == qp->u[r] ? rho * QP_RHO_EQ_SCALE : rho;
+        qp->rho_inv[r] = 1.0 / qp->rho_row[r];
+    }
+}
+
+/* Form P + sigma I + A' R A in band storage and factor it in place */
+static int qp_factor(qp_t* qp) {
+    int n = qp->n, bw = qp->bandwidth;
+
+    memset(qp->band, 0, (size_t)n * (size_t)(bw + 1) * sizeof(double));
+
+    for (int i = 0; i < n; i++)
+        QP_BAND(qp, i, i) = qp->p_diag[i] + QP_SIGMA;
+
+    for (int r = 0; r < qp->m; r++) {
+        double rho = qp->rho_row[r];
+
+        for (int a = qp->row_start[r]; a < qp->row_start[r + 1]; a++) {
+            for (int b = qp->row_start[r]; b < qp->row_start[r + 1]; b++) {
+                if (qp->col[a] < qp->col[b]) continue;
+                QP_BAND(qp, qp->col[a], qp->col[b]) += rho * qp->val[a] * qp->val[b];
+            }
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        int first = i - bw > 0 ? i - bw : 0;
+
+        for (int j = first; j <= i; j++) {
+            double s = QP_BAND(qp, i, j);
+            for (int k = first; k < j; k++)
+                s -= QP_BAND(qp, i, k) * QP_BAND(qp, j, k);
+
+            if (i == j) {
+                if (!(s > 0.0)) return -1;
+                QP_BAND(qp, i, i) = sqrt(s);
+                qp->diag_inv[i] = 1.0 / QP_BAND(qp, i, i);
+            } else {
+                QP_BAND(qp, i, j) = s / QP_BAND(qp, j, j);
+            }
+        }
+    }
+
+    qp->factored = true;
+    return 0;
+}
+
+/* x = (L L')^-1 b, in place. Two partial sums halve the dependency chain
+ * through x, which is what bounds the substitution */
+static void qp_back_solve(const qp_t* qp, double* restrict x) {
+    int n = qp->n, bw = qp->bandwidth;
+    const double* restrict band = qp->band;
+    const double* restrict diag_inv = qp->diag_inv;
+
+    for (int i = 0; i < n; i++) {
+        const double* row = &band[(size_t)i * (bw + 1)];
+        double s0 = x[i], s1 = 0.0;
+        int k = i - bw > 0 ? i - bw : 0;
+        for (; k + 1 < i; k += 2) {
+            s0 -= row[i - k] * x[k];
+            s1 -= row[i - k - 1] * x[k + 1];
+        }
+        if (k < i) s0 -= row[i - k] * x[k];
+        x[i] = (s0 + s1) * diag_inv[i];
+    }
+
+    for (int i = n - 1; i >= 0; i--) {
+        double s0 = x[i], s1 = 0.0;
+        int last = i + bw < n - 1 ? i + bw : n - 1;
+        int k = i + 1;
+        for (; k + 1 <= last; k += 2) {
+            s0 -= band[(size_t)k * (bw + 1) + (k - i)] * x[k];
+            s1 -= band[(size_t)(k + 1) * (bw + 1) + (k + 1 - i)] * x[k + 1];
+        }
+        if (k <= last) s0 -= band[(size_t)k * (bw + 1) + (k - i)] * x[k];
+        x[i] = (s0 + s1) * diag_inv[i];
+    }
+}
+
+static double qp_row_dot(const qp_t* qp, int r, const double* x) {
+    double s = 0.0;
+    for (int k = qp->row_start[r]; k < qp->row_start[r + 1]; k++)
+        s += qp->val[k] * x[qp->col[k]];
+    return s;
+}
+
+static double qp_clamp(double v, double lo, double hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+/* Residuals in the infinity norm, with the scales OSQP uses for its
+ * relative tolerances */
+static void qp_residuals(qp_t* qp, double* prim_scale, double* dual_scale) {
+    int n = qp->n;
+    double r_prim = 0.0, ax_max = 0.0, z_max = 0.0;
+
+    for (int r = 0; r < qp->m; r++) {
+        double ax = qp_row_dot(qp, r, qp->x);
+        r_prim = fmax(r_prim, fabs(ax - qp->z[r]));
+        ax_max = fmax(ax_max, fabs(ax));
+        z_max = fmax(z_max, fabs(qp->z[r]));
+    }
+
+    // rhs doubles as scratch for A'y
+    double* aty = qp->rhs;
+    memset(aty, 0, (size_t)n * sizeof(double));
+    for (int r = 0; r < qp->m; r++)
+        for (int k = qp->row_start[r]; k < qp->row_start[r + 1]; k++)
+            aty[qp->col[k]] += qp->val[k] * qp->y[r];
+
+    double r_dual = 0.0, px_max = 0.0, aty_max = 0.0, q_max = 0.0;
+    for (int i = 0; i < n; i++) {
+        double px = qp->p_diag[i] * qp->x[i];
+        r_dual = fmax(r_dual, fabs(px + qp->q[i] + aty[i]));
+        px_max = fmax(px_max, fabs(px));
+        aty_max = fmax(aty_max, fabs(aty[i]));
+        q_max = fmax(q_max, fabs(qp->q[i]));
+    }
+
+    qp->primal_residual = r_prim;
+    qp->dual_residual = r_dual;
+    *prim_scale = fmax(ax_max, z_max);
+    *dual_scale = fmax(px_max, fmax(aty_max, q_max));
+}
+
+qp_status_t qp_solve(qp_t* qp) {
+    if (!qp || qp->m == 0) return QP_INVALID;
+
+    int n = qp->n, m = qp->m;
+    double rho = qp->rho > QP_RHO_MIN ? qp->rho : QP_RHO_DEFAULT;
+
+    // Warm-start values may sit outside bounds that moved since the last solve
+    for (int r = 0; r < m; r++)
+        qp->z[r] = qp_clamp(qp->z[r], qp->l[r], qp->u[r]);
+
+    qp_set_rho(qp, rho);
+    if (qp_factor(qp) != 0) {
+        qp->status = QP_NUMERICAL_ERROR;
+        return qp->status;
+    }
+
+    qp->status = QP_MAX_ITER_REACHED;
+
+    for (qp->iterations = 1; qp->iterations <= qp->max_iter; qp->iterations++) {
+        // x~ = K^-1 (sigma x - q + A' (R z - y))
+        for (int i = 0; i < n; i++)
+            qp->rhs[i] = QP_SIGMA * qp->x[i] - qp->q[i];
+        for (int r = 0; r < m; r++) {
+            double w = qp->rho_row[r] * qp->z[r] - qp->y[r];
+            for (int k = qp->row_start[r]; k < qp->row_start[r + 1]; k++)
+                qp->rhs[qp->col[k]] += qp->val[k] * w;
+        }
+        memcpy(qp->x_tilde, qp->rhs, (size_t)n * sizeof(double));
+        qp_back_solve(qp, qp->x_tilde);
+
+        for (int i = 0; i < n; i++)
+            qp->x[i] = QP_ALPHA * qp->x_tilde[i] + (1.0 - QP_ALPHA) * qp->x[i];
+
+        for (int r = 0; r < m; r++) {
+            double zh = QP_ALPHA * qp_row_dot(qp, r, qp->x_tilde) + (1.0 - QP_ALPHA) * qp->z[r];
+            double z = qp_clamp(zh + qp->y[r] * qp->rho_inv[r], qp->l[r], qp->u[r]);
+
+            qp->y[r] += qp->rho_row[r] * (zh - z);
+            qp->z[r] = z;
+        }
+
+        if (qp->iterations % QP_CHECK_EVERY) continue;
+
+        double prim_scale, dual_scale;
+        qp_residuals(qp, &prim_scale, &dual_scale);
+
+        if (!isfinite(qp->primal_residual) || !isfinite(qp->dual_residual)) {
+            qp->status = QP_NUMERICAL_ERROR;
+            break;
+        }
+
+        if (qp->primal_residual <= qp->eps_abs + qp->eps_rel * prim_scale &&
+            qp->dual_residual <= qp->eps_abs + qp->eps_rel * dual_scale) {
+            qp->status = QP_SOLVED;
+            break;
+        }
+
+        // Rebalance rho when one residual dominates the other
+        double ratio = (qp->primal_residual / fmax(prim_scale, 1e-12)) /
+                       fmax(qp->dual_residual / fmax(dual_scale, 1e-12), 1e-12);
+        double rho_new = qp_clamp(qp->rho * sqrt(ratio), QP_RHO_MIN, QP_RHO_MAX);
+
+        if (rho_new > 5.0 * qp->rho || rho_new < 0.2 * qp->rho) {
+            qp_set_rho(qp, rho_new);
+            if (qp_factor(qp) != 0) {
+                qp->status = QP_NUMERICAL_ERROR;
+                break;
+            }
+        }
+    }
+
+    if (qp->iterations > qp->max_iter) qp->iterations = qp->max_iter;
+
+    qp->objective = 0.0;
+    for (int i = 0; i < n; i++)
+        qp->objective += 0.5 * qp->p_diag[i] * qp->x[i] * qp->x[i] + qp->q[i] * qp->x[i];
+
+    return qp->status;
+}
@@ -0,0 +1,164 @@
+#include "reload.h"
+#include "logging.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+/* Parse and validate one request into a freshly allocated config */
+static system_config_t* reload_build(config_reload_t* rl, const char* body, size_t length) {
+    system_config_t* config = malloc(sizeof(system_config_t));
+    if (!config) {
+        atomic_store(&rl->last_result, CONFIG_MEMORY_ERROR);
+        return NULL;
+    }
+
+    config_error_t res = body ? config_parse(body, length, config)
+                              : config_load(rl->config_path, config);
+
+    if (res == CONFIG_SUCCESS)
+        res = config_validate(config);
+
+    atomic_store(&rl->last_result, res);
+
+    if (res != CONFIG_SUCCESS) {
+        LOG_ERROR("Configuration reload from %s rejected: %d",
+            body ? "API request" : rl->config_path, res);
+        atomic_fetch_add(&rl->reject_count, 1);
+        free(config);
+        return NULL;
+    }
+
+    return config;
+}
+
+/* Hand a validated config to the control loop, replacing one it has not taken yet */
+static void reload_publish(config_reload_t* rl, system_config_t* config) {
+    system_config_t* superseded = atomic_exchange(&rl->staged, config);
+
+    if (superseded) {
+        LOG_DEBUG("Staged configuration superseded before it was applied");
+        free(superseded);
+    }
+
+    atomic_fetch_add(&rl->reload_count, 1);
+    LOG_INFO("Configuration staged, applying at next cycle boundary");
+}
+
+static void* reload_worker(void* arg) {
+    config_reload_t* rl = (config_reload_t*)arg;
+
+    while (atomic_load(&rl->running)) {
+        if (sem_wait(&rl->wakeup) != 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (!atomic_load(&rl->running)) break;
+
+        if (atomic_exchange(&rl->file_requested, false)) {
+            system_config_t* config = reload_build(rl, NULL, 0);
+            if (config) reload_publish(rl, config);
+        }
+
+        pthread_mutex_lock(&rl->body_lock);
+        char* body = rl->pending_body;
+        size_t length = rl->pending_length;
+        rl->pending_body = NULL;
+        rl->pending_length = 0;
+        pthread_mutex_unlock(&rl->body_lock);
+
+        if (body) {
+            system_config_t* config = reload_build(rl, body, length);
+            if (config) reload_publish(rl, config);
+            free(body);
+        }
+    }
+
+    return NULL;
+}
+
+int config_reload_start(config_reload_t* rl, const char* config_path) {
+    if (!rl || !config_path) return -1;
+
+    memset(rl, 0, sizeof(config_reload_t));
+    snprintf(rl->config_path, sizeof(rl->config_path), "%s", config_path);
+
+    atomic_init(&rl->running, true);
+    atomic_init(&rl->file_requested, false);
+    atomic_init(&rl->staged, NULL);
+    atomic_init(&rl->reload_count, 0);
+    atomic_init(&rl->reject_count, 0);
+    atomic_init(&rl->last_result, CONFIG_SUCCESS);
+
+    if (sem_init(&rl->wakeup, 0, 0) != 0) {
+        LOG_ERROR_ERRNO("Failed to create reload semaphore");
+        atomic_store(&rl->running, false);
+        return -1;
+    }
+
+    pthread_mutex_init(&rl->body_lock, NULL);
+
+    if (pthread_create(&rl->thread, NULL, reload_worker, rl) != 0) {
+        LOG_ERROR("Failed to start configuration reload thread");
+        pthread_mutex_destroy(&rl->body_lock);
+        sem_destroy(&rl->wakeup);
+        atomic_store(&rl->running, false);
+        return -1;
+    }
+
+    return 0;
+}
+
+void config_reload_stop(config_reload_t* rl) {
+    if (!rl || !atomic_exchange(&rl->running, false)) return;
+
+    sem_post(&rl->wakeup);
+    pthread_join(rl->thread, NULL);
+
+    free(rl->pending_body);
+    rl->pending_body = NULL;
+    free(atomic_exchange(&rl->staged, NULL));
+
+    pthread_mutex_destroy(&rl->body_lock);
+    sem_destroy(&rl->wakeup);
+}
+
+/* Re-read the config file. Only touches atomics and sem_post, so it is safe
+ * to call from a signal handler. */
+void config_reload_request_file(config_reload_t* rl) {
+    if (!rl || !atomic_load(&rl->running)) return;
+
+    atomic_store(&rl->file_requested, true);
+    sem_post(&rl->wakeup);
+}
+
+/* Queue a JSON config document (API thread). A newer submission replaces an older one. */
+int config_reload_submit(config_reload_t* rl, const char* json, size_t length) {
+    if (!rl || !json || !atomic_load(&rl->running)) return -1;
+    if (length > RELOAD_MAX_BODY) return -1;
+
+    char* body = malloc(length);
+    if (!body) return -1;
+    memcpy(body, json, length);
+
+    pthread_mutex_lock(&rl->body_lock);
+    char* previous = rl->pending_body;
+    rl->pending_body = body;
+    rl->pending_length = length;
+    pthread_mutex_unlock(&rl->body_lock);
+
+    free(previous);
+    sem_post(&rl->wakeup);
+    return 0;
+}
+
+/* Control thread, between cycles: returns a staged config (caller frees) or NULL */
+system_config_t* config_reload_take(config_reload_t* rl) {
+    if (!rl) return NULL;
+
+    // Cheap load first so the common no-reload cycle does not write the cache line
+    if (!atomic_load_explicit(&rl->staged, memory_order_relaxed)) return NULL;
+
+    return atomic_exchange(&rl->staged, NULL);
+}
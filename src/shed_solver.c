@@ -0,0 +1,154 @@
+#include "shed_solver.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SHED_SOLVER_ROW_WORDS   ((SHED_SOLVER_CELLS + 1 + 63) / 64)
+
+int shed_solver_init(shed_solver_t* solver, int capacity) {
+    if (!solver || capacity < 0) return -1;
+
+    memset(solver, 0, sizeof(shed_solver_t));
+    size_t n = capacity > 0 ? (size_t)capacity : 1;
+
+    solver->id = malloc(n * sizeof(int));
+    solver->power = malloc(n * sizeof(double));
+    solver->impact = malloc(n * sizeof(double));
+    solver->picked = malloc(n * sizeof(bool));
+    solver->units = malloc(n * sizeof(int));
+    solver->cost = malloc((SHED_SOLVER_CELLS + 1) * sizeof(double));
+    solver->take = malloc(n * SHED_SOLVER_ROW_WORDS * sizeof(uint64_t));
+
+    if (!solver->id || !solver->power || !solver->impact || !solver->picked ||
+        !solver->units || !solver->cost || !solver->take) {
+        shed_solver_free(solver);
+        return -1;
+    }
+
+    solver->capacity = capacity;
+    return 0;
+}
+
+void shed_solver_free(shed_solver_t* solver) {
+    if (!solver) return;
+
+    free(solver->id);
+    free(solver->power);
+    free(solver->impact);
+    free(solver->picked);
+    free(solver->units);
+    free(solver->cost);
+    free(solver->take);
+    memset(solver, 0, sizeof(shed_solver_t));
+}
+
+void shed_solver_reset(shed_solver_t* solver) {
+    if (solver) solver->count = 0;
+}
+
+int shed_solver_add(shed_solver_t* solver, int id, double power_w, double impact) {
+    if (!solver || solver->count >= solver->capacity || power_w <= 0.0) return -1;
+
+    int k = solver->count++;
+    solver->id[k] = id;
+    solver->power[k] = power_w;
+    solver->impact[k] = impact;
+    solver->picked[k] = false;
+    return 0;
+}
+
+static double shed_solver_elapsed(const struct timespec* since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - since->tv_sec) + (double)(now.tv_nsec - since->tv_nsec) / 1e9;
+}
+
+static void shed_solver_timed(shed_solver_t* solver, const struct timespec* started) {
+    solver->last_solve_s = shed_solver_elapsed(started);
+    if (solver->last_solve_s > solver->worst_solve_s) solver->worst_solve_s = solver->last_solve_s;
+}
+
+/* Pick the candidates to shed. Returns 0 with picked[] set, or -1 when the
+ * budget ran out or the need cannot be represented, picked[] untouched. */
+int shed_solver_solve(shed_solver_t* solver, double need_w, double budget_s) {
+    if (!solver || need_w <= 0.0) return -1;
+
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    solver->solves++;
+
+    int n = solver->count;
+    double total = 0.0;
+    for (int k = 0; k < n; k++) total += solver->power[k];
+
+    // Not enough to cover: least shortfall is everything
+    if (total < need_w) {
+        for (int k = 0; k < n; k++) solver->picked[k] = true;
+        shed_solver_timed(solver, &started);
+        return 0;
+    }
+
+    double step = fmax(need_w / SHED_SOLVER_CELLS, SHED_SOLVER_MIN_STEP_W);
+    int cells = (int)ceil(need_w / step);
+    int units_total = 0;
+
+    for (int k = 0; k < n; k++) {
+        solver->units[k] = (int)(solver->power[k] / step);
+        units_total += solver->units[k];
+    }
+
+    // Rounding down lost the cover; leave it to the caller
+    if (units_total < cells) {
+        solver->fallbacks++;
+        shed_solver_timed(solver, &started);
+        return -1;
+    }
+
+    // cost[w]: least impact shedding at least w steps, capped at the need
+    solver->cost[0] = 0.0;
+    for (int w = 1; w <= cells; w++) solver->cost[w] = INFINITY;
+
+    for (int k = 0; k < n; k++) {
+        uint64_t* take = &solver->take[(size_t)k * SHED_SOLVER_ROW_WORDS];
+        int u = solver->units[k];
+
+        memset(take, 0, SHED_SOLVER_ROW_WORDS * sizeof(uint64_t));
+        if (u == 0) continue;
+
+        for (int w = cells; w > 0; w--) {
+            double c = solver->cost[w > u ? w - u : 0] + solver->impact[k];
+            if (c < solver->cost[w]) {
+                solver->cost[w] = c;
+                take[w / 64] |= (uint64_t)1 << (w % 64);
+            }
+        }
+
+        if (shed_solver_elapsed(&started) > budget_s) {
+            solver->fallbacks++;
+            shed_solver_timed(solver, &started);
+            return -1;
+        }
+    }
+
+    for (int w = cells, k = n - 1; k >= 0; k--) {
+        const uint64_t* take = &solver->take[(size_t)k * SHED_SOLVER_ROW_WORDS];
+
+        solver->picked[k] = w > 0 && (take[w / 64] >> (w % 64)) & 1;
+        if (solver->picked[k]) w = w > solver->units[k] ? w - solver->units[k] : 0;
+    }
+
+    // Counted at full power rather than rounded down, some picks may be spare
+    double shed = 0.0;
+    for (int k = 0; k < n; k++) if (solver->picked[k]) shed += solver->power[k];
+
+    for (int k = 0; k < n; k++) {
+        if (solver->picked[k] && shed - solver->power[k] >= need_w) {
+            solver->picked[k] = false;
+            shed -= solver->power[k];
+        }
+    }
+
+    shed_solver_timed(solver, &started);
+    return 0;
+}
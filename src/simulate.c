@@ -0,0 +1,430 @@
+#include "simulate.h"
+#include "clock.h"
+#include "logging.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Per-scenario generator: xorshift64*, seeded through splitmix64 */
+typedef struct {
+    uint64_t state;
+    double spare;
+    bool has_spare;
+} sim_rng_t;
+
+typedef struct {
+    float soc_at_sunrise;
+    float unserved_critical_wh;
+    float cost;
+    bool outage;
+} sim_outcome_t;
+
+/* A worker's share of the scenario indices, [next, end) */
+typedef struct {
+    pthread_mutex_t lock;
+    int next;
+    int end;
+} sim_range_t;
+
+typedef struct {
+    const sim_snapshot_t* snap;
+    const sim_request_t* req;
+    sim_outcome_t* outcomes;
+    sim_range_t ranges[SIM_MAX_THREADS];
+    int threads;
+    atomic_int steals;
+} sim_pool_t;
+
+typedef struct {
+    sim_pool_t* pool;
+    int id;
+} sim_worker_t;
+
+void sim_request_defaults(sim_request_t* req) {
+    if (!req) return;
+
+    memset(req, 0, sizeof(*req));
+    req->scenarios = SIM_DEFAULT_SCENARIOS;
+    req->steps = SIM_MAX_STEPS;
+    req->seed = 1;
+    req->outage_mean_s = 3600.0;
+}
+
+static uint64_t sim_splitmix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+static void sim_rng_seed(sim_rng_t* rng, uint64_t seed, int index) {
+    rng->state = sim_splitmix(seed ^ sim_splitmix((uint64_t)index + 1));
+    if (rng->state == 0) rng->state = 1;
+    rng->has_spare = false;
+}
+
+/* Uniform on (0, 1) */
+static double sim_uniform(sim_rng_t* rng) {
+    rng->state ^= rng->state >> 12;
+    rng->state ^= rng->state << 25;
+    rng->state ^= rng->state >> 27;
+    uint64_t x = rng->state * 0x2545F4914F6CDD1Dull;
+    return ((double)(x >> 11) + 0.5) * 0x1.0p-53;
+}
+
+/* Standard normal, Box-Muller in pairs */
+static double sim_normal(sim_rng_t* rng) {
+    if (rng->has_spare) {
+        rng->has_spare = false;
+        return rng->spare;
+    }
+
+    double r = sqrt(-2.0 * log(sim_uniform(rng)));
+    double a = 2.0 * 3.14159265358979323846 * sim_uniform(rng);
+
+    rng->spare = r * sin(a);
+    rng->has_spare = true;
+    return r * cos(a);
+}
+
+static double sim_exponential(sim_rng_t* rng, double mean) {
+    return -mean * log(sim_uniform(rng));
+}
+
+/* Copy what the energy balance depends on out of the controller. Only
+ * reads, but the tariff, schedule and measurements change every cycle: off
+ * the control thread the caller must hold controller_lock() around it. */
+int sim_snapshot(const system_controller_t* ctrl, int steps, sim_snapshot_t* snap) {
+    if (!ctrl || !snap) return -1;
+
+    const battery_system_t* bat = &ctrl->battery_system;
+    if (bat->capacity_nominal_wh <= 0.0) return -1;
+    if (steps <= 0 || steps > SIM_MAX_STEPS) steps = SIM_MAX_STEPS;
+
+    memset(snap, 0, sizeof(*snap));
+
+    time_t now = ctrl->measurements.timestamp ? ctrl->measurements.timestamp : clock_now();
+    snap->start = now;
+    snap->energy_wh = bat->capacity_remaining_wh;
+    snap->capacity_wh = bat->capacity_nominal_wh;
+    snap->min_energy_wh = bat->min_operating_soc / 100.0 * bat->capacity_nominal_wh;
+    snap->max_energy_wh = bat->max_operating_soc / 100.0 * bat->capacity_nominal_wh;
+
+    for (int b = 0; b < bat->bank_count && b < MAX_BATTERY_BANKS; b++) {
+        snap->max_charge_w += bat->bank_state[b].max_charge_power_w;
+        snap->max_discharge_w += bat->bank_state[b].max_discharge_power_w;
+    }
+
+    snap->import_limit_w = ctrl->grid_import_allowed ? ctrl->grid_import_limit : 0.0;
+    snap->export_limit_w = ctrl->grid_export_allowed ? ctrl->grid_export_limit : 0.0;
+    snap->feed_in_limit_w = ctrl->config.feed_in_limit;
+    snap->pv_capacity_w = ctrl->pv_system.total_capacity;
+    snap->grid_available = ctrl->status.grid_available;
+
+    // Irrigation and EV charging are never critical
+    double consumption = ctrl->measurements.load_power_total + ctrl->measurements.irrigation_power +
+                         ctrl->measurements.ev_charging_power;
+    snap->critical_fraction = consumption > 0.0
+        ? fmin(fmax(ctrl->measurements.load_power_critical / consumption, 0.0), 1.0) : 1.0;
+
+    tariff_t tariff = ctrl->tariff;
+    double pv_peak = 0.0;
+
+    for (int s = 0; s < steps; s++) {
+        time_t from = now + (time_t)s * SIM_STEP_S;
+
+        snap->load_w[s] = (float)(controller_forecast_w(NULL, &ctrl->load_manager.forecast, from, from + SIM_STEP_S) +
+                                  loads_plan_power_w(&ctrl->load_manager, from, from + SIM_STEP_S));
+        snap->pv_w[s] = (float)controller_forecast_w(&ctrl->pv_system.forecast, NULL, from, from + SIM_STEP_S);
+        snap->import_price[s] = (float)tariff_import_price(&tariff, from);
+        snap->export_price[s] = (float)tariff_export_price(&tariff, from);
+        if (snap->pv_w[s] > pv_peak) pv_peak = snap->pv_w[s];
+    }
+    snap->load_w[0] = (float)consumption;
+    snap->pv_w[0] = (float)ctrl->measurements.pv_power_total;
+    snap->steps = steps;
+
+    // Sunrise: the first rise of the forecast above a small share of its peak
+    snap->sunrise_step = -1;
+    double threshold = SIM_SUNRISE_FRACTION * pv_peak;
+    for (int s = 1; s < steps && pv_peak > 0.0; s++) {
+        if (snap->pv_w[s] > threshold && snap->pv_w[s - 1] <= threshold) {
+            snap->sunrise_step = s;
+            break;
+        }
+    }
+
+    snap->schedule = ctrl->schedule;
+    return 0;
+}
+
+/* One scenario through the controller's dispatch rules */
+static void sim_scenario(const sim_snapshot_t* snap, const sim_request_t* req, int index, sim_outcome_t* out) {
+    sim_rng_t rng;
+    sim_rng_seed(&rng, req->seed, index);
+
+    double dt_h = SIM_STEP_S / 3600.0;
+    double eta = TARIFF_EFFICIENCY;
+    double kwh_per_w = dt_h / 1000.0;
+    double pv_noise = SIM_PV_SIGMA * sqrt(1.0 - SIM_PV_RHO * SIM_PV_RHO);
+    double load_noise = SIM_LOAD_SIGMA * sqrt(1.0 - SIM_LOAD_RHO * SIM_LOAD_RHO);
+
+    // Anomalies start at zero (step 0 is measured) and their variance grows
+    // towards the stationary one; exp(x - var / 2) keeps the forecast the mean
+    double c = 0.0, c_var = 0.0, l = 0.0, l_var = 0.0;
+
+    // Outage window in steps; a grid that is down now stays down
+    bool random_outages = req->outage_duration_s <= 0.0 && req->outage_rate_per_day > 0.0;
+    double down_from = INFINITY, down_to = -INFINITY;
+    if (!snap->grid_available) {
+        down_from = 0.0;
+        down_to = INFINITY;
+    } else if (req->outage_duration_s > 0.0) {
+        down_from = req->outage_start_s / SIM_STEP_S;
+        down_to = (req->outage_start_s + req->outage_duration_s) / SIM_STEP_S;
+    } else if (random_outages) {
+        down_from = sim_exponential(&rng, 86400.0 / req->outage_rate_per_day) / SIM_STEP_S;
+        down_to = down_from + sim_exponential(&rng, req->outage_mean_s) / SIM_STEP_S;
+    }
+
+    double e = snap->energy_wh;
+    double unserved_wh = 0.0, cost = 0.0;
+    double soc_at_sunrise = -1.0;
+    bool outage = false;
+
+    for (int s = 0; s < snap->steps; s++) {
+        time_t t = snap->start + (time_t)s * SIM_STEP_S;
+
+        if (s > 0) {
+            c = SIM_PV_RHO * c + pv_noise * sim_normal(&rng);
+            c_var = SIM_PV_RHO * SIM_PV_RHO * c_var + pv_noise * pv_noise;
+            l = SIM_LOAD_RHO * l + load_noise * sim_normal(&rng);
+            l_var = SIM_LOAD_RHO * SIM_LOAD_RHO * l_var + load_noise * load_noise;
+        }
+
+        if (random_outages && s >= down_to && snap->grid_available) {
+            down_from = down_to + sim_exponential(&rng, 86400.0 / req->outage_rate_per_day) / SIM_STEP_S;
+            down_to = down_from + sim_exponential(&rng, req->outage_mean_s) / SIM_STEP_S;
+        }
+        bool grid = !(s >= down_from && s < down_to);
+        if (!grid) outage = true;
+
+        double pv = snap->pv_w[s] * exp(c - 0.5 * c_var);
+        if (snap->pv_capacity_w > 0.0 && pv > snap->pv_capacity_w) pv = snap->pv_capacity_w;
+        double load = snap->load_w[s] * exp(l - 0.5 * l_var);
+        double net = load - pv;
+
+        double max_discharge = fmin(snap->max_discharge_w, fmax(e - snap->min_energy_wh, 0.0) * eta / dt_h);
+        double max_charge = fmin(snap->max_charge_w, fmax(snap->max_energy_wh - e, 0.0) / eta / dt_h);
+        double battery = net;
+
+        if (grid) {
+            int slot = tariff_schedule_slot(&snap->schedule, t);
+            if (slot >= 0)
+                battery = tariff_schedule_setpoint(&snap->schedule, slot, t, e, snap->capacity_wh, net);
+            // The battery makes up what the import limit will not carry
+            if (net - battery > snap->import_limit_w) battery = net - snap->import_limit_w;
+        }
+        battery = fmin(fmax(battery, -max_charge), max_discharge);
+        e -= battery > 0.0 ? battery * dt_h / eta : battery * dt_h * eta;
+
+        // Shed everything non-critical before critical load goes unserved:
+        // islanded the whole deficit, grid-connected what is above the
+        // import limit
+        double deficit = net - battery;
+        double sheddable = load * (1.0 - snap->critical_fraction);
+
+        if (grid) {
+            double g = fmin(deficit, snap->import_limit_w);
+            deficit -= g;
+            if (g > 0.0) {
+                cost += g * snap->import_price[s] * kwh_per_w;
+            } else {
+                double paid = fmin(-g, snap->export_limit_w);
+                if (snap->feed_in_limit_w > 0.0) paid = fmin(paid, snap->feed_in_limit_w);
+                cost -= paid * snap->export_price[s] * kwh_per_w;
+            }
+        }
+        if (deficit > sheddable) unserved_wh += (deficit - sheddable) * dt_h;
+
+        if (s + 1 == snap->sunrise_step) soc_at_sunrise = e / snap->capacity_wh * 100.0;
+    }
+
+    if (soc_at_sunrise < 0.0) soc_at_sunrise = e / snap->capacity_wh * 100.0;
+
+    out->soc_at_sunrise = (float)soc_at_sunrise;
+    out->unserved_critical_wh = (float)unserved_wh;
+    out->cost = (float)cost;
+    out->outage = outage;
+}
+
+/* Take up to SIM_CHUNK scenarios from the front of a range */
+static bool sim_take(sim_range_t* range, int* from, int* to) {
+    bool ok = false;
+
+    pthread_mutex_lock(&range->lock);
+    if (range->next < range->end) {
+        *from = range->next;
+        *to = range->next + SIM_CHUNK < range->end ? range->next + SIM_CHUNK : range->end;
+        range->next = *to;
+        ok = true;
+    }
+    pthread_mutex_unlock(&range->lock);
+    return ok;
+}
+
+/* Move the back half of another worker's range into our own */
+static bool sim_steal(sim_pool_t* pool, int self) {
+    for (int k = 1; k < pool->threads; k++) {
+        sim_range_t* victim = &pool->ranges[(self + k) % pool->threads];
+        int from = 0, to = 0;
+
+        pthread_mutex_lock(&victim->lock);
+        int left = victim->end - victim->next;
+        if (left > 0) {
+            to = victim->end;
+            from = to - (left + 1) / 2;
+            victim->end = from;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if (to > from) {
+            sim_range_t* own = &pool->ranges[self];
+            pthread_mutex_lock(&own->lock);
+            own->next = from;
+            own->end = to;
+            pthread_mutex_unlock(&own->lock);
+
+            atomic_fetch_add(&pool->steals, 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void* sim_worker(void* arg) {
+    sim_worker_t* worker = (sim_worker_t*)arg;
+    sim_pool_t* pool = worker->pool;
+    int from, to;
+
+    for (;;) {
+        if (sim_take(&pool->ranges[worker->id], &from, &to)) {
+            for (int i = from; i < to; i++)
+                sim_scenario(pool->snap, pool->req, i, &pool->outcomes[i]);
+        } else if (!sim_steal(pool, worker->id)) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static int sim_compare_float(const void* a, const void* b) {
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+/* Summarise values (sorted in place) */
+static void sim_distribution(float* values, int n, sim_distribution_t* d) {
+    qsort(values, (size_t)n, sizeof(float), sim_compare_float);
+
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) sum += values[i];
+
+    d->mean = sum / n;
+    d->min = values[0];
+    d->p05 = values[(int)(0.05 * (n - 1) + 0.5)];
+    d->p50 = values[(int)(0.50 * (n - 1) + 0.5)];
+    d->p95 = values[(int)(0.95 * (n - 1) + 0.5)];
+    d->max = values[n - 1];
+}
+
+static double sim_elapsed_ms(const struct timespec* since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - since->tv_sec) * 1e3 + (double)(now.tv_nsec - since->tv_nsec) / 1e6;
+}
+
+/* Run the request's scenarios over the snapshot; blocks until all are done */
+int sim_run(const sim_snapshot_t* snap, const sim_request_t* req, sim_result_t* result) {
+    if (!snap || !req || !result) return -1;
+    if (req->scenarios <= 0 || req->scenarios > SIM_MAX_SCENARIOS || snap->steps <= 0) return -1;
+
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    int n = req->scenarios;
+    int threads = req->threads > 0 ? req->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+    if (threads > SIM_MAX_THREADS) threads = SIM_MAX_THREADS;
+    if (threads > (n + SIM_CHUNK - 1) / SIM_CHUNK) threads = (n + SIM_CHUNK - 1) / SIM_CHUNK;
+
+    sim_outcome_t* outcomes = malloc((size_t)n * sizeof(sim_outcome_t));
+    float* values = malloc((size_t)n * sizeof(float));
+    if (!outcomes || !values) {
+        free(outcomes);
+        free(values);
+        return -1;
+    }
+
+    sim_pool_t pool = {
+        .snap = snap,
+        .req = req,
+        .outcomes = outcomes,
+        .threads = threads,
+    };
+    atomic_init(&pool.steals, 0);
+
+    for (int w = 0; w < threads; w++) {
+        pthread_mutex_init(&pool.ranges[w].lock, NULL);
+        pool.ranges[w].next = (int)((long)n * w / threads);
+        pool.ranges[w].end = (int)((long)n * (w + 1) / threads);
+    }
+
+    // The caller is worker 0. A worker that fails to start leaves its range
+    // to be stolen by the others.
+    sim_worker_t workers[SIM_MAX_THREADS];
+    pthread_t tids[SIM_MAX_THREADS];
+    bool started_ok[SIM_MAX_THREADS] = { false };
+
+    for (int w = 0; w < threads; w++) workers[w] = (sim_worker_t){ .pool = &pool, .id = w };
+    for (int w = 1; w < threads; w++)
+        started_ok[w] = pthread_create(&tids[w], NULL, sim_worker, &workers[w]) == 0;
+
+    sim_worker(&workers[0]);
+
+    for (int w = 1; w < threads; w++)
+        if (started_ok[w]) pthread_join(tids[w], NULL);
+    for (int w = 0; w < threads; w++) pthread_mutex_destroy(&pool.ranges[w].lock);
+
+    memset(result, 0, sizeof(*result));
+    result->scenarios = n;
+    result->threads = threads;
+    result->steals = atomic_load(&pool.steals);
+    result->sunrise = snap->sunrise_step >= 0 ? snap->start + (time_t)snap->sunrise_step * SIM_STEP_S : 0;
+
+    int served = 0, outages = 0;
+    for (int i = 0; i < n; i++) {
+        if (outcomes[i].unserved_critical_wh <= 0.0f) served++;
+        if (outcomes[i].outage) outages++;
+    }
+    result->p_critical_served = (double)served / n;
+    result->p_outage = (double)outages / n;
+
+    for (int i = 0; i < n; i++) values[i] = outcomes[i].soc_at_sunrise;
+    sim_distribution(values, n, &result->soc_at_sunrise);
+    for (int i = 0; i < n; i++) values[i] = outcomes[i].unserved_critical_wh;
+    sim_distribution(values, n, &result->unserved_critical_wh);
+    for (int i = 0; i < n; i++) values[i] = outcomes[i].cost;
+    sim_distribution(values, n, &result->cost);
+
+    free(outcomes);
+    free(values);
+
+    result->elapsed_ms = sim_elapsed_ms(&started);
+    LOG_DEBUG("Simulation: %d scenarios x %d steps on %d threads (%d steals) in %.1f ms",
+        n, snap->steps, threads, result->steals, result->elapsed_ms);
+    return 0;
+}
@@ -0,0 +1,216 @@
+#include "solar.h"
+#include "logging.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SOLAR_DEG           (3.14159265358979323846 / 180.0)
+#define SOLAR_J2000_UNIX    946728000.0     // 2000-01-01 12:00 UTC
+#define SOLAR_DIFFUSE_RATIO 0.1             // clear-sky DHI / DNI
+
+static long solar_day_of(time_t t) {
+    long day = (long)(t / 86400);
+    return (t < 0 && t % 86400) ? day - 1 : day;
+}
+
+/* Sun unit vector (east, north, up) for one instant */
+static void solar_position(const solar_site_t* site, double unix_s, double* e, double* n, double* u) {
+    double d = (unix_s - SOLAR_J2000_UNIX) / 86400.0;
+
+    double mean_long = fmod(280.460 + 0.9856474 * d, 360.0);
+    double anomaly = fmod(357.528 + 0.9856003 * d, 360.0) * SOLAR_DEG;
+    double ecl_long = (mean_long + 1.915 * sin(anomaly) + 0.020 * sin(2.0 * anomaly)) * SOLAR_DEG;
+    double obliquity = (23.439 - 0.0000004 * d) * SOLAR_DEG;
+
+    double ra = atan2(cos(obliquity) * sin(ecl_long), cos(ecl_long));
+    double dec = asin(sin(obliquity) * sin(ecl_long));
+
+    double gmst = fmod(18.697374558 + 24.06570982441908 * d, 24.0) * 15.0;
+    double hour_angle = (gmst + site->longitude) * SOLAR_DEG - ra;
+    double lat = site->latitude * SOLAR_DEG;
+
+    *e = -cos(dec) * sin(hour_angle);
+    *n = cos(lat) * sin(dec) - sin(lat) * cos(dec) * cos(hour_angle);
+    *u = sin(lat) * sin(dec) + cos(lat) * cos(dec) * cos(hour_angle);
+}
+
+/* Clear-sky beam normal irradiance: Kasten-Young air mass, Meinel attenuation */
+static double solar_clear_sky_dni(double cos_zenith, double day_of_year) {
+    if (cos_zenith <= 0.0) return 0.0;
+
+    double zenith_deg = acos(cos_zenith) / SOLAR_DEG;
+    double air_mass = 1.0 / (cos_zenith + 0.50572 * pow(96.07995 - zenith_deg, -1.6364));
+    double extraterrestrial = SOLAR_CONSTANT * (1.0 + 0.033 * cos(360.0 * SOLAR_DEG * day_of_year / 365.0));
+
+    return extraterrestrial * pow(0.7, pow(air_mass, 0.678));
+}
+
+void solar_table_build(solar_day_table_t* table, const solar_site_t* site, long day) {
+    if (!table || !site) return;
+
+    double day_of_year = fmod((double)day + 0.5 - 10957.0, 365.2422);  // days since 2000-01-01
+    if (day_of_year < 0.0) day_of_year += 365.2422;
+
+    for (int s = 0; s < SOLAR_TABLE_SLOTS; s++) {
+        double e, n, u;
+        solar_position(site, (double)day * 86400.0 + (double)s * SOLAR_SLOT_SECONDS, &e, &n, &u);
+
+        double dni = solar_clear_sky_dni(u, day_of_year);
+        table->sun_e[s] = (float)e;
+        table->sun_n[s] = (float)n;
+        table->sun_u[s] = (float)u;
+        table->dni[s] = (float)dni;
+        table->dhi[s] = (float)(SOLAR_DIFFUSE_RATIO * dni);
+    }
+
+    table->day = day;
+}
+
+/* Rebuild the table when the UTC day has changed; true if it was rebuilt */
+bool solar_table_refresh(solar_day_table_t* table, const solar_site_t* site, time_t now) {
+    if (!table || !site) return false;
+
+    long day = solar_day_of(now);
+    if (table->day == day) return false;
+
+    solar_table_build(table, site, day);
+    LOG_DEBUG("Solar table rebuilt for day %ld (lat %.2f, lon %.2f)", day, site->latitude, site->longitude);
+    return true;
+}
+
+/* Interpolated sample at the time of day of now; slots past the last one
+ * blend into this day's first (sub-0.5 deg error for adjacent days) */
+void solar_table_sample(const solar_day_table_t* table, time_t now, solar_sample_t* sample) {
+    if (!table || !sample) return;
+
+    long tod = (long)((now - (time_t)table->day * 86400) % 86400);
+    if (tod < 0) tod += 86400;
+    double offset = (double)tod / SOLAR_SLOT_SECONDS;
+
+    int a = (int)offset;
+    if (a >= SOLAR_TABLE_SLOTS) a = SOLAR_TABLE_SLOTS - 1;
+    int b = (a + 1) % SOLAR_TABLE_SLOTS;
+    float w = (float)(offset - a);
+
+    sample->sun_e = table->sun_e[a] + w * (table->sun_e[b] - table->sun_e[a]);
+    sample->sun_n = table->sun_n[a] + w * (table->sun_n[b] - table->sun_n[a]);
+    sample->sun_u = table->sun_u[a] + w * (table->sun_u[b] - table->sun_u[a]);
+    sample->dni = table->dni[a] + w * (table->dni[b] - table->dni[a]);
+    sample->dhi = table->dhi[a] + w * (table->dhi[b] - table->dhi[a]);
+
+    if (sample->sun_u <= 0.0f) {
+        sample->dni = 0.0f;
+        sample->dhi = 0.0f;
+    }
+    sample->ghi = sample->dni * fmaxf(sample->sun_u, 0.0f) + sample->dhi;
+}
+
+double solar_elevation_deg(const solar_sample_t* sample) {
+    if (!sample) return -90.0;
+
+    double u = sample->sun_u;
+    if (u > 1.0) u = 1.0;
+    if (u < -1.0) u = -1.0;
+    return asin(u) / SOLAR_DEG;
+}
+
+int solar_array_alloc(solar_array_t* array, int count) {
+    if (!array || count <= 0) return -1;
+
+    memset(array, 0, sizeof(*array));
+
+    size_t n = (size_t)count;
+    array->normal_e = calloc(n, sizeof(float));
+    array->normal_n = calloc(n, sizeof(float));
+    array->normal_u = calloc(n, sizeof(float));
+    array->sky_view = calloc(n, sizeof(float));
+    array->ground_view = calloc(n, sizeof(float));
+    array->rated_power = calloc(n, sizeof(float));
+    array->temp_coeff = calloc(n, sizeof(float));
+    array->expected = calloc(n, sizeof(float));
+    array->scratch = calloc(n, sizeof(float));
+
+    if (!array->normal_e || !array->normal_n || !array->normal_u || !array->sky_view ||
+        !array->ground_view || !array->rated_power || !array->temp_coeff || !array->expected ||
+        !array->scratch) {
+        LOG_ERROR("Failed to allocate solar model for %d PV strings", count);
+        solar_array_free(array);
+        return -1;
+    }
+
+    array->count = count;
+    return 0;
+}
+
+void solar_array_free(solar_array_t* array) {
+    if (!array) return;
+
+    free(array->normal_e);
+    free(array->normal_n);
+    free(array->normal_u);
+    free(array->sky_view);
+    free(array->ground_view);
+    free(array->rated_power);
+    free(array->temp_coeff);
+    free(array->expected);
+    free(array->scratch);
+    memset(array, 0, sizeof(*array));
+}
+
+void solar_array_set_plane(solar_array_t* array, int index, double tilt_deg, double azimuth_deg,
+                           double albedo, double rated_power, double temp_coeff) {
+    if (!array || index < 0 || index >= array->count) return;
+
+    double tilt = tilt_deg * SOLAR_DEG;
+    double azimuth = azimuth_deg * SOLAR_DEG;
+
+    array->normal_e[index] = (float)(sin(tilt) * sin(azimuth));
+    array->normal_n[index] = (float)(sin(tilt) * cos(azimuth));
+    array->normal_u[index] = (float)cos(tilt);
+    array->sky_view[index] = (float)((1.0 + cos(tilt)) / 2.0);
+    array->ground_view[index] = (float)(albedo * (1.0 - cos(tilt)) / 2.0);
+    array->rated_power[index] = (float)rated_power;
+    array->temp_coeff[index] = (float)temp_coeff;
+}
+
+/* Branch-free pass over the strings; restrict parameters let -O2 vectorize */
+static void solar_evaluate_range(const float* restrict ne, const float* restrict nn, const float* restrict nu,
+                                 const float* restrict sky, const float* restrict ground,
+                                 const float* restrict rated, const float* restrict coeff,
+                                 float* restrict out, int n, solar_sample_t s, float ambient_c) {
+    for (int k = 0; k < n; k++) {
+        float incidence = s.sun_e * ne[k] + s.sun_n * nn[k] + s.sun_u * nu[k];
+        float beam = s.dni * incidence;         // dni >= 0, so the sign is the incidence's
+        beam = beam > 0.0f ? beam : 0.0f;
+        float poa = beam + s.dhi * sky[k] + s.ghi * ground[k];
+        float cell_c = ambient_c + SOLAR_CELL_RISE * poa;
+        float p = rated[k] * (poa / SOLAR_STC_IRRADIANCE) * (1.0f + coeff[k] * (cell_c - 25.0f));
+
+        out[k] = p > 0.0f ? p : 0.0f;
+    }
+}
+
+/* Clear-sky power of every string into array->expected; returns the sum (W) */
+double solar_array_evaluate(solar_array_t* array, const solar_sample_t* sample, double ambient_c) {
+    if (!array || !sample) return 0.0;
+
+    solar_evaluate_range(array->normal_e, array->normal_n, array->normal_u, array->sky_view,
+                         array->ground_view, array->rated_power, array->temp_coeff, array->expected,
+                         array->count, *sample, (float)ambient_c);
+
+    // Summed separately: a float reduction would keep the loop above scalar
+    double total = 0.0;
+    for (int k = 0; k < array->count; k++) total += array->expected[k];
+    return total;
+}
+
+/* Per-string clear-sky power for another instant (forecasting) into the
+ * scratch buffer, leaving the current evaluation intact */
+const float* solar_array_evaluate_at(solar_array_t* array, const solar_sample_t* sample, double ambient_c) {
+    if (!array || !sample) return NULL;
+
+    solar_evaluate_range(array->normal_e, array->normal_n, array->normal_u, array->sky_view,
+                         array->ground_view, array->rated_power, array->temp_coeff, array->scratch,
+                         array->count, *sample, (float)ambient_c);
+    return array->scratch;
+}
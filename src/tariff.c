@@ -0,0 +1,381 @@
+#include "tariff.h"
+#include "clock.h"
+#include "logging.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Scheduler working state for one call */
+typedef struct {
+    const tariff_battery_t* bat;
+    const float* load_w;
+    const float* pv_w;
+    float import_price[TARIFF_SCHEDULE_SLOTS];
+    float export_price[TARIFF_SCHEDULE_SLOTS];
+    double feed_in_limit_w;
+    double level_wh;                        // energy between adjacent levels
+    int charge_levels;                      // largest step up per slot
+    int discharge_levels;                   // largest step down per slot
+    double terminal_price;                  // value of stored energy at the end, per Wh
+    int8_t policy[TARIFF_SCHEDULE_SLOTS][TARIFF_SOC_LEVELS];
+    int path[TARIFF_SCHEDULE_SLOTS + 1];
+} tariff_dp_t;
+
+static bool tariff_period_covers(const tariff_period_t* p, int weekday, double hour) {
+    if (!(p->days & (1u << weekday))) return false;
+    if (p->start_hour < p->end_hour) return hour >= p->start_hour && hour < p->end_hour;
+    return hour >= p->start_hour || hour < p->end_hour;
+}
+
+/* Expand the configured periods into the weekly price table */
+int tariff_apply_config(tariff_t* tariff, const system_config_t* config) {
+    if (!tariff || !config) return -1;
+
+    for (int wd = 0; wd < 7; wd++) {
+        for (int s = 0; s < TARIFF_SLOTS_PER_DAY; s++) {
+            double hour = s * (TARIFF_STEP_S / 3600.0);
+            double import_price = config->grid_import_price;
+            double export_price = config->grid_export_price;
+
+            for (int i = 0; i < config->tariff_period_count && i < CONFIG_MAX_TARIFF_PERIODS; i++) {
+                const tariff_period_t* p = &config->tariff_periods[i];
+                if (!tariff_period_covers(p, wd, hour)) continue;
+
+                import_price = p->import_price;
+                export_price = p->export_price;
+            }
+
+            tariff->import_price[wd * TARIFF_SLOTS_PER_DAY + s] = (float)import_price;
+            tariff->export_price[wd * TARIFF_SLOTS_PER_DAY + s] = (float)export_price;
+        }
+    }
+
+    tariff->demand_charge = config->demand_charge;
+    tariff->feed_in_limit_w = config->feed_in_limit;
+
+    LOG_INFO("Tariff: %d periods, demand charge %.2f/kW, feed-in cap %.0f W",
+        config->tariff_period_count, tariff->demand_charge, tariff->feed_in_limit_w);
+    return 0;
+}
+
+int tariff_init(tariff_t* tariff, const system_config_t* config) {
+    if (!tariff || !config) return -1;
+
+    memset(tariff, 0, sizeof(*tariff));
+    tariff->peak_month = -1;
+    return tariff_apply_config(tariff, config);
+}
+
+/* Table index of t; localtime only runs when t leaves the cached day */
+static int tariff_index(tariff_t* tariff, time_t t) {
+    if (t < tariff->day_start || t >= tariff->day_end) {
+        struct tm local;
+        localtime_r(&t, &local);
+
+        tariff->weekday = local.tm_wday;
+        tariff->month = local.tm_year * 12 + local.tm_mon;
+        long into_day = local.tm_hour * 3600L + local.tm_min * 60L + local.tm_sec;
+
+        local.tm_hour = 0;
+        local.tm_min = 0;
+        local.tm_sec = 0;
+        local.tm_isdst = -1;
+        tariff->day_start = mktime(&local);
+
+        local.tm_mday++;
+        local.tm_hour = 0;
+        local.tm_isdst = -1;
+        tariff->day_end = mktime(&local);
+
+        if (tariff->day_end <= t || tariff->day_start > t) {
+            // mktime could not place local midnight; fall back to a plain day
+            tariff->day_start = t - into_day;
+            tariff->day_end = tariff->day_start + 86400;
+        }
+    }
+
+    long slot = (long)((t - tariff->day_start) / TARIFF_STEP_S);
+    if (slot >= TARIFF_SLOTS_PER_DAY) slot = TARIFF_SLOTS_PER_DAY - 1;   // 25-hour day
+
+    return tariff->weekday * TARIFF_SLOTS_PER_DAY + (int)slot;
+}
+
+double tariff_import_price(tariff_t* tariff, time_t t) {
+    if (!tariff) return 0.0;
+    return tariff->import_price[tariff_index(tariff, t)];
+}
+
+double tariff_export_price(tariff_t* tariff, time_t t) {
+    if (!tariff) return 0.0;
+    return tariff->export_price[tariff_index(tariff, t)];
+}
+
+/* Meter one cycle of grid power (positive = import) */
+void tariff_update(tariff_t* tariff, time_t now, double grid_w) {
+    if (!tariff) return;
+
+    double dt = tariff->last_update ? difftime(now, tariff->last_update) : 0.0;
+    tariff->last_update = now;
+
+    // Long gaps (outage of the controller, clock step) are not billed
+    if (dt < 0.0 || dt > TARIFF_DEMAND_WINDOW_S) dt = 0.0;
+
+    int idx = tariff_index(tariff, now);
+    tariff->import_price_now = tariff->import_price[idx];
+    tariff->export_price_now = tariff->export_price[idx];
+
+    time_t window = now - now % TARIFF_DEMAND_WINDOW_S;
+    if (window != tariff->window_start) {
+        double demand_w = tariff->window_wh * 3600.0 / TARIFF_DEMAND_WINDOW_S;
+        if (tariff->window_start && demand_w > tariff->month_peak_w) tariff->month_peak_w = demand_w;
+
+        tariff->window_start = window;
+        tariff->window_wh = 0.0;
+    }
+
+    if (tariff->peak_month != tariff->month) {
+        tariff->peak_month = tariff->month;
+        tariff->month_peak_w = 0.0;
+    }
+
+    if (tariff->cost_day != tariff->day_start) {
+        tariff->cost_day = tariff->day_start;
+        tariff->cost_today = 0.0;
+        tariff->import_wh_today = 0.0;
+        tariff->export_wh_today = 0.0;
+    }
+
+    double wh = fabs(grid_w) * dt / 3600.0;
+
+    if (grid_w > 0.0) {
+        tariff->window_wh += wh;
+        tariff->import_wh_today += wh;
+        tariff->cost_today += wh / 1000.0 * tariff->import_price[idx];
+    } else if (grid_w < 0.0) {
+        double paid_w = tariff->feed_in_limit_w > 0.0 ? fmin(-grid_w, tariff->feed_in_limit_w) : -grid_w;
+
+        tariff->export_wh_today += wh;
+        tariff->cost_today -= paid_w * dt / 3600.0 / 1000.0 * tariff->export_price[idx];
+    }
+}
+
+/* Battery power (W, positive = discharge) of a step of k levels in one slot */
+static double tariff_step_power(const tariff_dp_t* dp, int k) {
+    double tau = TARIFF_STEP_S / 3600.0;
+
+    if (k >= 0) return -k * dp->level_wh / (TARIFF_EFFICIENCY * tau);
+    return -k * dp->level_wh * TARIFF_EFFICIENCY / tau;
+}
+
+/* Energy cost of slot t with the battery at battery_w, import above cap
+ * paid at a penalty; wear is included */
+static double tariff_slot_cost(const tariff_dp_t* dp, int t, int k, double import_cap_w) {
+    double kwh_per_w = TARIFF_STEP_S / 3600.0 / 1000.0;
+    double grid = dp->load_w[t] - dp->pv_w[t] - tariff_step_power(dp, k);
+    double cost = abs(k) * dp->level_wh / 1000.0 * TARIFF_WEAR_COST;
+
+    if (grid > 0.0) {
+        double over = fmax(grid - import_cap_w, 0.0);
+        return cost + (grid * dp->import_price[t] + over * TARIFF_OVER_LIMIT_COST) * kwh_per_w;
+    }
+
+    // Surplus beyond the export limit is curtailed, beyond the feed-in cap unpaid
+    double paid = fmin(-grid, dp->bat->export_limit_w);
+    if (dp->feed_in_limit_w > 0.0) paid = fmin(paid, dp->feed_in_limit_w);
+
+    return cost - paid * dp->export_price[t] * kwh_per_w;
+}
+
+/* Backward recursion for one import cap, then the path from first_level */
+static void tariff_dp_solve(tariff_dp_t* dp, double import_cap_w, int first_level) {
+    double value[TARIFF_SOC_LEVELS], next[TARIFF_SOC_LEVELS];
+    double step_cost[2 * TARIFF_SOC_LEVELS];
+    int kd = dp->discharge_levels, kc = dp->charge_levels;
+
+    for (int i = 0; i < TARIFF_SOC_LEVELS; i++)
+        next[i] = -i * dp->level_wh * dp->terminal_price;
+
+    for (int t = TARIFF_SCHEDULE_SLOTS - 1; t >= 0; t--) {
+        // The slot cost depends only on the step, not on the level
+        for (int k = -kd; k <= kc; k++)
+            step_cost[k + kd] = tariff_slot_cost(dp, t, k, import_cap_w);
+
+        for (int i = 0; i < TARIFF_SOC_LEVELS; i++) {
+            int k_lo = -i > -kd ? -i : -kd;
+            int k_hi = TARIFF_SOC_LEVELS - 1 - i < kc ? TARIFF_SOC_LEVELS - 1 - i : kc;
+            double best = INFINITY;
+            int best_k = 0;
+
+            for (int k = k_lo; k <= k_hi; k++) {
+                double v = step_cost[k + kd] + next[i + k];
+                if (v < best) {
+                    best = v;
+                    best_k = k;
+                }
+            }
+
+            value[i] = best;
+            dp->policy[t][i] = (int8_t)best_k;
+        }
+
+        memcpy(next, value, sizeof(next));
+    }
+
+    dp->path[0] = first_level;
+    for (int t = 0; t < TARIFF_SCHEDULE_SLOTS; t++)
+        dp->path[t + 1] = dp->path[t] + dp->policy[t][dp->path[t]];
+}
+
+/* True cost of the current path: energy at the grid limit, demand charge
+ * on the increase of this month's peak, stored energy at the end credited */
+static double tariff_path_cost(const tariff_dp_t* dp, const tariff_t* tariff, double* peak_w) {
+    double cost = 0.0, peak = 0.0;
+
+    for (int t = 0; t < TARIFF_SCHEDULE_SLOTS; t++) {
+        int k = dp->path[t + 1] - dp->path[t];
+        double grid = dp->load_w[t] - dp->pv_w[t] - tariff_step_power(dp, k);
+
+        cost += tariff_slot_cost(dp, t, k, dp->bat->import_limit_w);
+        if (grid > peak) peak = grid;
+    }
+
+    cost += tariff->demand_charge * fmax(peak - tariff->month_peak_w, 0.0) / 1000.0;
+    cost -= dp->path[TARIFF_SCHEDULE_SLOTS] * dp->level_wh * dp->terminal_price;
+
+    if (peak_w) *peak_w = peak;
+    return cost;
+}
+
+/* Plan battery energy over the next TARIFF_SCHEDULE_SLOTS slots from start
+ * (aligned to TARIFF_STEP_S); load_w and pv_w are slot averages */
+int tariff_schedule_battery(tariff_t* tariff, const tariff_battery_t* bat, const float* load_w,
+                            const float* pv_w, time_t start, tariff_schedule_t* schedule)
+{
+    if (!tariff || !bat || !load_w || !pv_w || !schedule) return -1;
+
+    schedule->valid = false;
+
+    double span_wh = bat->max_energy_wh - bat->min_energy_wh;
+    if (span_wh < TARIFF_SOC_LEVELS || bat->capacity_wh <= 0.0) return -1;
+
+    static _Thread_local tariff_dp_t dp;
+    double tau = TARIFF_STEP_S / 3600.0;
+
+    dp.bat = bat;
+    dp.load_w = load_w;
+    dp.pv_w = pv_w;
+    dp.feed_in_limit_w = tariff->feed_in_limit_w;
+    dp.level_wh = span_wh / (TARIFF_SOC_LEVELS - 1);
+
+    // Round to the nearest whole step, but let a slow battery move at least one
+    dp.charge_levels = (int)lround(fmax(bat->max_charge_w, 0.0) * TARIFF_EFFICIENCY * tau / dp.level_wh);
+    dp.discharge_levels = (int)lround(fmax(bat->max_discharge_w, 0.0) * tau / TARIFF_EFFICIENCY / dp.level_wh);
+    if (dp.charge_levels == 0 && bat->max_charge_w > 0.0) dp.charge_levels = 1;
+    if (dp.discharge_levels == 0 && bat->max_discharge_w > 0.0) dp.discharge_levels = 1;
+    if (dp.charge_levels > TARIFF_SOC_LEVELS - 1) dp.charge_levels = TARIFF_SOC_LEVELS - 1;
+    if (dp.discharge_levels > TARIFF_SOC_LEVELS - 1) dp.discharge_levels = TARIFF_SOC_LEVELS - 1;
+
+    double min_price = INFINITY, unshaved_peak = 0.0;
+    for (int t = 0; t < TARIFF_SCHEDULE_SLOTS; t++) {
+        time_t slot_start = start + (time_t)t * TARIFF_STEP_S;
+
+        dp.import_price[t] = (float)tariff_import_price(tariff, slot_start);
+        dp.export_price[t] = (float)tariff_export_price(tariff, slot_start);
+        if (dp.import_price[t] < min_price) min_price = dp.import_price[t];
+        if (load_w[t] - pv_w[t] > unshaved_peak) unshaved_peak = load_w[t] - pv_w[t];
+    }
+    dp.terminal_price = TARIFF_EFFICIENCY * min_price / 1000.0;
+
+    long first = lround((bat->energy_wh - bat->min_energy_wh) / dp.level_wh);
+    int first_level = first < 0 ? 0 : first > TARIFF_SOC_LEVELS - 1 ? TARIFF_SOC_LEVELS - 1 : (int)first;
+
+    // Cost of leaving the battery idle, for the savings figure
+    for (int t = 0; t <= TARIFF_SCHEDULE_SLOTS; t++) dp.path[t] = first_level;
+    double idle_cost = tariff_path_cost(&dp, tariff, NULL);
+
+    // Without a demand charge to trade against, one pass at the grid limit
+    int caps = (tariff->demand_charge > 0.0 && unshaved_peak > tariff->month_peak_w) ? TARIFF_DEMAND_CAPS : 1;
+    double best_cost = INFINITY, best_cap = bat->import_limit_w;
+
+    for (int j = 0; j < caps; j++) {
+        double cap = caps == 1 ? bat->import_limit_w
+                               : tariff->month_peak_w + (unshaved_peak - tariff->month_peak_w) * j / (caps - 1);
+        if (cap > bat->import_limit_w) cap = bat->import_limit_w;
+
+        tariff_dp_solve(&dp, cap, first_level);
+        double cost = tariff_path_cost(&dp, tariff, NULL);
+
+        if (cost < best_cost) {
+            best_cost = cost;
+            best_cap = cap;
+        }
+    }
+
+    // Re-run the winner to recover its path
+    if (caps > 1) tariff_dp_solve(&dp, best_cap, first_level);
+
+    for (int t = 0; t < TARIFF_SCHEDULE_SLOTS; t++) {
+        int k = dp.path[t + 1] - dp.path[t];
+        double energy = bat->min_energy_wh + dp.path[t + 1] * dp.level_wh;
+
+        schedule->soc[t] = (float)(energy / bat->capacity_wh * 100.0);
+        schedule->battery_w[t] = (float)tariff_step_power(&dp, k);
+        schedule->grid_w[t] = load_w[t] - pv_w[t] - schedule->battery_w[t];
+    }
+
+    schedule->start = start;
+    schedule->created = clock_now();
+    schedule->import_cap_w = best_cap;
+    schedule->cost = best_cost + dp.path[TARIFF_SCHEDULE_SLOTS] * dp.level_wh * dp.terminal_price;
+    schedule->savings = idle_cost - best_cost;
+    schedule->valid = true;
+    return 0;
+}
+
+/* Slot of the schedule covering now, -1 when there is none */
+int tariff_schedule_slot(const tariff_schedule_t* schedule, time_t now) {
+    if (!schedule || !schedule->valid || now < schedule->start) return -1;
+
+    long h = (long)((now - schedule->start) / TARIFF_STEP_S);
+    return h < TARIFF_SCHEDULE_SLOTS ? (int)h : -1;
+}
+
+/* Battery setpoint (W, positive = discharge) that follows the schedule:
+ * cover the net load, but never past the SOC target for the end of the slot;
+ * charge from the grid when the target is above where the net load would
+ * leave the battery, and discharge beyond the load only in slots scheduled
+ * to export */
+double tariff_schedule_setpoint(const tariff_schedule_t* schedule, int slot, time_t now, double energy_wh,
+                                double capacity_wh, double net_load_w)
+{
+    if (!schedule || slot < 0 || slot >= TARIFF_SCHEDULE_SLOTS) return net_load_w;
+
+    time_t slot_end = schedule->start + (time_t)(slot + 1) * TARIFF_STEP_S;
+    double remaining_s = fmax((double)(slot_end - now), TARIFF_TRACK_MIN_S);
+    double target_wh = schedule->soc[slot] / 100.0 * capacity_wh;
+    double track_w = (energy_wh - target_wh) * 3600.0 / remaining_s;
+
+    if (schedule->battery_w[slot] > 0.0f && schedule->grid_w[slot] < 0.0f)
+        return fmax(track_w, net_load_w);
+    return fmin(track_w, net_load_w);
+}
+
+void tariff_log_status(tariff_t* tariff, const tariff_schedule_t* schedule) {
+    if (!tariff) return;
+
+    time_t now = clock_now();
+
+    printf("=== Tariff Status ===\n");
+    printf("Import Price: %.3f /kWh, Export Price: %.3f /kWh\n",
+           tariff_import_price(tariff, now), tariff_export_price(tariff, now));
+    printf("Today: %.2f kWh in, %.2f kWh out, cost %.2f\n",
+           tariff->import_wh_today / 1000.0, tariff->export_wh_today / 1000.0, tariff->cost_today);
+    printf("Month Peak Demand: %.0f W (charge %.2f /kW)\n", tariff->month_peak_w, tariff->demand_charge);
+
+    int slot = tariff_schedule_slot(schedule, now);
+    if (slot >= 0)
+        printf("Schedule: SOC target %.1f%%, battery %.0f W, import cap %.0f W, saves %.2f over 24 h\n",
+               schedule->soc[slot], schedule->battery_w[slot], schedule->import_cap_w, schedule->savings);
+    printf("=====================\n");
+}
@@ -0,0 +1,346 @@
+#include "twin.h"
+#include "clock.h"
+#include "hal_sim.h"
+#include "hal_pv.h"
+#include "hal_battery.h"
+#include "hal_meter.h"
+#include "hal_relay.h"
+#include "logging.h"
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+// Claim the simulated devices the way the HAL setup claims real ones
+static int twin_claim_devices(twin_t* twin) {
+    pv_inverter_config_t pv_cfg;
+    battery_config_t bat_cfg;
+    meter_config_t meter_cfg;
+    relay_config_t relay_cfg;
+
+    memset(&pv_cfg, 0, sizeof(pv_cfg));
+    for (uint32_t i = 0; i < hal_sim_inverter_count(); i++) {
+        if (hal_pv_init_inverter(&pv_cfg, &twin->inverter_ids[twin->inverter_count]) != HAL_SUCCESS) return -1;
+        twin->inverter_count++;
+    }
+
+    memset(&bat_cfg, 0, sizeof(bat_cfg));
+    for (uint32_t i = 0; i < hal_sim_battery_count(); i++) {
+        if (hal_battery_init(&bat_cfg, &twin->battery_ids[twin->battery_count]) != HAL_SUCCESS) return -1;
+        twin->battery_count++;
+    }
+
+    memset(&meter_cfg, 0, sizeof(meter_cfg));
+    meter_cfg.measurement_type = METER_MEASUREMENT_GRID;
+    if (hal_meter_init(&meter_cfg, &twin->grid_meter) != HAL_SUCCESS) return -1;
+    meter_cfg.measurement_type = METER_MEASUREMENT_LOAD;
+    if (hal_meter_init(&meter_cfg, &twin->load_meter) != HAL_SUCCESS) return -1;
+
+    memset(&relay_cfg, 0, sizeof(relay_cfg));
+    relay_cfg.channel_count = HAL_SIM_RELAY_CHANNELS;
+    for (uint32_t i = 0; i < hal_sim_relay_module_count(); i++) {
+        if (hal_relay_init_module(&relay_cfg, &twin->relay_modules[twin->relay_module_count]) != HAL_SUCCESS) return -1;
+        twin->relay_module_count++;
+    }
+
+    return 0;
+}
+
+// MPPT worker read hook: the inverter's DC side as of the last plant step
+static int twin_mppt_read(void* ctx, int inverter, double* dc_voltage, double* dc_power) {
+    twin_t* twin = (twin_t*)ctx;
+    int rc = -1;
+
+    if (inverter < 0 || inverter >= twin->inverter_count) return -1;
+
+    pthread_mutex_lock(&twin->dc_lock);
+    if (twin->dc_valid[inverter]) {
+        *dc_voltage = twin->dc_voltage[inverter];
+        *dc_power = twin->dc_power[inverter];
+        rc = 0;
+    }
+    pthread_mutex_unlock(&twin->dc_lock);
+    return rc;
+}
+
+// One worker per plant inverter. The plant's inverters track internally, so
+// the workers take no voltage setpoint.
+static void twin_start_mppt(twin_t* twin) {
+    system_controller_t* ctrl = twin->ctrl;
+    pv_mppt_io_t io = { .read = twin_mppt_read, .set_voltage = NULL, .ctx = twin };
+
+    if (twin->inverter_count == 0) return;
+
+    if (pv_mppt_start(&twin->mppt, twin->inverter_count, ctrl->config.pv_mppt_rate_hz,
+                      ctrl->pv_system.mppt_algorithm, ctrl->pv_system.strings[0].max_voltage, &io) != 0) {
+        LOG_WARNING("Digital twin: MPPT workers unavailable, PV read once per cycle");
+        return;
+    }
+
+    twin->mppt_running = true;
+    pv_attach_mppt(&ctrl->pv_system, &twin->mppt);
+}
+
+// Build the plant from the controller's nameplate data and attach it to the HAL.
+// Switches the control clock to virtual time, starting now, unless the caller
+// already did.
+int twin_init(twin_t* twin, system_controller_t* ctrl, uint64_t seed) {
+    if (!twin || !ctrl) return -1;
+
+    memset(twin, 0, sizeof(twin_t));
+    twin->ctrl = ctrl;
+    pthread_mutex_init(&twin->dc_lock, NULL);
+
+    if (!clock_is_virtual()) clock_use_virtual((double)time(NULL));
+
+    if (plant_init(&twin->plant, ctrl, seed, clock_now_s()) != 0) {
+        LOG_ERROR("Failed to build the plant model");
+        return -1;
+    }
+
+    if (hal_sim_attach(&twin->plant) != HAL_SUCCESS || twin_claim_devices(twin) != 0) {
+        LOG_ERROR("Failed to attach the plant model to the HAL");
+        hal_sim_detach();
+        plant_free(&twin->plant);
+        pthread_mutex_destroy(&twin->dc_lock);
+        return -1;
+    }
+
+    // The controller was set up on the system clock; restart its timing on the virtual one
+    ctrl->last_control_cycle = 0;
+    ctrl->statistics.stats_start_time = clock_now();
+
+    // Cell and string telemetry start from the plant, not from estimates
+    for (int b = 0; b < MAX_BATTERY_BANKS; b++) battery_cells_clear(&ctrl->battery_system.cells, b);
+
+    twin_start_mppt(twin);
+
+    LOG_INFO("Digital twin: %d inverters, %d battery banks, %d load channels",
+        twin->inverter_count, twin->battery_count, twin->plant.load_count);
+
+    return 0;
+}
+
+// Previous cycle's commands to the devices
+static void twin_send_commands(twin_t* twin) {
+    const system_controller_t* ctrl = twin->ctrl;
+    const control_commands_t* cmd = &ctrl->commands;
+
+    for (int b = 0; b < twin->battery_count; b++) {
+        double setpoint = cmd->battery_bank_setpoint[b];
+        double voltage = ctrl->battery_system.bank_state[b].voltage;
+        battery_command_t bat_cmd;
+
+        memset(&bat_cmd, 0, sizeof(bat_cmd));
+        bat_cmd.enable_charge = true;
+        bat_cmd.enable_discharge = true;
+
+        // An idle bank gets an explicit zero, not the previous current
+        if (fabs(setpoint) > 0.1 && voltage > 0.0) {
+            if (setpoint > 0.0) {
+                bat_cmd.enable_charge = false;
+                bat_cmd.discharge_current = (float)(setpoint / voltage);
+            } else {
+                bat_cmd.enable_discharge = false;
+                bat_cmd.charge_current = (float)(-setpoint / voltage);
+            }
+        }
+
+        hal_battery_send_command(twin->battery_ids[b], &bat_cmd);
+    }
+
+    // The limit is always sent so lifting a curtailment takes effect
+    float limit = cmd->pv_curtail ? (float)(100.0 - cmd->pv_curtail_percent) : 100.0f;
+    for (int i = 0; i < twin->inverter_count; i++)
+        hal_pv_set_power_limit(twin->inverter_ids[i], fminf(fmaxf(limit, 0.0f), 100.0f));
+
+    for (int i = 0; i < twin->plant.load_count; i++) {
+        bool on = !cmd->load_shed[i] && ctrl->load_manager.load_states[i] == LOAD_STATE_ON;
+        hal_relay_set_state(twin->relay_modules[i / HAL_SIM_RELAY_CHANNELS], (uint8_t)(i % HAL_SIM_RELAY_CHANNELS),
+                            on ? RELAY_STATE_ON : RELAY_STATE_OFF);
+    }
+}
+
+static void twin_read_pv(twin_t* twin, system_measurements_t* meas) {
+    pv_inverter_measurement_t pv_meas;
+    float voltage[PLANT_STRINGS_REPORTED];
+    float current[PLANT_STRINGS_REPORTED];
+    int read = 0;
+
+    meas->pv_power_total = 0.0;
+    meas->pv_strings_active = 0;
+
+    for (int i = 0; i < twin->inverter_count; i++) {
+        bool ok = hal_pv_get_measurements(twin->inverter_ids[i], &pv_meas) == HAL_SUCCESS;
+
+        pthread_mutex_lock(&twin->dc_lock);
+        twin->dc_valid[i] = ok;
+        if (ok) {
+            twin->dc_voltage[i] = pv_meas.dc_voltage;
+            twin->dc_power[i] = pv_meas.dc_power;
+        }
+        pthread_mutex_unlock(&twin->dc_lock);
+
+        if (!ok) continue;
+        read++;
+
+        meas->pv_power_total += pv_meas.ac_power;
+        if (i < MAX_PV_STRINGS) {
+            meas->pv_voltage[i] = pv_meas.dc_voltage;
+            meas->pv_current[i] = pv_meas.dc_current;
+        }
+        meas->pv_strings_active += pv_meas.string_count;
+
+        for (uint8_t s = 0; s < pv_meas.string_count && s < PLANT_STRINGS_REPORTED; s++) {
+            voltage[s] = pv_meas.strings[s].voltage;
+            current[s] = pv_meas.strings[s].current;
+        }
+        pv_strings_ingest(&twin->ctrl->pv_system.telemetry, i, voltage, current,
+                          pv_meas.string_count, pv_meas.timestamp);
+    }
+
+    // With workers running, PV power is theirs to report
+    if (read > 0 && !twin->mppt_running) meas->measured |= MEASURED_PV;
+}
+
+// Pack values accumulate over the banks; EMS current is positive on charge
+static void twin_read_batteries(twin_t* twin, system_measurements_t* meas) {
+    static battery_cell_t hal_cells[BATTERY_CELLS_MAX_PER_BANK];
+    static float voltage[BATTERY_CELLS_MAX_PER_BANK];
+    static float temperature[BATTERY_CELLS_MAX_PER_BANK];
+    battery_cells_t* cells = &twin->ctrl->battery_system.cells;
+    battery_measurement_t bat_meas;
+    double soc_ah = 0.0, capacity_ah = 0.0;
+    int read = 0;
+
+    meas->battery_power = 0.0;
+    meas->battery_current = 0.0;
+    meas->battery_temp = 0.0;
+    meas->battery_bank_count = 0;
+
+    for (int b = 0; b < twin->battery_count; b++) {
+        uint32_t id = twin->battery_ids[b];
+        if (hal_battery_get_measurements(id, &bat_meas) != HAL_SUCCESS) continue;
+        read++;
+
+        double bank_current = -bat_meas.current;
+        meas->battery_power += bat_meas.power;
+        meas->battery_current += bank_current;
+        meas->battery_voltage = bat_meas.voltage;
+        if (bat_meas.temperature > meas->battery_temp) meas->battery_temp = bat_meas.temperature;
+
+        meas->battery_bank_voltage[b] = bat_meas.voltage;
+        meas->battery_bank_current[b] = bank_current;
+        meas->battery_bank_temp[b] = bat_meas.temperature;
+        meas->battery_bank_count = (uint8_t)(b + 1);
+
+        // BMS SOC seeds the estimator; after that it tracks on its own
+        soc_ah += bat_meas.soc * twin->plant.banks[b].capacity_ah;
+        capacity_ah += twin->plant.banks[b].capacity_ah;
+
+        uint16_t count = BATTERY_CELLS_MAX_PER_BANK;
+        if (hal_battery_get_cell_info(id, hal_cells, &count) != HAL_SUCCESS) {
+            battery_cells_clear(cells, b);
+            continue;
+        }
+        for (uint16_t c = 0; c < count; c++) {
+            voltage[c] = hal_cells[c].voltage;
+            temperature[c] = hal_cells[c].temperature;
+        }
+        battery_cells_ingest(cells, b, voltage, temperature, count, bat_meas.timestamp);
+    }
+
+    if (capacity_ah > 0.0 && twin->ctrl->battery_system.last_update_ts == 0) meas->battery_soc = soc_ah / capacity_ah;
+    if (read > 0) meas->measured |= MEASURED_BATTERY;
+}
+
+static void twin_read_meters(twin_t* twin, system_measurements_t* meas) {
+    meter_measurement_t meter_meas;
+
+    if (hal_meter_get_measurements(twin->load_meter, &meter_meas) == HAL_SUCCESS) {
+        meas->load_power_total = meter_meas.power_total;
+        meas->measured |= MEASURED_LOADS;
+    }
+
+    // Signed as the EMS counts it: positive = import
+    if (hal_meter_get_measurements(twin->grid_meter, &meter_meas) == HAL_SUCCESS) {
+        meas->grid_power = meter_meas.power_total;
+        meas->grid_voltage = meter_meas.voltage_avg;
+        meas->grid_frequency = meter_meas.frequency;
+        meas->measured |= MEASURED_GRID;
+    }
+}
+
+// One control cycle in closed loop with the plant
+// Take the grid down at the next local hour of day (0-24) for duration_s
+int twin_schedule_outage(twin_t* twin, double hour, double duration_s) {
+    if (!twin || hour < 0.0 || hour >= 24.0 || duration_s <= 0.0) return -1;
+
+    time_t now = clock_now();
+    struct tm tm_info;
+    localtime_r(&now, &tm_info);
+
+    int minutes = (int)(hour * 60.0 + 0.5);
+    tm_info.tm_hour = minutes / 60;
+    tm_info.tm_min = minutes % 60;
+    tm_info.tm_sec = 0;
+    tm_info.tm_isdst = -1;
+
+    time_t from = mktime(&tm_info);
+    if (from <= now) {
+        tm_info.tm_mday++;
+        tm_info.tm_isdst = -1;
+        from = mktime(&tm_info);
+    }
+
+    twin->outage_from = (double)from;
+    twin->outage_to = (double)from + duration_s;
+
+    char at[32];
+    strftime(at, sizeof(at), "%Y-%m-%d %H:%M", localtime_r(&from, &tm_info));
+    LOG_INFO("Digital twin: grid outage scheduled at %s for %.1f h", at, duration_s / 3600.0);
+    return 0;
+}
+
+int twin_step(twin_t* twin) {
+    if (!twin || !twin->ctrl) return -1;
+
+    system_controller_t* ctrl = twin->ctrl;
+    system_measurements_t* meas = &ctrl->measurements;
+
+    twin_send_commands(twin);
+    plant_set_external_load(&twin->plant, meas->irrigation_power + meas->ev_charging_power);
+
+    clock_advance(ctrl->control_interval);
+
+    if (twin->outage_to > 0.0) {
+        double t = clock_now_s();
+        plant_set_grid(&twin->plant, t < twin->outage_from || t >= twin->outage_to);
+        if (t >= twin->outage_to) twin->outage_to = 0.0;
+    }
+    plant_step(&twin->plant, clock_now_s());
+
+    meas->measured = 0;
+    twin_read_pv(twin, meas);
+    twin_read_batteries(twin, meas);
+    twin_read_meters(twin, meas);
+    meas->timestamp = clock_now();
+
+    twin->steps++;
+    return controller_run_cycle(ctrl);
+}
+
+void twin_free(twin_t* twin) {
+    if (!twin) return;
+
+    if (twin->mppt_running) {
+        if (twin->ctrl) pv_attach_mppt(&twin->ctrl->pv_system, NULL);
+        pv_mppt_stop(&twin->mppt);
+        twin->mppt_running = false;
+    }
+    pthread_mutex_destroy(&twin->dc_lock);
+
+    hal_sim_detach();
+    plant_free(&twin->plant);
+    if (twin->ctrl) twin->ctrl->measurements.measured = 0;
+    twin->ctrl = NULL;
+}
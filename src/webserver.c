@@ -36,6 +36,7 @@ static const api_route_t api_routes[] = {
     {"POST", "/api/system/config", api_system_config, ROLE_ADMIN, true},
     {"GET", "/api/system/stats", api_system_stats, ROLE_VIEWER, true},
     {"POST", "/api/system/mode", api_system_mode, ROLE_OPERATOR, true},
+    {"POST", "/api/simulate", api_simulate, ROLE_OPERATOR, true},
     
     /* PV API */
     {"GET", "/api/pv/status", api_pv_status, ROLE_VIEWER, true},
@@ -61,6 +62,7 @@ static const api_route_t api_routes[] = {
     
     /* History API */
     {"GET", "/api/history", api_history, ROLE_VIEWER, true},
+    {"GET", "/api/events", api_events, ROLE_VIEWER, true},
     {"GET", "/api/export", api_export_data, ROLE_ADMIN, true},
     
     /* Auth API */
@@ -10,6 +10,9 @@
 #include <fcntl.h>
 #include "config.h"
 #include "controller.h"
+#include "reload.h"
+#include "dispatch.h"
+#include "twin.h"
 
 /* Configuration */
 typedef struct {
@@ -20,11 +23,20 @@ typedef struct {
     char *pid_file;
     int web_port;
     char *web_root;
+    bool simulate;              // run against the digital twin
+    double sim_speed;           // x real time, 0 = free-running
+    double outage_rate_per_day; // simulated random grid outages
+    double outage_mean_h;       // their mean length, 0 = the plant's default
+    double outage_at_h;         // simulated forced outage: local hour of day
+    double outage_for_h;        // and its length, 0 = none
 } app_config_t;
 
 /* Global instances */
 static volatile sig_atomic_t running = 1;
 static system_controller_t *system_ctrl = NULL;
+static config_reload_t config_reloader;
+static dispatch_worker_t dispatcher;
+static twin_t twin;
 // static webserver_t *web_server = NULL;
 static app_config_t app_config = {
     .config_file = "/etc/energy-mgmt/config.json",
@@ -52,8 +64,10 @@ void handle_shutdown_signal(int sig) {
 }
 
 void handle_reload_signal(int sig) {
-    syslog(LOG_INFO, "Received signal %d, reloading configuration", sig);
-    // TODO: Implement configuration reload
+    (void)sig;
+    // Async-signal-safe: wakes the reload worker, which parses and stages the
+    // new config; the main loop applies it at the next cycle boundary
+    config_reload_request_file(&config_reloader);
 }
 
 /* Daemonize process */
@@ -122,7 +136,7 @@ int write_pid_file(const char *pid_file) {
 void parse_arguments(int argc, char *argv[]) {
     int opt;
     
-    while ((opt = getopt(argc, argv, "c:l:dp:f:hw:r:")) != -1) {
+    while ((opt = getopt(argc, argv, "c:l:dp:f:hw:r:s:o:g:")) != -1) {
         switch (opt) {
             case 'c':
                 app_config.config_file = optarg;
@@ -142,6 +156,24 @@ void parse_arguments(int argc, char *argv[]) {
             case 'w':
                 app_config.web_root = optarg;
                 break;
+            case 's':
+                app_config.sim_speed = atof(optarg);
+                app_config.simulate = app_config.sim_speed >= 0.0;
+                break;
+            case 'o':
+                if (sscanf(optarg, "%lf,%lf", &app_config.outage_rate_per_day, &app_config.outage_mean_h) < 1 ||
+                    app_config.outage_rate_per_day < 0.0 || app_config.outage_mean_h < 0.0) {
+                    fprintf(stderr, "Invalid -o %s, expected <per day>[,<mean hours>]\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'g':
+                if (sscanf(optarg, "%lf,%lf", &app_config.outage_at_h, &app_config.outage_for_h) != 2 ||
+                    app_config.outage_at_h < 0.0 || app_config.outage_at_h >= 24.0 || app_config.outage_for_h <= 0.0) {
+                    fprintf(stderr, "Invalid -g %s, expected <hour of day>,<hours>\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
             case 'h':
                 printf("Usage: %s [options]\n", argv[0]);
                 printf("Options:\n");
@@ -151,6 +183,9 @@ void parse_arguments(int argc, char *argv[]) {
                 printf("  -p <port>    Web server port (default: 8080)\n");
                 printf("  -f <file>    PID file\n");
                 printf("  -w <dir>     Web root directory\n");
+                printf("  -s <speed>   Run against the simulated plant at speed x real time (0 = as fast as possible)\n");
+                printf("  -o <n>[,<h>] Simulated grid outages: n per day at random, h hours long on average\n");
+                printf("  -g <hh>,<h>  Simulated grid outage at local hour hh for h hours\n");
                 printf("  -h           Show this help\n");
                 exit(EXIT_SUCCESS);
         }
@@ -225,6 +260,29 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
     
+    if (config_reload_start(&config_reloader, app_config.config_file) == 0) {
+        system_ctrl->reload = &config_reloader;
+    } else {
+        syslog(LOG_WARNING, "Configuration reload unavailable");
+    }
+    
+    if (dispatch_start(&dispatcher) == 0) {
+        system_ctrl->dispatch = &dispatcher;
+    } else {
+        syslog(LOG_WARNING, "Dispatch optimizer unavailable");
+    }
+    
+    if (app_config.simulate && twin_init(&twin, system_ctrl, (uint64_t)time(NULL)) != 0) {
+        syslog(LOG_ERR, "Failed to start the simulated plant");
+        controller_cleanup(system_ctrl);
+        free(system_ctrl);
+        return EXIT_FAILURE;
+    }
+    if (app_config.simulate && app_config.outage_rate_per_day > 0.0)
+        plant_set_outages(&twin.plant, app_config.outage_rate_per_day, app_config.outage_mean_h * 3600.0);
+    if (app_config.simulate && app_config.outage_for_h > 0.0)
+        twin_schedule_outage(&twin, app_config.outage_at_h, app_config.outage_for_h * 3600.0);
+    
     // Setup web server
     // web_server = webserver_create(system_ctrl);
 
@@ -278,8 +336,26 @@ int main(int argc, char *argv[]) {
     uint64_t cycle_count = 0;
     
     while (running) {
+        // Apply a reloaded configuration between cycles
+        system_config_t *reloaded = config_reload_take(&config_reloader);
+
+        controller_lock(system_ctrl);
+        if (reloaded) {
+            if (controller_apply_config(system_ctrl, reloaded) == 0) {
+                syslog(LOG_INFO, "Configuration reloaded");
+                sys_config = *reloaded;
+            } else {
+                syslog(LOG_ERR, "Failed to apply reloaded configuration");
+            }
+            free(reloaded);
+        }
+        
         // Run control cycle
-        controller_run_cycle(system_ctrl);
+        if (app_config.simulate)
+            twin_step(&twin);
+        else
+            controller_run_cycle(system_ctrl);
+        controller_unlock(system_ctrl);
         cycle_count++;
         
         // Send WebSocket updates every second
@@ -296,18 +372,24 @@ int main(int argc, char *argv[]) {
             last_statistics = now;
         }
         
-        // Sleep for control interval
+        // Sleep for control interval, scaled down when simulating
+        double interval = sys_config.control_interval;
+        if (app_config.simulate)
+            interval = app_config.sim_speed > 0.0 ? interval / app_config.sim_speed : 0.0;
         struct timespec ts = {
-            .tv_sec = sys_config.control_interval,
-            .tv_nsec = 0
+            .tv_sec = (time_t)interval,
+            .tv_nsec = (long)((interval - (double)(time_t)interval) * 1e9)
         };
-        nanosleep(&ts, NULL);
+        if (interval > 0.0) nanosleep(&ts, NULL);
     }
     
     // Cleanup
     syslog(LOG_INFO, "Shutting down...");
     
     // if (web_server) webserver_destroy(web_server);
+    config_reload_stop(&config_reloader);
+    dispatch_stop(&dispatcher);
+    if (app_config.simulate) twin_free(&twin);
     if (system_ctrl) {
         controller_cleanup(system_ctrl);
         free(system_ctrl);